@@ -1,7 +1,16 @@
 #include "application.h"
 #include "SDL_events.h"
 #include "commandqueue.h"
+#include "descriptorallocator.h"
+#include "gpuallocator.h"
+#include "fencewatcher.h"
+#include "framecontext.h"
 #include "helpers.h"
+#include "mailbox.h"
+#include "queuefencewaiter.h"
+#include "releasequeue.h"
+#include "timelinetracker.h"
+#include "uploadservice.h"
 #include "window.h"
 #include "clock.h"
 #include <SDL.h>
@@ -28,13 +37,13 @@ static WindowNameMap gs_WindowByName;
 // A wrapper struct to allow shared pointers for the window class.
 struct MakeWindow : public Window
 {
-    MakeWindow(const std::string& windowName, int clientWidth, int clientHeight, bool vSync) :
-        Window(windowName, clientWidth, clientHeight, vSync)
+    MakeWindow(const std::string& windowName, int clientWidth, int clientHeight, bool vSync, bool lowLatency) :
+        Window(windowName, clientWidth, clientHeight, vSync, lowLatency)
     {
     }
 };
 
-Application::Application() :
+Application::Application(uint32_t framesInFlight) :
     m_TearingSupported(false)
 {
     // Windows 10 Creators update adds Per Monitor V2 DPI awareness context.
@@ -59,12 +68,41 @@ Application::Application() :
     }
     if (m_d3d12Device)
     {
-        m_DirectCommandQueue = std::make_shared<CommandQueue>(
-            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+        // The queues wait for each other on the GPU, through one tracker.
+        m_TimelineTracker     = std::make_shared<TimelineTracker>(3);
+        m_DirectCommandQueue  = std::make_shared<CommandQueue>(
+            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_DIRECT, m_TimelineTracker, 0);
         m_ComputeCommandQueue = std::make_shared<CommandQueue>(
-            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COMPUTE);
-        m_CopyCommandQueue = std::make_shared<CommandQueue>(
-            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COPY);
+            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COMPUTE, m_TimelineTracker, 1);
+        m_CopyCommandQueue    = std::make_shared<CommandQueue>(
+            m_d3d12Device, D3D12_COMMAND_LIST_TYPE_COPY, m_TimelineTracker, 2);
+        m_GpuAllocator  = std::make_shared<GpuAllocator>(m_d3d12Device);
+        m_UploadService = std::make_shared<UploadService>(
+            m_GpuAllocator, m_CopyCommandQueue);
+        m_ReleaseQueue = std::make_shared<ReleaseQueue>(m_GpuAllocator);
+
+        // One large heap per type instead of one per view.
+        static const struct
+        {
+            D3D12_DESCRIPTOR_HEAP_TYPE type;
+            uint32_t                   capacity;
+        } descriptorCapacities[] = {
+            { D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 16384 },
+            { D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 2048 },
+            { D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 1024 },
+            { D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 256 },
+        };
+        for (const auto& heap : descriptorCapacities)
+            m_DescriptorAllocators[heap.type] = std::make_shared<DescriptorAllocator>(
+                m_d3d12Device, heap.type, heap.capacity);
+        m_ShaderVisibleHeap = std::make_shared<ShaderVisibleHeap>(
+            m_d3d12Device, 16384, 16384);
+
+        m_FrameContext = std::make_shared<FrameContext>(
+            m_DirectCommandQueue, m_GpuAllocator, m_ShaderVisibleHeap, framesInFlight);
+        m_Mailbox      = std::make_shared<Mailbox>();
+        m_FenceWatcher = std::make_shared<FenceWatcher>(
+            std::make_shared<QueueFenceWaiter>(m_d3d12Device));
 
         m_TearingSupported = CheckTearingSupport();
     }
@@ -219,7 +257,8 @@ std::shared_ptr<Window>
     Application::CreateRenderWindow(const std::string& windowName,
                                     int                clientWidth,
                                     int                clientHeight,
-                                    bool               vSync)
+                                    bool               vSync,
+                                    bool               lowLatency)
 {
     // First check if a window with the given name already exists.
     WindowNameMap::iterator windowIter = gs_WindowByName.find(windowName);
@@ -228,7 +267,7 @@ std::shared_ptr<Window>
         return gs_Windows[windowIter->second];
     }
 
-    WindowPtr pWindow = std::make_shared<MakeWindow>(windowName, clientWidth, clientHeight, vSync);
+    WindowPtr pWindow = std::make_shared<MakeWindow>(windowName, clientWidth, clientHeight, vSync, lowLatency);
 
     gs_Windows.insert(WindowMap::value_type(pWindow->GetWindowId(), pWindow));
     gs_WindowByName.insert(WindowNameMap::value_type(windowName,
@@ -280,8 +319,16 @@ int Application::Run()
     if (!Initialize()) return 1;
     if (!LoadContent()) return 2;
 
+    // Once per rendered frame, events without one do not take a slot.
+    bool waitFrameLatency = true;
     while (m_running = true)
     {
+        if (waitFrameLatency)
+        {
+            if (auto window = GetActiveWindow())
+                window->WaitForFrameLatency();
+            waitFrameLatency = false;
+        }
         m_UpdateClock.Tick();
         SDL_Event event;
         if (SDL_PollEvent(&event))
@@ -309,14 +356,23 @@ int Application::Run()
                 continue;
             }
         }
+        m_Mailbox->Run();
+        m_ReleaseQueue->Retire();
         Update(m_UpdateClock.GetDeltaSeconds(), m_UpdateClock.GetTotalSeconds());
+        // As late as possible, Update runs while the GPU still works on the
+        // frames in flight.
+        m_FrameContext->BeginFrame();
         Render(m_UpdateClock.GetDeltaSeconds(), m_UpdateClock.GetTotalSeconds());
+        m_FrameContext->EndFrame();
+        waitFrameLatency = true;
     }
     // Flush any commands in the commands queues before quiting.
     Flush();
+    m_Mailbox->Run();
 
     UnloadContent();
     CleanUp();
+    m_ReleaseQueue->Retire();
 
     // destroy all the windows
     gs_Windows.clear();
@@ -361,6 +417,48 @@ void Application::Flush()
     m_CopyCommandQueue->Flush();
 }
 
+std::shared_ptr<UploadService> Application::GetUploadService() const
+{
+    return m_UploadService;
+}
+
+std::shared_ptr<GpuAllocator> Application::GetGpuAllocator() const
+{
+    return m_GpuAllocator;
+}
+
+std::shared_ptr<ReleaseQueue> Application::GetReleaseQueue() const
+{
+    return m_ReleaseQueue;
+}
+
+std::shared_ptr<FenceWatcher> Application::GetFenceWatcher() const
+{
+    return m_FenceWatcher;
+}
+
+std::shared_ptr<Mailbox> Application::GetMailbox() const
+{
+    return m_Mailbox;
+}
+
+std::shared_ptr<FrameContext> Application::GetFrameContext() const
+{
+    return m_FrameContext;
+}
+
+std::shared_ptr<DescriptorAllocator>
+    Application::GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE type) const
+{
+    assert(type < D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES && "Invalid descriptor heap type.");
+    return m_DescriptorAllocators[type];
+}
+
+std::shared_ptr<ShaderVisibleHeap> Application::GetShaderVisibleHeap() const
+{
+    return m_ShaderVisibleHeap;
+}
+
 Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>
     Application::CreateDescriptorHeap(UINT                       numDescriptors,
                                       D3D12_DESCRIPTOR_HEAP_TYPE type)
@@ -4,6 +4,7 @@
 #pragma once
 
 #include <memory>
+#include <stdint.h>
 #include <string>
 #include <type_traits>
 #include "helpers.h"
@@ -13,12 +14,23 @@
 class Window;
 class Game;
 class CommandQueue;
+class UploadService;
+class GpuAllocator;
+class ReleaseQueue;
+class TimelineTracker;
+class DescriptorAllocator;
+class ShaderVisibleHeap;
+class FenceWatcher;
+class FrameContext;
+class Mailbox;
 union SDL_Event;
 struct SDL_KeyboardEvent;
 
 class Application
 {
 public:
+    static constexpr uint32_t DefaultFramesInFlight = 2;
+
     /**
      * Create the application singleton with the application instance handle.
      */
@@ -55,6 +67,8 @@ public:
      * refresh rate of the screen.
      * @param windowed If true, the window will be created in windowed mode. If
      * false, the window will be created full-screen.
+     * @param lowLatency Bound the frames queued for display with the frame
+     * latency waitable object of the swapchain, see Window::WaitForFrameLatency.
      * @returns The created window instance. If an error occurred while creating
      * the window an invalid window instance is returned. If a window with the
      * given name already exists, that window will be returned.
@@ -62,7 +76,8 @@ public:
     std::shared_ptr<Window> CreateRenderWindow(const std::string& windowName,
                                                int                clientWidth,
                                                int                clientHeight,
-                                               bool               vSync = true);
+                                               bool               vSync      = true,
+                                               bool               lowLatency = true);
 
     /**
      * Destroy a window given the window name.
@@ -105,6 +120,50 @@ public:
     // Flush all command queues.
     void Flush();
 
+    /**
+     * Get the service batching buffer and texture uploads on the COPY
+     * queue.
+     */
+    std::shared_ptr<UploadService> GetUploadService() const;
+
+    /**
+     * Get the allocator placing resources in shared heaps.
+     */
+    std::shared_ptr<GpuAllocator> GetGpuAllocator() const;
+
+    /**
+     * Get the queue releasing resources once the GPU is done with them.
+     */
+    std::shared_ptr<ReleaseQueue> GetReleaseQueue() const;
+
+    /**
+     * Get the thread calling back when command queue fences complete.
+     */
+    std::shared_ptr<FenceWatcher> GetFenceWatcher() const;
+
+    /**
+     * Get the mailbox drained by the application loop, once per frame.
+     */
+    std::shared_ptr<Mailbox> GetMailbox() const;
+
+    /**
+     * Get the resources of the frames in flight. The current frame is the
+     * one Render records.
+     */
+    std::shared_ptr<FrameContext> GetFrameContext() const;
+
+    /**
+     * Get the allocator of CPU only descriptors of a type, for RTVs, DSVs
+     * and views staged for the shader visible heap.
+     */
+    std::shared_ptr<DescriptorAllocator> GetDescriptorAllocator(
+        D3D12_DESCRIPTOR_HEAP_TYPE type) const;
+
+    /**
+     * Get the CBV_SRV_UAV heap shaders read descriptors from.
+     */
+    std::shared_ptr<ShaderVisibleHeap> GetShaderVisibleHeap() const;
+
     Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>
         CreateDescriptorHeap(UINT                       numDescriptors,
                              D3D12_DESCRIPTOR_HEAP_TYPE type);
@@ -112,8 +171,9 @@ public:
         GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE type) const;
 
 protected:
-    // Create an application instance.
-    Application();
+    // Create an application instance, the CPU runs up to `framesInFlight`
+    // frames ahead of the GPU.
+    explicit Application(uint32_t framesInFlight = DefaultFramesInFlight);
     // Destroy the application instance and all windows associated with this
     // application.
     virtual ~Application();
@@ -149,9 +209,20 @@ private:
     Microsoft::WRL::ComPtr<IDXGIAdapter4> m_dxgiAdapter;
     Microsoft::WRL::ComPtr<ID3D12Device2> m_d3d12Device;
 
+    std::shared_ptr<TimelineTracker> m_TimelineTracker;
     std::shared_ptr<CommandQueue> m_DirectCommandQueue;
     std::shared_ptr<CommandQueue> m_ComputeCommandQueue;
     std::shared_ptr<CommandQueue> m_CopyCommandQueue;
+    std::shared_ptr<GpuAllocator>  m_GpuAllocator;
+    std::shared_ptr<UploadService> m_UploadService;
+    std::shared_ptr<ReleaseQueue>  m_ReleaseQueue;
+    std::shared_ptr<DescriptorAllocator>
+                                       m_DescriptorAllocators[D3D12_DESCRIPTOR_HEAP_TYPE_NUM_TYPES];
+    std::shared_ptr<ShaderVisibleHeap> m_ShaderVisibleHeap;
+    std::shared_ptr<FrameContext>  m_FrameContext;
+    std::shared_ptr<Mailbox>       m_Mailbox;
+    // Last, its thread stops before anything it may call back goes away.
+    std::shared_ptr<FenceWatcher> m_FenceWatcher;
 
     HighResolutionClock m_UpdateClock;
 
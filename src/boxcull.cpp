@@ -0,0 +1,182 @@
+#include "boxcull.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Fewest boxes worth a job of their own.
+constexpr size_t kBoxesPerJob = 16384;
+
+// Per plane, the bound arrays of the corner farthest along its normal.
+struct PlaneCorner
+{
+    const float* x;
+    const float* y;
+    const float* z;
+    glm::vec4    plane;
+};
+
+void SelectCorners(const glm::vec4 planes[6], const BoxesSoA& boxes, PlaneCorner corners[6])
+{
+    for (int p = 0; p < 6; p++)
+    {
+        corners[p].x     = planes[p].x >= 0.0f ? boxes.max_x.data() : boxes.min_x.data();
+        corners[p].y     = planes[p].y >= 0.0f ? boxes.max_y.data() : boxes.min_y.data();
+        corners[p].z     = planes[p].z >= 0.0f ? boxes.max_z.data() : boxes.min_z.data();
+        corners[p].plane = planes[p];
+    }
+}
+
+size_t CullScalar(const PlaneCorner corners[6], size_t begin, size_t end, uint8_t* visible)
+{
+    size_t count = 0;
+    for (size_t i = begin; i < end; i++)
+    {
+        bool outside = false;
+        for (int p = 0; p < 6; p++)
+        {
+            const PlaneCorner& c = corners[p];
+            float              d = c.plane.x * c.x[i] + c.plane.y * c.y[i] + c.plane.z * c.z[i] + c.plane.w;
+            outside              = outside || d < 0.0f;
+        }
+        visible[i] = outside ? 0 : 1;
+        count += visible[i];
+    }
+    return count;
+}
+
+#if PETIT_SIMD_SSE2
+size_t CullSse2(const PlaneCorner corners[6], size_t begin, size_t end, uint8_t* visible)
+{
+    size_t count = 0;
+    size_t i     = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            const PlaneCorner& c = corners[p];
+            __m128             d = _mm_mul_ps(_mm_set1_ps(c.plane.x), _mm_loadu_ps(c.x + i));
+            d                    = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(c.plane.y), _mm_loadu_ps(c.y + i)));
+            d                    = _mm_add_ps(d, _mm_mul_ps(_mm_set1_ps(c.plane.z), _mm_loadu_ps(c.z + i)));
+            d                    = _mm_add_ps(d, _mm_set1_ps(c.plane.w));
+            outside              = _mm_or_ps(outside, _mm_cmplt_ps(d, _mm_setzero_ps()));
+        }
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            visible[i + lane] = ((mask >> lane) & 1) ^ 1;
+            count += visible[i + lane];
+        }
+    }
+    return count + CullScalar(corners, i, end, visible);
+}
+#endif
+
+#if PETIT_SIMD_AVX2
+PETIT_TARGET_AVX2 size_t CullAvx2(const PlaneCorner corners[6], size_t begin, size_t end, uint8_t* visible)
+{
+    size_t count = 0;
+    size_t i     = begin;
+    for (; i + 8 <= end; i += 8)
+    {
+        __m256 outside = _mm256_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            const PlaneCorner& c = corners[p];
+            __m256             d = _mm256_mul_ps(_mm256_set1_ps(c.plane.x), _mm256_loadu_ps(c.x + i));
+            d                    = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(c.plane.y), _mm256_loadu_ps(c.y + i)));
+            d                    = _mm256_add_ps(d, _mm256_mul_ps(_mm256_set1_ps(c.plane.z), _mm256_loadu_ps(c.z + i)));
+            d                    = _mm256_add_ps(d, _mm256_set1_ps(c.plane.w));
+            outside              = _mm256_or_ps(outside, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        int mask = _mm256_movemask_ps(outside);
+        for (int lane = 0; lane < 8; lane++)
+        {
+            visible[i + lane] = ((mask >> lane) & 1) ^ 1;
+            count += visible[i + lane];
+        }
+    }
+    return count + CullScalar(corners, i, end, visible);
+}
+#endif
+
+} // namespace
+
+void BoxesSoA::Resize(size_t count)
+{
+    for (std::vector<float>* bound : { &min_x, &min_y, &min_z, &max_x, &max_y, &max_z })
+        bound->resize(count);
+}
+
+void BoxesSoA::Set(size_t i, const glm::vec3& min, const glm::vec3& max)
+{
+    min_x[i] = min.x;
+    min_y[i] = min.y;
+    min_z[i] = min.z;
+    max_x[i] = max.x;
+    max_y[i] = max.y;
+    max_z[i] = max.z;
+}
+
+BoxCullKernel GetBoxCullKernel()
+{
+#if PETIT_SIMD_AVX2
+    if (CpuHasAvx2())
+        return BoxCullKernel::Avx2;
+#endif
+#if PETIT_SIMD_SSE2
+    return BoxCullKernel::Sse2;
+#else
+    return BoxCullKernel::Scalar;
+#endif
+}
+
+size_t CullBoxes(const glm::vec4 planes[6],
+                 const BoxesSoA&  boxes,
+                 size_t           begin,
+                 size_t           end,
+                 uint8_t*         visible,
+                 BoxCullKernel    kernel)
+{
+    PlaneCorner corners[6];
+    SelectCorners(planes, boxes, corners);
+
+    switch (kernel)
+    {
+#if PETIT_SIMD_AVX2
+        case BoxCullKernel::Avx2:
+            return CullAvx2(corners, begin, end, visible);
+#endif
+#if PETIT_SIMD_SSE2
+        case BoxCullKernel::Sse2:
+            return CullSse2(corners, begin, end, visible);
+#endif
+        default:
+            return CullScalar(corners, begin, end, visible);
+    }
+}
+
+size_t CullBoxes(JobPool& pool, const glm::vec4 planes[6], const BoxesSoA& boxes, uint8_t* visible)
+{
+    size_t count = boxes.size();
+    size_t jobs  = (count + kBoxesPerJob - 1) / kBoxesPerJob;
+    if (jobs <= 1)
+        return CullBoxes(planes, boxes, 0, count, visible);
+
+    BoxCullKernel       kernel = GetBoxCullKernel();
+    std::vector<size_t> visibleCounts(jobs);
+    pool.ParallelFor(jobs, [&](size_t job) {
+        size_t begin       = job * kBoxesPerJob;
+        size_t end         = std::min(begin + kBoxesPerJob, count);
+        visibleCounts[job] = CullBoxes(planes, boxes, begin, end, visible, kernel);
+    });
+
+    size_t total = 0;
+    for (size_t c : visibleCounts)
+        total += c;
+    return total;
+}
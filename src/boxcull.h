@@ -0,0 +1,55 @@
+/**
+ * Frustum culling of many axis aligned boxes.
+ *
+ * The boxes are stored as six float arrays, one per bound and axis, so a
+ * kernel loads the same bound of eight boxes at once with AVX2, or four
+ * with SSE2. A box is outside a plane when its corner farthest along the
+ * plane normal is, the sign of the normal picks the min or max array of
+ * every axis once per plane instead of once per box. The kernels compute
+ * the same products and sums in the same order, so they all agree with the
+ * scalar one.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobPool;
+
+struct BoxesSoA
+{
+    std::vector<float> min_x, min_y, min_z;
+    std::vector<float> max_x, max_y, max_z;
+
+    void   Resize(size_t count);
+    void   Set(size_t i, const glm::vec3& min, const glm::vec3& max);
+    size_t size() const { return min_x.size(); }
+};
+
+enum class BoxCullKernel
+{
+    Scalar,
+    Sse2,
+    Avx2,
+};
+
+// The widest kernel compiled in and supported by the CPU.
+BoxCullKernel GetBoxCullKernel();
+
+/**
+ * Set visible[i] to 1 for the boxes in [begin, end) on the inner side of
+ * every plane, to 0 for the others, and return how many are visible. Planes
+ * as given by ExtractFrustumPlanes, they need not be normalized.
+ */
+size_t CullBoxes(const glm::vec4 planes[6],
+                 const BoxesSoA&  boxes,
+                 size_t           begin,
+                 size_t           end,
+                 uint8_t*         visible,
+                 BoxCullKernel    kernel = GetBoxCullKernel());
+
+// Same for all the boxes, split across `pool` when there are enough of them.
+size_t CullBoxes(JobPool& pool, const glm::vec4 planes[6], const BoxesSoA& boxes, uint8_t* visible);
@@ -0,0 +1,669 @@
+#include "bvh.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+
+constexpr uint32_t kBinCount   = 16;
+constexpr uint32_t kLeafFlag   = 0x80000000;
+constexpr uint32_t kEmptyChild = 0xffffffff;
+// Cost of visiting a node, relative to one triangle test.
+constexpr float kTraversalCost = 1.0f;
+// Nodes with fewer triangles are not worth a thread or a parallel binning.
+constexpr uint32_t kForkTriangles = 4096;
+constexpr uint32_t kParallelBinTriangles = 64 * 1024;
+// Past this depth nodes are split at the median, which bounds the depth of
+// the tree and so the traversal stack on adversarial inputs.
+constexpr uint32_t kMaxSahDepth = 48;
+constexpr size_t   kStackSize   = 256;
+
+struct Bounds
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void Grow(const glm::vec3& p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void Grow(const Bounds& b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+    // Half the surface area, only ever compared.
+    float HalfArea() const
+    {
+        glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+struct Bin
+{
+    Bounds   bounds;
+    uint32_t count = 0;
+};
+
+struct BuildNode
+{
+    Bounds bounds;
+    // Leaf if count is non zero, a range of BvhBuilder::order.
+    uint32_t first;
+    uint32_t count;
+    uint32_t left;
+    uint32_t right;
+};
+
+struct BuildTask
+{
+    uint32_t node;
+    uint32_t first;
+    uint32_t count;
+    uint32_t depth;
+    Bounds   centroids;
+};
+
+void TransformTriangle(const MeshView& mesh, const glm::mat4& transform, uint32_t triangle, glm::vec3 p[3])
+{
+    for (int k = 0; k < 3; k++)
+        p[k] = glm::vec3(transform * glm::vec4(mesh.vertices[mesh.indices[3 * size_t(triangle) + k]].position, 1.0f));
+}
+
+BvhTriangle MakeTriangle(const glm::vec3 p[3], uint32_t triangle)
+{
+    BvhTriangle result;
+    result.v0       = p[0];
+    result.edge1    = p[1] - p[0];
+    result.edge2    = p[2] - p[0];
+    result.triangle = triangle;
+    return result;
+}
+
+uint32_t EncodeLeaf(size_t first, uint32_t count)
+{
+    return kLeafFlag | ((count - 1) << 28) | uint32_t(first);
+}
+
+Bounds GetChildBounds(const BvhNode4& node, int slot)
+{
+    Bounds b;
+    b.min = glm::vec3(node.bounds[0][slot], node.bounds[1][slot], node.bounds[2][slot]);
+    b.max = glm::vec3(node.bounds[3][slot], node.bounds[4][slot], node.bounds[5][slot]);
+    return b;
+}
+
+void SetChildBounds(BvhNode4& node, int slot, const Bounds& b)
+{
+    for (int axis = 0; axis < 3; axis++)
+    {
+        node.bounds[axis][slot]     = b.min[axis];
+        node.bounds[axis + 3][slot] = b.max[axis];
+    }
+}
+
+class BvhBuilder
+{
+public:
+    // Per triangle bounds and centroids, in the space of the tree.
+    std::vector<Bounds>    boxes;
+    std::vector<glm::vec3> centroids;
+    // Triangles sorted into the leaves of the tree.
+    std::vector<uint32_t> order;
+
+    std::vector<BuildNode> nodes;
+    std::atomic<uint32_t>  nodeCount { 0 };
+
+    void Build(BuildTask root, unsigned budget)
+    {
+        std::vector<BuildTask> stack;
+        stack.push_back(root);
+        while (!stack.empty())
+        {
+            BuildTask task = stack.back();
+            stack.pop_back();
+
+            BuildTask children[2];
+            if (!Split(task, budget, children))
+                continue;
+
+            if (budget > 1 && task.count >= kForkTriangles)
+            {
+                unsigned half = budget / 2;
+                ParallelInvoke([&]() { Build(children[0], half); },
+                               [&]() { Build(children[1], budget - half); });
+                continue;
+            }
+            stack.push_back(children[1]);
+            stack.push_back(children[0]);
+        }
+    }
+
+private:
+    // Make the node a leaf or split it, returns false for a leaf.
+    bool Split(const BuildTask& task, unsigned budget, BuildTask children[2])
+    {
+        BuildNode& node = nodes[task.node];
+        node.first      = task.first;
+        node.count      = task.count;
+        if (task.count <= 2)
+            return false;
+
+        glm::vec3 extent = task.centroids.max - task.centroids.min;
+        glm::vec3 scale;
+        for (int axis = 0; axis < 3; axis++)
+            scale[axis] = extent[axis] > 0.0f ? kBinCount / extent[axis] : 0.0f;
+
+        auto binOf = [&](uint32_t triangle, int axis) {
+            float offset = (centroids[triangle][axis] - task.centroids.min[axis]) * scale[axis];
+            return std::min(uint32_t(offset), kBinCount - 1);
+        };
+
+        int      bestAxis  = -1;
+        uint32_t bestSplit = 0;
+        float    bestCost  = FLT_MAX;
+        Bounds   bestBounds[2];
+
+        if (task.depth < kMaxSahDepth && (scale.x > 0.0f || scale.y > 0.0f || scale.z > 0.0f))
+        {
+            Bin bins[3][kBinCount];
+            Fill(task, budget, binOf, bins);
+
+            for (int axis = 0; axis < 3; axis++)
+            {
+                if (scale[axis] == 0.0f)
+                    continue;
+
+                // Sweep from the right first, then evaluate every split
+                // plane while sweeping from the left.
+                Bounds   rightBounds[kBinCount];
+                uint32_t rightCounts[kBinCount];
+                Bin      right;
+                for (uint32_t b = kBinCount - 1; b > 0; b--)
+                {
+                    right.bounds.Grow(bins[axis][b].bounds);
+                    right.count += bins[axis][b].count;
+                    rightBounds[b] = right.bounds;
+                    rightCounts[b] = right.count;
+                }
+
+                Bin left;
+                for (uint32_t b = 1; b < kBinCount; b++)
+                {
+                    left.bounds.Grow(bins[axis][b - 1].bounds);
+                    left.count += bins[axis][b - 1].count;
+                    if (left.count == 0 || rightCounts[b] == 0)
+                        continue;
+
+                    float cost = left.bounds.HalfArea() * left.count + rightBounds[b].HalfArea() * rightCounts[b];
+                    if (cost < bestCost)
+                    {
+                        bestCost      = cost;
+                        bestAxis      = axis;
+                        bestSplit     = b;
+                        bestBounds[0] = left.bounds;
+                        bestBounds[1] = rightBounds[b];
+                    }
+                }
+            }
+        }
+
+        uint32_t* begin = order.data() + task.first;
+        uint32_t* end   = begin + task.count;
+        uint32_t  mid;
+        if (bestAxis >= 0)
+        {
+            float leafCost = (task.count - kTraversalCost) * node.bounds.HalfArea();
+            if (task.count <= kBvhMaxLeafTriangles && leafCost <= bestCost)
+                return false;
+
+            mid = uint32_t(std::partition(begin, end, [&](uint32_t t) { return binOf(t, bestAxis) < bestSplit; }) - begin);
+        }
+        else
+        {
+            // Every centroid in the same spot or the tree is too deep, split
+            // at the median of the longest axis.
+            if (task.count <= kBvhMaxLeafTriangles)
+                return false;
+
+            glm::vec3 size = node.bounds.max - node.bounds.min;
+            int       axis = size.x >= size.y && size.x >= size.z ? 0 : size.y >= size.z ? 1 :
+                                                                                              2;
+            mid            = task.count / 2;
+            std::nth_element(begin, begin + mid, end, [&](uint32_t a, uint32_t b) {
+                return centroids[a][axis] < centroids[b][axis] || (centroids[a][axis] == centroids[b][axis] && a < b);
+            });
+            for (uint32_t* t = begin; t != end; t++)
+                bestBounds[t - begin >= mid].Grow(boxes[*t]);
+        }
+
+        // The bins only track triangle bounds, the children need the
+        // bounds of their centroids to bin again.
+        Bounds childCentroids[2];
+        for (uint32_t* t = begin; t != end; t++)
+            childCentroids[t - begin >= mid].Grow(centroids[*t]);
+
+        uint32_t first = nodeCount.fetch_add(2);
+        node.count     = 0;
+        node.left      = first;
+        node.right     = first + 1;
+
+        children[0] = { first, task.first, mid, task.depth + 1, childCentroids[0] };
+        children[1] = { first + 1, task.first + mid, task.count - mid, task.depth + 1, childCentroids[1] };
+        nodes[first].bounds     = bestBounds[0];
+        nodes[first + 1].bounds = bestBounds[1];
+        return true;
+    }
+
+    template <typename BinOf>
+    void Fill(const BuildTask& task, unsigned budget, BinOf& binOf, Bin bins[3][kBinCount])
+    {
+        auto fill = [&](size_t begin, size_t end, Bin out[3][kBinCount]) {
+            for (size_t i = begin; i < end; i++)
+            {
+                uint32_t t = order[task.first + i];
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    Bin& bin = out[axis][binOf(t, axis)];
+                    bin.bounds.Grow(boxes[t]);
+                    bin.count++;
+                }
+            }
+        };
+
+        if (budget <= 1 || task.count < kParallelBinTriangles)
+        {
+            fill(0, task.count, bins);
+            return;
+        }
+
+        // One set of bins per thread, merged in order.
+        std::vector<Bin> chunkBins(size_t(budget) * 3 * kBinCount);
+        ParallelForChunks(task.count, budget, [&](size_t chunk, size_t begin, size_t end) {
+            fill(begin, end, reinterpret_cast<Bin(*)[kBinCount]>(&chunkBins[chunk * 3 * kBinCount]));
+        });
+        for (size_t chunk = 0; chunk < budget; chunk++)
+        {
+            for (int axis = 0; axis < 3; axis++)
+            {
+                for (uint32_t b = 0; b < kBinCount; b++)
+                {
+                    const Bin& from = chunkBins[(chunk * 3 + axis) * kBinCount + b];
+                    bins[axis][b].bounds.Grow(from.bounds);
+                    bins[axis][b].count += from.count;
+                }
+            }
+        }
+    }
+};
+
+// Collapse the binary tree into 4 wide nodes, depth first.
+void Flatten(const BvhBuilder& builder, MeshBvh& bvh, const std::vector<uint32_t>& triangleIds)
+{
+    struct Pending
+    {
+        uint32_t node;
+        uint32_t parent;
+        int      slot;
+    };
+
+    auto emitLeaf = [&](const BuildNode& leaf) {
+        uint32_t first = (uint32_t)bvh.triangles.size();
+        for (uint32_t i = 0; i < leaf.count; i++)
+        {
+            BvhTriangle triangle = {};
+            triangle.triangle    = triangleIds[builder.order[leaf.first + i]];
+            bvh.triangles.push_back(triangle);
+        }
+        return EncodeLeaf(first, leaf.count);
+    };
+
+    BvhNode4 empty;
+    for (int slot = 0; slot < 4; slot++)
+    {
+        SetChildBounds(empty, slot, Bounds());
+        empty.children[slot] = kEmptyChild;
+    }
+
+    std::vector<Pending> stack;
+    stack.push_back({ 0, kEmptyChild, 0 });
+    while (!stack.empty())
+    {
+        Pending pending = stack.back();
+        stack.pop_back();
+
+        uint32_t index = (uint32_t)bvh.nodes.size();
+        bvh.nodes.push_back(empty);
+        if (pending.parent != kEmptyChild)
+            bvh.nodes[pending.parent].children[pending.slot] = index;
+
+        // Open the largest interior child until there are four.
+        uint32_t children[4];
+        int      childCount = 0;
+        const BuildNode& node = builder.nodes[pending.node];
+        if (node.count > 0)
+            children[childCount++] = pending.node;
+        else
+        {
+            children[childCount++] = node.left;
+            children[childCount++] = node.right;
+        }
+        while (childCount < 4)
+        {
+            int   largest = -1;
+            float area    = -1.0f;
+            for (int c = 0; c < childCount; c++)
+            {
+                const BuildNode& child = builder.nodes[children[c]];
+                if (child.count == 0 && child.bounds.HalfArea() > area)
+                {
+                    largest = c;
+                    area    = child.bounds.HalfArea();
+                }
+            }
+            if (largest < 0)
+                break;
+
+            const BuildNode& opened = builder.nodes[children[largest]];
+            children[largest]       = opened.left;
+            children[childCount++]  = opened.right;
+        }
+
+        for (int c = 0; c < childCount; c++)
+        {
+            const BuildNode& child = builder.nodes[children[c]];
+            SetChildBounds(bvh.nodes[index], c, child.bounds);
+            if (child.count > 0)
+                bvh.nodes[index].children[c] = emitLeaf(child);
+        }
+        // Pushed backwards so the first child is emitted right after us.
+        for (int c = childCount - 1; c >= 0; c--)
+            if (builder.nodes[children[c]].count == 0)
+                stack.push_back({ children[c], index, c });
+    }
+}
+
+// Recompute the triangles of the tree, in parallel.
+void TransformTriangles(MeshBvh& bvh, const MeshView& mesh, const glm::mat4& transform)
+{
+    ParallelForChunks(bvh.triangles.size(), GetWorkerCount(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 p[3];
+            TransformTriangle(mesh, transform, bvh.triangles[i].triangle, p);
+            bvh.triangles[i] = MakeTriangle(p, bvh.triangles[i].triangle);
+        }
+    });
+}
+
+void UpdateBounds(MeshBvh& bvh)
+{
+    Bounds total;
+    if (!bvh.nodes.empty())
+    {
+        const BvhNode4& root = bvh.nodes[0];
+        for (int slot = 0; slot < 4; slot++)
+            total.Grow(GetChildBounds(root, slot));
+    }
+    // Inverted if there are no triangles.
+    bvh.bounds_min = total.min;
+    bvh.bounds_max = total.max;
+}
+
+// Möller-Trumbore, double sided.
+inline bool IntersectTriangle(const BvhTriangle& triangle, const BvhRay& ray, BvhHit& hit)
+{
+    glm::vec3 p   = glm::cross(ray.direction, triangle.edge2);
+    float     det = glm::dot(triangle.edge1, p);
+    if (det == 0.0f)
+        return false;
+
+    float     invDet = 1.0f / det;
+    glm::vec3 s      = ray.origin - triangle.v0;
+    float     u      = glm::dot(s, p) * invDet;
+    if (u < 0.0f || u > 1.0f)
+        return false;
+
+    glm::vec3 q = glm::cross(s, triangle.edge1);
+    float     v = glm::dot(ray.direction, q) * invDet;
+    if (v < 0.0f || u + v > 1.0f)
+        return false;
+
+    float t = glm::dot(triangle.edge2, q) * invDet;
+    if (t <= ray.tmin || t >= hit.t)
+        return false;
+
+    hit.t        = t;
+    hit.u        = u;
+    hit.v        = v;
+    hit.triangle = triangle.triangle;
+    return true;
+}
+
+template <bool AnyHit>
+bool Traverse(const MeshBvh& bvh, const BvhRay& ray, BvhHit& hit)
+{
+    hit          = {};
+    hit.t        = ray.tmax;
+    hit.triangle = kBvhNoHit;
+    if (bvh.nodes.empty())
+        return false;
+
+    // Clamped so the slab distances never compute 0 * inf.
+    glm::vec3 invDirection;
+    // Bounds rows of the planes the ray enters and leaves every slab by.
+    int nearPlane[3];
+    int farPlane[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float d            = ray.direction[axis];
+        invDirection[axis] = 1.0f / (std::fabs(d) > 1e-30f ? d : std::copysign(1e-30f, d));
+        nearPlane[axis]    = invDirection[axis] >= 0.0f ? axis : axis + 3;
+        farPlane[axis]     = invDirection[axis] >= 0.0f ? axis + 3 : axis;
+    }
+
+#if PETIT_SIMD_SSE2
+    __m128 originX = _mm_set1_ps(ray.origin.x);
+    __m128 originY = _mm_set1_ps(ray.origin.y);
+    __m128 originZ = _mm_set1_ps(ray.origin.z);
+    __m128 invX    = _mm_set1_ps(invDirection.x);
+    __m128 invY    = _mm_set1_ps(invDirection.y);
+    __m128 invZ    = _mm_set1_ps(invDirection.z);
+    __m128 tmin    = _mm_set1_ps(ray.tmin);
+#endif
+
+    struct Entry
+    {
+        uint32_t child;
+        float    t;
+    };
+    Entry stack[kStackSize];
+    int   top  = 0;
+    stack[top++] = { 0, ray.tmin };
+
+    while (top > 0)
+    {
+        Entry entry = stack[--top];
+        if (entry.t >= hit.t)
+            continue;
+
+        if (entry.child & kLeafFlag)
+        {
+            uint32_t first = entry.child & 0x0fffffff;
+            uint32_t count = ((entry.child >> 28) & 7) + 1;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                if (IntersectTriangle(bvh.triangles[i], ray, hit) && AnyHit)
+                    return true;
+            }
+            continue;
+        }
+
+        const BvhNode4& node = bvh.nodes[entry.child];
+        alignas(16) float distances[4];
+        int               mask = 0;
+#if PETIT_SIMD_SSE2
+        __m128 nx = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearPlane[0]]), originX), invX);
+        __m128 ny = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearPlane[1]]), originY), invY);
+        __m128 nz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[nearPlane[2]]), originZ), invZ);
+        __m128 fx = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farPlane[0]]), originX), invX);
+        __m128 fy = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farPlane[1]]), originY), invY);
+        __m128 fz = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(node.bounds[farPlane[2]]), originZ), invZ);
+        __m128 tn = _mm_max_ps(_mm_max_ps(nx, ny), _mm_max_ps(nz, tmin));
+        __m128 tf = _mm_min_ps(_mm_min_ps(fx, fy), _mm_min_ps(fz, _mm_set1_ps(hit.t)));
+        mask      = _mm_movemask_ps(_mm_cmple_ps(tn, tf));
+        _mm_store_ps(distances, tn);
+#else
+        for (int slot = 0; slot < 4; slot++)
+        {
+            float tn = ray.tmin;
+            float tf = hit.t;
+            for (int axis = 0; axis < 3; axis++)
+            {
+                tn = std::max(tn, (node.bounds[nearPlane[axis]][slot] - ray.origin[axis]) * invDirection[axis]);
+                tf = std::min(tf, (node.bounds[farPlane[axis]][slot] - ray.origin[axis]) * invDirection[axis]);
+            }
+            distances[slot] = tn;
+            if (tn <= tf)
+                mask |= 1 << slot;
+        }
+#endif
+
+        // Push the hit children far to near, so the nearest is popped first.
+        Entry hits[4];
+        int   hitCount = 0;
+        for (int slot = 0; slot < 4; slot++)
+        {
+            if (!(mask & (1 << slot)))
+                continue;
+
+            Entry child = { node.children[slot], distances[slot] };
+            int   i     = hitCount++;
+            for (; i > 0 && hits[i - 1].t < child.t; i--)
+                hits[i] = hits[i - 1];
+            hits[i] = child;
+        }
+        for (int i = 0; i < hitCount; i++)
+            stack[top++] = hits[i];
+    }
+    return hit.triangle != kBvhNoHit;
+}
+
+} // namespace
+
+void BuildBvh(MeshBvh& bvh, const MeshView& mesh, const glm::mat4& transform)
+{
+    bvh.nodes.clear();
+    bvh.triangles.clear();
+
+    // Only the full resolution ranges, LODs are appended after them.
+    std::vector<uint32_t> triangleIds;
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+        for (uint32_t t = 0; t < submesh.index_count / 3; t++)
+            triangleIds.push_back(submesh.index_offset / 3 + t);
+
+    size_t count = triangleIds.size();
+    if (count == 0)
+    {
+        UpdateBounds(bvh);
+        return;
+    }
+
+    BvhBuilder builder;
+    builder.boxes.resize(count);
+    builder.centroids.resize(count);
+    builder.order.resize(count);
+    builder.nodes.resize(std::max<size_t>(2 * count, 1));
+
+    unsigned            workers = GetWorkerCount();
+    std::vector<Bounds> chunkCentroids(workers);
+    std::vector<Bounds> chunkBounds(workers);
+    ParallelForChunks(count, workers, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+        {
+            glm::vec3 p[3];
+            TransformTriangle(mesh, transform, triangleIds[i], p);
+
+            Bounds box;
+            box.Grow(p[0]);
+            box.Grow(p[1]);
+            box.Grow(p[2]);
+            builder.boxes[i]     = box;
+            builder.centroids[i] = (box.min + box.max) * 0.5f;
+            builder.order[i]     = (uint32_t)i;
+            chunkCentroids[chunk].Grow(builder.centroids[i]);
+            chunkBounds[chunk].Grow(box);
+        }
+    });
+
+    BuildTask root = { 0, 0, (uint32_t)count, 0, Bounds() };
+    for (unsigned chunk = 0; chunk < workers; chunk++)
+    {
+        root.centroids.Grow(chunkCentroids[chunk]);
+        builder.nodes[0].bounds.Grow(chunkBounds[chunk]);
+    }
+    builder.nodeCount = 1;
+    builder.Build(root, workers);
+
+    Flatten(builder, bvh, triangleIds);
+    TransformTriangles(bvh, mesh, transform);
+    UpdateBounds(bvh);
+}
+
+void RefitBvh(MeshBvh& bvh, const MeshView& mesh, const glm::mat4& transform)
+{
+    TransformTriangles(bvh, mesh, transform);
+
+    // Children always come after their parent, so walking the nodes
+    // backwards refits every child before it is read.
+    for (size_t n = bvh.nodes.size(); n-- > 0;)
+    {
+        BvhNode4& node = bvh.nodes[n];
+        for (int slot = 0; slot < 4; slot++)
+        {
+            uint32_t child = node.children[slot];
+            if (child == kEmptyChild)
+                continue;
+
+            Bounds bounds;
+            if (child & kLeafFlag)
+            {
+                uint32_t first = child & 0x0fffffff;
+                uint32_t count = ((child >> 28) & 7) + 1;
+                for (uint32_t i = first; i < first + count; i++)
+                {
+                    glm::vec3 p[3];
+                    TransformTriangle(mesh, transform, bvh.triangles[i].triangle, p);
+                    bounds.Grow(p[0]);
+                    bounds.Grow(p[1]);
+                    bounds.Grow(p[2]);
+                }
+            }
+            else
+            {
+                for (int c = 0; c < 4; c++)
+                    bounds.Grow(GetChildBounds(bvh.nodes[child], c));
+            }
+            SetChildBounds(node, slot, bounds);
+        }
+    }
+    UpdateBounds(bvh);
+}
+
+bool IntersectBvh(const MeshBvh& bvh, const BvhRay& ray, BvhHit& hit)
+{
+    return Traverse<false>(bvh, ray, hit);
+}
+
+bool IsRayOccluded(const MeshBvh& bvh, const BvhRay& ray)
+{
+    BvhHit hit;
+    return Traverse<true>(bvh, ray, hit);
+}
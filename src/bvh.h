@@ -0,0 +1,93 @@
+/**
+ * Bounding volume hierarchy over the triangles of a mesh, for CPU side ray
+ * queries such as picking and visibility probes.
+ *
+ * The tree is built top down with a binned surface area heuristic, forking
+ * the two halves of large nodes onto their own threads, then collapsed into
+ * a 4 wide tree. Every node stores the bounds of its four children as a
+ * structure of arrays, so one ray is tested against all of them at once, and
+ * the nodes are laid out depth first so the first child usually sits right
+ * after its parent.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Largest number of triangles a leaf can hold, see BvhNode4::children.
+constexpr uint32_t kBvhMaxLeafTriangles = 8;
+// Returned in BvhHit::triangle when nothing was hit.
+constexpr uint32_t kBvhNoHit = 0xffffffff;
+
+struct alignas(16) BvhNode4
+{
+    // Bounds of the four children, min x, y, z then max x, y, z. Unused
+    // slots have empty bounds that no ray can hit.
+    float bounds[6][4];
+    // Index of a child node, or a leaf if the top bit is set: bits 28 to 30
+    // hold the triangle count minus one and the low bits the first
+    // MeshBvh::triangles entry.
+    uint32_t children[4];
+};
+
+// Triangle in the layout the ray test wants, in the space of the tree.
+struct BvhTriangle
+{
+    glm::vec3 v0;
+    glm::vec3 edge1;
+    glm::vec3 edge2;
+    // Triangle of the source mesh, its first index divided by 3.
+    uint32_t triangle;
+};
+
+struct MeshBvh
+{
+    // nodes[0] is the root.
+    std::vector<BvhNode4>    nodes;
+    std::vector<BvhTriangle> triangles;
+
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+struct BvhRay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    // Only hits with tmin < t < tmax count, t in units of `direction`.
+    float tmin = 0.0f;
+    float tmax = 1e30f;
+};
+
+struct BvhHit
+{
+    float t = 0.0f;
+    // Barycentric coordinates of the hit, relative to the second and third
+    // vertex of the triangle.
+    float    u        = 0.0f;
+    float    v        = 0.0f;
+    uint32_t triangle = kBvhNoHit;
+};
+
+/**
+ * Build the tree over the full resolution triangles of every submesh of
+ * `mesh`, with the vertices transformed by `transform`.
+ */
+void BuildBvh(MeshBvh& bvh, const MeshView& mesh, const glm::mat4& transform = glm::mat4(1.0f));
+
+/**
+ * Recompute the triangles and node bounds of a tree built from `mesh` with
+ * a new transform, without rebuilding the hierarchy. Much cheaper than
+ * BuildBvh, the tree gets less efficient the more the transform deforms the
+ * mesh but stays correct.
+ */
+void RefitBvh(MeshBvh& bvh, const MeshView& mesh, const glm::mat4& transform);
+
+// Find the closest hit along the ray, returns false if there is none.
+bool IntersectBvh(const MeshBvh& bvh, const BvhRay& ray, BvhHit& hit);
+
+// True if anything is hit along the ray, stops at the first hit found.
+bool IsRayOccluded(const MeshBvh& bvh, const BvhRay& ray);
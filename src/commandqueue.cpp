@@ -2,9 +2,16 @@
 #include "helpers.h"
 #include <assert.h>
 
+// Private data of a command list: the thread slot that recorded it.
+static const GUID CommandListSlotGuid = {
+    0x5c1e7d0a, 0x3f2b, 0x4e8c, {0x9a, 0x61, 0x2d, 0x7f, 0x14, 0xb3, 0xc8, 0x05}};
+
 CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device,
-                           D3D12_COMMAND_LIST_TYPE type)
-    : m_FenceValue(0), m_CommandListType(type), m_d3d12Device(device)
+                           D3D12_COMMAND_LIST_TYPE type,
+                           std::shared_ptr<TimelineTracker> tracker,
+                           uint32_t timeline)
+    : m_FenceValue(0), m_CommandListType(type), m_d3d12Device(device),
+      m_Tracker(tracker), m_Timeline(timeline)
 {
     D3D12_COMMAND_QUEUE_DESC desc = {};
     desc.Type = type;
@@ -16,36 +23,93 @@ CommandQueue::CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device,
         &desc, IID_PPV_ARGS(&m_d3d12CommandQueue)));
     ThrowIfFailed(m_d3d12Device->CreateFence(
         m_FenceValue, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(&m_d3d12Fence)));
-
-    m_FenceEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
-    assert(m_FenceEvent && "Failed to create fence event handle.");
 }
 
 CommandQueue::~CommandQueue() {}
 
 uint64_t CommandQueue::Signal()
 {
-    uint64_t fenceValue = ++m_FenceValue;
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    return SignalLocked();
+}
+
+uint64_t CommandQueue::SignalLocked()
+{
+    uint64_t fenceValue = m_FenceValue.load() + 1;
     m_d3d12CommandQueue->Signal(m_d3d12Fence.Get(), fenceValue);
+    // Before the value is visible, nothing can wait for it untracked.
+    if (m_Tracker)
+    {
+        m_Tracker->Signal(m_Timeline, fenceValue);
+        m_Tracker->Complete(m_Timeline, GetCompletedFenceValue());
+    }
+    m_FenceValue.store(fenceValue);
     return fenceValue;
 }
 
-bool CommandQueue::IsFenceComplete(uint64_t fenceValue)
+bool CommandQueue::IsFenceComplete(uint64_t fenceValue) const
 {
     return m_d3d12Fence->GetCompletedValue() >= fenceValue;
 }
 
+uint64_t CommandQueue::GetCompletedFenceValue() const
+{
+    return m_d3d12Fence->GetCompletedValue();
+}
+
+uint64_t CommandQueue::GetLastFenceValue() const { return m_FenceValue; }
+
 void CommandQueue::WaitForFenceValue(uint64_t fenceValue)
 {
+    // Without an event the call blocks until the fence completes, so any
+    // number of threads can wait at once.
     if (!IsFenceComplete(fenceValue))
-    {
-        m_d3d12Fence->SetEventOnCompletion(fenceValue, m_FenceEvent);
-        ::WaitForSingleObject(m_FenceEvent, DWORD_MAX);
-    }
+        ThrowIfFailed(m_d3d12Fence->SetEventOnCompletion(fenceValue, nullptr));
 }
 
 void CommandQueue::Flush() { WaitForFenceValue(Signal()); }
 
+void CommandQueue::Wait(const CommandQueue& other, uint64_t fenceValue)
+{
+    QueueWait wait = {&other, fenceValue};
+    std::lock_guard<std::mutex> lock(m_SubmitMutex);
+    WaitLocked({&wait, 1});
+}
+
+void CommandQueue::WaitLocked(Span<const QueueWait> waits)
+{
+    std::vector<SyncPoint> points;
+    for (const QueueWait& wait : waits)
+    {
+        // Waits already satisfied cost a queue operation for nothing.
+        if (wait.queue == this || wait.queue->IsFenceComplete(wait.fenceValue))
+            continue;
+        if (m_Tracker && wait.queue->m_Tracker == m_Tracker)
+            points.push_back({wait.queue->m_Timeline, wait.fenceValue});
+        else
+            ThrowIfFailed(m_d3d12CommandQueue->Wait(
+                wait.queue->m_d3d12Fence.Get(), wait.fenceValue));
+    }
+    if (points.empty())
+        return;
+
+    std::vector<SyncPoint> resolved;
+    m_Tracker->Resolve(m_Timeline, points, resolved);
+    for (const SyncPoint& point : resolved)
+    {
+        for (const QueueWait& wait : waits)
+        {
+            if (wait.queue->m_Tracker == m_Tracker &&
+                wait.queue->m_Timeline == point.timeline)
+            {
+                ThrowIfFailed(m_d3d12CommandQueue->Wait(
+                    wait.queue->m_d3d12Fence.Get(), point.value));
+                break;
+            }
+        }
+    }
+}
+
 Microsoft::WRL::ComPtr<ID3D12CommandAllocator>
     CommandQueue::CreateCommandAllocator()
 {
@@ -74,66 +138,115 @@ Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList;
 
-    if (!m_CommandAllocatorQueue.empty() &&
-        IsFenceComplete(m_CommandAllocatorQueue.front().fenceValue))
-    {
-        commandAllocator = m_CommandAllocatorQueue.front().commandAllocator;
-        m_CommandAllocatorQueue.pop();
-
+    uint32_t slot = GetThreadSlot();
+    if (m_CommandAllocatorPools.Get(slot).Acquire(GetCompletedFenceValue(),
+                                                  commandAllocator))
         ThrowIfFailed(commandAllocator->Reset());
-    }
     else
-    {
         commandAllocator = CreateCommandAllocator();
-    }
-
-    if (!m_CommandListQueue.empty())
-    {
-        commandList = m_CommandListQueue.front();
-        m_CommandListQueue.pop();
 
+    // Lists can be reset as soon as they are submitted.
+    if (m_CommandListPools.Get(slot).Acquire(GetCompletedFenceValue(),
+                                             commandList))
         ThrowIfFailed(commandList->Reset(commandAllocator.Get(), nullptr));
-    }
     else
-    {
         commandList = CreateCommandList(commandAllocator);
-    }
 
     // Associate the command allocator with the command list so that it can be
-    // retrieved when the command list is executed.
+    // retrieved when the command list is executed, and remember which pools
+    // they go back to.
     ThrowIfFailed(commandList->SetPrivateDataInterface(
         __uuidof(ID3D12CommandAllocator), commandAllocator.Get()));
+    ThrowIfFailed(commandList->SetPrivateData(CommandListSlotGuid,
+                                              sizeof(slot), &slot));
 
     return commandList;
 }
 
+uint64_t CommandQueue::ExecuteAndRecycle(Span<const CommandList> commandLists,
+                                         Span<const QueueWait> waits)
+{
+    std::vector<ID3D12CommandList*> ppCommandLists(commandLists.size());
+    for (size_t i = 0; i < commandLists.size(); i++)
+        ppCommandLists[i] = commandLists[i].Get();
+
+    uint64_t fenceValue;
+    {
+        std::lock_guard<std::mutex> lock(m_SubmitMutex);
+        WaitLocked(waits);
+        if (!ppCommandLists.empty())
+            m_d3d12CommandQueue->ExecuteCommandLists(
+                UINT(ppCommandLists.size()), ppCommandLists.data());
+        fenceValue = SignalLocked();
+    }
+
+    for (size_t i = 0; i < commandLists.size(); i++)
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
+        UINT dataSize = sizeof(ID3D12CommandAllocator*);
+        ThrowIfFailed(commandLists[i]->GetPrivateData(
+            __uuidof(ID3D12CommandAllocator), &dataSize,
+            commandAllocator.GetAddressOf()));
+
+        uint32_t slot;
+        dataSize = sizeof(slot);
+        ThrowIfFailed(commandLists[i]->GetPrivateData(CommandListSlotGuid,
+                                                      &dataSize, &slot));
+
+        m_CommandAllocatorPools.Get(slot).Return(fenceValue, commandAllocator);
+        m_CommandListPools.Get(slot).Return(0, commandLists[i]);
+    }
+    return fenceValue;
+}
+
 // Execute a command list.
 // Returns the fence value to wait for for this command list.
 uint64_t CommandQueue::ExecuteCommandList(
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList)
 {
     commandList->Close();
+    return ExecuteAndRecycle({std::addressof(commandList), 1}, {});
+}
 
-    ID3D12CommandAllocator* commandAllocator;
-    UINT dataSize = sizeof(commandAllocator);
-    ThrowIfFailed(commandList->GetPrivateData(__uuidof(ID3D12CommandAllocator),
-                                              &dataSize, &commandAllocator));
+uint64_t CommandQueue::ExecuteCommandLists(
+    Span<const Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>>
+        commandLists,
+    Span<const QueueWait> waits)
+{
+    if (commandLists.empty() && waits.empty())
+        return GetLastFenceValue();
 
-    ID3D12CommandList* const ppCommandLists[] = {commandList.Get()};
+    for (auto& commandList : commandLists)
+        commandList->Close();
+    return ExecuteAndRecycle(commandLists, waits);
+}
 
-    m_d3d12CommandQueue->ExecuteCommandLists(1, ppCommandLists);
-    uint64_t fenceValue = Signal();
+void CommandQueue::HandOff(
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList)
+{
+    commandList->Close();
+    m_HandedOff.Push(commandList);
+}
 
-    m_CommandAllocatorQueue.emplace(
-        CommandAllocatorEntry{fenceValue, commandAllocator});
-    m_CommandListQueue.push(commandList);
+uint64_t CommandQueue::ExecuteHandedOff()
+{
+    std::vector<CommandList> commandLists;
+    m_HandedOff.Drain([&](CommandList commandList) {
+        commandLists.push_back(std::move(commandList));
+    });
+    if (commandLists.empty())
+        return GetLastFenceValue();
+    return ExecuteAndRecycle(commandLists, {});
+}
 
-    // The ownership of the command allocator has been transferred to the ComPtr
-    // in the command allocator queue. It is safe to release the reference
-    // in this temporary COM pointer here.
-    commandAllocator->Release();
+FencedPoolStats CommandQueue::GetCommandAllocatorStats() const
+{
+    return m_CommandAllocatorPools.GetStats();
+}
 
-    return fenceValue;
+FencedPoolStats CommandQueue::GetCommandListStats() const
+{
+    return m_CommandListPools.GetStats();
 }
 
 Microsoft::WRL::ComPtr<ID3D12CommandQueue>
@@ -141,3 +254,5 @@ Microsoft::WRL::ComPtr<ID3D12CommandQueue>
 {
     return m_d3d12CommandQueue;
 }
+
+ID3D12Fence* CommandQueue::GetD3D12Fence() const { return m_d3d12Fence.Get(); }
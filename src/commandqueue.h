@@ -1,5 +1,16 @@
 /**
  * Wrapper class for a ID3D12CommandQueue.
+ *
+ * Command lists can be recorded from any thread. Each thread takes command
+ * allocators and lists from pools of its own and submission gives them back
+ * to those pools, the allocators once the fence of the submission
+ * completes. Workers either execute their lists directly or hand them off
+ * to the submitting thread, which executes everything handed off in one
+ * batch.
+ *
+ * Queues sharing a TimelineTracker wait for each other on the GPU only when
+ * the wait is not implied by one issued before, see timelinetracker.h.
+ * Queues are fences a FenceWatcher can watch, with a QueueFenceWaiter.
  */
 
 #pragma once
@@ -7,17 +18,39 @@
 #include <d3d12.h> // For ID3D12CommandQueue, ID3D12Device2, and ID3D12Fence
 #include <wrl.h>   // For Microsoft::WRL::ComPtr
 
+#include <atomic>
 #include <cstdint> // For uint64_t
-#include <queue>   // For std::queue
+#include <memory>
+#include <mutex>
+#include <vector>
 
-class CommandQueue
+#include "fencedpool.h"
+#include "fencewatcher.h"
+#include "mpscqueue.h"
+#include "span.h"
+#include "timelinetracker.h"
+
+class CommandQueue;
+
+// GPU side wait for `queue` to reach `fenceValue`, 0 waits for nothing.
+struct QueueWait
+{
+    const CommandQueue* queue;
+    uint64_t fenceValue;
+};
+
+class CommandQueue : public WatchedFence
 {
   public:
+    // `timeline` is the index of the queue in `tracker`, shared with the
+    // queues it waits for.
     CommandQueue(Microsoft::WRL::ComPtr<ID3D12Device2> device,
-                 D3D12_COMMAND_LIST_TYPE type);
+                 D3D12_COMMAND_LIST_TYPE type,
+                 std::shared_ptr<TimelineTracker> tracker = nullptr,
+                 uint32_t timeline = 0);
     virtual ~CommandQueue();
 
-    // Get an available command list from the command queue.
+    // Get an available command list from the calling thread's pool.
     Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> GetCommandList();
 
     // Execute a command list.
@@ -25,12 +58,42 @@ class CommandQueue
     uint64_t ExecuteCommandList(
         Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
 
+    // Close command lists and execute them in order with one
+    // ExecuteCommandLists call and one signal, after the GPU waits in
+    // `waits`. Every allocator involved is recycled with the returned fence
+    // value.
+    uint64_t ExecuteCommandLists(
+        Span<const Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>>
+            commandLists,
+        Span<const QueueWait> waits = {});
+
+    // Close `commandList` and queue it for ExecuteHandedOff, from any
+    // thread, without locking.
+    void HandOff(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> commandList);
+    // Execute every list handed off so far in one batch. Only one thread
+    // may call it. Returns the fence value of the batch, or the last one if
+    // there was nothing to execute.
+    uint64_t ExecuteHandedOff();
+
     uint64_t Signal();
-    bool IsFenceComplete(uint64_t fenceValue);
+    bool IsFenceComplete(uint64_t fenceValue) const;
+    uint64_t GetCompletedFenceValue() const override;
+    // The value of the last Signal, what is submitted so far completes there.
+    uint64_t GetLastFenceValue() const;
     void WaitForFenceValue(uint64_t fenceValue);
     void Flush();
 
+    // Make the GPU wait, before anything submitted after this call, until
+    // `other` reaches `fenceValue`. The CPU does not block.
+    void Wait(const CommandQueue& other, uint64_t fenceValue);
+
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> GetD3D12CommandQueue() const;
+    ID3D12Fence* GetD3D12Fence() const;
+
+    // Creations and reuses of command allocators and lists, summed over
+    // every thread.
+    FencedPoolStats GetCommandAllocatorStats() const;
+    FencedPoolStats GetCommandListStats() const;
 
   protected:
     Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CreateCommandAllocator();
@@ -38,24 +101,31 @@ class CommandQueue
         Microsoft::WRL::ComPtr<ID3D12CommandAllocator> allocator);
 
   private:
-    // Keep track of command allocators that are "in-flight"
-    struct CommandAllocatorEntry
-    {
-        uint64_t fenceValue;
-        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> commandAllocator;
-    };
+    using CommandList = Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>;
 
-    using CommandAllocatorQueue = std::queue<CommandAllocatorEntry>;
-    using CommandListQueue =
-        std::queue<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>>;
+    uint64_t SignalLocked();
+    // Issue the GPU waits in `waits` that are neither complete nor implied
+    // by earlier ones.
+    void WaitLocked(Span<const QueueWait> waits);
+    // Execute closed command lists and give them and their allocators back
+    // to the pools of the threads that recorded them.
+    uint64_t ExecuteAndRecycle(Span<const CommandList> commandLists,
+                               Span<const QueueWait> waits);
 
     D3D12_COMMAND_LIST_TYPE m_CommandListType;
     Microsoft::WRL::ComPtr<ID3D12Device2> m_d3d12Device;
     Microsoft::WRL::ComPtr<ID3D12CommandQueue> m_d3d12CommandQueue;
     Microsoft::WRL::ComPtr<ID3D12Fence> m_d3d12Fence;
-    HANDLE m_FenceEvent;
-    uint64_t m_FenceValue;
+    std::atomic<uint64_t> m_FenceValue;
+
+    std::shared_ptr<TimelineTracker> m_Tracker;
+    uint32_t m_Timeline;
+
+    // Held while executing and signaling, so fence values stay in order.
+    std::mutex m_SubmitMutex;
 
-    CommandAllocatorQueue m_CommandAllocatorQueue;
-    CommandListQueue m_CommandListQueue;
+    FencedPools<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>>
+        m_CommandAllocatorPools;
+    FencedPools<CommandList> m_CommandListPools;
+    MpscQueue<CommandList> m_HandedOff;
 };
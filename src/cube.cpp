@@ -6,7 +6,11 @@
 #include "window.h"
 
 #include "commandqueue.h"
+#include "descriptorallocator.h"
+#include "gpuallocator.h"
+#include "releasequeue.h"
 #include <memory>
+#include <vector>
 #include <SDL_events.h>
 
 using namespace Microsoft::WRL;
@@ -57,29 +61,17 @@ void CubeApp::UpdateBufferResource(
     const void*                        bufferData,
     D3D12_RESOURCE_FLAGS               flags)
 {
-    auto device = Application::Get().GetDevice();
+    auto allocator = Application::Get().GetGpuAllocator();
 
     size_t bufferSize = numElements * elementSize;
 
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(pDestinationResource)));
+    // Place the GPU resource in a default heap.
+    *pDestinationResource = allocator->CreateBuffer(bufferSize, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COPY_DEST, flags).Detach();
 
-    // Create an committed resource for the upload.
+    // And the one for the upload in an upload heap.
     if (bufferData)
     {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(pIntermediateResource)));
+        *pIntermediateResource = allocator->CreateBuffer(bufferSize, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ).Detach();
 
         D3D12_SUBRESOURCE_DATA subresourceData = {};
         subresourceData.pData                  = bufferData;
@@ -134,8 +126,13 @@ void CubeApp::LoadVertices()
     m_IndexBufferView.SizeInBytes    = sizeof(g_Indicies);
     m_IndexBuffer->SetName(L"Index Buffer");
 
-    auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-    commandQueue->WaitForFenceValue(fenceValue);
+    // Nothing waits on the CPU, the first frame waits on the GPU and the
+    // intermediate buffers go once the copy is done.
+    m_UploadFenceValue = commandQueue->ExecuteCommandList(commandList);
+
+    auto releaseQueue = Application::Get().GetReleaseQueue();
+    releaseQueue->Release(intermediateVertexBuffer, *commandQueue, m_UploadFenceValue);
+    releaseQueue->Release(intermediateIndexBuffer, *commandQueue, m_UploadFenceValue);
 }
 
 bool CubeApp::LoadContent()
@@ -146,12 +143,8 @@ bool CubeApp::LoadContent()
 
     LoadVertices();
 
-    // Create the descriptor heap for the depth-stencil view.
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-    dsvHeapDesc.NumDescriptors             = 1;
-    dsvHeapDesc.Type                       = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    ThrowIfFailed(device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DSVHeap)));
+    // Allocate the depth-stencil view.
+    m_DepthStencilView = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->Allocate();
 
     // Load the vertex shader.
     ComPtr<ID3DBlob> vertexShaderBlob;
@@ -241,27 +234,27 @@ void CubeApp::ResizeDepthBuffer(int width, int height)
 {
     if (m_ContentLoaded)
     {
-        // Flush any GPU commands that might be referencing the depth buffer.
-        Application::Get().Flush();
-
         width  = std::max(1, width);
         height = std::max(1, height);
 
-        auto device = Application::Get().GetDevice();
+        auto device      = Application::Get().GetDevice();
+        auto allocator   = Application::Get().GetGpuAllocator();
+        auto directQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
         // Resize screen dependent resources.
-        // Create a depth buffer.
+        // Create a depth buffer. It is cleared before every use, as a placed
+        // resource needs.
         D3D12_CLEAR_VALUE optimizedClearValue = {};
         optimizedClearValue.Format            = DXGI_FORMAT_D32_FLOAT;
         optimizedClearValue.DepthStencil      = { 1.0f, 0 };
 
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+        // The frames in flight may still use the old one.
+        Application::Get().GetReleaseQueue()->Release(m_DepthBuffer, *directQueue);
+        m_DepthBuffer = allocator->CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
             D3D12_RESOURCE_STATE_DEPTH_WRITE,
-            &optimizedClearValue,
-            IID_PPV_ARGS(&m_DepthBuffer)));
+            &optimizedClearValue);
 
         // Update the depth-stencil view.
         D3D12_DEPTH_STENCIL_VIEW_DESC dsv = {};
@@ -270,7 +263,8 @@ void CubeApp::ResizeDepthBuffer(int width, int height)
         dsv.Texture2D.MipSlice            = 0;
         dsv.Flags                         = D3D12_DSV_FLAG_NONE;
 
-        device->CreateDepthStencilView(m_DepthBuffer.Get(), &dsv, m_DSVHeap->GetCPUDescriptorHandleForHeapStart());
+        auto dsvs = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+        device->CreateDepthStencilView(m_DepthBuffer.Get(), &dsv, dsvs->GetCpuHandle(m_DepthStencilView));
     }
 }
 
@@ -305,6 +299,12 @@ void CubeApp::ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> comm
 
 void CubeApp::UnloadContent()
 {
+    auto allocator = Application::Get().GetGpuAllocator();
+    allocator->Release(m_VertexBuffer);
+    allocator->Release(m_IndexBuffer);
+    allocator->Release(m_DepthBuffer);
+    Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->Free(m_DepthStencilView);
+
     m_ContentLoaded = false;
 }
 
@@ -374,10 +374,9 @@ void CubeApp::Render(double delta, double total)
     auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
     auto commandList  = commandQueue->GetCommandList();
 
-    UINT currentBackBufferIndex = window->GetCurrentBackBufferIndex();
-    auto backBuffer             = window->GetCurrentBackBuffer();
-    auto rtv                    = window->GetCurrentRenderTargetView();
-    auto dsv                    = m_DSVHeap->GetCPUDescriptorHandleForHeapStart();
+    auto backBuffer = window->GetCurrentBackBuffer();
+    auto rtv        = window->GetCurrentRenderTargetView();
+    auto dsv        = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->GetCpuHandle(m_DepthStencilView);
 
     // Clear the render targets.
     {
@@ -411,11 +410,17 @@ void CubeApp::Render(double delta, double total)
     {
         TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
 
-        m_FenceValues[currentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);
-
-        currentBackBufferIndex = window->Present();
-
-        commandQueue->WaitForFenceValue(m_FenceValues[currentBackBufferIndex]);
+        std::vector<QueueWait> waits;
+        if (m_UploadFenceValue != 0)
+        {
+            waits.push_back({ Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY).get(), m_UploadFenceValue });
+            m_UploadFenceValue = 0;
+        }
+        commandQueue->ExecuteCommandLists({ std::addressof(commandList), 1 }, waits);
+
+        // The next frame waits for the oldest one in flight, in
+        // FrameContext::BeginFrame.
+        window->Present();
     }
 }
 
@@ -63,7 +63,9 @@ private:
                     FLOAT                                              depth = 1.0f);
 
 private:
-    uint64_t m_FenceValues[Window::BufferCount] = {};
+    // COPY queue value of the vertex upload, the first frame waits for it
+    // on the GPU.
+    uint64_t m_UploadFenceValue = 0;
     // Vertex buffer for the cube.
     Microsoft::WRL::ComPtr<ID3D12Resource> m_VertexBuffer;
     D3D12_VERTEX_BUFFER_VIEW               m_VertexBufferView;
@@ -72,8 +74,8 @@ private:
     D3D12_INDEX_BUFFER_VIEW                m_IndexBufferView;
 
     Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthBuffer;
-    // Descriptor heap for depth buffer.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_DSVHeap;
+    // From the application's DSV allocator.
+    DescriptorHandle m_DepthStencilView;
 
     // Root signature
     Microsoft::WRL::ComPtr<ID3D12RootSignature> m_RootSignature;
@@ -0,0 +1,59 @@
+/**
+ * Objects waiting for a fence value before they can be destroyed.
+ *
+ * Bookkeeping only, like the UploadRing: fence values are plain integers
+ * and what "destroying" means is up to the callback given to Retire. The
+ * ReleaseQueue keeps one per command queue.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+
+template <typename T>
+class DeferredQueue
+{
+public:
+    // Keep `item` until `fenceValue` completes. Values usually come in
+    // increasing order, an older one is sorted in from the back.
+    void Push(uint64_t fenceValue, T item)
+    {
+        auto position = m_Entries.end();
+        while (position != m_Entries.begin() && std::prev(position)->fenceValue > fenceValue)
+            --position;
+        m_Entries.insert(position, Entry { fenceValue, std::move(item) });
+    }
+
+    // Hand every item whose fence value is at most `completedValue` to
+    // `release`, oldest first. Returns how many there were.
+    template <typename F>
+    size_t Retire(uint64_t completedValue, F&& release)
+    {
+        size_t count = 0;
+        while (!m_Entries.empty() && m_Entries.front().fenceValue <= completedValue)
+        {
+            T item = std::move(m_Entries.front().item);
+            m_Entries.pop_front();
+            release(std::move(item));
+            count++;
+        }
+        return count;
+    }
+
+    // Fence value to wait for so that the oldest item retires, 0 if empty.
+    uint64_t GetOldestFenceValue() const { return m_Entries.empty() ? 0 : m_Entries.front().fenceValue; }
+
+    size_t GetSize() const { return m_Entries.size(); }
+    bool   IsEmpty() const { return m_Entries.empty(); }
+
+private:
+    struct Entry
+    {
+        uint64_t fenceValue;
+        T        item;
+    };
+
+    std::deque<Entry> m_Entries;
+};
@@ -0,0 +1,114 @@
+#include "descriptorallocator.h"
+
+#include <assert.h>
+#include <stdexcept>
+
+using namespace Microsoft::WRL;
+
+static ComPtr<ID3D12DescriptorHeap> CreateHeap(ID3D12Device2*              device,
+                                               D3D12_DESCRIPTOR_HEAP_TYPE  type,
+                                               uint32_t                    count,
+                                               D3D12_DESCRIPTOR_HEAP_FLAGS flags)
+{
+    D3D12_DESCRIPTOR_HEAP_DESC desc = {};
+    desc.Type                       = type;
+    desc.NumDescriptors             = count;
+    desc.Flags                      = flags;
+
+    ComPtr<ID3D12DescriptorHeap> heap;
+    ThrowIfFailed(device->CreateDescriptorHeap(&desc, IID_PPV_ARGS(&heap)));
+    return heap;
+}
+
+DescriptorAllocator::DescriptorAllocator(ComPtr<ID3D12Device2>      device,
+                                         D3D12_DESCRIPTOR_HEAP_TYPE type,
+                                         uint32_t                   capacity) :
+    m_Type(type),
+    m_Heap(CreateHeap(device.Get(), type, capacity, D3D12_DESCRIPTOR_HEAP_FLAG_NONE)),
+    m_Start(m_Heap->GetCPUDescriptorHandleForHeapStart()),
+    m_IncrementSize(device->GetDescriptorHandleIncrementSize(type)),
+    m_Handles(capacity)
+{
+}
+
+DescriptorHandle DescriptorAllocator::Allocate()
+{
+    DescriptorHandle handle = m_Handles.Allocate();
+    if (!handle.IsValid())
+        throw std::runtime_error("DescriptorAllocator: heap full");
+    return handle;
+}
+
+void DescriptorAllocator::Free(DescriptorHandle handle)
+{
+    bool freed = m_Handles.Free(handle);
+    assert(freed && "Descriptor freed twice.");
+    (void)freed;
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE DescriptorAllocator::GetCpuHandle(DescriptorHandle handle) const
+{
+    assert(m_Handles.IsAlive(handle) && "Stale descriptor handle.");
+    return { m_Start.ptr + SIZE_T(handle.index) * m_IncrementSize };
+}
+
+ShaderVisibleHeap::ShaderVisibleHeap(ComPtr<ID3D12Device2> device,
+                                     uint32_t              persistentCount,
+                                     uint32_t              transientCount) :
+    m_Device(device),
+    m_Heap(CreateHeap(device.Get(),
+                      D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+                      persistentCount + transientCount,
+                      D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE)),
+    m_CpuStart(m_Heap->GetCPUDescriptorHandleForHeapStart()),
+    m_GpuStart(m_Heap->GetGPUDescriptorHandleForHeapStart()),
+    m_IncrementSize(device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV)),
+    m_Handles(persistentCount),
+    m_Ring(transientCount)
+{
+}
+
+DescriptorHandle ShaderVisibleHeap::AllocatePersistent()
+{
+    DescriptorHandle handle = m_Handles.Allocate();
+    if (!handle.IsValid())
+        throw std::runtime_error("ShaderVisibleHeap: persistent region full");
+    return handle;
+}
+
+void ShaderVisibleHeap::FreePersistent(DescriptorHandle handle)
+{
+    bool freed = m_Handles.Free(handle);
+    assert(freed && "Descriptor freed twice.");
+    (void)freed;
+}
+
+void ShaderVisibleHeap::CopyPersistent(DescriptorHandle handle, D3D12_CPU_DESCRIPTOR_HANDLE source)
+{
+    assert(m_Handles.IsAlive(handle) && "Stale descriptor handle.");
+    m_Device->CopyDescriptorsSimple(1, GetCpuHandle(handle.index), source, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE ShaderVisibleHeap::AllocateTransient(Span<const D3D12_CPU_DESCRIPTOR_HANDLE> sources)
+{
+    uint64_t offset = m_Ring.Allocate(sources.size(), 1);
+    if (offset == UploadRing::InvalidOffset)
+        throw std::runtime_error("ShaderVisibleHeap: transient ring full");
+
+    // One destination range, one source range per descriptor.
+    uint32_t                    first       = GetPersistentCount() + uint32_t(offset);
+    D3D12_CPU_DESCRIPTOR_HANDLE destination = GetCpuHandle(first);
+    UINT                        count       = UINT(sources.size());
+    m_Device->CopyDescriptors(1, &destination, &count, count, sources.data(), nullptr, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    return GetGpuHandle(first);
+}
+
+D3D12_CPU_DESCRIPTOR_HANDLE ShaderVisibleHeap::GetCpuHandle(uint32_t index) const
+{
+    return { m_CpuStart.ptr + SIZE_T(index) * m_IncrementSize };
+}
+
+D3D12_GPU_DESCRIPTOR_HANDLE ShaderVisibleHeap::GetGpuHandle(uint32_t index) const
+{
+    return { m_GpuStart.ptr + UINT64(index) * m_IncrementSize };
+}
@@ -0,0 +1,101 @@
+/**
+ * Descriptors.
+ *
+ * Views are created in large CPU only heaps, one DescriptorAllocator per
+ * type, and handed out through a lock-free HandlePool instead of a heap
+ * per caller. Shaders read them from the one ShaderVisibleHeap: its
+ * persistent region holds descriptors at fixed indices for bindless
+ * access, its transient region is a ring the descriptor tables of a frame
+ * are copied into, recycled once the frame's fence completes.
+ */
+#pragma once
+
+#include "handlepool.h"
+#include "helpers.h"
+#include "span.h"
+#include "uploadring.h"
+
+#include <stdint.h>
+
+// A descriptor of a DescriptorAllocator, or a persistent one of the
+// ShaderVisibleHeap. Its index is its bindless index in the latter.
+using DescriptorHandle = HandlePool::Handle;
+
+class DescriptorAllocator
+{
+public:
+    DescriptorAllocator(Microsoft::WRL::ComPtr<ID3D12Device2> device,
+                        D3D12_DESCRIPTOR_HEAP_TYPE            type,
+                        uint32_t                              capacity);
+
+    // Any thread. Throws when the heap is full.
+    DescriptorHandle Allocate();
+    // Any thread. RTVs, DSVs and staging views are read when recorded or
+    // copied, they can go as soon as that is done.
+    void Free(DescriptorHandle handle);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(DescriptorHandle handle) const;
+
+    D3D12_DESCRIPTOR_HEAP_TYPE GetType() const { return m_Type; }
+    uint32_t                   GetCapacity() const { return m_Handles.GetCapacity(); }
+    uint32_t                   GetAllocatedCount() const { return m_Handles.GetAllocatedCount(); }
+
+private:
+    D3D12_DESCRIPTOR_HEAP_TYPE                   m_Type;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
+    D3D12_CPU_DESCRIPTOR_HANDLE                  m_Start;
+    UINT                                         m_IncrementSize;
+    HandlePool                                   m_Handles;
+};
+
+class ShaderVisibleHeap
+{
+public:
+    ShaderVisibleHeap(Microsoft::WRL::ComPtr<ID3D12Device2> device,
+                      uint32_t                              persistentCount,
+                      uint32_t                              transientCount);
+
+    // The CBV_SRV_UAV heap to bind with SetDescriptorHeaps.
+    ID3D12DescriptorHeap* GetHeap() const { return m_Heap.Get(); }
+
+    /**
+     * Persistent descriptors, any thread. A descriptor freed while frames in
+     * flight may read it has to be freed once they complete, through
+     * FrameContext::Defer. Allocate throws when the region is full.
+     */
+    DescriptorHandle AllocatePersistent();
+    void             FreePersistent(DescriptorHandle handle);
+    // Copy the view at `source`, in a CPU only heap, to `handle`.
+    void CopyPersistent(DescriptorHandle handle, D3D12_CPU_DESCRIPTOR_HANDLE source);
+
+    /**
+     * Copy `sources` to consecutive transient descriptors and return the
+     * first one, for SetGraphicsRootDescriptorTable. Valid until the
+     * submission of the frame completes. Recording thread only, throws when
+     * the ring is full.
+     */
+    D3D12_GPU_DESCRIPTOR_HANDLE AllocateTransient(Span<const D3D12_CPU_DESCRIPTOR_HANDLE> sources);
+
+    // The transient descriptors allocated since the last call are read by
+    // the submission signaling `fenceValue`.
+    void Submit(uint64_t fenceValue) { m_Ring.Submit(fenceValue); }
+    // Recycle the transient descriptors up to `completedValue`.
+    void Retire(uint64_t completedValue) { m_Ring.Retire(completedValue); }
+
+    D3D12_CPU_DESCRIPTOR_HANDLE GetCpuHandle(uint32_t index) const;
+    D3D12_GPU_DESCRIPTOR_HANDLE GetGpuHandle(uint32_t index) const;
+
+    uint32_t GetPersistentCount() const { return m_Handles.GetCapacity(); }
+    uint32_t GetAllocatedPersistentCount() const { return m_Handles.GetAllocatedCount(); }
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device2>        m_Device;
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_Heap;
+    D3D12_CPU_DESCRIPTOR_HANDLE                  m_CpuStart;
+    D3D12_GPU_DESCRIPTOR_HANDLE                  m_GpuStart;
+    UINT                                         m_IncrementSize;
+
+    // [0, persistentCount) persistent, the transient ring after it.
+    HandlePool m_Handles;
+    UploadRing m_Ring;
+};
@@ -0,0 +1,67 @@
+#include "drawcull.h"
+
+#include <cmath>
+
+// Fill `draw` if the source is visible. Built without contracting the
+// multiplies and adds into fused ones, the shader does not either.
+static bool CullDraw(const DrawCullConstants& constants,
+                     const DrawSource&        source,
+                     const MeshLod*           lods,
+                     IndirectDraw&            draw)
+{
+    const glm::vec4& offset = source.dequant.offset;
+    const glm::vec4& scale  = source.dequant.scale;
+
+    float cx     = offset.x + scale.x * 0.5f;
+    float cy     = offset.y + scale.y * 0.5f;
+    float cz     = offset.z + scale.z * 0.5f;
+    float radius = std::sqrt(scale.x * scale.x + scale.y * scale.y + scale.z * scale.z) * 0.5f;
+
+    for (int p = 0; p < 6; p++)
+    {
+        const glm::vec4& plane = constants.planes[p];
+        if (plane.x * cx + plane.y * cy + plane.z * cz + plane.w < -radius)
+            return false;
+    }
+
+    // World space distance to the sphere, like MeshApp::SelectLod. The error
+    // test is multiplied through by it instead of dividing.
+    float dx       = cx - constants.eye.x;
+    float dy       = cy - constants.eye.y;
+    float dz       = cz - constants.eye.z;
+    float distance = (std::sqrt(dx * dx + dy * dy + dz * dz) - radius) * constants.eye.w;
+    distance       = distance > 1.0f ? distance : 1.0f;
+
+    uint32_t lod = source.lod_offset;
+    for (uint32_t level = source.lod_count; level-- > 1;)
+    {
+        if (lods[source.lod_offset + level].error * constants.lod_scale <= constants.lod_error_pixels * distance)
+        {
+            lod = source.lod_offset + level;
+            break;
+        }
+    }
+
+    draw.material             = source.material;
+    draw.dequant              = source.dequant;
+    draw.args.index_count     = lods[lod].index_count;
+    draw.args.instance_count  = 1;
+    draw.args.index_offset    = lods[lod].index_offset;
+    draw.args.vertex_offset   = 0;
+    draw.args.instance_offset = 0;
+    return true;
+}
+
+uint32_t CullDraws(const DrawCullConstants& constants,
+                   const DrawSource*        sources,
+                   const MeshLod*           lods,
+                   IndirectDraw*            out)
+{
+    uint32_t count = 0;
+    for (uint32_t d = 0; d < constants.draw_count; d++)
+    {
+        if (CullDraw(constants, sources[d], lods, out[count]))
+            count++;
+    }
+    return count;
+}
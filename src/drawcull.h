@@ -0,0 +1,80 @@
+/**
+ * Draw culling and compaction, the CPU reference of the DrawCull compute
+ * shader.
+ *
+ * Every submesh has a DrawSource. Culling tests its bounding sphere, taken
+ * from its quantization box, against the frustum, picks its level of
+ * detail like MeshApp::SelectLod, and appends an IndirectDraw for the
+ * visible ones, in submesh order. The shader writes the same array into the
+ * argument buffer ExecuteIndirect reads, so the CPU only records one
+ * dispatch and one ExecuteIndirect however many submeshes there are.
+ *
+ * The math is done in object space with multiplies, adds and square roots
+ * written out in the same order as the shader, which marks it precise, so
+ * both produce the same draws bit for bit as long as the GPU rounds its
+ * square roots correctly. The structs below are laid out as the shader's.
+ */
+#pragma once
+
+#include "meshdata.h"
+#include "vertexformat.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Layout of D3D12_DRAW_INDEXED_ARGUMENTS.
+struct DrawIndexedArgs
+{
+    uint32_t index_count;
+    uint32_t instance_count;
+    uint32_t index_offset;
+    int32_t  vertex_offset;
+    uint32_t instance_offset;
+};
+
+struct DrawSource
+{
+    VertexQuantization dequant;
+    uint32_t           material;
+    // Range of MeshBuffers::lods, the first is the full submesh.
+    uint32_t lod_offset;
+    uint32_t lod_count;
+    uint32_t padding;
+};
+
+// One command of the indirect argument buffer: the material index and
+// dequantization root constants, then the draw.
+struct IndirectDraw
+{
+    uint32_t           material;
+    VertexQuantization dequant;
+    DrawIndexedArgs    args;
+};
+
+static_assert(sizeof(DrawSource) == 48, "DrawSource must match DrawCull.hlsl");
+static_assert(sizeof(IndirectDraw) == 56, "IndirectDraw must match DrawCull.hlsl");
+
+// Constants of a culling pass.
+struct DrawCullConstants
+{
+    // Frustum planes in object space, see ExtractFrustumPlanes.
+    glm::vec4 planes[6];
+    // Eye position in object space, w is the uniform scale of the model.
+    glm::vec4 eye;
+    // Pixels per object space unit at a distance of one world unit.
+    float    lod_scale;
+    // Largest LOD error allowed on screen, in pixels.
+    float    lod_error_pixels;
+    uint32_t draw_count;
+    uint32_t padding;
+};
+
+/**
+ * Cull `constants.draw_count` sources and write the visible draws to `out`,
+ * which has room for all of them, in source order. Returns how many were
+ * written.
+ */
+uint32_t CullDraws(const DrawCullConstants& constants,
+                   const DrawSource*        sources,
+                   const MeshLod*           lods,
+                   IndirectDraw*            out);
@@ -0,0 +1,56 @@
+/**
+ * Recording of the CPU path's submesh draws.
+ *
+ * MeshApp::RenderMesh splits the draws into contiguous ranges, one job and
+ * command list each, submitted in order. The per draw loop is a template
+ * over the command list, so the recording benchmark runs it against a stub.
+ */
+#pragma once
+
+#include "meshdata.h"
+#include "vertexformat.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+// Fewest draws worth a command list and a recording job of their own.
+constexpr size_t kDrawsPerRecordJob = 256;
+
+// Jobs to record `drawCount` draws with on `threadCount` threads.
+inline size_t GetRecordJobCount(size_t drawCount, size_t threadCount)
+{
+    return std::max<size_t>(1, std::min(threadCount, (drawCount + kDrawsPerRecordJob - 1) / kDrawsPerRecordJob));
+}
+
+/**
+ * Draw the visible submeshes of [begin, end), the material index and the
+ * vertex dequantization pushed as root constants, at the level
+ * `getLod(s)` picks.
+ *
+ * @param materialCount Size of the material table, out of range materials
+ *                      use its last entry, the default material.
+ */
+template <typename CommandList, typename GetLod>
+void RecordSubmeshDraws(CommandList*              commandList,
+                        const MeshSubMesh*        submeshes,
+                        const uint8_t*            visible,
+                        const VertexQuantization* quantization,
+                        uint32_t                  materialCount,
+                        size_t                    begin,
+                        size_t                    end,
+                        GetLod&&                  getLod)
+{
+    for (size_t s = begin; s < end; s++)
+    {
+        if (!visible[s])
+            continue;
+
+        const MeshLod& lod      = getLod(s);
+        uint32_t       material = std::min<uint32_t>(submeshes[s].material_id, materialCount - 1);
+
+        commandList->SetGraphicsRoot32BitConstant(1, material, 0);
+        commandList->SetGraphicsRoot32BitConstants(2, sizeof(VertexQuantization) / sizeof(uint32_t), &quantization[s], 0);
+        commandList->DrawIndexedInstanced(lod.index_count, 1, lod.index_offset, 0, 0);
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * Per thread pools of objects recycled by fence value.
+ *
+ * Command allocators can only be reset once the GPU is done with what was
+ * recorded into them. Each thread takes them from a pool of its own
+ * without locking, and whoever submits gives them back through the pool's
+ * MpscQueue with the fence value to wait for. Acquire looks at every
+ * returned object, not only the oldest, so a single one still in flight
+ * does not force a new creation.
+ *
+ * Bookkeeping only, fence values are plain integers.
+ */
+#pragma once
+
+#include "mpscqueue.h"
+
+#include <assert.h>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+// Most threads that may use the pools at the same time.
+constexpr uint32_t MaxThreadSlots = 64;
+
+// Index in [0, MaxThreadSlots) of the calling thread, unique among live
+// threads. It is given back when the thread exits, threads come and go
+// with every ParallelFor.
+inline uint32_t GetThreadSlot()
+{
+    static std::atomic<uint64_t> used { 0 };
+
+    struct Slot
+    {
+        uint32_t index;
+
+        Slot()
+        {
+            uint64_t current = used.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                if (~current == 0)
+                    throw std::runtime_error("GetThreadSlot: more than MaxThreadSlots threads");
+                uint32_t free = 0;
+                while (current & (1ull << free))
+                    free++;
+                if (used.compare_exchange_weak(current, current | (1ull << free), std::memory_order_acquire))
+                {
+                    index = free;
+                    return;
+                }
+            }
+        }
+        ~Slot() { used.fetch_and(~(1ull << index), std::memory_order_release); }
+    };
+    thread_local Slot slot;
+    return slot.index;
+}
+
+struct FencedPoolStats
+{
+    uint64_t created  = 0;
+    uint64_t recycled = 0;
+};
+
+template <typename T>
+class FencedPool
+{
+public:
+    /**
+     * Calling thread only. Move an object whose fence value is at most
+     * `completedValue` to `object`, or return false and count a creation,
+     * the caller makes a new one then.
+     */
+    bool Acquire(uint64_t completedValue, T& object)
+    {
+        m_Returned.Drain([this](Entry entry) { m_Entries.push_back(std::move(entry)); });
+
+        for (size_t i = 0; i < m_Entries.size(); i++)
+        {
+            if (m_Entries[i].fenceValue <= completedValue)
+            {
+                object       = std::move(m_Entries[i].object);
+                m_Entries[i] = std::move(m_Entries.back());
+                m_Entries.pop_back();
+                m_Recycled.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        m_Created.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    // Any thread. `object` can be reused once `fenceValue` completes, 0 if
+    // right away.
+    void Return(uint64_t fenceValue, T object) { m_Returned.Push({ fenceValue, std::move(object) }); }
+
+    FencedPoolStats GetStats() const
+    {
+        return { m_Created.load(std::memory_order_relaxed), m_Recycled.load(std::memory_order_relaxed) };
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t fenceValue;
+        T        object;
+    };
+
+    MpscQueue<Entry>   m_Returned;
+    std::vector<Entry> m_Entries;
+
+    std::atomic<uint64_t> m_Created { 0 };
+    std::atomic<uint64_t> m_Recycled { 0 };
+};
+
+// One FencedPool per thread slot, created on first use.
+template <typename T>
+class FencedPools
+{
+public:
+    FencedPools()
+    {
+        for (auto& pool : m_Pools)
+            pool.store(nullptr, std::memory_order_relaxed);
+    }
+    FencedPools(const FencedPools&) = delete;
+    FencedPools& operator=(const FencedPools&) = delete;
+
+    ~FencedPools()
+    {
+        for (auto& pool : m_Pools)
+            delete pool.load(std::memory_order_relaxed);
+    }
+
+    // The pool of `slot`, GetThreadSlot() for the calling thread's own.
+    FencedPool<T>& Get(uint32_t slot)
+    {
+        assert(slot < MaxThreadSlots);
+        FencedPool<T>* pool = m_Pools[slot].load(std::memory_order_acquire);
+        if (!pool)
+        {
+            // Only the thread owning the slot gets here, others only return
+            // objects that came out of an existing pool.
+            pool = new FencedPool<T>();
+            m_Pools[slot].store(pool, std::memory_order_release);
+        }
+        return *pool;
+    }
+
+    // Summed over every pool.
+    FencedPoolStats GetStats() const
+    {
+        FencedPoolStats stats;
+        for (auto& pool : m_Pools)
+        {
+            if (FencedPool<T>* p = pool.load(std::memory_order_acquire))
+            {
+                FencedPoolStats s = p->GetStats();
+                stats.created += s.created;
+                stats.recycled += s.recycled;
+            }
+        }
+        return stats;
+    }
+
+private:
+    std::atomic<FencedPool<T>*> m_Pools[MaxThreadSlots];
+};
@@ -0,0 +1,90 @@
+#include "fencewatcher.h"
+#include "mailbox.h"
+
+void CpuFenceWaiter::WaitAny(Span<const FenceTarget> targets)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Condition.wait(lock, [&]() {
+        if (m_Woken)
+            return true;
+        for (const FenceTarget& target : targets)
+        {
+            if (target.fence->GetCompletedFenceValue() >= target.fenceValue)
+                return true;
+        }
+        return false;
+    });
+    m_Woken = false;
+}
+
+void CpuFenceWaiter::Wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Woken = true;
+    }
+    m_Condition.notify_one();
+}
+
+FenceWatcher::FenceWatcher(std::shared_ptr<FenceWaiter> waiter) :
+    m_Waiter(waiter)
+{
+    m_Thread = std::thread([this]() { ThreadLoop(); });
+}
+
+FenceWatcher::~FenceWatcher()
+{
+    m_Quit.store(true);
+    m_Waiter->Wake();
+    m_Thread.join();
+}
+
+void FenceWatcher::Watch(const WatchedFence& fence, uint64_t fenceValue, Callback callback)
+{
+    m_Incoming.Push({ &fence, fenceValue, std::move(callback) });
+    m_Waiter->Wake();
+}
+
+void FenceWatcher::Watch(const WatchedFence& fence, uint64_t fenceValue, Mailbox& mailbox, Callback callback)
+{
+    Watch(fence, fenceValue, [&mailbox, callback = std::move(callback)]() mutable { mailbox.Post(std::move(callback)); });
+}
+
+void FenceWatcher::ThreadLoop()
+{
+    std::vector<FenceTarget> targets;
+    std::vector<Callback>    due;
+    while (!m_Quit.load())
+    {
+        m_Incoming.Drain([&](Registration registration) {
+            auto pending = m_Pending.begin();
+            while (pending != m_Pending.end() && pending->fence != registration.fence)
+                ++pending;
+            if (pending == m_Pending.end())
+                pending = m_Pending.insert(pending, Pending { registration.fence, {} });
+            pending->callbacks.Push(registration.fenceValue, std::move(registration.callback));
+        });
+
+        targets.clear();
+        for (Pending& pending : m_Pending)
+        {
+            if (pending.callbacks.IsEmpty())
+                continue;
+            uint64_t completed = pending.fence->GetCompletedFenceValue();
+            pending.callbacks.Retire(completed, [&](Callback callback) { due.push_back(std::move(callback)); });
+            if (!pending.callbacks.IsEmpty())
+                targets.push_back({ pending.fence, pending.callbacks.GetOldestFenceValue() });
+        }
+
+        if (!due.empty())
+        {
+            for (Callback& callback : due)
+                callback();
+            m_Completed.fetch_add(due.size(), std::memory_order_relaxed);
+            due.clear();
+            // The callbacks took a while, fences may have moved meanwhile.
+            continue;
+        }
+        m_Waiter->WaitAny(targets);
+    }
+}
@@ -0,0 +1,139 @@
+/**
+ * Callbacks on fence completion, from one wait thread.
+ *
+ * Any thread registers a fence value with a callback. The watcher thread
+ * sleeps until one of the watched fences reaches the oldest value
+ * registered on it and runs the callbacks that are due, or posts them to a
+ * Mailbox. Nothing else has to block on a fence to learn it completed.
+ *
+ * How the thread sleeps is up to a FenceWaiter: the D3D12 one waits on the
+ * command queue fences, the CpuFenceWaiter on a condition variable for
+ * CpuFences signaled by other threads.
+ */
+#pragma once
+
+#include "deferredqueue.h"
+#include "mpscqueue.h"
+#include "span.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Mailbox;
+
+// A fence the watcher can wait on.
+class WatchedFence
+{
+public:
+    virtual ~WatchedFence() = default;
+
+    virtual uint64_t GetCompletedFenceValue() const = 0;
+};
+
+struct FenceTarget
+{
+    const WatchedFence* fence;
+    uint64_t            fenceValue;
+};
+
+class FenceWaiter
+{
+public:
+    virtual ~FenceWaiter() = default;
+
+    // Block until one of `targets` completes or Wake is called, may return
+    // early. A Wake before the call makes it return at once.
+    virtual void WaitAny(Span<const FenceTarget> targets) = 0;
+    // Any thread.
+    virtual void Wake() = 0;
+};
+
+class CpuFenceWaiter : public FenceWaiter
+{
+public:
+    void WaitAny(Span<const FenceTarget> targets) override;
+    void Wake() override;
+
+private:
+    std::mutex              m_Mutex;
+    std::condition_variable m_Condition;
+    bool                    m_Woken = false;
+};
+
+// A fence signaled from the CPU, for timelines that are not a queue.
+class CpuFence : public WatchedFence
+{
+public:
+    explicit CpuFence(CpuFenceWaiter& waiter) :
+        m_Waiter(waiter)
+    {
+    }
+
+    uint64_t GetCompletedFenceValue() const override { return m_Value.load(std::memory_order_acquire); }
+
+    // Values must increase.
+    void Signal(uint64_t fenceValue)
+    {
+        m_Value.store(fenceValue, std::memory_order_release);
+        m_Waiter.Wake();
+    }
+
+private:
+    CpuFenceWaiter&       m_Waiter;
+    std::atomic<uint64_t> m_Value = { 0 };
+};
+
+class FenceWatcher
+{
+public:
+    using Callback = std::function<void()>;
+
+    explicit FenceWatcher(std::shared_ptr<FenceWaiter> waiter);
+    // Stops the thread. Callbacks not due yet are dropped.
+    ~FenceWatcher();
+
+    FenceWatcher(const FenceWatcher&) = delete;
+    FenceWatcher& operator=(const FenceWatcher&) = delete;
+
+    // Run `callback` on the watcher thread once `fence` reaches
+    // `fenceValue`. It should be short, it delays the others. Any thread,
+    // does not block.
+    void Watch(const WatchedFence& fence, uint64_t fenceValue, Callback callback);
+    // Post `callback` to `mailbox` instead, to run on its thread.
+    void Watch(const WatchedFence& fence, uint64_t fenceValue, Mailbox& mailbox, Callback callback);
+
+    // Callbacks run so far.
+    uint64_t GetCompletedCount() const { return m_Completed.load(std::memory_order_relaxed); }
+
+private:
+    void ThreadLoop();
+
+    struct Registration
+    {
+        const WatchedFence* fence;
+        uint64_t            fenceValue;
+        Callback            callback;
+    };
+
+    std::shared_ptr<FenceWaiter> m_Waiter;
+    MpscQueue<Registration>      m_Incoming;
+    std::atomic<bool>            m_Quit      = { false };
+    std::atomic<uint64_t>        m_Completed = { 0 };
+
+    // Owned by the watcher thread. A handful of fences at most, found by a
+    // linear search.
+    struct Pending
+    {
+        const WatchedFence*     fence;
+        DeferredQueue<Callback> callbacks;
+    };
+    std::vector<Pending> m_Pending;
+
+    std::thread m_Thread;
+};
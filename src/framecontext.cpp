@@ -0,0 +1,73 @@
+#include "framecontext.h"
+#include "commandqueue.h"
+#include "descriptorallocator.h"
+#include "gpuallocator.h"
+
+using namespace Microsoft::WRL;
+
+FrameContext::FrameContext(std::shared_ptr<CommandQueue>      queue,
+                           std::shared_ptr<GpuAllocator>      allocator,
+                           std::shared_ptr<ShaderVisibleHeap> descriptors,
+                           uint32_t                           framesInFlight) :
+    m_Queue(queue),
+    m_Allocator(allocator),
+    m_Descriptors(descriptors),
+    m_Pacer(framesInFlight),
+    m_ConstantAllocator(allocator),
+    m_Releases(m_Pacer.GetFramesInFlight())
+{
+}
+
+FrameContext::~FrameContext()
+{
+    for (auto& releases : m_Releases)
+    {
+        for (auto& release : releases)
+            release();
+    }
+    for (auto& release : m_Pending)
+        release();
+}
+
+void FrameContext::BeginFrame()
+{
+    uint64_t fenceValue = m_Pacer.BeginFrame();
+    // The only CPU wait of the frame, for the frame N back.
+    m_Queue->WaitForFenceValue(fenceValue);
+
+    uint64_t completed = m_Queue->GetCompletedFenceValue();
+    m_ConstantAllocator.Retire(completed);
+    m_Descriptors->Retire(completed);
+    std::vector<std::function<void()>> releases = std::move(m_Releases[m_Pacer.GetFrameIndex()]);
+    m_Releases[m_Pacer.GetFrameIndex()].clear();
+    for (auto& release : releases)
+        release();
+}
+
+void FrameContext::EndFrame()
+{
+    uint64_t fenceValue = m_Queue->GetLastFenceValue();
+    m_ConstantAllocator.Submit(fenceValue);
+    m_Descriptors->Submit(fenceValue);
+    m_Pacer.EndFrame(fenceValue);
+
+    auto& releases = m_Releases[m_Pacer.GetFrameIndex()];
+    for (auto& release : m_Pending)
+        releases.push_back(std::move(release));
+    m_Pending.clear();
+}
+
+void FrameContext::Defer(std::function<void()> release)
+{
+    m_Pending.push_back(std::move(release));
+}
+
+void FrameContext::Release(ComPtr<ID3D12Resource>& resource)
+{
+    if (!resource)
+        return;
+
+    std::shared_ptr<GpuAllocator> allocator = m_Allocator;
+    ComPtr<ID3D12Resource>        released  = std::move(resource);
+    Defer([allocator, released]() mutable { allocator->Release(released); });
+}
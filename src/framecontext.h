@@ -0,0 +1,69 @@
+/**
+ * Resources of the frames in flight on the DIRECT queue.
+ *
+ * The application loop begins a frame right before Render and ends it
+ * right after. Beginning waits for the oldest frame in flight only, see
+ * FramePacer, then recycles what that frame used: its constant memory, its
+ * transient descriptors and the objects released while it was recorded.
+ * Everything a frame allocates here stays valid until the GPU is done with
+ * it, without the CPU waiting for the previous frame.
+ *
+ * Not thread safe, used from the application loop.
+ */
+#pragma once
+
+#include "framepacer.h"
+#include "helpers.h"
+#include "uploadallocator.h"
+
+#include <functional>
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CommandQueue;
+class GpuAllocator;
+class ShaderVisibleHeap;
+
+class FrameContext
+{
+public:
+    FrameContext(std::shared_ptr<CommandQueue>      queue,
+                 std::shared_ptr<GpuAllocator>      allocator,
+                 std::shared_ptr<ShaderVisibleHeap> descriptors,
+                 uint32_t                           framesInFlight);
+    // Runs what is still deferred, the GPU has to be idle.
+    ~FrameContext();
+
+    // Wait for the oldest frame in flight and recycle its resources.
+    void BeginFrame();
+    // The frame's work is everything submitted to the queue so far.
+    void EndFrame();
+
+    // Constants of the current frame.
+    UploadAllocator& GetConstantAllocator() { return m_ConstantAllocator; }
+    // Descriptors of the current frame, see ShaderVisibleHeap::AllocateTransient.
+    ShaderVisibleHeap& GetDescriptorHeap() { return *m_Descriptors; }
+
+    // Run `release` once the current frame completes, or the next one
+    // between frames.
+    void Defer(std::function<void()> release);
+    // Same for a resource, which is reset.
+    void Release(Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+    uint32_t GetFramesInFlight() const { return m_Pacer.GetFramesInFlight(); }
+    uint32_t GetFrameIndex() const { return m_Pacer.GetFrameIndex(); }
+    uint64_t GetFrameNumber() const { return m_Pacer.GetFrameNumber(); }
+
+private:
+    std::shared_ptr<CommandQueue>      m_Queue;
+    std::shared_ptr<GpuAllocator>      m_Allocator;
+    std::shared_ptr<ShaderVisibleHeap> m_Descriptors;
+
+    FramePacer      m_Pacer;
+    UploadAllocator m_ConstantAllocator;
+
+    // Per slot, what the last frame using it released.
+    std::vector<std::vector<std::function<void()>>> m_Releases;
+    std::vector<std::function<void()>>              m_Pending;
+};
@@ -0,0 +1,38 @@
+#include "framepacer.h"
+
+#include <assert.h>
+
+FramePacer::FramePacer(uint32_t framesInFlight) :
+    m_FenceValues(framesInFlight > 0 ? framesInFlight : 1, 0)
+{
+}
+
+uint64_t FramePacer::BeginFrame()
+{
+    assert(!m_InFrame);
+    // The first frame takes slot 0.
+    if (m_FrameNumber > 0)
+        m_FrameIndex = (m_FrameIndex + 1) % GetFramesInFlight();
+    m_FrameNumber++;
+    m_InFrame = true;
+    return m_FenceValues[m_FrameIndex];
+}
+
+void FramePacer::EndFrame(uint64_t fenceValue)
+{
+    assert(m_InFrame);
+    assert(fenceValue >= m_FenceValues[(m_FrameIndex + GetFramesInFlight() - 1) % GetFramesInFlight()]);
+    m_FenceValues[m_FrameIndex] = fenceValue;
+    m_InFrame                   = false;
+}
+
+uint32_t FramePacer::GetPendingFrameCount(uint64_t completedValue) const
+{
+    uint32_t count = 0;
+    for (uint64_t fenceValue : m_FenceValues)
+    {
+        if (fenceValue > completedValue)
+            count++;
+    }
+    return count;
+}
@@ -0,0 +1,47 @@
+/**
+ * Frames in flight.
+ *
+ * Bookkeeping only, like the LinearAllocator: the CPU records a frame
+ * while the GPU still runs up to N - 1 earlier ones. Every one of the N
+ * slots keeps the fence value of the last frame that used it, so starting a
+ * frame waits for the oldest frame in flight only, not for the previous
+ * one, and whatever is versioned per slot can be reused once that wait
+ * returns.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class FramePacer
+{
+public:
+    explicit FramePacer(uint32_t framesInFlight);
+
+    /**
+     * Start the next frame on the next slot. Returns the fence value the
+     * CPU has to wait for before touching what the slot holds, the one of
+     * the frame N frames back, 0 if there is none.
+     */
+    uint64_t BeginFrame();
+
+    // The work of the current frame completes at `fenceValue`. Values must
+    // not decrease.
+    void EndFrame(uint64_t fenceValue);
+
+    uint32_t GetFramesInFlight() const { return uint32_t(m_FenceValues.size()); }
+    // Slot of the current frame.
+    uint32_t GetFrameIndex() const { return m_FrameIndex; }
+    // Frames started so far.
+    uint64_t GetFrameNumber() const { return m_FrameNumber; }
+    bool     IsInFrame() const { return m_InFrame; }
+
+    // Ended frames the GPU has not finished, given its completed value.
+    uint32_t GetPendingFrameCount(uint64_t completedValue) const;
+
+private:
+    std::vector<uint64_t> m_FenceValues;
+    uint32_t              m_FrameIndex  = 0;
+    uint64_t              m_FrameNumber = 0;
+    bool                  m_InFrame     = false;
+};
@@ -0,0 +1,364 @@
+#include "gpuallocator.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+using namespace Microsoft::WRL;
+
+namespace
+{
+D3D12_HEAP_TYPE GetHeapType(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+        case GpuMemoryCategory::UploadBuffer:
+            return D3D12_HEAP_TYPE_UPLOAD;
+        case GpuMemoryCategory::ReadbackBuffer:
+            return D3D12_HEAP_TYPE_READBACK;
+        default:
+            return D3D12_HEAP_TYPE_DEFAULT;
+    }
+}
+
+D3D12_HEAP_FLAGS GetHeapFlags(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+        case GpuMemoryCategory::Texture:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+        case GpuMemoryCategory::RenderTarget:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES;
+        default:
+            return D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    }
+}
+
+// MSAA targets need 4MB, and only render targets and depth buffers can be
+// multisampled.
+uint64_t GetHeapAlignment(GpuMemoryCategory category)
+{
+    return category == GpuMemoryCategory::RenderTarget ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT :
+                                                         D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+// Private data of our resources, their GpuAllocator::PlacementHandle.
+// {7c1f3a52-9d4e-4b8a-a6f0-2e5d81c94b37}
+const GUID kPlacementHandleGuid = { 0x7c1f3a52, 0x9d4e, 0x4b8a, { 0xa6, 0xf0, 0x2e, 0x5d, 0x81, 0xc9, 0x4b, 0x37 } };
+} // namespace
+
+GpuAllocator::GpuAllocator(ComPtr<ID3D12Device2> device, uint64_t heapSize) :
+    m_Device(device),
+    m_HeapSize(heapSize)
+{
+}
+
+GpuAllocator::PlacementHandle GpuAllocator::GetHandle(const Placement& placement)
+{
+    return uint64_t(placement.category) << 56 | uint64_t(placement.heap) << 32 | placement.allocation.block;
+}
+
+GpuMemoryCategory GpuAllocator::GetCategory(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+    {
+        switch (heapType)
+        {
+            case D3D12_HEAP_TYPE_DEFAULT:
+                return GpuMemoryCategory::Buffer;
+            case D3D12_HEAP_TYPE_UPLOAD:
+                return GpuMemoryCategory::UploadBuffer;
+            case D3D12_HEAP_TYPE_READBACK:
+                return GpuMemoryCategory::ReadbackBuffer;
+            default:
+                throw std::invalid_argument("GpuAllocator: unsupported heap type");
+        }
+    }
+    if (heapType != D3D12_HEAP_TYPE_DEFAULT)
+        throw std::invalid_argument("GpuAllocator: textures live in the default heap");
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return GpuMemoryCategory::RenderTarget;
+    return GpuMemoryCategory::Texture;
+}
+
+const char* GpuAllocator::GetCategoryName(GpuMemoryCategory category)
+{
+    switch (category)
+    {
+        case GpuMemoryCategory::Buffer:
+            return "buffers";
+        case GpuMemoryCategory::UploadBuffer:
+            return "upload buffers";
+        case GpuMemoryCategory::ReadbackBuffer:
+            return "readback buffers";
+        case GpuMemoryCategory::Texture:
+            return "textures";
+        case GpuMemoryCategory::RenderTarget:
+            return "render targets";
+        default:
+            return "unknown";
+    }
+}
+
+D3D12_RESOURCE_ALLOCATION_INFO GpuAllocator::GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const
+{
+    // Small textures can be 4KB aligned, the device tells whether this one
+    // qualifies by returning that alignment.
+    bool target = (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)) != 0;
+    if (desc.Dimension != D3D12_RESOURCE_DIMENSION_BUFFER && desc.Alignment == 0 && !target && desc.SampleDesc.Count <= 1)
+    {
+        desc.Alignment                      = D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT;
+        D3D12_RESOURCE_ALLOCATION_INFO info = m_Device->GetResourceAllocationInfo(0, 1, &desc);
+        if (info.Alignment == D3D12_SMALL_RESOURCE_PLACEMENT_ALIGNMENT)
+            return info;
+        desc.Alignment = 0;
+    }
+    return m_Device->GetResourceAllocationInfo(0, 1, &desc);
+}
+
+uint32_t GpuAllocator::CreateHeap(GpuMemoryCategory category, uint64_t size, bool dedicated)
+{
+    uint64_t alignment = GetHeapAlignment(category);
+    size               = AlignUp(size, alignment);
+
+    Heap heap;
+    CD3DX12_HEAP_DESC desc(size, GetHeapType(category), alignment, GetHeapFlags(category));
+    ThrowIfFailed(m_Device->CreateHeap(&desc, IID_PPV_ARGS(&heap.heap)));
+    heap.allocator = std::make_unique<TlsfAllocator>(size);
+    heap.dedicated = dedicated;
+
+    std::vector<Heap>& heaps = m_Heaps[size_t(category)];
+    auto               slot  = std::find_if(heaps.begin(), heaps.end(), [](const Heap& h) { return !h.heap; });
+    if (slot != heaps.end())
+    {
+        *slot = std::move(heap);
+        return uint32_t(slot - heaps.begin());
+    }
+    heaps.push_back(std::move(heap));
+    return uint32_t(heaps.size() - 1);
+}
+
+void GpuAllocator::AllocateLocked(Placement& placement)
+{
+    std::vector<Heap>& heaps = m_Heaps[size_t(placement.category)];
+    if (placement.size <= m_HeapSize)
+    {
+        for (uint32_t i = 0; i < heaps.size(); i++)
+        {
+            if (!heaps[i].heap || heaps[i].dedicated)
+                continue;
+            placement.allocation = heaps[i].allocator->Allocate(placement.size, placement.alignment);
+            if (placement.allocation.offset != TlsfAllocator::InvalidOffset)
+            {
+                placement.heap = i;
+                return;
+            }
+        }
+    }
+
+    bool dedicated       = placement.size > m_HeapSize;
+    placement.heap       = CreateHeap(placement.category, dedicated ? placement.size : m_HeapSize, dedicated);
+    placement.allocation = heaps[placement.heap].allocator->Allocate(placement.size, placement.alignment);
+    if (placement.allocation.offset == TlsfAllocator::InvalidOffset)
+        throw std::runtime_error("GpuAllocator: resource does not fit a new heap");
+}
+
+void GpuAllocator::FreeLocked(const Placement& placement)
+{
+    Heap& heap = m_Heaps[size_t(placement.category)][placement.heap];
+    heap.allocator->Free(placement.allocation);
+    if (heap.dedicated && heap.allocator->GetAllocationCount() == 0)
+    {
+        heap.heap.Reset();
+        heap.allocator.reset();
+    }
+}
+
+ComPtr<ID3D12Resource> GpuAllocator::CreatePlacedLocked(Placement&               placement,
+                                                        D3D12_RESOURCE_STATES    initialState,
+                                                        const D3D12_CLEAR_VALUE* clearValue)
+{
+    ComPtr<ID3D12Resource> resource;
+    PlacementHandle        handle = GetHandle(placement);
+    try
+    {
+        ThrowIfFailed(m_Device->CreatePlacedResource(m_Heaps[size_t(placement.category)][placement.heap].heap.Get(),
+                                                     placement.allocation.offset,
+                                                     &placement.desc,
+                                                     initialState,
+                                                     clearValue,
+                                                     IID_PPV_ARGS(&resource)));
+        ThrowIfFailed(resource->SetPrivateData(kPlacementHandleGuid, sizeof(handle), &handle));
+    }
+    catch (...)
+    {
+        FreeLocked(placement);
+        throw;
+    }
+    placement.resource   = resource.Get();
+    m_Placements[handle] = placement;
+    return resource;
+}
+
+GpuAllocator::PlacementMap::iterator GpuAllocator::FindLocked(ID3D12Resource* resource)
+{
+    PlacementHandle handle;
+    UINT            size = sizeof(handle);
+    if (FAILED(resource->GetPrivateData(kPlacementHandleGuid, &size, &handle)) || size != sizeof(handle))
+        return m_Placements.end();
+    return m_Placements.find(handle);
+}
+
+ComPtr<ID3D12Resource> GpuAllocator::CreateResource(D3D12_HEAP_TYPE            heapType,
+                                                    const D3D12_RESOURCE_DESC& desc,
+                                                    D3D12_RESOURCE_STATES      initialState,
+                                                    const D3D12_CLEAR_VALUE*   clearValue)
+{
+    Placement placement = {};
+    placement.category  = GetCategory(heapType, desc);
+    placement.desc      = desc;
+
+    D3D12_RESOURCE_ALLOCATION_INFO info = GetAllocationInfo(placement.desc);
+    placement.size                      = info.SizeInBytes;
+    placement.alignment                 = info.Alignment;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    AllocateLocked(placement);
+    return CreatePlacedLocked(placement, initialState, clearValue);
+}
+
+ComPtr<ID3D12Resource> GpuAllocator::CreateBuffer(uint64_t              size,
+                                                  D3D12_HEAP_TYPE       heapType,
+                                                  D3D12_RESOURCE_STATES initialState,
+                                                  D3D12_RESOURCE_FLAGS  flags)
+{
+    return CreateResource(heapType, CD3DX12_RESOURCE_DESC::Buffer(size, flags), initialState);
+}
+
+void GpuAllocator::Release(ComPtr<ID3D12Resource>& resource)
+{
+    if (!resource)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    auto                        placement = FindLocked(resource.Get());
+    if (placement != m_Placements.end())
+    {
+        FreeLocked(placement->second);
+        m_Placements.erase(placement);
+    }
+    resource.Reset();
+}
+
+uint32_t GpuAllocator::Defragment(GpuMemoryCategory category, uint32_t maxMoves, const MoveCallback& move)
+{
+    struct Move
+    {
+        PlacementHandle        from;
+        ID3D12Resource*        resource;
+        ComPtr<ID3D12Resource> to;
+    };
+    std::vector<Move> moves;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        std::vector<Heap>&          heaps = m_Heaps[size_t(category)];
+
+        std::vector<std::pair<PlacementHandle, Placement>> candidates;
+        for (const auto& placement : m_Placements)
+        {
+            if (placement.second.category == category && !placement.second.moved && !heaps[placement.second.heap].dedicated)
+                candidates.push_back(placement);
+        }
+        // The last heap first, from its end, it is the most likely to empty.
+        std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+            if (a.second.heap != b.second.heap)
+                return a.second.heap > b.second.heap;
+            return a.second.allocation.offset > b.second.allocation.offset;
+        });
+
+        for (const auto& candidate : candidates)
+        {
+            if (moves.size() == maxMoves)
+                break;
+
+            Placement target         = candidate.second;
+            target.allocation.offset = TlsfAllocator::InvalidOffset;
+            for (uint32_t i = 0; i < candidate.second.heap && target.allocation.offset == TlsfAllocator::InvalidOffset; i++)
+            {
+                if (!heaps[i].heap || heaps[i].dedicated)
+                    continue;
+                target.allocation = heaps[i].allocator->Allocate(target.size, target.alignment);
+                target.heap       = i;
+            }
+            if (target.allocation.offset == TlsfAllocator::InvalidOffset)
+            {
+                target.heap       = candidate.second.heap;
+                target.allocation = heaps[target.heap].allocator->AllocateBelow(
+                    target.size, target.alignment, candidate.second.allocation.offset);
+            }
+            if (target.allocation.offset == TlsfAllocator::InvalidOffset)
+                continue;
+
+            D3D12_RESOURCE_STATES state = target.desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER ?
+                                              D3D12_RESOURCE_STATE_COMMON :
+                                              D3D12_RESOURCE_STATE_COPY_DEST;
+            moves.push_back({ candidate.first, candidate.second.resource, CreatePlacedLocked(target, state, nullptr) });
+            // Marked before the callback runs: once it accepts, it may
+            // Release the old resource and its handle may be reused.
+            m_Placements[candidate.first].moved = true;
+        }
+    }
+
+    // Outside of the lock, the callback may Release right away.
+    uint32_t accepted = 0;
+    for (auto& m : moves)
+    {
+        if (move(m.resource, m.to))
+        {
+            accepted++;
+            continue;
+        }
+        Release(m.to);
+
+        // Rejected, the old resource is still alive and stays a candidate.
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        auto                        placement = m_Placements.find(m.from);
+        if (placement != m_Placements.end())
+            placement->second.moved = false;
+    }
+    return accepted;
+}
+
+GpuMemoryStats GpuAllocator::GetStats(GpuMemoryCategory category) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+
+    GpuMemoryStats stats;
+    for (const Heap& heap : m_Heaps[size_t(category)])
+    {
+        if (!heap.heap)
+            continue;
+        stats.heapCount++;
+        stats.allocationCount += heap.allocator->GetAllocationCount();
+        stats.reservedSize += heap.allocator->GetSize();
+        stats.usedSize += heap.allocator->GetUsedSize();
+        stats.largestFreeBlock = std::max(stats.largestFreeBlock, heap.allocator->GetLargestFreeBlock());
+    }
+    return stats;
+}
+
+void GpuAllocator::PrintStats() const
+{
+    for (size_t i = 0; i < size_t(GpuMemoryCategory::Count); i++)
+    {
+        GpuMemoryStats stats = GetStats(GpuMemoryCategory(i));
+        if (stats.heapCount == 0)
+            continue;
+        std::cout << "gpu memory, " << GetCategoryName(GpuMemoryCategory(i)) << ": " << stats.allocationCount
+                  << " resources, " << stats.usedSize / (1024.0 * 1024.0) << " of "
+                  << stats.reservedSize / (1024.0 * 1024.0) << " MB in " << stats.heapCount
+                  << " heaps, largest free block " << stats.largestFreeBlock / (1024.0 * 1024.0) << " MB" << std::endl;
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * Placed resources sub-allocated from large heaps.
+ *
+ * Every committed resource gets an implicit heap and a kernel allocation of
+ * its own. The GpuAllocator reserves ID3D12Heaps of DefaultHeapSize per
+ * category instead and places resources in them with a TlsfAllocator. The
+ * categories follow resource heap tier 1, where buffers, textures and
+ * render target or depth textures cannot share a heap. Resources larger
+ * than a heap get a dedicated one, released when they are.
+ *
+ * Placement honours the alignment GetResourceAllocationInfo asks for: 64KB
+ * for buffers and most textures, 4KB for small textures and 4MB for MSAA
+ * targets, which is why render target heaps are 4MB aligned.
+ *
+ * Resources are handed out as plain ComPtrs and have to come back through
+ * Release, once the GPU is done with them. A render target or depth buffer
+ * placed over memory another resource used must be cleared, discarded or
+ * copied to before anything reads it.
+ *
+ * Thread safe.
+ */
+#pragma once
+
+#include "helpers.h"
+#include "tlsf.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+enum class GpuMemoryCategory
+{
+    Buffer,
+    UploadBuffer,
+    ReadbackBuffer,
+    Texture,
+    RenderTarget,
+    Count
+};
+
+struct GpuMemoryStats
+{
+    uint32_t heapCount       = 0;
+    uint32_t allocationCount = 0;
+    uint64_t reservedSize    = 0;
+    uint64_t usedSize        = 0;
+    // Largest free block of any heap, what the largest new resource can use
+    // without reserving another heap.
+    uint64_t largestFreeBlock = 0;
+};
+
+class GpuAllocator
+{
+public:
+    static constexpr uint64_t DefaultHeapSize = 64ull * 1024 * 1024;
+
+    GpuAllocator(Microsoft::WRL::ComPtr<ID3D12Device2> device, uint64_t heapSize = DefaultHeapSize);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateResource(D3D12_HEAP_TYPE             heapType,
+                                                          const D3D12_RESOURCE_DESC&  desc,
+                                                          D3D12_RESOURCE_STATES       initialState,
+                                                          const D3D12_CLEAR_VALUE*    clearValue = nullptr);
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateBuffer(uint64_t              size,
+                                                        D3D12_HEAP_TYPE       heapType     = D3D12_HEAP_TYPE_DEFAULT,
+                                                        D3D12_RESOURCE_STATES initialState = D3D12_RESOURCE_STATE_COMMON,
+                                                        D3D12_RESOURCE_FLAGS  flags        = D3D12_RESOURCE_FLAG_NONE);
+
+    // Give the memory of `resource` back and reset it. Resources not created
+    // here are only reset.
+    void Release(Microsoft::WRL::ComPtr<ID3D12Resource>& resource);
+
+    /**
+     * Defragmentation hook. Takes up to `maxMoves` resources of `category`
+     * from the end of the last heaps and places a copy of each lower, in the
+     * COMMON state for buffers and COPY_DEST for textures. `move` gets the
+     * old and the new resource and returns false to keep the old one. If it
+     * accepts, it records the copy, points its users to the new resource and
+     * Releases the old one once the copy is done. Returns the accepted moves.
+     */
+    using MoveCallback = std::function<bool(ID3D12Resource* from, Microsoft::WRL::ComPtr<ID3D12Resource> to)>;
+    uint32_t Defragment(GpuMemoryCategory category, uint32_t maxMoves, const MoveCallback& move);
+
+    GpuMemoryStats GetStats(GpuMemoryCategory category) const;
+    void           PrintStats() const;
+
+private:
+    struct Heap
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> heap;
+        std::unique_ptr<TlsfAllocator>     allocator;
+        bool                               dedicated;
+    };
+
+    // Identifies a placement: the category, heap and TLSF block. Stored on
+    // the resource as private data, so a resource released behind our back
+    // and a new one at the same address can't be mistaken for each other.
+    using PlacementHandle = uint64_t;
+
+    struct Placement
+    {
+        // Not owning, only handed to the Defragment callback.
+        ID3D12Resource*           resource;
+        GpuMemoryCategory         category;
+        uint32_t                  heap;
+        TlsfAllocator::Allocation allocation;
+        D3D12_RESOURCE_DESC       desc;
+        uint64_t                  size;
+        uint64_t                  alignment;
+        // Replaced by Defragment, waiting for its Release.
+        bool moved;
+    };
+    using PlacementMap = std::unordered_map<PlacementHandle, Placement>;
+
+    static PlacementHandle   GetHandle(const Placement& placement);
+    static GpuMemoryCategory GetCategory(D3D12_HEAP_TYPE heapType, const D3D12_RESOURCE_DESC& desc);
+    static const char*       GetCategoryName(GpuMemoryCategory category);
+
+    D3D12_RESOURCE_ALLOCATION_INFO GetAllocationInfo(D3D12_RESOURCE_DESC& desc) const;
+    // Find room in the heaps of `category`, reserving a new one if needed.
+    void AllocateLocked(Placement& placement);
+    uint32_t CreateHeap(GpuMemoryCategory category, uint64_t size, bool dedicated);
+    void     FreeLocked(const Placement& placement);
+    // The placement `resource` was created with, or end() if it wasn't.
+    PlacementMap::iterator FindLocked(ID3D12Resource* resource);
+
+    // Frees the placement's block if the resource can't be created.
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreatePlacedLocked(Placement&               placement,
+                                                              D3D12_RESOURCE_STATES    initialState,
+                                                              const D3D12_CLEAR_VALUE* clearValue);
+
+    Microsoft::WRL::ComPtr<ID3D12Device2> m_Device;
+    uint64_t                              m_HeapSize;
+
+    mutable std::mutex m_Mutex;
+    // Slots of released dedicated heaps are reused, the indices stay valid.
+    std::vector<Heap> m_Heaps[size_t(GpuMemoryCategory::Count)];
+    PlacementMap      m_Placements;
+};
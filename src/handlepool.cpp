@@ -0,0 +1,64 @@
+#include "handlepool.h"
+
+#include <assert.h>
+
+HandlePool::HandlePool(uint32_t capacity) :
+    m_Capacity(capacity),
+    m_Head(Pack(0, capacity > 0 ? 0 : InvalidIndex)),
+    m_Next(new std::atomic<uint32_t>[capacity]),
+    m_Generations(new std::atomic<uint32_t>[capacity])
+{
+    assert(capacity < InvalidIndex);
+    for (uint32_t i = 0; i < capacity; i++)
+    {
+        m_Next[i].store(i + 1 < capacity ? i + 1 : InvalidIndex, std::memory_order_relaxed);
+        m_Generations[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+HandlePool::Handle HandlePool::Allocate()
+{
+    uint64_t head = m_Head.load(std::memory_order_acquire);
+    for (;;)
+    {
+        uint32_t index = uint32_t(head);
+        if (index == InvalidIndex)
+            return {};
+        // May be stale if another thread pops `index` first, the tag makes
+        // the exchange fail then.
+        uint32_t next = m_Next[index].load(std::memory_order_relaxed);
+        if (m_Head.compare_exchange_weak(head, Pack(uint32_t(head >> 32) + 1, next), std::memory_order_acquire,
+                                         std::memory_order_acquire))
+        {
+            uint32_t generation = m_Generations[index].fetch_add(1, std::memory_order_relaxed) + 1;
+            m_AllocatedCount.fetch_add(1, std::memory_order_relaxed);
+            return { index, generation };
+        }
+    }
+}
+
+bool HandlePool::Free(Handle handle)
+{
+    assert(handle.index < m_Capacity);
+    // Only one Free of a handle wins, a second one or a stale handle fails.
+    uint32_t generation = handle.generation;
+    if ((generation & 1) == 0)
+        return false;
+    if (!m_Generations[handle.index].compare_exchange_strong(generation, generation + 1, std::memory_order_relaxed))
+        return false;
+    m_AllocatedCount.fetch_sub(1, std::memory_order_relaxed);
+
+    uint64_t head = m_Head.load(std::memory_order_relaxed);
+    do
+    {
+        m_Next[handle.index].store(uint32_t(head), std::memory_order_relaxed);
+    } while (!m_Head.compare_exchange_weak(head, Pack(uint32_t(head >> 32) + 1, handle.index), std::memory_order_release,
+                                           std::memory_order_relaxed));
+    return true;
+}
+
+bool HandlePool::IsAlive(Handle handle) const
+{
+    return handle.index < m_Capacity && (handle.generation & 1) != 0
+        && m_Generations[handle.index].load(std::memory_order_relaxed) == handle.generation;
+}
@@ -0,0 +1,62 @@
+/**
+ * Lock-free pool of indices with generations.
+ *
+ * Free indices form a stack threaded through a `next` array, its head
+ * packed with a tag that changes on every update so a compare and swap
+ * never mistakes a head popped and pushed back meanwhile for the one it
+ * read. Freeing bumps the generation of the index, a handle kept past its
+ * Free no longer matches and is caught instead of aliasing whatever reuses
+ * the index. Descriptors are the indices of a DescriptorAllocator.
+ *
+ * Thread safe, no call blocks.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+class HandlePool
+{
+public:
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    struct Handle
+    {
+        uint32_t index      = InvalidIndex;
+        uint32_t generation = 0;
+
+        bool IsValid() const { return index != InvalidIndex; }
+    };
+
+    explicit HandlePool(uint32_t capacity);
+
+    HandlePool(const HandlePool&) = delete;
+    HandlePool& operator=(const HandlePool&) = delete;
+
+    // Lowest indices first while the pool is fresh. Returns an invalid
+    // handle when every index is taken.
+    Handle Allocate();
+
+    // Give `handle` back. Returns false, and changes nothing, if it was
+    // freed already.
+    bool Free(Handle handle);
+
+    // Whether `handle` was allocated and not freed since.
+    bool IsAlive(Handle handle) const;
+
+    uint32_t GetCapacity() const { return m_Capacity; }
+    uint32_t GetAllocatedCount() const { return m_AllocatedCount.load(std::memory_order_relaxed); }
+
+private:
+    static uint64_t Pack(uint32_t tag, uint32_t index) { return uint64_t(tag) << 32 | index; }
+
+    uint32_t m_Capacity;
+
+    // Tag in the high half, top free index in the low one.
+    std::atomic<uint64_t>                    m_Head;
+    std::unique_ptr<std::atomic<uint32_t>[]> m_Next;
+    // Even while free, odd while allocated.
+    std::unique_ptr<std::atomic<uint32_t>[]> m_Generations;
+    std::atomic<uint32_t>                    m_AllocatedCount = { 0 };
+};
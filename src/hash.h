@@ -0,0 +1,47 @@
+/**
+ * Non-cryptographic 64 bit hashing helpers.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// 64 bit finalizer (murmur3 fmix64), spreads low entropy keys over all bits.
+inline uint64_t MixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+inline uint64_t CombineHash(uint64_t seed, uint64_t value)
+{
+    return MixHash(seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2)));
+}
+
+// Hash a block of memory, 8 bytes per step.
+inline uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0)
+{
+    const uint64_t kPrime = 0x100000001b3ULL;
+    const char*    bytes  = static_cast<const char*>(data);
+
+    uint64_t h = seed ^ (size * 0x9e3779b97f4a7c15ULL);
+    size_t   i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, 8);
+        h = (h ^ MixHash(word)) * kPrime;
+    }
+    if (i < size)
+    {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, size - i);
+        h = (h ^ MixHash(word)) * kPrime;
+    }
+    return MixHash(h);
+}
@@ -0,0 +1,55 @@
+#include "linearallocator.h"
+
+#include <assert.h>
+
+LinearAllocator::LinearAllocator(uint64_t pageSize) :
+    m_PageSize(pageSize)
+{
+}
+
+LinearAllocator::Allocation LinearAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    assert(m_PageSize % alignment == 0);
+    if (size == 0 || size > m_PageSize)
+        return {};
+
+    uint64_t start = (m_Offset + alignment - 1) & ~(alignment - 1);
+    if (m_CurrentPage == InvalidPage || start + size > m_PageSize)
+    {
+        // Most recently freed first, it is the most likely to be cached.
+        if (!m_FreePages.empty())
+        {
+            m_CurrentPage = m_FreePages.back();
+            m_FreePages.pop_back();
+        }
+        else
+            m_CurrentPage = m_PageCount++;
+        m_FramePages.push_back(m_CurrentPage);
+        start = 0;
+    }
+
+    m_Offset = start + size;
+    return { m_CurrentPage, start };
+}
+
+void LinearAllocator::Submit(uint64_t fenceValue)
+{
+    assert(m_InFlight.empty() || m_InFlight.back().fenceValue <= fenceValue);
+    for (uint32_t page : m_FramePages)
+        m_InFlight.push_back({ fenceValue, page });
+    m_FramePages.clear();
+
+    // The next frame starts on a page of its own.
+    m_CurrentPage = InvalidPage;
+    m_Offset      = 0;
+}
+
+void LinearAllocator::Retire(uint64_t completedValue)
+{
+    while (!m_InFlight.empty() && m_InFlight.front().fenceValue <= completedValue)
+    {
+        m_FreePages.push_back(m_InFlight.front().page);
+        m_InFlight.pop_front();
+    }
+}
@@ -0,0 +1,68 @@
+/**
+ * Frame scoped linear allocator for GPU constants.
+ *
+ * Bookkeeping only, like the UploadRing: memory comes in pages of a fixed
+ * size identified by their index, the owner creates the backing buffer the
+ * first time an index shows up. A frame bumps through pages of its own and
+ * Submit hands them over to the fence value of the frame, so every frame in
+ * flight reads its own partition. Pages come back once that value
+ * completes, and a frame that needs more than its share takes more pages
+ * instead of blocking.
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class LinearAllocator
+{
+public:
+    static constexpr uint32_t InvalidPage = ~0u;
+
+    struct Allocation
+    {
+        uint32_t page   = InvalidPage;
+        uint64_t offset = 0;
+    };
+
+    // @param pageSize Size of a page in bytes, a multiple of every alignment
+    //                 later passed to Allocate.
+    explicit LinearAllocator(uint64_t pageSize);
+
+    /**
+     * Reserve `size` bytes aligned to `alignment`, a power of two. The
+     * allocation moves to a new page when it does not fit the current one.
+     * Returns an invalid page if `size` is 0 or larger than a page.
+     */
+    Allocation Allocate(uint64_t size, uint64_t alignment);
+
+    // The pages used since the last call are read by the submission
+    // signaling `fenceValue`. Fence values must increase.
+    void Submit(uint64_t fenceValue);
+
+    // Recycle the pages of every submission up to `completedValue`.
+    void Retire(uint64_t completedValue);
+
+    uint64_t GetPageSize() const { return m_PageSize; }
+    // Pages handed out so far, indices are below this.
+    uint32_t GetPageCount() const { return m_PageCount; }
+    uint32_t GetFreePageCount() const { return uint32_t(m_FreePages.size()); }
+
+private:
+    struct InFlightPage
+    {
+        uint64_t fenceValue;
+        uint32_t page;
+    };
+
+    uint64_t m_PageSize;
+    uint32_t m_PageCount = 0;
+
+    uint32_t              m_CurrentPage = InvalidPage;
+    uint64_t              m_Offset      = 0;
+    std::vector<uint32_t> m_FramePages;
+
+    std::deque<InFlightPage> m_InFlight;
+    std::vector<uint32_t>    m_FreePages;
+};
@@ -0,0 +1,27 @@
+/**
+ * Work posted from any thread to run on one thread, the application loop
+ * drains its mailbox once per frame. Posting never blocks.
+ */
+#pragma once
+
+#include "mpscqueue.h"
+
+#include <cstddef>
+#include <functional>
+
+class Mailbox
+{
+public:
+    // Any thread.
+    void Post(std::function<void()> message) { m_Messages.Push(std::move(message)); }
+
+    // The owning thread. Run everything posted so far, in posting order for
+    // each thread, and return how many there were.
+    size_t Run()
+    {
+        return m_Messages.Drain([](std::function<void()> message) { message(); });
+    }
+
+private:
+    MpscQueue<std::function<void()>> m_Messages;
+};
@@ -0,0 +1,119 @@
+#include "mappedfile.h"
+
+#if defined(_WIN32)
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+// An empty file can not be mapped, but it is still a valid (empty) file.
+static const char gs_EmptyFile[1] = { 0 };
+
+MappedFile::~MappedFile() { Close(); }
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    HANDLE file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!::GetFileSizeEx(file, &size))
+    {
+        ::CloseHandle(file);
+        return false;
+    }
+
+    m_File = file;
+    m_Size = (size_t)size.QuadPart;
+    if (m_Size == 0)
+    {
+        m_Data = gs_EmptyFile;
+        return true;
+    }
+
+    m_Mapping = ::CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_Mapping)
+        m_Data = static_cast<const char*>(::MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+
+    if (!m_Data)
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data && m_Data != gs_EmptyFile)
+        ::UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        ::CloseHandle(m_Mapping);
+    if (m_File)
+        ::CloseHandle(m_File);
+
+    m_Data    = nullptr;
+    m_Size    = 0;
+    m_Mapping = nullptr;
+    m_File    = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path)
+{
+    Close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    m_Fd   = fd;
+    m_Size = (size_t)st.st_size;
+    if (m_Size == 0)
+    {
+        m_Data = gs_EmptyFile;
+        return true;
+    }
+
+    void* data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        Close();
+        return false;
+    }
+    // Every page is going to be touched by one of the parser threads.
+    ::madvise(data, m_Size, MADV_WILLNEED);
+
+    m_Data = static_cast<const char*>(data);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data && m_Data != gs_EmptyFile)
+        ::munmap(const_cast<char*>(m_Data), m_Size);
+    if (m_Fd >= 0)
+        ::close(m_Fd);
+
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Fd   = -1;
+}
+
+#endif
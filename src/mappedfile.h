@@ -0,0 +1,37 @@
+/**
+ * Read-only memory mapping of a whole file.
+ */
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // Map the file at `path`, closing any previously mapped file.
+    // Returns false if the file can not be opened or mapped.
+    bool Open(const std::string& path);
+    void Close();
+
+    bool        IsOpen() const { return m_Data != nullptr; }
+    const char* GetData() const { return m_Data; }
+    size_t      GetSize() const { return m_Size; }
+
+private:
+    MappedFile(const MappedFile& copy) = delete;
+    MappedFile& operator=(const MappedFile& other) = delete;
+
+    const char* m_Data = nullptr;
+    size_t      m_Size = 0;
+
+#if defined(_WIN32)
+    void* m_File    = nullptr;
+    void* m_Mapping = nullptr;
+#else
+    int m_Fd = -1;
+#endif
+};
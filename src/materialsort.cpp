@@ -0,0 +1,78 @@
+#include "materialsort.h"
+#include "parallel.h"
+
+#include <algorithm>
+
+namespace
+{
+
+// Below this many triangles per worker, forking costs more than it saves.
+constexpr size_t kMinTrianglesPerChunk = 64 * 1024;
+
+} // namespace
+
+size_t CountMaterialRuns(const std::vector<uint32_t>& triangleMaterials)
+{
+    size_t runs = 0;
+    for (size_t t = 0; t < triangleMaterials.size(); t++)
+        runs += t == 0 || triangleMaterials[t] != triangleMaterials[t - 1];
+    return runs;
+}
+
+void SortTrianglesByMaterial(std::vector<uint32_t>&       indices,
+                             const std::vector<uint32_t>& triangleMaterials,
+                             uint32_t                     materialCount,
+                             std::vector<MeshSubMesh>&    submeshes,
+                             size_t                       numChunks)
+{
+    const size_t triangleCount = triangleMaterials.size();
+    if (numChunks == 0)
+        numChunks = std::min<size_t>(GetWorkerCount(), triangleCount / kMinTrianglesPerChunk);
+    numChunks = std::max<size_t>(1, std::min(numChunks, triangleCount));
+
+    // Histogram of every chunk, laid out [chunk][material].
+    std::vector<uint32_t> counts(numChunks * materialCount, 0);
+    ParallelForChunks(triangleCount, numChunks, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t* histogram = &counts[chunk * materialCount];
+        for (size_t t = begin; t < end; t++)
+            histogram[triangleMaterials[t]]++;
+    });
+
+    // Exclusive prefix sum in (material, chunk) order turns the counts into
+    // the first output triangle of every chunk for every material, which
+    // keeps the sort stable.
+    submeshes.clear();
+    uint32_t offset = 0;
+    for (uint32_t m = 0; m < materialCount; m++)
+    {
+        uint32_t begin = offset;
+        for (size_t chunk = 0; chunk < numChunks; chunk++)
+        {
+            uint32_t& slot  = counts[chunk * materialCount + m];
+            uint32_t  count = slot;
+            slot            = offset;
+            offset += count;
+        }
+        if (offset != begin)
+        {
+            MeshSubMesh submesh  = {};
+            submesh.index_offset = 3 * begin;
+            submesh.index_count  = 3 * (offset - begin);
+            submesh.material_id  = m;
+            submeshes.push_back(submesh);
+        }
+    }
+
+    std::vector<uint32_t> sorted(indices.size());
+    ParallelForChunks(triangleCount, numChunks, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t* cursor = &counts[chunk * materialCount];
+        for (size_t t = begin; t < end; t++)
+        {
+            uint32_t dst        = cursor[triangleMaterials[t]]++;
+            sorted[3 * dst + 0] = indices[3 * t + 0];
+            sorted[3 * dst + 1] = indices[3 * t + 1];
+            sorted[3 * dst + 2] = indices[3 * t + 2];
+        }
+    });
+    indices.swap(sorted);
+}
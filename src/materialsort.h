@@ -0,0 +1,36 @@
+/**
+ * Material bucketing.
+ *
+ * OBJ faces switch materials freely, so walking them in file order produces
+ * a new index range every time the material changes. This groups the
+ * triangles by material with a parallel counting sort, so every material
+ * ends up in exactly one contiguous index range and one draw.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Number of index ranges a file order walk would produce: every change of
+ * material between consecutive triangles starts a new range.
+ */
+size_t CountMaterialRuns(const std::vector<uint32_t>& triangleMaterials);
+
+/**
+ * Reorder the triangles of `indices` so those with the same material are
+ * contiguous, keeping their relative order, and rebuild `submeshes` with one
+ * range per used material.
+ *
+ * @param triangleMaterials Material of every triangle, below `materialCount`.
+ * @param numChunks Ranges sorted in parallel, 0 picks one per worker once
+ *        the mesh is large enough to pay for the threads.
+ */
+void SortTrianglesByMaterial(std::vector<uint32_t>&       indices,
+                             const std::vector<uint32_t>& triangleMaterials,
+                             uint32_t                     materialCount,
+                             std::vector<MeshSubMesh>&    submeshes,
+                             size_t                       numChunks = 0);
@@ -9,12 +9,30 @@
 #include "glm/gtx/transform.hpp"
 #include "glm/matrix.hpp"
 
+#include "boxcull.h"
+#include "bvh.h"
 #include "clock.h"
 #include "commandqueue.h"
-
+#include "descriptorallocator.h"
+#include "drawcull.h"
+#include "drawrecord.h"
+#include "framecontext.h"
+#include "gpuallocator.h"
+#include "mailbox.h"
+#include "releasequeue.h"
+#include "materialsort.h"
+#include "meshcache.h"
+#include "meshlet.h"
+#include "meshweld.h"
+#include "objloader.h"
+#include "occlusion.h"
+#include "simplify.h"
+#include "vertexcache.h"
+#include "vertexformat.h"
+
+#include <SDL.h>
 #include <stdint.h>
 #include <tiny_obj_loader.h>
-#include <glm/gtx/hash.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
@@ -24,6 +42,27 @@
 
 using namespace Microsoft::WRL;
 
+static const char* kMeshObjPath     = "models/bmw.obj";
+static const char* kMeshMaterialDir = "models";
+static const char* kMeshCachePath   = "models/bmw.pmesh";
+
+// Largest LOD error allowed on screen, in pixels.
+static const float kLodErrorPixels = 1.0f;
+// Software occlusion buffer, small enough to clear and fill in well under a
+// millisecond.
+static const uint32_t kOcclusionWidth  = 320;
+static const uint32_t kOcclusionHeight = 184;
+// Submeshes drawn into it, the largest ones, at their full level. A
+// simplified level can bulge in front of the surface, and occluders may
+// only ever be behind it.
+static const size_t kOccluderCount = 32;
+// Triangles the occluders may add up to, a submesh whose full level would
+// go over is skipped, so a dense mesh cannot blow the rasterization cost
+// up, see occlusionbench.
+static const size_t kOccluderMaxTriangles = 64 * 1024;
+
+static_assert(sizeof(DrawIndexedArgs) == sizeof(D3D12_DRAW_INDEXED_ARGUMENTS), "DrawIndexedArgs must match D3D12");
+
 // Clamp a value between a min and max range.
 template <typename T>
 constexpr const T& clamp(const T& val, const T& min, const T& max)
@@ -32,17 +71,31 @@ constexpr const T& clamp(const T& val, const T& min, const T& max)
                                          val;
 }
 
-namespace std
+// Encode `mesh` in `Format`, returns the raw vertex buffer.
+template <typename Format>
+static std::vector<char> PackVertexBuffer(const MeshView&                  mesh,
+                                          std::vector<VertexQuantization>& quantization,
+                                          VertexFormat&                    format)
 {
-template <>
-struct hash<MeshApp::Vertex>
+    std::vector<Format> vertices = PackVertices<Format>(mesh, quantization);
+    format                       = GetVertexFormat<Format>();
+    return std::vector<char>(reinterpret_cast<const char*>(vertices.data()),
+                             reinterpret_cast<const char*>(vertices.data() + vertices.size()));
+}
+
+static DXGI_FORMAT GetDXGIFormat(VertexAttributeFormat format)
 {
-    size_t operator()(MeshApp::Vertex const& vertex) const
+    switch (format)
     {
-        return ((hash<glm::vec3>()(vertex.position) ^ (hash<glm::vec3>()(vertex.normal) << 1)) >> 1) ^ (hash<glm::vec2>()(vertex.texcoord) << 1);
+    case VERTEX_ATTRIBUTE_UNORM16X4:
+        return DXGI_FORMAT_R16G16B16A16_UNORM;
+    case VERTEX_ATTRIBUTE_SNORM16X2:
+        return DXGI_FORMAT_R16G16_SNORM;
+    case VERTEX_ATTRIBUTE_FLOAT16X2:
+        return DXGI_FORMAT_R16G16_FLOAT;
     }
-};
-} // namespace std
+    return DXGI_FORMAT_UNKNOWN;
+}
 
 MeshApp::MeshApp() :
     m_ScissorRect(CD3DX12_RECT(0, 0, LONG_MAX, LONG_MAX)),
@@ -70,7 +123,7 @@ bool MeshApp::LoadContent()
 
     CreateRenderTargets();
     CreatePSOs();
-    CreateUniforms();
+    m_RecordPool = std::make_unique<JobPool>();
 
     // Resize/Create the depth buffer.
     std::shared_ptr<Window> window = Application::Get().GetActiveWindow();
@@ -78,11 +131,53 @@ bool MeshApp::LoadContent()
 
     // rely on content loaded
     Resize(window->GetClientWidth(), window->GetClientHeight());
+    Application::Get().GetGpuAllocator()->PrintStats();
 
     return m_ContentLoaded;
 }
 
 bool MeshApp::LoadMesh()
+{
+    HighResolutionClock clock;
+
+    if (m_MeshCache.Open(kMeshCachePath, &m_LoadOptions, sizeof(m_LoadOptions)))
+    {
+        m_Mesh = m_MeshCache.GetView();
+        clock.Tick();
+        std::cout << "mesh cache load time:" << clock.GetTotalMilliSeconds() << " ms" << std::endl;
+        return true;
+    }
+
+    // Stamp the sources before parsing them, so a file changing under us
+    // invalidates the cache we are about to write.
+    MeshSources sources;
+    sources.Collect(kMeshObjPath, kMeshMaterialDir);
+
+    if (!LoadObjMesh(m_MeshBuffers))
+        return false;
+    m_Mesh = MeshView::FromBuffers(m_MeshBuffers);
+
+    clock.Tick();
+    std::cout << "total load time:" << clock.GetTotalSeconds() << " seconds" << std::endl;
+
+    // Bake the cache in the background, m_MeshBuffers is not modified anymore.
+    m_CacheWriter = std::async(std::launch::async, [this, sources]() {
+        if (!WriteMeshCache(kMeshCachePath, sources, &m_LoadOptions, sizeof(m_LoadOptions), m_MeshBuffers))
+            std::cout << "WARN: failed to write " << kMeshCachePath << std::endl;
+    });
+    return true;
+}
+
+void MeshApp::BuildMeshBvh()
+{
+    HighResolutionClock clock;
+    BuildBvh(m_Bvh, m_Mesh);
+    clock.Tick();
+    std::cout << "bvh: " << m_Bvh.triangles.size() << " triangles, " << m_Bvh.nodes.size() << " nodes, "
+              << clock.GetDeltaSeconds() << " seconds" << std::endl;
+}
+
+bool MeshApp::LoadObjMesh(MeshBuffers& mesh)
 {
     tinyobj::attrib_t attrib;
 
@@ -93,87 +188,99 @@ bool MeshApp::LoadMesh()
 
     HighResolutionClock clock;
 
-    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, "models/bmw.obj", "models", true))
+    if (!LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, kMeshObjPath, kMeshMaterialDir))
+    {
+        std::cout << "ERR: " << err << std::endl;
         return false;
+    }
     clock.Tick();
-    std::cout << "total load time:" << clock.GetTotalSeconds() << " seconds" << std::endl;
+    std::cout << "obj parse time:" << clock.GetTotalSeconds() << " seconds" << std::endl;
 
     if (!warn.empty())
         std::cout << "WARN: " << warn << std::endl;
     if (!err.empty())
         std::cout << "ERR: " << err << std::endl;
 
-    int last_mid = -2;
-    // Loop over shapes, we should only have one mesh here.
-    // std::unordered_map<Vertex, uint32_t> unique_vertices;
-
-    // load vertices
-    for (size_t s = 0; s < shapes.size(); s++)
+    // One material per triangle, bucketed afterwards. Faces without a
+    // material use the default one, appended last.
+    size_t                corner_count = 0;
+    std::vector<uint32_t> triangle_materials;
+    for (const auto& shape : shapes)
     {
-        // Loop over faces(polygon), obj does not pack the vertex attributes
-        // together, so we actually need to manually generate indices
+        corner_count += shape.mesh.indices.size();
+        for (int mid : shape.mesh.material_ids)
+            triangle_materials.push_back(mid >= 0 && mid < (int)materials.size() ? (uint32_t)mid : (uint32_t)materials.size());
+    }
 
-        size_t index_offset = 0;
-        for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++)
-        {
-            // the material processing is even worse, tinyobj loader uses
-            //  per-face material_id
-            //  shapes[s].mesh.
-            size_t fv  = size_t(shapes[s].mesh.num_face_vertices[f]);
-            int    mid = shapes[s].mesh.material_ids[f];
-            // creating new submesh
-            if (mid != last_mid)
-            {
-                last_mid = mid;
-
-                SubMesh new_subMesh      = {};
-                new_subMesh.material_id  = (uint32_t)mid;
-                new_subMesh.index_offset = (uint32_t)m_Indices.size();
-                new_subMesh.index_count  = 0;
-                m_SubMeshes.push_back(new_subMesh);
-            }
-
-            // Loop over vertices in the face.
-            for (size_t v = 0; v < fv; v++)
-            {
-                // access to vertex
-                tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                tinyobj::real_t vx = attrib.vertices[3 * size_t(idx.vertex_index) + 0];
-                tinyobj::real_t vy = attrib.vertices[3 * size_t(idx.vertex_index) + 1];
-                tinyobj::real_t vz = attrib.vertices[3 * size_t(idx.vertex_index) + 2];
-
-                // Check if `normal_index` is zero or positive. negative = no normal data
-                tinyobj::real_t nx = attrib.normals[3 * size_t(idx.normal_index) + 0];
-                tinyobj::real_t ny = attrib.normals[3 * size_t(idx.normal_index) + 1];
-                tinyobj::real_t nz = attrib.normals[3 * size_t(idx.normal_index) + 2];
-
-                Vertex vertex {};
-                vertex.position = glm::vec3(vx, vy, vz);
-                vertex.normal   = glm::normalize(glm::vec3(nx, ny, nz));
-                vertex.texcoord = glm::vec3(-1.0f, -1.0, -1.0);
-
-                // Check if `texcoord_index` is zero or positive. negative = no texcoord
-                if (idx.texcoord_index >= 0)
-                {
-                    tinyobj::real_t tx = attrib.texcoords[2 * size_t(idx.texcoord_index) + 0];
-                    tinyobj::real_t ty = attrib.texcoords[2 * size_t(idx.texcoord_index) + 1];
-                    vertex.texcoord    = glm::vec3(glm::vec2(tx, ty), 0.0);
-                }
-
-                // // deduplication of vertices, didn't work out
-                // if (unique_vertices.count(vertex) == 0)
-                // {
-                //     unique_vertices[vertex] = static_cast<uint32_t>(m_Vertices.size());
-                // }
-                m_Vertices.push_back(vertex);
-
-                m_Indices.push_back((uint32_t)m_Indices.size());
-                m_SubMeshes.back().index_count += 1;
-            }
-            index_offset += fv;
-        }
+    clock.Reset();
+
+    // Face corners with the same (vertex, normal, texcoord) triple are the
+    // same vertex, so we only expand every triple once.
+    DeduplicateCorners(attrib, shapes, mesh.vertices, mesh.indices);
+    if (m_LoadOptions.weldEpsilon > 0.0f)
+        WeldVerticesEpsilon(mesh.vertices, mesh.indices, m_LoadOptions.weldEpsilon);
+    clock.Tick();
+
+    std::cout << "dedup: " << corner_count << " -> " << mesh.vertices.size() << " vertices, "
+              << corner_count * sizeof(Vertex) / 1024 << " -> " << mesh.vertices.size() * sizeof(Vertex) / 1024 << " KB, "
+              << corner_count / std::max(clock.GetDeltaSeconds(), 1e-9) * 1e-6 << " M corners/s" << std::endl;
+
+    // One index range, and so one draw, per material instead of one per
+    // material change in file order.
+    size_t material_runs = CountMaterialRuns(triangle_materials);
+    SortTrianglesByMaterial(mesh.indices, triangle_materials, (uint32_t)materials.size() + 1, mesh.submeshes);
+    clock.Tick();
+
+    std::cout << "submeshes: " << material_runs << " -> " << mesh.submeshes.size()
+              << ", draws per frame: " << material_runs << " -> " << mesh.submeshes.size()
+              << ", " << clock.GetDeltaSeconds() << " seconds" << std::endl;
+
+    // Reorder the triangles for the post-transform cache, then the vertices
+    // for fetch locality. Both are baked into the cache.
+    VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size());
+    OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    VertexCacheStats reordered = AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size());
+    size_t           dropped   = OptimizeVertexFetch(mesh.vertices, mesh.indices);
+    VertexCacheStats after     = AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size());
+    clock.Tick();
+
+    std::cout << "vertex cache: ACMR " << before.acmr << " -> " << reordered.acmr
+              << ", ATVR " << before.atvr << " -> " << reordered.atvr << std::endl;
+    std::cout << "vertex fetch: ACMR " << reordered.acmr << " -> " << after.acmr
+              << ", ATVR " << reordered.atvr << " -> " << after.atvr
+              << ", " << dropped << " unreferenced vertices dropped, "
+              << clock.GetDeltaSeconds() << " seconds" << std::endl;
+
+    // Positions are quantized per submesh, so every submesh needs vertices of
+    // its own.
+    size_t duplicated = SplitVerticesBySubMesh(mesh.vertices, mesh.indices, mesh.submeshes);
+    std::cout << "vertex split: " << duplicated << " vertices shared between submeshes duplicated" << std::endl;
+
+    clock.Tick();
+    BuildMeshlets(mesh);
+    clock.Tick();
+
+    size_t meshlet_vertices  = 0;
+    size_t meshlet_triangles = 0;
+    for (const auto& meshlet : mesh.meshlets)
+    {
+        meshlet_vertices += meshlet.vertex_count;
+        meshlet_triangles += meshlet.triangle_count;
     }
+    size_t meshlet_count = std::max<size_t>(mesh.meshlets.size(), 1);
+    std::cout << "meshlets: " << mesh.meshlets.size() << ", "
+              << double(meshlet_vertices) / meshlet_count << "/" << kMeshletMaxVertices << " vertices, "
+              << double(meshlet_triangles) / meshlet_count << "/" << kMeshletMaxTriangles << " triangles, "
+              << 100.0 * meshlet_triangles / (meshlet_count * kMeshletMaxTriangles) << "% fill, "
+              << meshlet_triangles / std::max(clock.GetDeltaSeconds(), 1e-9) * 1e-6 << " M triangles/s" << std::endl;
+
+    size_t base_indices = mesh.indices.size();
+    BuildLodChains(mesh);
+    clock.Tick();
+
+    std::cout << "lods: " << mesh.lods.size() << " levels for " << mesh.submeshes.size() << " submeshes, "
+              << base_indices / 3 << " -> " << mesh.indices.size() / 3 << " triangles in total, "
+              << base_indices / 3 / std::max(clock.GetDeltaSeconds(), 1e-9) * 1e-6 << " M triangles/s simplified" << std::endl;
 
     // load materials, obj is phong model, There are extensions to have PBR but...
     for (size_t m = 0; m < materials.size(); m++)
@@ -184,101 +291,171 @@ bool MeshApp::LoadMesh()
                                          materials[m].dissolve);
         new_material.specular = glm::vec4(glm::make_vec3(materials[m].specular),
                                           materials[m].shininess);
-        m_Materials.push_back(new_material);
+        mesh.materials.push_back(new_material);
     }
+    mesh.materials.push_back(Material::default_material());
+    return true;
 }
 
-void MeshApp::UpdateBufferResource(
-    ComPtr<ID3D12GraphicsCommandList2> commandList,
-    ID3D12Resource**                   pDestinationResource,
-    ID3D12Resource**                   pIntermediateResource,
-    size_t                             numElements,
-    size_t                             elementSize,
-    const void*                        bufferData,
-    D3D12_RESOURCE_FLAGS               flags)
+ComPtr<ID3D12Resource> MeshApp::CreateBuffer(size_t size, D3D12_RESOURCE_FLAGS flags)
 {
-    auto device = Application::Get().GetDevice();
-
-    size_t bufferSize = numElements * elementSize;
-
-    // Create a committed resource for the GPU resource in a default heap.
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(bufferSize, flags),
-        D3D12_RESOURCE_STATE_COPY_DEST,
-        nullptr,
-        IID_PPV_ARGS(pDestinationResource)));
-
-    // Create an committed resource for the upload.
-    if (bufferData)
-    {
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Buffer(bufferSize),
-            D3D12_RESOURCE_STATE_GENERIC_READ,
-            nullptr,
-            IID_PPV_ARGS(pIntermediateResource)));
-
-        D3D12_SUBRESOURCE_DATA subresourceData = {};
-        subresourceData.pData                  = bufferData;
-        subresourceData.RowPitch               = bufferSize;
-        subresourceData.SlicePitch             = subresourceData.RowPitch;
-
-        UpdateSubresources(commandList.Get(),
-                           *pDestinationResource,
-                           *pIntermediateResource,
-                           0,
-                           0,
-                           1,
-                           &subresourceData);
-    }
+    return Application::Get().GetGpuAllocator()->CreateBuffer(size, D3D12_HEAP_TYPE_DEFAULT, D3D12_RESOURCE_STATE_COMMON, flags);
 }
 
 bool MeshApp::UploadVertices()
 {
-    auto device       = Application::Get().GetDevice();
-    auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY);
-    auto commandList  = commandQueue->GetCommandList();
+    auto uploader = Application::Get().GetUploadService();
 
-    // Upload vertex buffer data.
-    ComPtr<ID3D12Resource> intermediateVertexBuffer;
+    // Pack the vertices, the texcoords are only kept if the mesh has some.
+    HighResolutionClock clock;
+    std::vector<char>   packed;
+    if (HasTexcoords(m_Mesh.vertices))
+        packed = PackVertexBuffer<PackedVertexUV>(m_Mesh, m_Quantization, m_VertexFormat);
+    else
+        packed = PackVertexBuffer<PackedVertexNoUV>(m_Mesh, m_Quantization, m_VertexFormat);
+    clock.Tick();
+    std::cout << "vertex packing: " << sizeof(Vertex) << " -> " << m_VertexFormat.stride << " bytes per vertex, "
+              << m_Mesh.vertices.size() * sizeof(Vertex) / 1024 << " -> " << packed.size() / 1024 << " KB, "
+              << clock.GetTotalMilliSeconds() << " ms" << std::endl;
+
+    // The quantization grid of a submesh is its bounding box.
+    m_SubmeshBoxes.Resize(m_Quantization.size());
+    m_SubmeshVisible.assign(m_Quantization.size(), 1);
+    for (size_t s = 0; s < m_Quantization.size(); s++)
+    {
+        const VertexQuantization& q = m_Quantization[s];
+        m_SubmeshBoxes.Set(s, glm::vec3(q.offset), glm::vec3(q.offset + q.scale));
+    }
 
-    UpdateBufferResource(commandList, &m_VertexBuffer, &intermediateVertexBuffer, m_Vertices.size(), sizeof(Vertex), m_Vertices.data());
+    // Upload vertex buffer data.
+    m_VertexBuffer = CreateBuffer(packed.size());
     m_VertexBuffer->SetName(L"Vertex Buffer");
+    uploader->UploadBuffer(m_VertexBuffer.Get(), 0, packed.data(), packed.size());
     m_VertexBufferView.BufferLocation = m_VertexBuffer->GetGPUVirtualAddress();
-    m_VertexBufferView.SizeInBytes    = sizeof(Vertex) * m_Vertices.size();
-    m_VertexBufferView.StrideInBytes  = sizeof(Vertex);
+    m_VertexBufferView.SizeInBytes    = (UINT)packed.size();
+    m_VertexBufferView.StrideInBytes  = m_VertexFormat.stride;
 
     // Upload index buffer data.
-    ComPtr<ID3D12Resource> intermediateIndexBuffer;
-    UpdateBufferResource(commandList,
-                         &m_IndexBuffer,
-                         &intermediateIndexBuffer,
-                         m_Indices.size(),
-                         sizeof(uint32_t),
-                         m_Indices.data());
+    size_t indexSize = sizeof(uint32_t) * m_Mesh.indices.size();
+    m_IndexBuffer    = CreateBuffer(indexSize);
+    m_IndexBuffer->SetName(L"Index Buffer");
+    uploader->UploadBuffer(m_IndexBuffer.Get(), 0, m_Mesh.indices.data, indexSize);
     m_IndexBufferView.BufferLocation = m_IndexBuffer->GetGPUVirtualAddress();
     m_IndexBufferView.Format         = DXGI_FORMAT_R32_UINT;
-    m_IndexBufferView.SizeInBytes    = sizeof(uint32_t) * m_Indices.size();
-    m_IndexBuffer->SetName(L"Index Buffer");
+    m_IndexBufferView.SizeInBytes    = (UINT)indexSize;
+
+    // Upload the material table. LoadObjMesh ends it with the default
+    // material, which submeshes without a valid material use.
+    std::vector<GpuMaterial> materials;
+    materials.reserve(m_Mesh.materials.size());
+    for (const Material& material : m_Mesh.materials)
+        materials.push_back({ material.diffuse, material.specular });
+    size_t materialSize = sizeof(GpuMaterial) * materials.size();
+    m_MaterialCount     = (uint32_t)materials.size();
+    m_MaterialBuffer    = CreateBuffer(materialSize);
+    m_MaterialBuffer->SetName(L"Material Buffer");
+    uploader->UploadBuffer(m_MaterialBuffer.Get(), 0, materials.data(), materialSize);
+
+    // The pixel shader reads the table through a persistent descriptor of
+    // the shader visible heap. The view is staged in the CPU only heap.
+    D3D12_SHADER_RESOURCE_VIEW_DESC materialView = {};
+    materialView.Format                          = DXGI_FORMAT_UNKNOWN;
+    materialView.ViewDimension                   = D3D12_SRV_DIMENSION_BUFFER;
+    materialView.Shader4ComponentMapping         = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    materialView.Buffer.NumElements              = m_MaterialCount;
+    materialView.Buffer.StructureByteStride      = sizeof(GpuMaterial);
+
+    auto             staging     = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    auto             descriptors = Application::Get().GetShaderVisibleHeap();
+    DescriptorHandle stagingView = staging->Allocate();
+    Application::Get().GetDevice()->CreateShaderResourceView(m_MaterialBuffer.Get(), &materialView, staging->GetCpuHandle(stagingView));
+    m_MaterialView = descriptors->AllocatePersistent();
+    descriptors->CopyPersistent(m_MaterialView, staging->GetCpuHandle(stagingView));
+    staging->Free(stagingView);
+
+    // Upload what the culling pass reads, a draw per submesh.
+    std::vector<DrawSource> sources(m_Mesh.submeshes.size());
+    for (size_t s = 0; s < sources.size(); s++)
+    {
+        const SubMesh& submesh = m_Mesh.submeshes[s];
+        sources[s].dequant     = m_Quantization[s];
+        sources[s].material    = std::min<uint32_t>(submesh.material_id, m_MaterialCount - 1);
+        sources[s].lod_offset  = submesh.lod_offset;
+        sources[s].lod_count   = submesh.lod_count;
+    }
+    size_t sourceSize  = sizeof(DrawSource) * sources.size();
+    size_t lodSize     = sizeof(MeshLod) * m_Mesh.lods.size();
+    m_DrawCount        = (uint32_t)sources.size();
+    m_DrawSourceBuffer = CreateBuffer(std::max<size_t>(sourceSize, sizeof(DrawSource)));
+    m_DrawSourceBuffer->SetName(L"Draw Source Buffer");
+    uploader->UploadBuffer(m_DrawSourceBuffer.Get(), 0, sources.data(), sourceSize);
+    m_LodBuffer = CreateBuffer(std::max<size_t>(lodSize, sizeof(MeshLod)));
+    m_LodBuffer->SetName(L"LOD Buffer");
+    uploader->UploadBuffer(m_LodBuffer.Get(), 0, m_Mesh.lods.data, lodSize);
+
+    // Written by the culling pass of a frame while the previous ones may
+    // still draw from theirs. They are promoted from COMMON to
+    // UNORDERED_ACCESS on the COMPUTE queue, and decay back to it when the
+    // submission ends.
+    uint32_t framesInFlight = Application::Get().GetFrameContext()->GetFramesInFlight();
+    m_DrawArgumentBuffers.resize(framesInFlight);
+    m_DrawCountBuffers.resize(framesInFlight);
+    for (uint32_t f = 0; f < framesInFlight; f++)
+    {
+        m_DrawArgumentBuffers[f] = CreateBuffer(sizeof(IndirectDraw) * std::max<size_t>(m_DrawCount, 1),
+                                                D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        m_DrawArgumentBuffers[f]->SetName(L"Draw Argument Buffer");
+        m_DrawCountBuffers[f] = CreateBuffer(sizeof(uint32_t), D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS);
+        m_DrawCountBuffers[f]->SetName(L"Draw Count Buffer");
+    }
 
-    // upload to GPU
-    auto fenceValue = commandQueue->ExecuteCommandList(commandList);
-    commandQueue->WaitForFenceValue(fenceValue);
+    // All copies go in one COPY queue submission, the DIRECT queue waits
+    // for it on the GPU instead of the CPU waiting here.
+    m_UploadTicket = uploader->Submit();
+
+    // Reported from the application loop once the copies are done.
+    size_t uploadSize = packed.size() + indexSize + materialSize + sourceSize + lodSize;
+    Application::Get().GetFenceWatcher()->Watch(*Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COPY),
+                                                m_UploadTicket.fenceValue,
+                                                *Application::Get().GetMailbox(),
+                                                [clock, uploadSize]() mutable {
+                                                    clock.Tick();
+                                                    std::cout << "mesh upload: " << uploadSize / 1024 << " KB, done after "
+                                                              << clock.GetTotalMilliSeconds() << " ms" << std::endl;
+                                                });
     return true;
 }
 
+void MeshApp::SelectOccluders()
+{
+    // Largest boxes first, they hide the most.
+    std::vector<size_t> order(m_Quantization.size());
+    for (size_t s = 0; s < order.size(); s++)
+        order[s] = s;
+    auto diagonal = [&](size_t s) { return glm::length(glm::vec3(m_Quantization[s].scale)); };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return diagonal(a) > diagonal(b); });
+
+    m_OccluderIndices.clear();
+    size_t chosen = 0;
+    for (size_t i = 0; i < order.size() && chosen < kOccluderCount; i++)
+    {
+        const MeshLod& lod = m_Mesh.lods[m_Mesh.submeshes[order[i]].lod_offset];
+        if (m_OccluderIndices.size() / 3 + lod.index_count / 3 > kOccluderMaxTriangles)
+            continue;
+        const uint32_t* indices = &m_Mesh.indices[lod.index_offset];
+        m_OccluderIndices.insert(m_OccluderIndices.end(), indices, indices + lod.index_count);
+        chosen++;
+    }
+    m_Occlusion = std::make_unique<OcclusionBuffer>(kOcclusionWidth, kOcclusionHeight);
+    std::cout << "occluders: " << chosen << " submeshes, " << m_OccluderIndices.size() / 3 << " of "
+              << kOccluderMaxTriangles << " triangles" << std::endl;
+}
+
 bool MeshApp::CreateRenderTargets()
 {
     auto device = Application::Get().GetDevice();
-    // Create the descriptor heap for the depth-stencil view.
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc = {};
-    dsvHeapDesc.NumDescriptors             = 1;
-    dsvHeapDesc.Type                       = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags                      = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    ThrowIfFailed(device->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(&m_DSVHeap)));
+    // Allocate the depth-stencil view.
+    m_DepthStencilView = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->Allocate();
     return true;
 }
 
@@ -298,12 +475,17 @@ void MeshApp::CreateMeshRootSignature()
     // Allow input layout and deny unnecessary access to certain pipeline stages.
     D3D12_ROOT_SIGNATURE_FLAGS rootSignatureFlags = VertexPixelRootSignatureFlags();
 
-    //  A 32-bit constant root parameter for vertices
-    // And a material/lighting root parameters for pixels
-    std::array<CD3DX12_ROOT_PARAMETER1, 2> rootParameters;
+    //  The uniforms of the frame
+    // And the material index of the current submesh
+    // And the position dequantization of the current submesh
+    // And the material table
+    std::array<CD3DX12_ROOT_PARAMETER1, 4> rootParameters;
     // rootParameters[0].InitAsConstants(sizeof(Uniform) / sizeof(uint32_t), 0, 0, D3D12_SHADER_VISIBILITY_VERTEX);
     rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE, D3D12_SHADER_VISIBILITY_ALL);
-    rootParameters[1].InitAsConstants(sizeof(Material) / sizeof(uint32_t), 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[1].InitAsConstants(1, 1, 0, D3D12_SHADER_VISIBILITY_PIXEL);
+    rootParameters[2].InitAsConstants(sizeof(VertexQuantization) / sizeof(uint32_t), 2, 0, D3D12_SHADER_VISIBILITY_VERTEX);
+    CD3DX12_DESCRIPTOR_RANGE1 materialRange(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
+    rootParameters[3].InitAsDescriptorTable(1, &materialRange, D3D12_SHADER_VISIBILITY_PIXEL);
     // rootParameters[1].InitAsConstantBufferView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_DATA_VOLATILE, D3D12_SHADER_VISIBILITY_PIXEL);
 
     CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
@@ -324,12 +506,13 @@ void MeshApp::CreateMeshPSO()
 {
     // right now we just reuse the cube PSO
     auto device = Application::Get().GetDevice();
-    // Create the vertex input layout
-    D3D12_INPUT_ELEMENT_DESC inputLayout[] = {
-        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 },
-        { "TEXCOORD", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D12_APPEND_ALIGNED_ELEMENT, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 }
-    };
+    // Create the vertex input layout from the packed vertex format.
+    std::vector<D3D12_INPUT_ELEMENT_DESC> inputLayout;
+    for (uint32_t a = 0; a < m_VertexFormat.attributeCount; a++)
+    {
+        const VertexAttribute& attribute = m_VertexFormat.attributes[a];
+        inputLayout.push_back({ attribute.semantic, 0, GetDXGIFormat(attribute.format), 0, attribute.offset, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0 });
+    }
 
     // Load the vertex shader.
     ComPtr<ID3DBlob> vertexShaderBlob;
@@ -346,7 +529,7 @@ void MeshApp::CreateMeshPSO()
     rtvFormats.RTFormats[0]          = DXGI_FORMAT_R8G8B8A8_UNORM;
 
     pipelineStateStream.pRootSignature        = m_MeshPipeline.root_signature.Get();
-    pipelineStateStream.InputLayout           = { inputLayout, _countof(inputLayout) };
+    pipelineStateStream.InputLayout           = { inputLayout.data(), (UINT)inputLayout.size() };
     pipelineStateStream.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
     pipelineStateStream.VS                    = CD3DX12_SHADER_BYTECODE(vertexShaderBlob.Get());
     pipelineStateStream.PS                    = CD3DX12_SHADER_BYTECODE(pixelShaderBlob.Get());
@@ -361,6 +544,55 @@ void MeshApp::CreateMeshPSO()
                                               IID_PPV_ARGS(&m_MeshPipeline.pso)));
 }
 
+void MeshApp::CreateCullPipeline()
+{
+    auto device = Application::Get().GetDevice();
+
+    // The cull constants, the draw sources and LODs, the draws and their
+    // count.
+    std::array<CD3DX12_ROOT_PARAMETER1, 5> rootParameters;
+    rootParameters[0].InitAsConstantBufferView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE);
+    rootParameters[1].InitAsShaderResourceView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE);
+    rootParameters[2].InitAsShaderResourceView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE);
+    rootParameters[3].InitAsUnorderedAccessView(0, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE);
+    rootParameters[4].InitAsUnorderedAccessView(1, 0, D3D12_ROOT_DESCRIPTOR_FLAG_NONE);
+
+    CD3DX12_VERSIONED_ROOT_SIGNATURE_DESC rootSignatureDescription;
+    rootSignatureDescription.Init_1_1(rootParameters.size(), rootParameters.data(), 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_NONE);
+
+    ComPtr<ID3DBlob> rootSignatureBlob;
+    ComPtr<ID3DBlob> errorBlob;
+    ThrowIfFailed(D3DX12SerializeVersionedRootSignature(&rootSignatureDescription,
+                                                        D3D_ROOT_SIGNATURE_VERSION_1_1,
+                                                        &rootSignatureBlob,
+                                                        &errorBlob));
+    ThrowIfFailed(device->CreateRootSignature(0, rootSignatureBlob->GetBufferPointer(), rootSignatureBlob->GetBufferSize(), IID_PPV_ARGS(&m_CullPipeline.root_signature)));
+
+    ComPtr<ID3DBlob> computeShaderBlob;
+    ThrowIfFailed(D3DReadFileToBlob(L"DrawCull.cso", &computeShaderBlob));
+
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipelineStateDesc = {};
+    pipelineStateDesc.pRootSignature                    = m_CullPipeline.root_signature.Get();
+    pipelineStateDesc.CS                                = CD3DX12_SHADER_BYTECODE(computeShaderBlob.Get());
+    ThrowIfFailed(device->CreateComputePipelineState(&pipelineStateDesc, IID_PPV_ARGS(&m_CullPipeline.pso)));
+
+    // An IndirectDraw: the material index, the dequantization, the draw.
+    D3D12_INDIRECT_ARGUMENT_DESC arguments[3] = {};
+    arguments[0].Type                         = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    arguments[0].Constant.RootParameterIndex  = 1;
+    arguments[0].Constant.Num32BitValuesToSet = 1;
+    arguments[1].Type                         = D3D12_INDIRECT_ARGUMENT_TYPE_CONSTANT;
+    arguments[1].Constant.RootParameterIndex  = 2;
+    arguments[1].Constant.Num32BitValuesToSet = sizeof(VertexQuantization) / sizeof(uint32_t);
+    arguments[2].Type                         = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED;
+
+    D3D12_COMMAND_SIGNATURE_DESC signatureDesc = {};
+    signatureDesc.ByteStride                   = sizeof(IndirectDraw);
+    signatureDesc.NumArgumentDescs             = _countof(arguments);
+    signatureDesc.pArgumentDescs               = arguments;
+    ThrowIfFailed(device->CreateCommandSignature(&signatureDesc, m_MeshPipeline.root_signature.Get(), IID_PPV_ARGS(&m_DrawSignature)));
+}
+
 void MeshApp::CreatePSOs()
 {
     // right now we just reuse the cube PSO
@@ -368,33 +600,40 @@ void MeshApp::CreatePSOs()
 
     CreateMeshRootSignature();
     CreateMeshPSO();
+    CreateCullPipeline();
 }
 
-void MeshApp::CreateUniforms()
+void MeshApp::UnloadContent()
 {
-    auto device = Application::Get().GetDevice();
+    // Let a pending cache bake finish before its data goes away.
+    if (m_CacheWriter.valid())
+        m_CacheWriter.wait();
 
-    size_t uniform_size = (sizeof(Uniform) + 255) & ~255;
-
-    ThrowIfFailed(device->CreateCommittedResource(
-        &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
-        D3D12_HEAP_FLAG_NONE,
-        &CD3DX12_RESOURCE_DESC::Buffer(uniform_size, D3D12_RESOURCE_FLAG_NONE),
-        D3D12_RESOURCE_STATE_GENERIC_READ,
-        nullptr,
-        IID_PPV_ARGS(&m_UniformBuffer)));
-    m_UniformBuffer->SetName(L"Uniform Buffer");
-
-    // // I don't need a view for root descriptor
-    // D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc {};
-    // cbvDesc.BufferLocation = m_MaterialBuffer->GetGPUVirtualAddress();
-    // cbvDesc.SizeInBytes    = uniform_size; // need to be 256 byte aligned.
+    if (auto window = Application::Get().GetActiveWindow())
+    {
+        const PresentCounters& counters = window->GetPresentCounters();
+        std::cout << "present: " << counters.presents << " frames, " << counters.displayedFrames << " displayed, "
+                  << counters.missedVBlanks << " missed vblanks, frame latency " << counters.frameLatency << " ("
+                  << counters.latencyChangeCount << " changes)" << std::endl;
+    }
 
-    // D3D12_CPU_DESCRIPTOR_HANDLE
-}
+    auto allocator = Application::Get().GetGpuAllocator();
+    allocator->Release(m_VertexBuffer);
+    allocator->Release(m_IndexBuffer);
+    allocator->Release(m_MaterialBuffer);
+    allocator->Release(m_DrawSourceBuffer);
+    allocator->Release(m_LodBuffer);
+    for (auto& buffer : m_DrawArgumentBuffers)
+        allocator->Release(buffer);
+    for (auto& buffer : m_DrawCountBuffers)
+        allocator->Release(buffer);
+    allocator->Release(m_DepthBuffer);
+    Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->Free(m_DepthStencilView);
+    Application::Get().GetShaderVisibleHeap()->FreePersistent(m_MaterialView);
+    m_Occlusion.reset();
+    m_OccluderIndices.clear();
+    m_Bvh = MeshBvh();
 
-void MeshApp::UnloadContent()
-{
     m_ContentLoaded = false;
 }
 
@@ -407,27 +646,27 @@ void MeshApp::ResizeDepthBuffer(int width, int height)
 {
     if (m_ContentLoaded)
     {
-        // Flush any GPU commands that might be referencing the depth buffer.
-        Application::Get().Flush();
-
         width  = std::max(1, width);
         height = std::max(1, height);
 
-        auto device = Application::Get().GetDevice();
+        auto device      = Application::Get().GetDevice();
+        auto allocator   = Application::Get().GetGpuAllocator();
+        auto directQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
 
         // Resize screen dependent resources.
-        // Create a depth buffer.
+        // Create a depth buffer. It is cleared before every use, as a placed
+        // resource needs.
         D3D12_CLEAR_VALUE optimizedClearValue = {};
         optimizedClearValue.Format            = DXGI_FORMAT_D32_FLOAT;
         optimizedClearValue.DepthStencil      = { 1.0f, 0 };
 
-        ThrowIfFailed(device->CreateCommittedResource(
-            &CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
-            D3D12_HEAP_FLAG_NONE,
-            &CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
+        // The frames in flight may still use the old one.
+        Application::Get().GetReleaseQueue()->Release(m_DepthBuffer, *directQueue);
+        m_DepthBuffer = allocator->CreateResource(
+            D3D12_HEAP_TYPE_DEFAULT,
+            CD3DX12_RESOURCE_DESC::Tex2D(DXGI_FORMAT_D32_FLOAT, width, height, 1, 0, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL),
             D3D12_RESOURCE_STATE_DEPTH_WRITE,
-            &optimizedClearValue,
-            IID_PPV_ARGS(&m_DepthBuffer)));
+            &optimizedClearValue);
 
         // Update the depth-stencil view.
         D3D12_DEPTH_STENCIL_VIEW_DESC dsv = {};
@@ -436,7 +675,24 @@ void MeshApp::ResizeDepthBuffer(int width, int height)
         dsv.Texture2D.MipSlice            = 0;
         dsv.Flags                         = D3D12_DSV_FLAG_NONE;
 
-        device->CreateDepthStencilView(m_DepthBuffer.Get(), &dsv, m_DSVHeap->GetCPUDescriptorHandleForHeapStart());
+        auto dsvs = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
+        device->CreateDepthStencilView(m_DepthBuffer.Get(), &dsv, dsvs->GetCpuHandle(m_DepthStencilView));
+    }
+}
+
+void MeshApp::onKeyDown(const SDL_KeyboardEvent* key)
+{
+    switch (key->keysym.sym)
+    {
+    case SDLK_q:
+        Application::Get().Quit(0);
+        break;
+    case SDLK_g:
+        m_GpuDrivenDraws = !m_GpuDrivenDraws;
+        std::cout << (m_GpuDrivenDraws ? "GPU driven draws" : "CPU recorded draws") << std::endl;
+        break;
+    default:
+        break;
     }
 }
 
@@ -472,6 +728,7 @@ void MeshApp::Update(double delta, double total)
     const glm::vec3 center = glm::vec3(0, 0, 0);
     const glm::vec3 up     = glm::vec3(0, 1, 0);
     m_ViewMatrix           = glm::lookAt(eye, center, up);
+    m_EyePosition          = eye;
 
     // Update the projection matrix.
     auto  window       = Application::Get().GetActiveWindow();
@@ -486,10 +743,9 @@ void MeshApp::Render(double delta, double total)
     auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
     auto commandList  = commandQueue->GetCommandList();
 
-    UINT currentBackBufferIndex = window->GetCurrentBackBufferIndex();
-    auto backBuffer             = window->GetCurrentBackBuffer();
-    auto rtv                    = window->GetCurrentRenderTargetView();
-    auto dsv                    = m_DSVHeap->GetCPUDescriptorHandleForHeapStart();
+    auto backBuffer = window->GetCurrentBackBuffer();
+    auto rtv        = window->GetCurrentRenderTargetView();
+    auto dsv        = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->GetCpuHandle(m_DepthStencilView);
 
     // Clear the render targets.
     {
@@ -501,25 +757,112 @@ void MeshApp::Render(double delta, double total)
         ClearDepth(commandList, dsv);
     }
 
-    RenderMesh(commandList, delta, total);
+    std::vector<ComPtr<ID3D12GraphicsCommandList2>> commandLists = RenderMesh(commandList, delta, total);
+    commandLists.insert(commandLists.begin(), commandList);
 
     // Present
     {
-        TransitionResource(commandList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+        // After the draws, on a list of its own if they were recorded in
+        // parallel.
+        auto presentList = commandLists.size() > 1 ? commandQueue->GetCommandList() : commandList;
+        if (presentList != commandList)
+            commandLists.push_back(presentList);
+        TransitionResource(presentList, backBuffer, D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT);
+
+        // Later submissions on the queue are ordered after the first one,
+        // only it has to wait for the mesh upload.
+        std::vector<QueueWait> waits;
+        if (m_UploadTicket.fenceValue != 0)
+        {
+            waits.push_back(Application::Get().GetUploadService()->GetGpuWait(m_UploadTicket));
+            m_UploadTicket = {};
+        }
+        // The draws read what the culling pass writes.
+        if (m_GpuDrivenDraws)
+            waits.push_back(SubmitDrawCulling(waits));
+        commandQueue->ExecuteCommandLists(commandLists, waits);
+
+        // The next frame waits for the oldest one in flight, in
+        // FrameContext::BeginFrame.
+        window->Present();
+    }
+}
+
+std::vector<ComPtr<ID3D12GraphicsCommandList2>> MeshApp::RenderMesh(ComPtr<ID3D12GraphicsCommandList2> commandList,
+                                                                   double                             delta,
+                                                                   double                             total)
+{
+    std::shared_ptr<Window> window = Application::Get().GetActiveWindow();
+    auto                    rtv    = window->GetCurrentRenderTargetView();
+
+    // Update the MVP matrix
+    Uniform uniform = {
+        m_ProjectionMatrix * m_ViewMatrix * m_ModelMatrix,
+        glm::mat4(glm::transpose(glm::inverse(glm::mat3(m_ModelMatrix)))),
+        m_ModelMatrix,
+        glm::vec4(m_EyePosition, 1.0),
+        glm::vec4(m_LightDir, 0.0),
+    };
+    D3D12_GPU_VIRTUAL_ADDRESS uniforms = Application::Get().GetFrameContext()->GetConstantAllocator().AllocateConstants(uniform);
 
-        m_FenceValues[currentBackBufferIndex] = commandQueue->ExecuteCommandList(commandList);
+    std::vector<ComPtr<ID3D12GraphicsCommandList2>> commandLists;
+    if (m_GpuDrivenDraws)
+    {
+        RecordIndirectDraws(commandList.Get(), uniforms, rtv);
+        return commandLists;
+    }
 
-        currentBackBufferIndex = window->Present();
+    // Frustum cull the submeshes in object space, on the recording workers
+    // when there are many.
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(uniform.MVP, planes);
+    CullBoxes(*m_RecordPool, planes, m_SubmeshBoxes, m_SubmeshVisible.data());
+
+    // Then drop the ones behind the occluders. The occluders themselves
+    // are never behind their own depth. They are picked on the first frame
+    // that needs them, the GPU-driven path never does.
+    if (m_OcclusionCulling && !m_Occlusion)
+        SelectOccluders();
+    if (m_OcclusionCulling && !m_OccluderIndices.empty())
+    {
+        m_Occlusion->Clear();
+        m_Occlusion->RenderTriangles(uniform.MVP, &m_Mesh.vertices[0].position, sizeof(Vertex), m_OccluderIndices.data(), m_OccluderIndices.size() / 3, m_RecordPool.get());
+        for (size_t s = 0; s < m_Quantization.size(); s++)
+        {
+            const VertexQuantization& q = m_Quantization[s];
+            if (m_SubmeshVisible[s] && m_Occlusion->IsBoxOccluded(uniform.MVP, glm::vec3(q.offset), glm::vec3(q.offset + q.scale)))
+                m_SubmeshVisible[s] = 0;
+        }
+    }
 
-        commandQueue->WaitForFenceValue(m_FenceValues[currentBackBufferIndex]);
+    size_t drawCount = m_Mesh.submeshes.size();
+    size_t jobCount  = GetRecordJobCount(drawCount, m_RecordPool->GetThreadCount());
+    if (jobCount <= 1)
+    {
+        RecordDraws(commandList.Get(), uniforms, rtv, 0, drawCount);
+        return commandLists;
     }
+
+    // Contiguous ranges of draws on lists of their own, submitted in order
+    // so the result is the same as recording serially.
+    auto commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+    commandLists.resize(jobCount);
+    m_RecordPool->ParallelFor(jobCount, [&](size_t job) {
+        commandLists[job] = commandQueue->GetCommandList();
+        RecordDraws(commandLists[job].Get(), uniforms, rtv, drawCount * job / jobCount, drawCount * (job + 1) / jobCount);
+    });
+    return commandLists;
 }
 
-void MeshApp::RenderMesh(ComPtr<ID3D12GraphicsCommandList2> commandList, double delta, double total)
+void MeshApp::BindMeshPipeline(ID3D12GraphicsCommandList2* commandList,
+                               D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                               D3D12_CPU_DESCRIPTOR_HANDLE rtv) const
 {
-    std::shared_ptr<Window> window = Application::Get().GetActiveWindow();
-    auto                    rtv    = window->GetCurrentRenderTargetView();
-    auto                    dsv    = m_DSVHeap->GetCPUDescriptorHandleForHeapStart();
+    auto dsv = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_DSV)->GetCpuHandle(m_DepthStencilView);
+
+    auto                  descriptors = Application::Get().GetShaderVisibleHeap();
+    ID3D12DescriptorHeap* heaps[]     = { descriptors->GetHeap() };
+    commandList->SetDescriptorHeaps(_countof(heaps), heaps);
 
     commandList->SetPipelineState(m_MeshPipeline.pso.Get());
     commandList->SetGraphicsRootSignature(m_MeshPipeline.root_signature.Get());
@@ -533,28 +876,99 @@ void MeshApp::RenderMesh(ComPtr<ID3D12GraphicsCommandList2> commandList, double
 
     commandList->OMSetRenderTargets(1, &rtv, FALSE, &dsv);
 
-    // Update the MVP matrix
-    Uniform uniform = {
-        m_ProjectionMatrix * m_ViewMatrix * m_ModelMatrix,
-        glm::mat4(glm::transpose(glm::inverse(glm::mat3(m_ModelMatrix)))),
+    commandList->SetGraphicsRootConstantBufferView(0, uniforms);
+    commandList->SetGraphicsRootDescriptorTable(3, descriptors->GetGpuHandle(m_MaterialView.index));
+}
+
+void MeshApp::RecordDraws(ID3D12GraphicsCommandList2* commandList,
+                          D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                          D3D12_CPU_DESCRIPTOR_HANDLE rtv,
+                          size_t                      begin,
+                          size_t                      end) const
+{
+    BindMeshPipeline(commandList, uniforms, rtv);
+    RecordSubmeshDraws(commandList, m_Mesh.submeshes.data, m_SubmeshVisible.data(), m_Quantization.data(), m_MaterialCount, begin, end,
+                       [this](size_t s) -> const MeshLod& { return SelectLod(s); });
+}
+
+QueueWait MeshApp::SubmitDrawCulling(Span<const QueueWait> waits)
+{
+    auto     frameContext = Application::Get().GetFrameContext();
+    auto     commandQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_COMPUTE);
+    auto     commandList  = commandQueue->GetCommandList();
+    uint32_t frame        = frameContext->GetFrameIndex();
+
+    // Culled in object space, the model matrix only scales uniformly.
+    float             modelScale = glm::length(glm::vec3(m_ModelMatrix[0]));
+    DrawCullConstants constants  = {};
+    ExtractFrustumPlanes(m_ProjectionMatrix * m_ViewMatrix * m_ModelMatrix, constants.planes);
+    constants.eye              = glm::vec4(glm::vec3(glm::inverse(m_ModelMatrix) * glm::vec4(m_EyePosition, 1.0f)), modelScale);
+    constants.lod_scale        = modelScale * m_Viewport.Height / (2.0f * std::tan(m_FoV * 0.5f));
+    constants.lod_error_pixels = kLodErrorPixels;
+    constants.draw_count       = m_DrawCount;
+
+    // The DIRECT queue waits for this submission, its fence covers the
+    // constants.
+    commandList->SetPipelineState(m_CullPipeline.pso.Get());
+    commandList->SetComputeRootSignature(m_CullPipeline.root_signature.Get());
+    commandList->SetComputeRootConstantBufferView(0, frameContext->GetConstantAllocator().AllocateConstants(constants));
+    commandList->SetComputeRootShaderResourceView(1, m_DrawSourceBuffer->GetGPUVirtualAddress());
+    commandList->SetComputeRootShaderResourceView(2, m_LodBuffer->GetGPUVirtualAddress());
+    commandList->SetComputeRootUnorderedAccessView(3, m_DrawArgumentBuffers[frame]->GetGPUVirtualAddress());
+    commandList->SetComputeRootUnorderedAccessView(4, m_DrawCountBuffers[frame]->GetGPUVirtualAddress());
+    // One group, it compacts the draws in order.
+    commandList->Dispatch(1, 1, 1);
+
+    uint64_t fenceValue = commandQueue->ExecuteCommandLists({ std::addressof(commandList), 1 }, waits);
+    return { commandQueue.get(), fenceValue };
+}
+
+void MeshApp::RecordIndirectDraws(ID3D12GraphicsCommandList2* commandList,
+                                  D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                                  D3D12_CPU_DESCRIPTOR_HANDLE rtv) const
+{
+    uint32_t frame = Application::Get().GetFrameContext()->GetFrameIndex();
+
+    // Back in COMMON since the COMPUTE submission ended, decaying again at
+    // the end of this one.
+    CD3DX12_RESOURCE_BARRIER barriers[] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(m_DrawArgumentBuffers[frame].Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
+        CD3DX12_RESOURCE_BARRIER::Transition(m_DrawCountBuffers[frame].Get(), D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT),
     };
-    D3D12_RANGE readRange { 0, sizeof(uniform) };
-    Uniform*    mapped = nullptr;
-    ThrowIfFailed(m_UniformBuffer->Map(0, &readRange, reinterpret_cast<void**>(&mapped)));
-    memcpy(mapped, &uniform, sizeof(uniform));
-    m_UniformBuffer->Unmap(0, &readRange);
+    commandList->ResourceBarrier(_countof(barriers), barriers);
+
+    BindMeshPipeline(commandList, uniforms, rtv);
+    commandList->ExecuteIndirect(m_DrawSignature.Get(),
+                                 m_DrawCount,
+                                 m_DrawArgumentBuffers[frame].Get(),
+                                 0,
+                                 m_DrawCountBuffers[frame].Get(),
+                                 0);
+}
 
-    commandList->SetGraphicsRootConstantBufferView(0, m_UniformBuffer->GetGPUVirtualAddress());
+const MeshLod& MeshApp::SelectLod(size_t s) const
+{
+    const SubMesh& submesh = m_Mesh.submeshes[s];
 
-    for (auto submesh : m_SubMeshes)
-    {
-        Material material = submesh.material_id >= 0 ? m_Materials[submesh.material_id] :
-                                                       Material::default_material();
-        material.lightDir = glm::vec4(m_LightDir, 0.0);
+    // Bounding sphere of the submesh in world space, from its quantization
+    // box. The model matrix only scales uniformly.
+    const VertexQuantization& q          = m_Quantization[s];
+    float                     modelScale = glm::length(glm::vec3(m_ModelMatrix[0]));
+    glm::vec3                 center     = glm::vec3(m_ModelMatrix * glm::vec4(glm::vec3(q.offset + q.scale * 0.5f), 1.0f));
+    float                     radius     = glm::length(glm::vec3(q.scale)) * 0.5f * modelScale;
+    float                     distance   = std::max(glm::length(center - m_EyePosition) - radius, 1.0f);
+
+    // Pixels per world unit at that distance.
+    float pixelScale = m_Viewport.Height / (2.0f * std::tan(m_FoV * 0.5f) * distance);
 
-        commandList->SetGraphicsRoot32BitConstants(1, sizeof(Material) / sizeof(uint32_t), &material, 0);
-        commandList->DrawIndexedInstanced(submesh.index_count, 1, submesh.index_offset, 0, 0);
+    // Coarsest level whose error stays below kLodErrorPixels.
+    for (uint32_t level = submesh.lod_count; level-- > 1;)
+    {
+        const MeshLod& lod = m_Mesh.lods[submesh.lod_offset + level];
+        if (lod.error * modelScale * pixelScale <= kLodErrorPixels)
+            return lod;
     }
+    return m_Mesh.lods[submesh.lod_offset];
 }
 
 void MeshApp::Resize(int w, int h)
@@ -590,3 +1004,17 @@ void MeshApp::ClearDepth(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> comm
 {
     commandList->ClearDepthStencilView(dsv, D3D12_CLEAR_FLAG_DEPTH, depth, 0, 0, nullptr);
 }
+
+bool MeshApp::PickTriangle(const glm::vec3& origin, const glm::vec3& direction, BvhHit& hit)
+{
+    // Only picking needs the tree, build it on the first ray.
+    if (m_Bvh.nodes.empty())
+        BuildMeshBvh();
+
+    // The direction is not renormalized, so t is the same in both spaces.
+    glm::mat4 toObject = glm::inverse(m_ModelMatrix);
+    BvhRay    ray;
+    ray.origin    = glm::vec3(toObject * glm::vec4(origin, 1.0f));
+    ray.direction = glm::vec3(toObject * glm::vec4(direction, 0.0f));
+    return IntersectBvh(m_Bvh, ray, hit);
+}
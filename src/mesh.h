@@ -9,7 +9,18 @@
 #endif
 
 #include "application.h"
+#include "boxcull.h"
+#include "bvh.h"
+#include "commandqueue.h"
+#include "drawcull.h"
+#include "meshcache.h"
+#include "meshdata.h"
+#include "occlusion.h"
+#include "parallel.h"
+#include "uploadservice.h"
+#include "vertexformat.h"
 #include "window.h"
+#include <future>
 #include <stdint.h>
 
 #include <glm/glm.hpp>
@@ -19,31 +30,15 @@
 class MeshApp : public Application
 {
 public:
-    struct Vertex
-    {
-        glm::vec3 position;
-        glm::vec3 normal;
-        glm::vec3 texcoord;
-
-        bool operator==(const Vertex& other) const
-        {
-            return position == other.position && normal == other.normal && texcoord == other.texcoord;
-        }
-    };
-    struct SubMesh
-    {
-        uint32_t index_offset;
-        uint32_t index_count;
-        uint32_t material_id;
-    };
+    using Vertex   = MeshVertex;
+    using SubMesh  = MeshSubMesh;
+    using Material = MeshMaterial;
 
-    struct Material
+    // Everything that changes the processed mesh, part of the cache key.
+    struct LoadOptions
     {
-        glm::vec4 diffuse  = glm::vec4(1.0); // w alpha
-        glm::vec4 specular = glm::vec4(0.0);
-        glm::vec4 lightDir = glm::vec4(1.0, 1.0, 0.0, 0.0);
-
-        static Material default_material() { return Material(); }
+        // Vertices closer than this are merged after deduplication, 0 disables.
+        float weldEpsilon = 0.0f;
     };
 
     struct Uniform
@@ -52,6 +47,15 @@ public:
         glm::mat4 normal;
         glm::mat4 model;
         glm::vec4 eye;
+        glm::vec4 lightDir;
+    };
+
+    // An entry of the material table the pixel shader indexes, the light
+    // direction is in the Uniform.
+    struct GpuMaterial
+    {
+        glm::vec4 diffuse;  // w alpha
+        glm::vec4 specular; // w shininess
     };
 
 public:
@@ -62,27 +66,25 @@ protected: // overrides
     virtual bool LoadContent() override;
     virtual void UnloadContent() override;
     virtual void CleanUp() override;
+    virtual void onKeyDown(const SDL_KeyboardEvent* key) override;
     virtual void Update(double delta, double total) override;
     virtual void Render(double delta, double total) override;
     virtual void Resize(int w, int h) override;
 
 protected:
     bool LoadMesh();
+    bool LoadObjMesh(MeshBuffers& mesh);
+    void BuildMeshBvh();
     bool UploadVertices();
+    void SelectOccluders();
     bool CreateRenderTargets();
     void CreatePSOs();
-    void CreateUniforms();
     void CreateMeshPSO();
     void CreateMeshRootSignature();
+    void CreateCullPipeline();
 
-    void UpdateBufferResource(
-        WRL::ComPtr<ID3D12GraphicsCommandList2> commandList,
-        ID3D12Resource**                        pDestinationResource,
-        ID3D12Resource**                        pIntermediateResource,
-        size_t                                  numElements,
-        size_t                                  elementSize,
-        const void*                             bufferData,
-        D3D12_RESOURCE_FLAGS                    flags = D3D12_RESOURCE_FLAG_NONE);
+    // Buffer in a default heap, in the COMMON state the COPY queue wants.
+    WRL::ComPtr<ID3D12Resource> CreateBuffer(size_t size, D3D12_RESOURCE_FLAGS flags = D3D12_RESOURCE_FLAG_NONE);
     // Transitioning resource
     void TransitionResource(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> cmdlist,
                             Microsoft::WRL::ComPtr<ID3D12Resource>             resource,
@@ -101,9 +103,35 @@ protected:
 
     void ResizeDepthBuffer(int width, int height);
 
-    void RenderMesh(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> cmd_list,
-                    double                                             delta,
-                    double                                             total);
+    // Draw the mesh into `cmd_list`, or into the returned lists recorded in
+    // parallel when there are enough draws. They go after `cmd_list`.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2>>
+        RenderMesh(Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> cmd_list,
+                   double                                             delta,
+                   double                                             total);
+    // Bind the mesh pipeline and its targets.
+    void BindMeshPipeline(ID3D12GraphicsCommandList2* commandList,
+                          D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                          D3D12_CPU_DESCRIPTOR_HANDLE rtv) const;
+    // Bind the mesh pipeline and draw submeshes [begin, end). Reads only, any
+    // number of threads can record at once.
+    void RecordDraws(ID3D12GraphicsCommandList2* commandList,
+                     D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                     D3D12_CPU_DESCRIPTOR_HANDLE rtv,
+                     size_t                      begin,
+                     size_t                      end) const;
+    // Cull the draws of the current frame on the COMPUTE queue, after
+    // `waits`. Returns the wait for the draws.
+    QueueWait SubmitDrawCulling(Span<const QueueWait> waits);
+    // Draw what SubmitDrawCulling left in the frame's argument buffer.
+    void RecordIndirectDraws(ID3D12GraphicsCommandList2* commandList,
+                             D3D12_GPU_VIRTUAL_ADDRESS   uniforms,
+                             D3D12_CPU_DESCRIPTOR_HANDLE rtv) const;
+    // Level of detail to draw submesh `s` with, from its projected error.
+    const MeshLod& SelectLod(size_t s) const;
+    // Closest triangle hit by a world space ray, for picking. Builds m_Bvh
+    // on the first call.
+    bool PickTriangle(const glm::vec3& origin, const glm::vec3& direction, BvhHit& hit);
 
 private: // parameters
     bool           m_ContentLoaded = false;
@@ -115,28 +143,75 @@ private: // parameters
     glm::mat4 m_ViewMatrix;
     glm::mat4 m_ProjectionMatrix;
     glm::vec3 m_LightDir;
+    glm::vec3 m_EyePosition = glm::vec3(0.0f);
+
+    LoadOptions m_LoadOptions;
+    // Cull the submeshes and fill the draw arguments on the GPU, see
+    // drawcull.h. Otherwise the CPU culls and records a draw per submesh on
+    // the workers. G switches between the two.
+    bool m_GpuDrivenDraws = true;
+    // Skip the CPU recorded draws hidden behind the occluders, see
+    // occlusion.h.
+    bool m_OcclusionCulling = true;
 
 private: // CPU Data.
-    std::vector<Vertex>   m_Vertices;
-    std::vector<uint32_t> m_Indices;
-    std::vector<SubMesh>  m_SubMeshes;
-    std::vector<Material> m_Materials;
+    // Mesh built from the OBJ on a cold start.
+    MeshBuffers m_MeshBuffers;
+    // Mapped .pmesh on a warm start.
+    MeshCache m_MeshCache;
+    // Points into one of the two above.
+    MeshView          m_Mesh;
+    std::future<void> m_CacheWriter;
+    // Over m_Mesh in object space, rays are moved into it instead of
+    // refitting the tree every time the model matrix changes. Empty until
+    // the first PickTriangle.
+    MeshBvh m_Bvh;
 
 private: // GPU Data
-    uint64_t m_FenceValues[Window::BufferCount] = {};
     // Vertex buffer for the mesh
     Microsoft::WRL::ComPtr<ID3D12Resource> m_VertexBuffer;
     D3D12_VERTEX_BUFFER_VIEW               m_VertexBufferView;
+    // Packed layout of the vertex buffer, and the position dequantization of
+    // every submesh.
+    VertexFormat                    m_VertexFormat = {};
+    std::vector<VertexQuantization> m_Quantization;
+    // Object space bounds of every submesh, from its quantization grid, and
+    // whether it is in the frustum this frame. CPU recorded draws only.
+    BoxesSoA             m_SubmeshBoxes;
+    std::vector<uint8_t> m_SubmeshVisible;
+    // Full levels of the largest submeshes, drawn into the occlusion buffer
+    // every frame before the others are tested against it. Built by the
+    // first CPU recorded frame.
+    std::vector<uint32_t>            m_OccluderIndices;
+    std::unique_ptr<OcclusionBuffer> m_Occlusion;
     // Index buffer for the mesh
     Microsoft::WRL::ComPtr<ID3D12Resource> m_IndexBuffer;
     D3D12_INDEX_BUFFER_VIEW                m_IndexBufferView;
-
-    Microsoft::WRL::ComPtr<ID3D12Resource> m_UniformBuffer;
+    // The materials of the mesh then the default one, bound once per list,
+    // draws only pass their index.
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_MaterialBuffer;
+    uint32_t                               m_MaterialCount = 0;
+    // Its view in the persistent region of the ShaderVisibleHeap.
+    DescriptorHandle m_MaterialView;
+    // Input of the culling pass, uploaded with the mesh: a DrawSource per
+    // submesh and the LOD table.
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_DrawSourceBuffer;
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_LodBuffer;
+    uint32_t                               m_DrawCount = 0;
+    // Its output, IndirectDraws and their count, one pair per frame in
+    // flight.
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_DrawArgumentBuffers;
+    std::vector<Microsoft::WRL::ComPtr<ID3D12Resource>> m_DrawCountBuffers;
+    // Copies of the buffers above, the first frame waits for it on the GPU.
+    UploadTicket m_UploadTicket;
+
+    // Workers recording the draws.
+    std::unique_ptr<JobPool> m_RecordPool;
 
     /// render targets
     Microsoft::WRL::ComPtr<ID3D12Resource> m_DepthBuffer;
-    // Descriptor heap for depth buffer.
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_DSVHeap;
+    // From the application's DSV allocator.
+    DescriptorHandle m_DepthStencilView;
 
     // Pipelines
     struct
@@ -146,4 +221,13 @@ private: // GPU Data
         // Pipeline state object.
         Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
     } m_MeshPipeline;
+    // Sets the material and dequantization root constants of the mesh
+    // pipeline, then draws.
+    Microsoft::WRL::ComPtr<ID3D12CommandSignature> m_DrawSignature;
+
+    struct
+    {
+        Microsoft::WRL::ComPtr<ID3D12RootSignature> root_signature;
+        Microsoft::WRL::ComPtr<ID3D12PipelineState> pso;
+    } m_CullPipeline;
 };
@@ -0,0 +1,330 @@
+#include "meshcache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Files are hashed in blocks of this size, one block per task.
+constexpr size_t kHashBlockSize = 16 << 20;
+
+inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t HashFile(const char* path)
+{
+    MappedFile file;
+    if (!file.Open(path))
+        return 0;
+
+    size_t                blocks = (file.GetSize() + kHashBlockSize - 1) / kHashBlockSize;
+    std::vector<uint64_t> blockHashes(blocks);
+    ParallelFor(blocks, [&](size_t b) {
+        size_t begin   = b * kHashBlockSize;
+        size_t size    = std::min(kHashBlockSize, file.GetSize() - begin);
+        blockHashes[b] = HashBytes(file.GetData() + begin, size, b);
+    });
+
+    uint64_t h = file.GetSize();
+    for (uint64_t blockHash : blockHashes)
+        h = CombineHash(h, blockHash);
+    return h;
+}
+
+// The path of a stamp read from a cache is not trusted to be terminated.
+inline std::string GetStampPath(const MeshSourceStamp& stamp)
+{
+    return std::string(stamp.path, strnlen(stamp.path, sizeof(stamp.path)));
+}
+
+// Overwrite the source stamps of the cache at `path` in place. A torn write
+// only costs a content hash on the next open.
+bool RewriteStamps(const std::string& path, uint64_t offset, const std::vector<MeshSourceStamp>& stamps)
+{
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    if (!file)
+        return false;
+    file.seekp(std::streamoff(offset));
+    file.write(reinterpret_cast<const char*>(stamps.data()), std::streamsize(stamps.size() * sizeof(MeshSourceStamp)));
+    return bool(file);
+}
+
+// Expected element size of every section.
+const uint32_t kSectionStrides[MESH_CACHE_SECTION_COUNT] = {
+    sizeof(MeshSourceStamp),
+    sizeof(MeshVertex),
+    sizeof(uint32_t),
+    sizeof(MeshSubMesh),
+    sizeof(MeshMaterial),
+    sizeof(MeshLod),
+    sizeof(Meshlet),
+    sizeof(MeshletBounds),
+    sizeof(uint32_t),
+    sizeof(uint32_t),
+};
+
+} // namespace
+
+bool StampFile(const std::string& path, MeshSourceStamp* stamp)
+{
+    std::error_code ec;
+    uint64_t        size = fs::file_size(path, ec);
+    if (ec)
+        return false;
+    auto writeTime = fs::last_write_time(path, ec);
+    if (ec || path.size() >= sizeof(stamp->path))
+        return false;
+
+    memset(stamp, 0, sizeof(*stamp));
+    stamp->size      = size;
+    stamp->writeTime = (int64_t)writeTime.time_since_epoch().count();
+    memcpy(stamp->path, path.c_str(), path.size());
+    return true;
+}
+
+bool MeshSources::Collect(const std::string& objPath, const std::string& mtlBaseDir)
+{
+    stamps.clear();
+
+    MeshSourceStamp stamp;
+    if (!StampFile(objPath, &stamp))
+        return false;
+    stamps.push_back(stamp);
+
+    MappedFile obj;
+    if (!obj.Open(objPath))
+        return false;
+
+    // `mtllib` statements are rare, find them with memchr on their first
+    // letter instead of tokenizing the whole file.
+    const char*     p   = obj.GetData();
+    const char*     end = p + obj.GetSize();
+    const char      kKeyword[] = "mtllib";
+    while ((p = static_cast<const char*>(memchr(p, 'm', end - p))) != nullptr)
+    {
+        bool lineStart = p == obj.GetData() || p[-1] == '\n';
+        if (!lineStart || end - p < 7 || memcmp(p, kKeyword, 6) != 0 || (p[6] != ' ' && p[6] != '\t'))
+        {
+            p++;
+            continue;
+        }
+
+        const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+        eol             = eol ? eol : end;
+
+        std::istringstream files(std::string(p + 7, eol));
+        std::string        file;
+        while (files >> file)
+        {
+            fs::path mtlPath = fs::path(mtlBaseDir) / file;
+            if (StampFile(mtlPath.string(), &stamp))
+                stamps.push_back(stamp);
+        }
+        p = eol;
+    }
+    return true;
+}
+
+uint64_t MeshSources::HashContent(const void* options, size_t optionsSize) const
+{
+    uint64_t h = HashMeshOptions(options, optionsSize);
+    for (const auto& stamp : stamps)
+        h = CombineHash(h, HashFile(GetStampPath(stamp).c_str()));
+    return h;
+}
+
+bool WriteMeshCache(const std::string& path,
+                    const MeshSources& sources,
+                    const void*        options,
+                    size_t             optionsSize,
+                    const MeshBuffers& mesh)
+{
+    const void* sectionData[MESH_CACHE_SECTION_COUNT] = {
+        sources.stamps.data(),
+        mesh.vertices.data(),
+        mesh.indices.data(),
+        mesh.submeshes.data(),
+        mesh.materials.data(),
+        mesh.lods.data(),
+        mesh.meshlets.data(),
+        mesh.meshlet_bounds.data(),
+        mesh.meshlet_vertices.data(),
+        mesh.meshlet_triangles.data(),
+    };
+    const size_t sectionCounts[MESH_CACHE_SECTION_COUNT] = {
+        sources.stamps.size(),
+        mesh.vertices.size(),
+        mesh.indices.size(),
+        mesh.submeshes.size(),
+        mesh.materials.size(),
+        mesh.lods.size(),
+        mesh.meshlets.size(),
+        mesh.meshlet_bounds.size(),
+        mesh.meshlet_vertices.size(),
+        mesh.meshlet_triangles.size(),
+    };
+
+    MeshCacheHeader header = {};
+    header.magic           = kMeshCacheMagic;
+    header.version         = kMeshCacheVersion;
+    header.optionsHash     = HashMeshOptions(options, optionsSize);
+    header.contentHash     = sources.HashContent(options, optionsSize);
+
+    uint64_t offset = AlignUp(sizeof(header), kMeshCacheAlignment);
+    for (uint32_t s = 0; s < MESH_CACHE_SECTION_COUNT; s++)
+    {
+        header.sections[s].offset = offset;
+        header.sections[s].count  = sectionCounts[s];
+        header.sections[s].stride = kSectionStrides[s];
+        offset                    = AlignUp(offset + sectionCounts[s] * kSectionStrides[s], kMeshCacheAlignment);
+    }
+    header.fileSize = offset;
+
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+
+        static const char kPadding[kMeshCacheAlignment] = {};
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        uint64_t written = sizeof(header);
+        for (uint32_t s = 0; s < MESH_CACHE_SECTION_COUNT; s++)
+        {
+            out.write(kPadding, header.sections[s].offset - written);
+            out.write(static_cast<const char*>(sectionData[s]), sectionCounts[s] * kSectionStrides[s]);
+            written = header.sections[s].offset + sectionCounts[s] * kSectionStrides[s];
+        }
+        out.write(kPadding, header.fileSize - written);
+        if (!out)
+            return false;
+    }
+
+    std::error_code ec;
+    fs::rename(tmpPath, path, ec);
+    if (ec)
+    {
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool MeshCache::Open(const std::string& path, const void* options, size_t optionsSize)
+{
+    if (!Map(path))
+        return false;
+    auto header = reinterpret_cast<const MeshCacheHeader*>(m_File.GetData());
+    if (header->optionsHash == HashMeshOptions(options, optionsSize) && SourcesUnchanged())
+        return true;
+
+    // A stamp changed, the cache is still good if the content did not. The
+    // new stamps are taken before hashing and written back on a match, so
+    // the next open is fast again. A change during the hash leaves a stamp
+    // that does not match and only costs another hash.
+    MeshSources sources;
+    bool        stamped = true;
+    for (const MeshSourceStamp& source : m_Sources)
+    {
+        MeshSourceStamp stamp = source;
+        stamped               = StampFile(GetStampPath(source), &stamp) && stamped;
+        sources.stamps.push_back(stamp);
+    }
+    if (sources.HashContent(options, optionsSize) != header->contentHash)
+    {
+        Close();
+        return false;
+    }
+    if (!stamped)
+        return true;
+
+    // The mapping is read only, and on Windows it locks the file.
+    uint64_t stampOffset = header->sections[MESH_CACHE_SECTION_SOURCES].offset;
+    Close();
+    RewriteStamps(path, stampOffset, sources.stamps);
+    return Map(path);
+}
+
+void MeshCache::Close()
+{
+    m_File.Close();
+    m_Sources = {};
+    m_View    = {};
+}
+
+bool MeshCache::Map(const std::string& path)
+{
+    Close();
+    if (!m_File.Open(path))
+        return false;
+
+    auto header = reinterpret_cast<const MeshCacheHeader*>(m_File.GetData());
+    if (m_File.GetSize() < sizeof(MeshCacheHeader) || header->magic != kMeshCacheMagic ||
+        header->version != kMeshCacheVersion || header->fileSize != m_File.GetSize())
+    {
+        Close();
+        return false;
+    }
+
+    for (uint32_t s = 0; s < MESH_CACHE_SECTION_COUNT; s++)
+    {
+        const MeshCacheSection& section = header->sections[s];
+        // Without multiplying, a corrupt count could wrap around.
+        if (section.stride != kSectionStrides[s] || section.offset % kMeshCacheAlignment != 0 ||
+            section.offset > m_File.GetSize() || section.count > (m_File.GetSize() - section.offset) / section.stride)
+        {
+            Close();
+            return false;
+        }
+    }
+
+    auto sectionData = [&](MeshCacheSectionId id) { return m_File.GetData() + header->sections[id].offset; };
+    auto sectionCount = [&](MeshCacheSectionId id) { return (size_t)header->sections[id].count; };
+
+    m_Sources = { reinterpret_cast<const MeshSourceStamp*>(sectionData(MESH_CACHE_SECTION_SOURCES)),
+                  sectionCount(MESH_CACHE_SECTION_SOURCES) };
+
+    m_View.vertices  = { reinterpret_cast<const MeshVertex*>(sectionData(MESH_CACHE_SECTION_VERTICES)),
+                        sectionCount(MESH_CACHE_SECTION_VERTICES) };
+    m_View.indices   = { reinterpret_cast<const uint32_t*>(sectionData(MESH_CACHE_SECTION_INDICES)),
+                       sectionCount(MESH_CACHE_SECTION_INDICES) };
+    m_View.submeshes = { reinterpret_cast<const MeshSubMesh*>(sectionData(MESH_CACHE_SECTION_SUBMESHES)),
+                         sectionCount(MESH_CACHE_SECTION_SUBMESHES) };
+    m_View.materials = { reinterpret_cast<const MeshMaterial*>(sectionData(MESH_CACHE_SECTION_MATERIALS)),
+                         sectionCount(MESH_CACHE_SECTION_MATERIALS) };
+    m_View.lods      = { reinterpret_cast<const MeshLod*>(sectionData(MESH_CACHE_SECTION_LODS)),
+                         sectionCount(MESH_CACHE_SECTION_LODS) };
+
+    m_View.meshlets          = { reinterpret_cast<const Meshlet*>(sectionData(MESH_CACHE_SECTION_MESHLETS)),
+                                 sectionCount(MESH_CACHE_SECTION_MESHLETS) };
+    m_View.meshlet_bounds    = { reinterpret_cast<const MeshletBounds*>(sectionData(MESH_CACHE_SECTION_MESHLET_BOUNDS)),
+                                 sectionCount(MESH_CACHE_SECTION_MESHLET_BOUNDS) };
+    m_View.meshlet_vertices  = { reinterpret_cast<const uint32_t*>(sectionData(MESH_CACHE_SECTION_MESHLET_VERTICES)),
+                                 sectionCount(MESH_CACHE_SECTION_MESHLET_VERTICES) };
+    m_View.meshlet_triangles = { reinterpret_cast<const uint32_t*>(sectionData(MESH_CACHE_SECTION_MESHLET_TRIANGLES)),
+                                 sectionCount(MESH_CACHE_SECTION_MESHLET_TRIANGLES) };
+    return true;
+}
+
+bool MeshCache::SourcesUnchanged() const
+{
+    if (m_Sources.empty())
+        return false;
+
+    for (const auto& source : m_Sources)
+    {
+        MeshSourceStamp current;
+        if (!StampFile(GetStampPath(source), &current) || current.size != source.size || current.writeTime != source.writeTime)
+            return false;
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+/**
+ * Binary mesh cache (.pmesh).
+ *
+ * The file is a fixed header followed by a table of source file stamps and
+ * one section per mesh array. Sections are aligned so the mapped file can be
+ * used in place: MeshCache::GetView() points straight into the mapping.
+ *
+ * A cache is valid for a given content hash, covering the source OBJ, its MTL
+ * files and the loader options. To keep warm starts cheap, the size and the
+ * modification time of every source file are stored as well; the content is
+ * only re-hashed when one of those stamps changed.
+ */
+#pragma once
+
+#include "hash.h"
+#include "mappedfile.h"
+#include "meshdata.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr uint32_t kMeshCacheMagic   = 0x48534d50; // "PMSH"
+constexpr uint32_t kMeshCacheVersion = 6;
+// Every section starts on a cache line.
+constexpr uint64_t kMeshCacheAlignment = 64;
+
+enum MeshCacheSectionId : uint32_t
+{
+    MESH_CACHE_SECTION_SOURCES = 0,
+    MESH_CACHE_SECTION_VERTICES,
+    MESH_CACHE_SECTION_INDICES,
+    MESH_CACHE_SECTION_SUBMESHES,
+    MESH_CACHE_SECTION_MATERIALS,
+    MESH_CACHE_SECTION_LODS,
+    MESH_CACHE_SECTION_MESHLETS,
+    MESH_CACHE_SECTION_MESHLET_BOUNDS,
+    MESH_CACHE_SECTION_MESHLET_VERTICES,
+    MESH_CACHE_SECTION_MESHLET_TRIANGLES,
+    MESH_CACHE_SECTION_COUNT,
+};
+
+struct MeshCacheSection
+{
+    uint64_t offset; // from the start of the file
+    uint64_t count;  // number of elements
+    uint32_t stride; // element size, checked against the reader's structs
+    uint32_t reserved;
+};
+
+struct MeshCacheHeader
+{
+    uint32_t         magic;
+    uint32_t         version;
+    uint64_t         optionsHash; // loader options alone
+    uint64_t         contentHash; // loader options and every source file
+    uint64_t         fileSize;
+    MeshCacheSection sections[MESH_CACHE_SECTION_COUNT];
+};
+
+// A file the cache was built from.
+struct MeshSourceStamp
+{
+    uint64_t size;
+    int64_t  writeTime;
+    char     path[240];
+};
+
+// The files a mesh is built from, and their stamps.
+struct MeshSources
+{
+    std::vector<MeshSourceStamp> stamps;
+
+    /**
+     * Collect the OBJ and the MTL files its `mtllib` statements reference.
+     * @returns false if the OBJ can not be read.
+     */
+    bool Collect(const std::string& objPath, const std::string& mtlBaseDir);
+
+    /**
+     * Hash the content of every source file, and the loader `options`.
+     */
+    uint64_t HashContent(const void* options, size_t optionsSize) const;
+};
+
+inline uint64_t HashMeshOptions(const void* options, size_t optionsSize)
+{
+    return HashBytes(options, optionsSize, kMeshCacheVersion);
+}
+
+// Stamp `path` with its current size and modification time.
+bool StampFile(const std::string& path, MeshSourceStamp* stamp);
+
+/**
+ * Write `mesh` to a cache file. The file is written next to `path` first and
+ * then renamed, so readers never see a partial cache. This hashes every
+ * source file, call it off the main thread.
+ */
+bool WriteMeshCache(const std::string& path,
+                    const MeshSources& sources,
+                    const void*        options,
+                    size_t             optionsSize,
+                    const MeshBuffers& mesh);
+
+class MeshCache
+{
+public:
+    /**
+     * Map the cache at `path`. The cache is rejected if it is malformed, from
+     * another version, or if a source stamp changed and the content hash of
+     * the sources and `options` does not match anymore.
+     */
+    bool Open(const std::string& path, const void* options, size_t optionsSize);
+    void Close();
+
+    bool     IsOpen() const { return m_File.IsOpen(); }
+    MeshView GetView() const { return m_View; }
+
+private:
+    bool Map(const std::string& path);
+    bool SourcesUnchanged() const;
+
+    MappedFile                 m_File;
+    ArrayView<MeshSourceStamp> m_Sources;
+    MeshView                   m_View;
+};
@@ -0,0 +1,153 @@
+/**
+ * CPU side mesh data shared by the loader, the mesh processing passes and
+ * the renderer. Nothing in here depends on D3D12.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+
+struct MeshVertex
+{
+    glm::vec3 position;
+    glm::vec3 normal;
+    glm::vec3 texcoord;
+
+    bool operator==(const MeshVertex& other) const
+    {
+        return position == other.position && normal == other.normal && texcoord == other.texcoord;
+    }
+};
+
+struct MeshSubMesh
+{
+    uint32_t index_offset;
+    uint32_t index_count;
+    uint32_t material_id;
+    // Vertices only this submesh references, see SplitVerticesBySubMesh.
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    // Meshlets covering the index range, see BuildMeshlets.
+    uint32_t meshlet_offset;
+    uint32_t meshlet_count;
+    // Levels of detail, see BuildLodChains.
+    uint32_t lod_offset;
+    uint32_t lod_count;
+};
+
+// One level of detail of a submesh, sharing the submesh vertices.
+struct MeshLod
+{
+    uint32_t index_offset;
+    uint32_t index_count;
+    // Largest distance of the simplified surface to the full one, in object
+    // space.
+    float    error;
+    uint32_t padding;
+};
+
+struct Meshlet
+{
+    // Range of MeshBuffers::meshlet_vertices, global vertex indices.
+    uint32_t vertex_offset;
+    uint32_t vertex_count;
+    // Range of MeshBuffers::meshlet_triangles, three 8 bit local indices
+    // per triangle.
+    uint32_t triangle_offset;
+    uint32_t triangle_count;
+};
+
+struct MeshletBounds
+{
+    glm::vec3 center;
+    float     radius;
+    // Every triangle normal is within asin(cone_cutoff) of the axis, a
+    // cutoff of 1 means the normals spread too much to cull.
+    glm::vec3 cone_axis;
+    float     cone_cutoff;
+    // Behind every triangle plane of the meshlet.
+    glm::vec3 cone_apex;
+    float     padding;
+};
+
+struct MeshMaterial
+{
+    glm::vec4 diffuse  = glm::vec4(1.0); // w alpha
+    glm::vec4 specular = glm::vec4(0.0);
+    glm::vec4 lightDir = glm::vec4(1.0, 1.0, 0.0, 0.0);
+
+    static MeshMaterial default_material() { return MeshMaterial(); }
+};
+
+// Read-only view of a contiguous array, either owned by a std::vector or
+// pointing into a memory mapped file.
+template <typename T>
+struct ArrayView
+{
+    const T* data  = nullptr;
+    size_t   count = 0;
+
+    ArrayView() = default;
+    ArrayView(const T* items, size_t itemCount) :
+        data(items), count(itemCount) { }
+    ArrayView(const std::vector<T>& v) :
+        data(v.data()), count(v.size()) { }
+
+    const T* begin() const { return data; }
+    const T* end() const { return data + count; }
+    size_t   size() const { return count; }
+    bool     empty() const { return count == 0; }
+
+    const T& operator[](size_t i) const { return data[i]; }
+};
+
+// Mesh data as produced by the loader and the mesh processing passes.
+struct MeshBuffers
+{
+    std::vector<MeshVertex>   vertices;
+    std::vector<uint32_t>     indices;
+    std::vector<MeshSubMesh>  submeshes;
+    std::vector<MeshMaterial> materials;
+    std::vector<MeshLod>      lods;
+
+    std::vector<Meshlet>       meshlets;
+    std::vector<MeshletBounds> meshlet_bounds;
+    std::vector<uint32_t>      meshlet_vertices;
+    std::vector<uint32_t>      meshlet_triangles;
+};
+
+// What the renderer reads, it does not care where the data lives.
+struct MeshView
+{
+    ArrayView<MeshVertex>   vertices;
+    ArrayView<uint32_t>     indices;
+    ArrayView<MeshSubMesh>  submeshes;
+    ArrayView<MeshMaterial> materials;
+    ArrayView<MeshLod>      lods;
+
+    ArrayView<Meshlet>       meshlets;
+    ArrayView<MeshletBounds> meshlet_bounds;
+    ArrayView<uint32_t>      meshlet_vertices;
+    ArrayView<uint32_t>      meshlet_triangles;
+
+    static MeshView FromBuffers(const MeshBuffers& buffers)
+    {
+        MeshView view;
+        view.vertices  = buffers.vertices;
+        view.indices   = buffers.indices;
+        view.submeshes = buffers.submeshes;
+        view.materials = buffers.materials;
+        view.lods      = buffers.lods;
+
+        view.meshlets          = buffers.meshlets;
+        view.meshlet_bounds    = buffers.meshlet_bounds;
+        view.meshlet_vertices  = buffers.meshlet_vertices;
+        view.meshlet_triangles = buffers.meshlet_triangles;
+        return view;
+    }
+};
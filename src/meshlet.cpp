@@ -0,0 +1,245 @@
+#include "meshlet.h"
+#include "parallel.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Meshlets of one submesh, offsets relative to its own arrays.
+struct SubMeshMeshlets
+{
+    std::vector<Meshlet>  meshlets;
+    std::vector<uint32_t> vertices;
+    std::vector<uint32_t> triangles;
+};
+
+constexpr uint8_t kNoLocalIndex = 0xff;
+
+void BuildSubMeshMeshlets(const uint32_t*  indices,
+                          size_t           indexCount,
+                          uint32_t         maxVertices,
+                          uint32_t         maxTriangles,
+                          SubMeshMeshlets& out)
+{
+    if (indexCount < 3)
+        return;
+
+    // Local index of every vertex of the range in the current meshlet.
+    auto     range    = std::minmax_element(indices, indices + indexCount);
+    uint32_t minIndex = *range.first;
+    std::vector<uint8_t> local(*range.second - minIndex + 1, kNoLocalIndex);
+
+    Meshlet current = {};
+    auto    flush   = [&]() {
+        for (uint32_t v = 0; v < current.vertex_count; v++)
+            local[out.vertices[current.vertex_offset + v] - minIndex] = kNoLocalIndex;
+        out.meshlets.push_back(current);
+
+        current                 = {};
+        current.vertex_offset   = (uint32_t)out.vertices.size();
+        current.triangle_offset = (uint32_t)out.triangles.size();
+    };
+
+    for (size_t i = 0; i + 2 < indexCount; i += 3)
+    {
+        uint32_t a = indices[i + 0] - minIndex;
+        uint32_t b = indices[i + 1] - minIndex;
+        uint32_t c = indices[i + 2] - minIndex;
+
+        uint32_t added = (local[a] == kNoLocalIndex) + (local[b] == kNoLocalIndex && b != a) +
+                         (local[c] == kNoLocalIndex && c != a && c != b);
+        if (current.vertex_count + added > maxVertices || current.triangle_count == maxTriangles)
+            flush();
+
+        uint32_t corners[3] = { a, b, c };
+        uint32_t packed     = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            uint8_t& slot = local[corners[k]];
+            if (slot == kNoLocalIndex)
+            {
+                slot = (uint8_t)current.vertex_count++;
+                out.vertices.push_back(corners[k] + minIndex);
+            }
+            packed |= uint32_t(slot) << (8 * k);
+        }
+        out.triangles.push_back(packed);
+        current.triangle_count++;
+    }
+    if (current.triangle_count > 0)
+        flush();
+}
+
+// Ritter's bounding sphere, within a few percent of the minimal one.
+void ComputeBoundingSphere(const glm::vec3* points, size_t count, glm::vec3& center, float& radius)
+{
+    // Start from the most distant pair of the axis extremes.
+    size_t minAxis[3] = { 0, 0, 0 };
+    size_t maxAxis[3] = { 0, 0, 0 };
+    for (size_t i = 1; i < count; i++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (points[i][axis] < points[minAxis[axis]][axis])
+                minAxis[axis] = i;
+            if (points[i][axis] > points[maxAxis[axis]][axis])
+                maxAxis[axis] = i;
+        }
+    }
+
+    int   bestAxis = 0;
+    float bestSpan = -1.0f;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        glm::vec3 d    = points[maxAxis[axis]] - points[minAxis[axis]];
+        float     span = glm::dot(d, d);
+        if (span > bestSpan)
+        {
+            bestSpan = span;
+            bestAxis = axis;
+        }
+    }
+
+    center = (points[minAxis[bestAxis]] + points[maxAxis[bestAxis]]) * 0.5f;
+    radius = std::sqrt(bestSpan) * 0.5f;
+
+    // Grow the sphere over the points outside of it.
+    for (size_t i = 0; i < count; i++)
+    {
+        float distance = glm::length(points[i] - center);
+        if (distance > radius)
+        {
+            float grown = (radius + distance) * 0.5f;
+            center += (points[i] - center) * ((grown - radius) / distance);
+            radius = grown;
+        }
+    }
+}
+
+} // namespace
+
+MeshletBounds ComputeMeshletBounds(const MeshVertex* vertices,
+                                   const uint32_t*   meshletVertices,
+                                   const uint32_t*   meshletTriangles,
+                                   const Meshlet&    meshlet)
+{
+    MeshletBounds bounds = {};
+    assert(meshlet.vertex_count <= 256 && meshlet.triangle_count <= 256);
+
+    // Value-initialized, gcc can't tell vertex_count bounds the reads below.
+    glm::vec3 positions[256] = {};
+    for (uint32_t v = 0; v < meshlet.vertex_count; v++)
+        positions[v] = vertices[meshletVertices[meshlet.vertex_offset + v]].position;
+    ComputeBoundingSphere(positions, meshlet.vertex_count, bounds.center, bounds.radius);
+
+    // Unit normals of the non degenerate triangles.
+    glm::vec3 normals[256];
+    glm::vec3 corners[256];
+    uint32_t  normalCount = 0;
+    glm::vec3 axis(0.0f);
+    for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+    {
+        uint32_t local[3];
+        UnpackMeshletTriangle(meshletTriangles[meshlet.triangle_offset + t], local);
+        glm::vec3 a      = positions[local[0]];
+        glm::vec3 normal = glm::cross(positions[local[1]] - a, positions[local[2]] - a);
+        float     length = glm::length(normal);
+        if (length <= 0.0f)
+            continue;
+
+        normals[normalCount] = normal / length;
+        corners[normalCount] = a;
+        axis += normals[normalCount];
+        normalCount++;
+    }
+
+    bounds.cone_apex   = bounds.center;
+    bounds.cone_axis   = glm::vec3(0.0f);
+    bounds.cone_cutoff = 1.0f;
+
+    float axisLength = glm::length(axis);
+    if (normalCount == 0 || axisLength <= 0.0f)
+        return bounds;
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (uint32_t t = 0; t < normalCount; t++)
+        minDot = std::min(minDot, glm::dot(axis, normals[t]));
+    // Close to a hemisphere the apex runs off to infinity and the cone never
+    // culls anything anyway.
+    if (minDot <= 0.1f)
+        return bounds;
+
+    // Move the apex back along the axis until it is behind every triangle
+    // plane: dot(apex - corner, normal) <= 0.
+    float maxT = 0.0f;
+    for (uint32_t t = 0; t < normalCount; t++)
+        maxT = std::max(maxT, glm::dot(bounds.center - corners[t], normals[t]) / glm::dot(axis, normals[t]));
+
+    bounds.cone_apex   = bounds.center - axis * maxT;
+    bounds.cone_axis   = axis;
+    bounds.cone_cutoff = std::sqrt(1.0f - minDot * minDot);
+    return bounds;
+}
+
+void BuildMeshlets(MeshBuffers& mesh, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    // Local indices are 8 bit, 0xff marks a vertex not in the meshlet, and
+    // ComputeMeshletBounds works on the stack with room for 256 triangles.
+    maxVertices  = std::min(std::max(maxVertices, 3u), 255u);
+    maxTriangles = std::min(std::max(maxTriangles, 1u), 256u);
+
+    std::vector<SubMeshMeshlets> built(mesh.submeshes.size());
+    ParallelFor(mesh.submeshes.size(), [&](size_t s) {
+        const MeshSubMesh& submesh = mesh.submeshes[s];
+        BuildSubMeshMeshlets(mesh.indices.data() + submesh.index_offset, submesh.index_count, maxVertices, maxTriangles, built[s]);
+    });
+
+    mesh.meshlets.clear();
+    mesh.meshlet_vertices.clear();
+    mesh.meshlet_triangles.clear();
+    for (size_t s = 0; s < mesh.submeshes.size(); s++)
+    {
+        mesh.submeshes[s].meshlet_offset = (uint32_t)mesh.meshlets.size();
+        mesh.submeshes[s].meshlet_count  = (uint32_t)built[s].meshlets.size();
+
+        uint32_t vertexBase   = (uint32_t)mesh.meshlet_vertices.size();
+        uint32_t triangleBase = (uint32_t)mesh.meshlet_triangles.size();
+        for (Meshlet meshlet : built[s].meshlets)
+        {
+            meshlet.vertex_offset += vertexBase;
+            meshlet.triangle_offset += triangleBase;
+            mesh.meshlets.push_back(meshlet);
+        }
+        mesh.meshlet_vertices.insert(mesh.meshlet_vertices.end(), built[s].vertices.begin(), built[s].vertices.end());
+        mesh.meshlet_triangles.insert(mesh.meshlet_triangles.end(), built[s].triangles.begin(), built[s].triangles.end());
+    }
+
+    mesh.meshlet_bounds.resize(mesh.meshlets.size());
+    ParallelFor(mesh.meshlets.size(), [&](size_t m) {
+        mesh.meshlet_bounds[m] = ComputeMeshletBounds(mesh.vertices.data(),
+                                                      mesh.meshlet_vertices.data(),
+                                                      mesh.meshlet_triangles.data(),
+                                                      mesh.meshlets[m]);
+    });
+}
+
+void ExtractFrustumPlanes(const glm::mat4& clip, glm::vec4 planes[6])
+{
+    // glm is column major, row r of the matrix is (m[0][r], ..., m[3][r]).
+    auto row = [&](int r) { return glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]); };
+
+    planes[0] = row(3) + row(0); // left
+    planes[1] = row(3) - row(0); // right
+    planes[2] = row(3) + row(1); // bottom
+    planes[3] = row(3) - row(1); // top
+    planes[4] = row(2);          // near, depth is [0, 1]
+    planes[5] = row(3) - row(2); // far
+
+    for (int p = 0; p < 6; p++)
+        planes[p] /= glm::length(glm::vec3(planes[p]));
+}
@@ -0,0 +1,72 @@
+/**
+ * Meshlets.
+ *
+ * Every submesh index range is split into small clusters of at most
+ * kMeshletMaxVertices vertices and kMeshletMaxTriangles triangles. A meshlet
+ * indexes a local vertex table, so its triangles only need 8 bit indices,
+ * and it carries a bounding sphere and a normal cone, so whole clusters can
+ * be frustum and backface culled before their triangles are looked at.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Limits matching the common mesh shader output limits.
+constexpr uint32_t kMeshletMaxVertices  = 64;
+constexpr uint32_t kMeshletMaxTriangles = 124;
+
+/**
+ * Build the meshlets of every submesh of `mesh`, the submeshes are processed
+ * in parallel. The triangles are taken in index order, so run it after the
+ * vertex cache optimization, which leaves neighbouring triangles next to
+ * each other. Fills the meshlet arrays of `mesh` and
+ * MeshSubMesh::meshlet_offset and meshlet_count.
+ */
+void BuildMeshlets(MeshBuffers& mesh,
+                   uint32_t     maxVertices  = kMeshletMaxVertices,
+                   uint32_t     maxTriangles = kMeshletMaxTriangles);
+
+// Bounding sphere and normal cone of one meshlet.
+MeshletBounds ComputeMeshletBounds(const MeshVertex* vertices,
+                                   const uint32_t*   meshletVertices,
+                                   const uint32_t*   meshletTriangles,
+                                   const Meshlet&    meshlet);
+
+/**
+ * True if every triangle of the meshlet faces away from `eye`, in the space
+ * of the mesh. A triangle (a, b, c) faces away when its normal
+ * cross(b - a, c - a) points away from the eye.
+ */
+inline bool IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& eye)
+{
+    glm::vec3 view = bounds.cone_apex - eye;
+    return bounds.cone_cutoff < 1.0f && glm::dot(view, bounds.cone_axis) >= bounds.cone_cutoff * glm::length(view);
+}
+
+/**
+ * Extract the six frustum planes of a clip space matrix with a [0, 1] depth
+ * range (Gribb/Hartmann). Planes are normalized, points inside have a
+ * non-negative distance.
+ */
+void ExtractFrustumPlanes(const glm::mat4& clip, glm::vec4 planes[6]);
+
+// True if the sphere is entirely on the outer side of one frustum plane.
+inline bool IsSphereOutsideFrustum(const glm::vec3& center, float radius, const glm::vec4 planes[6])
+{
+    for (int p = 0; p < 6; p++)
+        if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius)
+            return true;
+    return false;
+}
+
+// Unpack the local vertex indices of a meshlet triangle.
+inline void UnpackMeshletTriangle(uint32_t packed, uint32_t local[3])
+{
+    local[0] = packed & 0xff;
+    local[1] = (packed >> 8) & 0xff;
+    local[2] = (packed >> 16) & 0xff;
+}
@@ -0,0 +1,159 @@
+#include "meshweld.h"
+
+#include <cmath>
+
+namespace
+{
+
+struct GridCell
+{
+    int64_t x, y, z;
+
+    bool operator==(const GridCell& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct GridCellHash
+{
+    uint64_t operator()(const GridCell& cell) const
+    {
+        return MixHash(uint64_t(cell.x) * 73856093ULL ^ uint64_t(cell.y) * 19349663ULL ^ uint64_t(cell.z) * 83492791ULL);
+    }
+};
+
+using GridMap = FlatIndexMap<GridCell, GridCellHash>;
+
+constexpr uint32_t kNone = GridMap::kEmpty;
+
+inline bool IsNear(const glm::vec3& a, const glm::vec3& b, float epsilon)
+{
+    glm::vec3 d = glm::abs(a - b);
+    return d.x <= epsilon && d.y <= epsilon && d.z <= epsilon;
+}
+
+} // namespace
+
+void DeduplicateCorners(const tinyobj::attrib_t&             attrib,
+                        const std::vector<tinyobj::shape_t>& shapes,
+                        std::vector<MeshVertex>&             vertices,
+                        std::vector<uint32_t>&               indices)
+{
+    size_t cornerCount = 0;
+    for (const tinyobj::shape_t& shape : shapes)
+        cornerCount += shape.mesh.indices.size();
+    IndexTripleMap uniqueVertices(cornerCount / 4);
+    indices.reserve(indices.size() + cornerCount);
+
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        for (const tinyobj::index_t& idx : shape.mesh.indices)
+        {
+            auto unique = uniqueVertices.Insert({ idx.vertex_index, idx.normal_index, idx.texcoord_index }, uint32_t(vertices.size()));
+            indices.push_back(unique.first);
+            if (!unique.second)
+                continue;
+
+            MeshVertex vertex {};
+            vertex.position = glm::vec3(attrib.vertices[3 * size_t(idx.vertex_index) + 0],
+                                        attrib.vertices[3 * size_t(idx.vertex_index) + 1],
+                                        attrib.vertices[3 * size_t(idx.vertex_index) + 2]);
+            vertex.normal   = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.texcoord = glm::vec3(-1.0f, -1.0f, -1.0f);
+            // Negative indices mean no normal or texcoord.
+            if (idx.normal_index >= 0)
+            {
+                vertex.normal = glm::normalize(glm::vec3(attrib.normals[3 * size_t(idx.normal_index) + 0],
+                                                         attrib.normals[3 * size_t(idx.normal_index) + 1],
+                                                         attrib.normals[3 * size_t(idx.normal_index) + 2]));
+            }
+            if (idx.texcoord_index >= 0)
+            {
+                vertex.texcoord = glm::vec3(attrib.texcoords[2 * size_t(idx.texcoord_index) + 0],
+                                            attrib.texcoords[2 * size_t(idx.texcoord_index) + 1],
+                                            0.0f);
+            }
+            vertices.push_back(vertex);
+        }
+    }
+}
+
+size_t WeldVerticesEpsilon(std::vector<MeshVertex>& vertices,
+                           std::vector<uint32_t>&   indices,
+                           float                    epsilon)
+{
+    if (vertices.empty() || epsilon <= 0.0f)
+        return 0;
+
+    // Cells are epsilon wide, so a match is always in one of the 27 cells
+    // around the vertex. Every cell stores the first representative that
+    // fell in it, the others are chained through `next`.
+    const float inverseCell = 1.0f / epsilon;
+
+    GridMap                 grid(vertices.size());
+    std::vector<uint32_t>   next;
+    std::vector<uint32_t>   remap(vertices.size());
+    std::vector<MeshVertex> welded;
+    welded.reserve(vertices.size());
+
+    auto cellOf = [inverseCell](const glm::vec3& p) {
+        return GridCell { (int64_t)std::floor(p.x * inverseCell),
+                          (int64_t)std::floor(p.y * inverseCell),
+                          (int64_t)std::floor(p.z * inverseCell) };
+    };
+
+    for (size_t v = 0; v < vertices.size(); v++)
+    {
+        const MeshVertex& vertex = vertices[v];
+        GridCell          cell   = cellOf(vertex.position);
+
+        uint32_t match = kNone;
+        for (int64_t dz = -1; dz <= 1 && match == kNone; dz++)
+        {
+            for (int64_t dy = -1; dy <= 1 && match == kNone; dy++)
+            {
+                for (int64_t dx = -1; dx <= 1; dx++)
+                {
+                    uint32_t candidate = grid.Find({ cell.x + dx, cell.y + dy, cell.z + dz });
+                    for (; candidate != kNone; candidate = next[candidate])
+                    {
+                        const MeshVertex& other = welded[candidate];
+                        if (IsNear(vertex.position, other.position, epsilon) &&
+                            IsNear(vertex.normal, other.normal, epsilon) &&
+                            IsNear(vertex.texcoord, other.texcoord, epsilon))
+                        {
+                            match = candidate;
+                            break;
+                        }
+                    }
+                    if (match != kNone)
+                        break;
+                }
+            }
+        }
+
+        if (match == kNone)
+        {
+            match     = (uint32_t)welded.size();
+            auto head = grid.Insert(cell, match);
+            // the cell already had a representative, chain the new one in
+            // front of the list behind it.
+            if (!head.second)
+            {
+                next.push_back(next[head.first]);
+                next[head.first] = match;
+            }
+            else
+            {
+                next.push_back(kNone);
+            }
+            welded.push_back(vertex);
+        }
+        remap[v] = match;
+    }
+
+    for (auto& index : indices)
+        index = remap[index];
+
+    size_t removed = vertices.size() - welded.size();
+    vertices.swap(welded);
+    return removed;
+}
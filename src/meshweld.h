@@ -0,0 +1,151 @@
+/**
+ * Vertex deduplication.
+ *
+ * OBJ indexes position, normal and texcoord separately, so two face corners
+ * are the same vertex exactly when their index triples are equal. The
+ * triples are hashed into an open addressing table, which is a lot cheaper
+ * than hashing and comparing the expanded vertices. An optional second pass
+ * merges vertices that are only equal up to an epsilon, using a spatial hash
+ * grid.
+ */
+#pragma once
+
+#include "hash.h"
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+/**
+ * Open addressing (linear probing) hash table mapping a key to a uint32_t.
+ * Keys can only be inserted, never removed. `Hasher` returns a 64 bit hash.
+ */
+template <typename Key, typename Hasher>
+class FlatIndexMap
+{
+public:
+    explicit FlatIndexMap(size_t expectedCount = 16) { Rehash(CapacityFor(expectedCount)); }
+
+    /**
+     * Look up `key`, inserting it with `value` if it is not in the table.
+     * @returns The value stored for the key and whether it was inserted.
+     */
+    std::pair<uint32_t, bool> Insert(const Key& key, uint32_t value)
+    {
+        if ((m_Count + 1) * 2 > m_Slots.size())
+            Rehash(m_Slots.size() * 2);
+
+        size_t slot = Hasher()(key) & m_Mask;
+        while (m_Slots[slot].value != kEmpty)
+        {
+            if (m_Slots[slot].key == key)
+                return std::make_pair(m_Slots[slot].value, false);
+            slot = (slot + 1) & m_Mask;
+        }
+        m_Slots[slot].key   = key;
+        m_Slots[slot].value = value;
+        m_Count++;
+        return std::make_pair(value, true);
+    }
+
+    // Returns the value stored for `key`, or kEmpty.
+    uint32_t Find(const Key& key) const
+    {
+        size_t slot = Hasher()(key) & m_Mask;
+        while (m_Slots[slot].value != kEmpty)
+        {
+            if (m_Slots[slot].key == key)
+                return m_Slots[slot].value;
+            slot = (slot + 1) & m_Mask;
+        }
+        return kEmpty;
+    }
+
+    size_t GetSize() const { return m_Count; }
+
+    static constexpr uint32_t kEmpty = UINT32_MAX;
+
+private:
+    struct Slot
+    {
+        Key      key;
+        uint32_t value = kEmpty;
+    };
+
+    static size_t CapacityFor(size_t count)
+    {
+        size_t capacity = 16;
+        while (capacity < count * 2)
+            capacity *= 2;
+        return capacity;
+    }
+
+    void Rehash(size_t capacity)
+    {
+        std::vector<Slot> old(capacity);
+        old.swap(m_Slots);
+        m_Mask = capacity - 1;
+        for (const Slot& entry : old)
+        {
+            if (entry.value == kEmpty)
+                continue;
+            size_t slot = Hasher()(entry.key) & m_Mask;
+            while (m_Slots[slot].value != kEmpty)
+                slot = (slot + 1) & m_Mask;
+            m_Slots[slot] = entry;
+        }
+    }
+
+    std::vector<Slot> m_Slots;
+    size_t            m_Mask  = 0;
+    size_t            m_Count = 0;
+};
+
+// A face corner of an OBJ file: position, normal and texcoord index.
+struct IndexTriple
+{
+    int vertex;
+    int normal;
+    int texcoord;
+
+    bool operator==(const IndexTriple& other) const
+    {
+        return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+    }
+};
+
+struct IndexTripleHash
+{
+    uint64_t operator()(const IndexTriple& key) const
+    {
+        uint64_t h = uint64_t(uint32_t(key.vertex)) | (uint64_t(uint32_t(key.normal)) << 32);
+        return MixHash(h ^ MixHash(uint32_t(key.texcoord)));
+    }
+};
+
+using IndexTripleMap = FlatIndexMap<IndexTriple, IndexTripleHash>;
+
+/**
+ * Expand the triangulated face corners of `shapes` into `vertices`, one per
+ * distinct index triple, and append an index per corner to `indices`, in
+ * shape and face order. Normals are normalized, missing normals default to
+ * +Y and missing texcoords to -1.
+ */
+void DeduplicateCorners(const tinyobj::attrib_t&             attrib,
+                        const std::vector<tinyobj::shape_t>& shapes,
+                        std::vector<MeshVertex>&             vertices,
+                        std::vector<uint32_t>&               indices);
+
+/**
+ * Merge vertices whose position, normal and texcoord are all within
+ * `epsilon` of an earlier vertex. The vertex array is compacted, keeping the
+ * first vertex of every cluster, and `indices` are rewritten.
+ * @returns The number of vertices removed.
+ */
+size_t WeldVerticesEpsilon(std::vector<MeshVertex>& vertices,
+                           std::vector<uint32_t>&   indices,
+                           float                    epsilon);
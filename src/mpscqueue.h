@@ -0,0 +1,83 @@
+/**
+ * Lock-free multiple producer, single consumer queue.
+ *
+ * Producers push onto an atomic list head with a compare and swap, the
+ * consumer takes the whole list with one exchange and walks it in push
+ * order. Neither side ever blocks, which is what handing command lists or
+ * recycled objects to another thread needs. Every push allocates a node.
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() = default;
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    ~MpscQueue()
+    {
+        Node* node = m_Head.load(std::memory_order_acquire);
+        while (node)
+        {
+            Node* next = node->next;
+            delete node;
+            node = next;
+        }
+    }
+
+    // Any thread.
+    void Push(T value)
+    {
+        Node* node = new Node { std::move(value), m_Head.load(std::memory_order_relaxed) };
+        while (!m_Head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // Consumer only. Call func(value) for everything pushed so far, in push
+    // order for each producer. Returns how many there were.
+    template <typename F>
+    size_t Drain(F&& func)
+    {
+        Node* node = m_Head.exchange(nullptr, std::memory_order_acquire);
+
+        // The list runs newest first, reverse it.
+        Node* oldest = nullptr;
+        while (node)
+        {
+            Node* next = node->next;
+            node->next = oldest;
+            oldest     = node;
+            node       = next;
+        }
+
+        size_t count = 0;
+        while (oldest)
+        {
+            Node* next = oldest->next;
+            func(std::move(oldest->value));
+            delete oldest;
+            oldest = next;
+            count++;
+        }
+        return count;
+    }
+
+    // A hint, it may be stale by the time it returns.
+    bool IsEmpty() const { return m_Head.load(std::memory_order_relaxed) == nullptr; }
+
+private:
+    struct Node
+    {
+        T     value;
+        Node* next;
+    };
+
+    std::atomic<Node*> m_Head { nullptr };
+};
@@ -0,0 +1,589 @@
+#include "objloader.h"
+#include "mappedfile.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace
+{
+
+// Below this size per chunk the thread start-up cost dominates.
+constexpr size_t kMinChunkSize = 1 << 20;
+
+// A relative (negative) index can only be resolved once we know how many
+// elements precede the chunk, remember where they are.
+struct RelativeFixup
+{
+    size_t  corner;
+    uint8_t component; // 0: vertex, 1: normal, 2: texcoord
+};
+
+// `usemtl`, `g` and `o` take effect starting at the given triangle.
+struct NameMark
+{
+    size_t   triangle;
+    uint32_t name;
+};
+
+struct ObjChunk
+{
+    std::vector<tinyobj::real_t>  vertices;
+    std::vector<tinyobj::real_t>  normals;
+    std::vector<tinyobj::real_t>  texcoords;
+    std::vector<tinyobj::index_t> corners;
+    std::vector<uint8_t>          faceSizes;
+    std::vector<RelativeFixup>    fixups;
+    std::vector<NameMark>         materialMarks;
+    std::vector<NameMark>         shapeMarks;
+    std::vector<std::string>      names;
+    std::vector<std::string>      mtllibs;
+    size_t                        triangleCount   = 0;
+    size_t                        degenerateFaces = 0;
+    std::string                   error;
+};
+
+inline bool IsSpace(char c) { return c == ' ' || c == '\t'; }
+inline bool IsLineEnd(char c) { return c == '\n' || c == '\r'; }
+
+inline void SkipSpaces(const char*& p, const char* end)
+{
+    while (p < end && IsSpace(*p))
+        p++;
+}
+
+inline const char* FindLineEnd(const char* p, const char* end)
+{
+    const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+    return eol ? eol : end;
+}
+
+// Strip the trailing '\r' and spaces of [begin, end).
+inline std::string TrimmedString(const char* begin, const char* end)
+{
+    while (end > begin && (IsSpace(end[-1]) || IsLineEnd(end[-1])))
+        end--;
+    return std::string(begin, end);
+}
+
+// Locale independent float parser, OBJ files only use plain decimal notation.
+inline tinyobj::real_t ParseReal(const char*& p, const char* end)
+{
+    static const double kPow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    SkipSpaces(p, end);
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    uint64_t mantissa = 0;
+    int      exponent = 0;
+    int      digits   = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+    {
+        if (digits < 19)
+        {
+            mantissa = mantissa * 10 + (*p - '0');
+            digits += mantissa != 0;
+        }
+        else
+        {
+            exponent++;
+        }
+    }
+    if (p < end && *p == '.')
+    {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+        {
+            if (digits < 19)
+            {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits += mantissa != 0;
+                exponent--;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E'))
+    {
+        p++;
+        bool negativeExp = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            negativeExp = *p++ == '-';
+        int e = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++)
+            e = std::min(e * 10 + (*p - '0'), 10000);
+        exponent += negativeExp ? -e : e;
+    }
+
+    double value = (double)mantissa;
+    if (exponent < 0 && exponent >= -22)
+        value /= kPow10[-exponent];
+    else if (exponent > 0 && exponent <= 22)
+        value *= kPow10[exponent];
+    else if (exponent != 0)
+        value *= std::pow(10.0, exponent);
+
+    return (tinyobj::real_t)(negative ? -value : value);
+}
+
+inline bool ParseInt(const char*& p, const char* end, int* value)
+{
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    const char* start  = p;
+    int64_t     result = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        result = std::min<int64_t>(result * 10 + (*p - '0'), INT32_MAX);
+
+    *value = (int)(negative ? -result : result);
+    return p != start;
+}
+
+// Parse one of v, v/vt, v//vn, v/vt/vn. The resolved index is written to
+// `out`, relative indices are resolved against the chunk local counts and
+// recorded as a fixup.
+inline bool ParseCorner(const char*& p, const char* end, ObjChunk& chunk, tinyobj::index_t* out)
+{
+    const int counts[3] = {
+        int(chunk.vertices.size() / 3),
+        int(chunk.normals.size() / 3),
+        int(chunk.texcoords.size() / 2),
+    };
+    int* fields[3] = { &out->vertex_index, &out->normal_index, &out->texcoord_index };
+
+    out->vertex_index   = -1;
+    out->normal_index   = -1;
+    out->texcoord_index = -1;
+
+    // file order is v/vt/vn, component order is v, vn, vt.
+    static const int kFileOrder[3] = { 0, 2, 1 };
+    for (int f = 0; f < 3; f++)
+    {
+        int component = kFileOrder[f];
+        if (f > 0)
+        {
+            if (p >= end || *p != '/')
+                break;
+            p++;
+            // empty field, as in v//vn
+            if (p < end && *p == '/')
+                continue;
+        }
+
+        int value;
+        if (!ParseInt(p, end, &value))
+        {
+            if (f == 0)
+                return false;
+            continue;
+        }
+        if (value == 0)
+            return false;
+
+        if (value > 0)
+        {
+            *fields[component] = value - 1;
+        }
+        else
+        {
+            *fields[component] = counts[component] + value;
+            chunk.fixups.push_back({ chunk.corners.size(), (uint8_t)component });
+        }
+    }
+    return true;
+}
+
+void ParseChunk(const char* begin, const char* end, ObjChunk& chunk)
+{
+    // Rough estimate: a typical line is 30 to 40 bytes long.
+    size_t estimatedLines = (end - begin) / 32;
+    chunk.vertices.reserve(estimatedLines);
+    chunk.corners.reserve(estimatedLines);
+
+    for (const char* p = begin; p < end;)
+    {
+        const char* eol = FindLineEnd(p, end);
+        SkipSpaces(p, eol);
+
+        if (p + 1 < eol && p[0] == 'v' && IsSpace(p[1]))
+        {
+            p += 2;
+            chunk.vertices.push_back(ParseReal(p, eol));
+            chunk.vertices.push_back(ParseReal(p, eol));
+            chunk.vertices.push_back(ParseReal(p, eol));
+        }
+        else if (p + 2 < eol && p[0] == 'v' && p[1] == 'n' && IsSpace(p[2]))
+        {
+            p += 3;
+            chunk.normals.push_back(ParseReal(p, eol));
+            chunk.normals.push_back(ParseReal(p, eol));
+            chunk.normals.push_back(ParseReal(p, eol));
+        }
+        else if (p + 2 < eol && p[0] == 'v' && p[1] == 't' && IsSpace(p[2]))
+        {
+            p += 3;
+            chunk.texcoords.push_back(ParseReal(p, eol));
+            chunk.texcoords.push_back(ParseReal(p, eol));
+        }
+        else if (p + 1 < eol && p[0] == 'f' && IsSpace(p[1]))
+        {
+            p += 2;
+            size_t first = chunk.corners.size();
+            size_t count = 0;
+            for (SkipSpaces(p, eol); p < eol && !IsLineEnd(*p); SkipSpaces(p, eol), count++)
+            {
+                tinyobj::index_t corner;
+                if (!ParseCorner(p, eol, chunk, &corner))
+                {
+                    chunk.error = "Failed to parse `f' line (e.g. a zero value for vertex index).";
+                    return;
+                }
+                chunk.corners.push_back(corner);
+            }
+
+            if (count > 255)
+            {
+                chunk.error = "Face with more than 255 vertices.";
+                return;
+            }
+            if (count < 3)
+            {
+                // drop the corners together with their fixups.
+                while (!chunk.fixups.empty() && chunk.fixups.back().corner >= first)
+                    chunk.fixups.pop_back();
+                chunk.corners.resize(first);
+                chunk.degenerateFaces++;
+            }
+            else
+            {
+                chunk.faceSizes.push_back((uint8_t)count);
+                chunk.triangleCount += count - 2;
+            }
+        }
+        else if (eol - p > 6 && strncmp(p, "usemtl", 6) == 0 && IsSpace(p[6]))
+        {
+            p += 7;
+            SkipSpaces(p, eol);
+            const char* nameEnd = p;
+            while (nameEnd < eol && !IsSpace(*nameEnd) && !IsLineEnd(*nameEnd))
+                nameEnd++;
+
+            chunk.materialMarks.push_back({ chunk.triangleCount, (uint32_t)chunk.names.size() });
+            chunk.names.emplace_back(p, nameEnd);
+        }
+        else if (eol - p > 6 && strncmp(p, "mtllib", 6) == 0 && IsSpace(p[6]))
+        {
+            p += 7;
+            std::istringstream files(TrimmedString(p, eol));
+            std::string        file;
+            while (files >> file)
+                chunk.mtllibs.push_back(file);
+        }
+        else if (p < eol && (p[0] == 'g' || p[0] == 'o') && (p + 1 == eol || IsSpace(p[1]) || IsLineEnd(p[1])))
+        {
+            std::string name;
+            if (p[0] == 'o')
+            {
+                p += 1;
+                SkipSpaces(p, eol);
+                name = TrimmedString(p, eol);
+            }
+            else
+            {
+                // tinyobj concatenates multiple group names with a space.
+                std::istringstream groups(TrimmedString(p + 1, eol));
+                std::string        group;
+                while (groups >> group)
+                    name += name.empty() ? group : " " + group;
+            }
+
+            chunk.shapeMarks.push_back({ chunk.triangleCount, (uint32_t)chunk.names.size() });
+            chunk.names.push_back(std::move(name));
+        }
+
+        p = eol + 1;
+    }
+}
+
+struct ShapeRange
+{
+    std::string name;
+    size_t      firstTriangle;
+    size_t      triangleCount;
+};
+
+} // namespace
+
+bool LoadObjParallel(tinyobj::attrib_t*                attrib,
+                     std::vector<tinyobj::shape_t>*    shapes,
+                     std::vector<tinyobj::material_t>* materials,
+                     std::string*                      warn,
+                     std::string*                      err,
+                     const char*                       filename,
+                     const char*                       mtl_basedir,
+                     unsigned                          numThreads)
+{
+    *attrib = tinyobj::attrib_t();
+    shapes->clear();
+    materials->clear();
+
+    MappedFile file;
+    if (!file.Open(filename))
+    {
+        if (err)
+            *err = std::string("Cannot open file [") + filename + "]\n";
+        return false;
+    }
+
+    // Split the file in line aligned chunks.
+    const char* data      = file.GetData();
+    const char* dataEnd   = data + file.GetSize();
+    size_t      threads   = numThreads ? numThreads : GetWorkerCount();
+    size_t      numChunks = std::max<size_t>(1, std::min(threads * 4, file.GetSize() / kMinChunkSize));
+
+    std::vector<const char*> bounds(numChunks + 1, dataEnd);
+    bounds[0] = data;
+    for (size_t c = 1; c < numChunks; c++)
+    {
+        const char* p = std::max(bounds[c - 1], data + file.GetSize() * c / numChunks);
+        bounds[c]     = p < dataEnd ? std::min(dataEnd, FindLineEnd(p, dataEnd) + 1) : dataEnd;
+    }
+
+    std::vector<ObjChunk> chunks(numChunks);
+    ParallelForChunks(numChunks, threads, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+            ParseChunk(bounds[c], bounds[c + 1], chunks[c]);
+    });
+
+    for (const auto& chunk : chunks)
+    {
+        if (!chunk.error.empty())
+        {
+            if (err)
+                *err += chunk.error + "\n";
+            return false;
+        }
+    }
+
+    // Materials, in the order the mtllib statements appear.
+    std::map<std::string, int> materialMap;
+    {
+        std::string baseDir = mtl_basedir ? mtl_basedir : "";
+#ifndef _WIN32
+        const char dirsep = '/';
+#else
+        const char dirsep = '\\';
+#endif
+        if (!baseDir.empty() && baseDir.back() != dirsep)
+            baseDir += dirsep;
+
+        tinyobj::MaterialFileReader reader(baseDir);
+        std::set<std::string>       loaded;
+        for (const auto& chunk : chunks)
+        {
+            for (const auto& mtllib : chunk.mtllibs)
+            {
+                if (!loaded.insert(mtllib).second)
+                    continue;
+                std::string warnMtl, errMtl;
+                reader(mtllib, materials, &materialMap, &warnMtl, &errMtl);
+                if (warn)
+                    *warn += warnMtl;
+                if (err)
+                    *err += errMtl;
+            }
+        }
+    }
+
+    // Prefix sums of every per-chunk stream.
+    std::vector<size_t> vertexBase(numChunks + 1, 0);
+    std::vector<size_t> normalBase(numChunks + 1, 0);
+    std::vector<size_t> texcoordBase(numChunks + 1, 0);
+    std::vector<size_t> triangleBase(numChunks + 1, 0);
+    std::vector<int>    chunkMaterial(numChunks, -1);
+
+    std::vector<ShapeRange> shapeRanges(1, ShapeRange { "", 0, 0 });
+    int                     material = -1;
+    size_t                  degenerateFaces = 0;
+    for (size_t c = 0; c < numChunks; c++)
+    {
+        const ObjChunk& chunk = chunks[c];
+
+        vertexBase[c + 1]   = vertexBase[c] + chunk.vertices.size() / 3;
+        normalBase[c + 1]   = normalBase[c] + chunk.normals.size() / 3;
+        texcoordBase[c + 1] = texcoordBase[c] + chunk.texcoords.size() / 2;
+        triangleBase[c + 1] = triangleBase[c] + chunk.triangleCount;
+        degenerateFaces += chunk.degenerateFaces;
+
+        // material in effect at the start of the chunk, and the one it leaves.
+        chunkMaterial[c] = material;
+        for (const auto& mark : chunk.materialMarks)
+        {
+            auto it  = materialMap.find(chunk.names[mark.name]);
+            material = it != materialMap.end() ? it->second : -1;
+            if (it == materialMap.end() && warn)
+                *warn += "material [ '" + chunk.names[mark.name] + "' ] not found in .mtl\n";
+        }
+
+        for (const auto& mark : chunk.shapeMarks)
+            shapeRanges.push_back({ chunk.names[mark.name], triangleBase[c] + mark.triangle, 0 });
+    }
+    if (degenerateFaces && warn)
+        *warn += "Degenerated face found\n.";
+
+    for (size_t s = 0; s < shapeRanges.size(); s++)
+    {
+        size_t next                = s + 1 < shapeRanges.size() ? shapeRanges[s + 1].firstTriangle : triangleBase[numChunks];
+        shapeRanges[s].triangleCount = next - shapeRanges[s].firstTriangle;
+    }
+    // Like tinyobj, shapes without any face are dropped.
+    shapeRanges.erase(std::remove_if(shapeRanges.begin(),
+                                     shapeRanges.end(),
+                                     [](const ShapeRange& range) { return range.triangleCount == 0; }),
+                      shapeRanges.end());
+
+    attrib->vertices.resize(vertexBase[numChunks] * 3);
+    attrib->normals.resize(normalBase[numChunks] * 3);
+    attrib->texcoords.resize(texcoordBase[numChunks] * 2);
+
+    shapes->resize(shapeRanges.size());
+    ParallelFor(shapeRanges.size(), [&](size_t s) {
+        tinyobj::mesh_t& mesh = (*shapes)[s].mesh;
+        (*shapes)[s].name     = shapeRanges[s].name;
+        mesh.indices.resize(shapeRanges[s].triangleCount * 3);
+        mesh.num_face_vertices.assign(shapeRanges[s].triangleCount, 3);
+        mesh.material_ids.resize(shapeRanges[s].triangleCount);
+        mesh.smoothing_group_ids.assign(shapeRanges[s].triangleCount, 0);
+    });
+
+    // Scatter the attributes and resolve the relative indices. Every chunk
+    // has to be done before any quad can be split, since the split looks at
+    // vertex positions that may live in any other chunk.
+    std::vector<std::string> chunkErrors(numChunks);
+    ParallelForChunks(numChunks, threads, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+        {
+            ObjChunk& chunk = chunks[c];
+            std::copy(chunk.vertices.begin(), chunk.vertices.end(), attrib->vertices.begin() + vertexBase[c] * 3);
+            std::copy(chunk.normals.begin(), chunk.normals.end(), attrib->normals.begin() + normalBase[c] * 3);
+            std::copy(chunk.texcoords.begin(), chunk.texcoords.end(), attrib->texcoords.begin() + texcoordBase[c] * 2);
+
+            const int bases[3] = { int(vertexBase[c]), int(normalBase[c]), int(texcoordBase[c]) };
+            for (const auto& fixup : chunk.fixups)
+            {
+                tinyobj::index_t& corner = chunk.corners[fixup.corner];
+                int* fields[3]           = { &corner.vertex_index, &corner.normal_index, &corner.texcoord_index };
+                *fields[fixup.component] += bases[fixup.component];
+            }
+
+            for (const auto& corner : chunk.corners)
+            {
+                if (corner.vertex_index < 0 || size_t(corner.vertex_index) >= vertexBase[numChunks] ||
+                    corner.normal_index >= int(normalBase[numChunks]) ||
+                    corner.texcoord_index >= int(texcoordBase[numChunks]))
+                {
+                    chunkErrors[c] = "Face with invalid vertex index found.";
+                    break;
+                }
+            }
+        }
+    });
+    for (const auto& chunkError : chunkErrors)
+    {
+        if (!chunkError.empty())
+        {
+            if (err)
+                *err += chunkError + "\n";
+            return false;
+        }
+    }
+
+    // Triangulate straight into the final shape arrays.
+    const std::vector<tinyobj::real_t>& positions = attrib->vertices;
+    ParallelForChunks(numChunks, threads, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++)
+        {
+            const ObjChunk& chunk = chunks[c];
+            if (chunk.triangleCount == 0)
+                continue;
+
+            size_t triangle = triangleBase[c];
+            auto   range    = std::upper_bound(shapeRanges.begin(),
+                                          shapeRanges.end(),
+                                          triangle,
+                                          [](size_t t, const ShapeRange& r) { return t < r.firstTriangle; }) -
+                         1;
+            size_t shape = range - shapeRanges.begin();
+
+            int    faceMaterial = chunkMaterial[c];
+            size_t nextMark     = 0;
+            size_t cornerPos    = 0;
+
+            auto emit = [&](const tinyobj::index_t& a, const tinyobj::index_t& b, const tinyobj::index_t& d) {
+                while (nextMark < chunk.materialMarks.size() && chunk.materialMarks[nextMark].triangle + triangleBase[c] <= triangle)
+                {
+                    auto it      = materialMap.find(chunk.names[chunk.materialMarks[nextMark++].name]);
+                    faceMaterial = it != materialMap.end() ? it->second : -1;
+                }
+                while (triangle >= shapeRanges[shape].firstTriangle + shapeRanges[shape].triangleCount)
+                    shape++;
+
+                tinyobj::mesh_t& mesh  = (*shapes)[shape].mesh;
+                size_t           local = triangle - shapeRanges[shape].firstTriangle;
+                mesh.indices[local * 3 + 0] = a;
+                mesh.indices[local * 3 + 1] = b;
+                mesh.indices[local * 3 + 2] = d;
+                mesh.material_ids[local]    = faceMaterial;
+                triangle++;
+            };
+
+            for (uint8_t faceSize : chunk.faceSizes)
+            {
+                const tinyobj::index_t* corners = &chunk.corners[cornerPos];
+                cornerPos += faceSize;
+
+                if (faceSize == 4)
+                {
+                    // split along the shorter diagonal, same as tinyobj.
+                    auto sqrDistance = [&](int i, int j) {
+                        tinyobj::real_t d = 0;
+                        for (int k = 0; k < 3; k++)
+                        {
+                            tinyobj::real_t e = positions[3 * corners[j].vertex_index + k] - positions[3 * corners[i].vertex_index + k];
+                            d += e * e;
+                        }
+                        return d;
+                    };
+                    if (sqrDistance(0, 2) < sqrDistance(1, 3))
+                    {
+                        emit(corners[0], corners[1], corners[2]);
+                        emit(corners[0], corners[2], corners[3]);
+                    }
+                    else
+                    {
+                        emit(corners[0], corners[1], corners[3]);
+                        emit(corners[1], corners[2], corners[3]);
+                    }
+                }
+                else
+                {
+                    for (uint8_t v = 2; v < faceSize; v++)
+                        emit(corners[0], corners[v - 1], corners[v]);
+                }
+            }
+        }
+    });
+
+    return true;
+}
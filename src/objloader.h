@@ -0,0 +1,31 @@
+/**
+ * Parallel OBJ loader.
+ *
+ * The OBJ file is memory mapped and split into line aligned chunks, every chunk
+ * is tokenized on its own thread, and the per-chunk v/vn/vt/f/usemtl streams
+ * are merged with prefix sums. The output has the same layout as
+ * tinyobj::LoadObj with triangulation enabled, so it can be used as a drop-in
+ * replacement.
+ */
+#pragma once
+
+#include <tiny_obj_loader.h>
+
+#include <string>
+#include <vector>
+
+/**
+ * Load an OBJ file, same contract as tinyobj::LoadObj(..., triangulate=true).
+ * @param mtl_basedir Directory the `mtllib` files are looked up in.
+ * @param numThreads Number of parser threads, 0 uses all hardware threads.
+ * Differences with tinyobj: polygons with more than 4 corners are fan
+ * triangulated, and `l`/`p`/`t` statements and vertex colors are ignored.
+ */
+bool LoadObjParallel(tinyobj::attrib_t*                attrib,
+                     std::vector<tinyobj::shape_t>*    shapes,
+                     std::vector<tinyobj::material_t>* materials,
+                     std::string*                      warn,
+                     std::string*                      err,
+                     const char*                       filename,
+                     const char*                       mtl_basedir = nullptr,
+                     unsigned                          numThreads  = 0);
@@ -0,0 +1,410 @@
+#include "occlusion.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+constexpr uint32_t kTileWidth  = OcclusionBuffer::kTileWidth;
+constexpr uint32_t kTileHeight = OcclusionBuffer::kTileHeight;
+
+// Fewest triangles worth a setup job of their own.
+constexpr size_t kTrianglesPerJob = 1024;
+
+// Pixels off screen a vertex may be before its triangle is dropped, the
+// edge functions lose too much precision farther out.
+constexpr float kGuardBand = 4096.0f;
+
+// Pixels of a row in [begin, end), relative to the tile.
+inline uint32_t RowMask(int32_t begin, int32_t end)
+{
+    begin = std::max(begin, 0);
+    end   = std::min(end, int32_t(kTileWidth));
+    if (begin >= end)
+        return 0;
+    uint64_t bits = (uint64_t(1) << end) - (uint64_t(1) << begin);
+    return uint32_t(bits);
+}
+
+inline float MaxF(float a, float b)
+{
+    return a > b ? a : b;
+}
+
+inline float MinF(float a, float b)
+{
+    return a < b ? a : b;
+}
+
+// Round like the SIMD path, truncate and correct.
+inline int32_t CeilToInt(float t)
+{
+    int32_t i = int32_t(t);
+    return float(i) < t ? i + 1 : i;
+}
+
+inline int32_t FloorToInt(float t)
+{
+    int32_t i = int32_t(t);
+    return float(i) > t ? i - 1 : i;
+}
+
+#if PETIT_SIMD_SSE2
+inline __m128i MaxEpi32(__m128i a, __m128i b)
+{
+    __m128i greater = _mm_cmpgt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(greater, a), _mm_andnot_si128(greater, b));
+}
+
+inline __m128i MinEpi32(__m128i a, __m128i b)
+{
+    __m128i less = _mm_cmplt_epi32(a, b);
+    return _mm_or_si128(_mm_and_si128(less, a), _mm_andnot_si128(less, b));
+}
+#endif
+
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer(uint32_t width, uint32_t height) :
+    m_TilesX((width + kTileWidth - 1) / kTileWidth),
+    m_TilesY((height + kTileHeight - 1) / kTileHeight),
+    m_Tiles(size_t(m_TilesX) * m_TilesY)
+{
+    Clear();
+}
+
+void OcclusionBuffer::Clear()
+{
+    for (Tile& tile : m_Tiles)
+    {
+        tile.zMax0 = 1.0f;
+        tile.zMax1 = 0.0f;
+        memset(tile.mask, 0, sizeof(tile.mask));
+    }
+}
+
+void OcclusionBuffer::SetupTriangle(const glm::mat4& clip, const glm::vec3 v[3], ScreenTriangle& triangle) const
+{
+    triangle.minX = triangle.maxX = 0;
+    triangle.minY = triangle.maxY = 0;
+
+    float width  = float(GetWidth());
+    float height = float(GetHeight());
+    float x[3], y[3], z[3];
+    for (int i = 0; i < 3; i++)
+    {
+        glm::vec4 p = clip * glm::vec4(v[i], 1.0f);
+        // In front of the near plane, or too close to the eye to divide.
+        if (p.z < 0.0f || p.w < 1e-6f)
+            return;
+        x[i] = (p.x / p.w * 0.5f + 0.5f) * width;
+        y[i] = (0.5f - p.y / p.w * 0.5f) * height;
+        z[i] = p.z / p.w;
+        if (std::fabs(x[i] - 0.5f * width) > kGuardBand || std::fabs(y[i] - 0.5f * height) > kGuardBand)
+            return;
+    }
+
+    // Twice the signed area, the edges are flipped so the inside is
+    // positive whatever the winding.
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (!(std::fabs(area) > 0.0f))
+        return;
+    float sign = area > 0.0f ? 1.0f : -1.0f;
+    for (int e = 0; e < 3; e++)
+    {
+        int a             = e;
+        int b             = (e + 1) % 3;
+        triangle.edgeA[e] = sign * (y[a] - y[b]);
+        triangle.edgeB[e] = sign * (x[b] - x[a]);
+        triangle.edgeC[e] = sign * (x[a] * y[b] - x[b] * y[a]);
+    }
+
+    triangle.zx   = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+    triangle.zy   = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+    triangle.z0   = z[0] - triangle.zx * x[0] - triangle.zy * y[0];
+    triangle.zMin = std::min({ z[0], z[1], z[2] });
+    triangle.zMax = std::max({ z[0], z[1], z[2] });
+
+    // Pixels whose centers may be inside, clamped to the buffer.
+    auto clampX   = [&](float value) { return int32_t(std::min(std::max(value, 0.0f), width)); };
+    auto clampY   = [&](float value) { return int32_t(std::min(std::max(value, 0.0f), height)); };
+    triangle.minX = clampX(std::floor(std::min({ x[0], x[1], x[2] })));
+    triangle.maxX = clampX(std::ceil(std::max({ x[0], x[1], x[2] })));
+    triangle.minY = clampY(std::floor(std::min({ y[0], y[1], y[2] })));
+    triangle.maxY = clampY(std::ceil(std::max({ y[0], y[1], y[2] })));
+}
+
+void OcclusionBuffer::RenderTriangles(const glm::mat4& clip,
+                                      const glm::vec3* positions,
+                                      size_t           stride,
+                                      const uint32_t*  indices,
+                                      size_t           triangleCount,
+                                      JobPool*         pool)
+{
+    const char* base  = reinterpret_cast<const char*>(positions);
+    auto        setup = [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++)
+        {
+            glm::vec3 v[3];
+            for (int i = 0; i < 3; i++)
+                v[i] = *reinterpret_cast<const glm::vec3*>(base + indices[t * 3 + i] * stride);
+            SetupTriangle(clip, v, m_Triangles[t]);
+        }
+    };
+
+    m_Triangles.resize(triangleCount);
+    size_t setupJobs = (triangleCount + kTrianglesPerJob - 1) / kTrianglesPerJob;
+    if (pool && setupJobs > 1)
+    {
+        pool->ParallelFor(setupJobs, [&](size_t job) {
+            setup(job * kTrianglesPerJob, std::min((job + 1) * kTrianglesPerJob, triangleCount));
+        });
+    }
+    else
+        setup(0, triangleCount);
+
+    // Bands of tile rows, a few per thread to even out the load.
+    uint32_t bandCount = pool ? std::min(m_TilesY, pool->GetThreadCount() * 2) : 1;
+    if (bandCount > 1)
+    {
+        pool->ParallelFor(bandCount, [&](size_t band) {
+            RasterizeBand(uint32_t(m_TilesY * band / bandCount), uint32_t(m_TilesY * (band + 1) / bandCount));
+        });
+    }
+    else
+        RasterizeBand(0, m_TilesY);
+}
+
+void OcclusionBuffer::RasterizeBand(uint32_t tileRowBegin, uint32_t tileRowEnd)
+{
+    for (const ScreenTriangle& triangle : m_Triangles)
+    {
+        if (triangle.minX >= triangle.maxX || triangle.minY >= triangle.maxY)
+            continue;
+        uint32_t first = std::max(tileRowBegin, uint32_t(triangle.minY) / kTileHeight);
+        uint32_t last  = std::min(tileRowEnd, (uint32_t(triangle.maxY) + kTileHeight - 1) / kTileHeight);
+        for (uint32_t tileRow = first; tileRow < last; tileRow++)
+            RasterizeTileRow(triangle, tileRow);
+    }
+}
+
+void OcclusionBuffer::RasterizeTileRow(const ScreenTriangle& triangle, uint32_t tileRow)
+{
+    // Span [left, right) of pixel centers inside every edge, per row.
+    int32_t left[kTileHeight];
+    int32_t right[kTileHeight];
+    int32_t rowBase = int32_t(tileRow * kTileHeight);
+    float   lo      = float(triangle.minX - 1);
+    float   hi      = float(triangle.maxX + 1);
+
+    // x = -(b y + c) / a on an edge, pixel x + 0.5 inside on one side of it.
+    float k[3];
+    for (int e = 0; e < 3; e++)
+        k[e] = triangle.edgeA[e] != 0.0f ? -1.0f / triangle.edgeA[e] : 0.0f;
+
+#if PETIT_SIMD_SSE2
+    for (uint32_t r = 0; r < kTileHeight; r += 4)
+    {
+        __m128  yc = _mm_add_ps(_mm_set1_ps(float(rowBase + int32_t(r))), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+        __m128i l  = _mm_set1_epi32(triangle.minX);
+        __m128i rr = _mm_set1_epi32(triangle.maxX);
+        for (int e = 0; e < 3; e++)
+        {
+            __m128 v = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeB[e]), yc), _mm_set1_ps(triangle.edgeC[e]));
+            if (triangle.edgeA[e] == 0.0f)
+            {
+                // Horizontal edge, the whole row is on one side.
+                __m128i outside = _mm_castps_si128(_mm_cmplt_ps(v, _mm_setzero_ps()));
+                rr              = _mm_or_si128(_mm_and_si128(outside, l), _mm_andnot_si128(outside, rr));
+                continue;
+            }
+            __m128 t = _mm_sub_ps(_mm_mul_ps(v, _mm_set1_ps(k[e])), _mm_set1_ps(0.5f));
+            t        = _mm_min_ps(_mm_max_ps(t, _mm_set1_ps(lo)), _mm_set1_ps(hi));
+            __m128i i = _mm_cvttps_epi32(t);
+            __m128  f = _mm_cvtepi32_ps(i);
+            if (triangle.edgeA[e] > 0.0f)
+                l = MaxEpi32(l, _mm_sub_epi32(i, _mm_castps_si128(_mm_cmplt_ps(f, t))));
+            else
+                rr = MinEpi32(rr, _mm_sub_epi32(_mm_add_epi32(i, _mm_castps_si128(_mm_cmpgt_ps(f, t))), _mm_set1_epi32(-1)));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(left + r), l);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(right + r), rr);
+    }
+#else
+    for (uint32_t r = 0; r < kTileHeight; r++)
+    {
+        float   yc = float(rowBase + int32_t(r)) + 0.5f;
+        int32_t l  = triangle.minX;
+        int32_t rr = triangle.maxX;
+        for (int e = 0; e < 3; e++)
+        {
+            float v = triangle.edgeB[e] * yc + triangle.edgeC[e];
+            if (triangle.edgeA[e] == 0.0f)
+            {
+                if (v < 0.0f)
+                    rr = l;
+                continue;
+            }
+            float t = MinF(MaxF(v * k[e] - 0.5f, lo), hi);
+            if (triangle.edgeA[e] > 0.0f)
+                l = std::max(l, CeilToInt(t));
+            else
+                rr = std::min(rr, FloorToInt(t) + 1);
+        }
+        left[r]  = l;
+        right[r] = rr;
+    }
+#endif
+
+    bool any = false;
+    for (uint32_t r = 0; r < kTileHeight; r++)
+    {
+        int32_t y = rowBase + int32_t(r);
+        if (y < triangle.minY || y >= triangle.maxY)
+            right[r] = left[r];
+        any = any || left[r] < right[r];
+    }
+    if (!any)
+        return;
+
+    int32_t rowTop    = std::max(rowBase, triangle.minY);
+    int32_t rowBottom = std::min(rowBase + int32_t(kTileHeight), triangle.maxY);
+    for (uint32_t tileX = uint32_t(triangle.minX) / kTileWidth; tileX * kTileWidth < uint32_t(triangle.maxX); tileX++)
+    {
+        int32_t  tileLeft = int32_t(tileX * kTileWidth);
+        uint32_t coverage[kTileHeight];
+        uint32_t covered = 0;
+        for (uint32_t r = 0; r < kTileHeight; r++)
+        {
+            coverage[r] = RowMask(left[r] - tileLeft, right[r] - tileLeft);
+            covered |= coverage[r];
+        }
+        if (!covered)
+            continue;
+
+        // The depth plane is extreme at the corners of the part of the tile
+        // in the triangle bounds.
+        float x0    = float(std::max(tileLeft, triangle.minX));
+        float x1    = float(std::min(tileLeft + int32_t(kTileWidth), triangle.maxX));
+        float y0    = float(rowTop);
+        float y1    = float(rowBottom);
+        float zNear = triangle.z0 + std::min(triangle.zx * x0, triangle.zx * x1) + std::min(triangle.zy * y0, triangle.zy * y1);
+        float zFar  = triangle.z0 + std::max(triangle.zx * x0, triangle.zx * x1) + std::max(triangle.zy * y0, triangle.zy * y1);
+        zNear       = std::max(zNear, triangle.zMin);
+        zFar        = std::min(zFar, triangle.zMax);
+
+        Tile& tile = m_Tiles[size_t(tileRow) * m_TilesX + tileX];
+        if (zNear >= tile.zMax0)
+            continue;
+        UpdateTile(tile, coverage, zFar);
+    }
+}
+
+void OcclusionBuffer::UpdateTile(Tile& tile, const uint32_t coverage[kTileHeight], float z)
+{
+    // A triangle nearer than the working layer by more than the layer is
+    // nearer than the tile starts a new layer, the old one would only
+    // hold it back.
+    if (tile.zMax1 - z > tile.zMax0 - tile.zMax1)
+    {
+        tile.zMax1 = 0.0f;
+        memset(tile.mask, 0, sizeof(tile.mask));
+    }
+
+    tile.zMax1    = std::max(tile.zMax1, z);
+    uint32_t full = ~0u;
+    for (uint32_t r = 0; r < kTileHeight; r++)
+    {
+        tile.mask[r] |= coverage[r];
+        full &= tile.mask[r];
+    }
+
+    if (full == ~0u)
+    {
+        tile.zMax0 = std::min(tile.zMax0, tile.zMax1);
+        tile.zMax1 = 0.0f;
+        memset(tile.mask, 0, sizeof(tile.mask));
+    }
+}
+
+bool OcclusionBuffer::IsBoxOccluded(const glm::mat4& clip, const glm::vec3& min, const glm::vec3& max) const
+{
+    float width  = float(GetWidth());
+    float height = float(GetHeight());
+    float minX   = width;
+    float maxX   = 0.0f;
+    float minY   = height;
+    float maxY   = 0.0f;
+    float zNear  = 1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 v(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+        glm::vec4 p = clip * glm::vec4(v, 1.0f);
+        if (p.z < 0.0f || p.w < 1e-6f)
+            return false;
+        float x = (p.x / p.w * 0.5f + 0.5f) * width;
+        float y = (0.5f - p.y / p.w * 0.5f) * height;
+        minX    = std::min(minX, x);
+        maxX    = std::max(maxX, x);
+        minY    = std::min(minY, y);
+        maxY    = std::max(maxY, y);
+        zNear   = std::min(zNear, p.z / p.w);
+    }
+
+    // Every pixel the box touches.
+    int32_t left   = int32_t(std::max(std::floor(minX), 0.0f));
+    int32_t right  = int32_t(std::min(std::ceil(maxX), width));
+    int32_t top    = int32_t(std::max(std::floor(minY), 0.0f));
+    int32_t bottom = int32_t(std::min(std::ceil(maxY), height));
+    if (left >= right || top >= bottom)
+        return false;
+
+    for (int32_t tileY = top / int32_t(kTileHeight); tileY * int32_t(kTileHeight) < bottom; tileY++)
+    {
+        for (int32_t tileX = left / int32_t(kTileWidth); tileX * int32_t(kTileWidth) < right; tileX++)
+        {
+            const Tile& tile = m_Tiles[size_t(tileY) * m_TilesX + tileX];
+            if (zNear > tile.zMax0)
+                continue;
+            // Nearer than the tile, but maybe behind the working layer
+            // everywhere it covers the box.
+            if (!(zNear > tile.zMax1))
+                return false;
+            int32_t  tileLeft = tileX * int32_t(kTileWidth);
+            int32_t  tileTop  = tileY * int32_t(kTileHeight);
+            uint32_t columns  = RowMask(left - tileLeft, right - tileLeft);
+            for (int32_t r = std::max(top - tileTop, 0); r < std::min(bottom - tileTop, int32_t(kTileHeight)); r++)
+            {
+                if ((tile.mask[r] & columns) != columns)
+                    return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionBuffer::ReadDepth(std::vector<float>& depth) const
+{
+    uint32_t width = GetWidth();
+    depth.resize(size_t(width) * GetHeight());
+    for (uint32_t tileY = 0; tileY < m_TilesY; tileY++)
+    {
+        for (uint32_t tileX = 0; tileX < m_TilesX; tileX++)
+        {
+            const Tile& tile = m_Tiles[size_t(tileY) * m_TilesX + tileX];
+            for (uint32_t r = 0; r < kTileHeight; r++)
+            {
+                for (uint32_t c = 0; c < kTileWidth; c++)
+                {
+                    bool  covered = (tile.mask[r] >> c) & 1;
+                    float z       = covered ? std::min(tile.zMax0, tile.zMax1) : tile.zMax0;
+                    depth[size_t(tileY * kTileHeight + r) * width + tileX * kTileWidth + c] = z;
+                }
+            }
+        }
+    }
+}
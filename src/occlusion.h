@@ -0,0 +1,110 @@
+/**
+ * Masked software occlusion culling.
+ *
+ * Occluder triangles are rasterized on the CPU into a small depth buffer
+ * split in 32x8 pixel tiles. A tile does not store a depth per pixel, only
+ * a coverage bit per pixel and two depths: the farthest depth of the whole
+ * tile, and the farthest depth of the triangles merged into the working
+ * layer the coverage mask belongs to. Once the mask is full the working
+ * layer replaces the tile depth. A triangle much nearer than the working
+ * layer discards it and starts a new one. Depths only ever overestimate,
+ * so a box found behind them is hidden for sure.
+ *
+ * A triangle covers a row of a tile between the intercepts of its edges
+ * with the row, computed four rows at once with SSE2, and a row of 32
+ * pixels is one mask word. The buffer is split in bands of tile rows
+ * rasterized by the workers of a JobPool, each band walking the triangles
+ * in order, so the result does not depend on the thread count.
+ *
+ * Depth is z / w of a [0, 1] depth range, 0 near. Nothing in here depends
+ * on D3D12.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class JobPool;
+
+class OcclusionBuffer
+{
+public:
+    static constexpr uint32_t kTileWidth  = 32;
+    static constexpr uint32_t kTileHeight = 8;
+
+    // Rounded up to whole tiles.
+    OcclusionBuffer(uint32_t width, uint32_t height);
+
+    // Remove every occluder.
+    void Clear();
+
+    /**
+     * Rasterize `triangleCount` triangles, three `indices` each, into the
+     * buffer. `positions` are read every `stride` bytes and transformed by
+     * `clip`. Triangles crossing the near plane or reaching far off
+     * screen are dropped, which only loses occlusion. Both faces are
+     * rasterized.
+     */
+    void RenderTriangles(const glm::mat4& clip,
+                         const glm::vec3* positions,
+                         size_t           stride,
+                         const uint32_t*  indices,
+                         size_t           triangleCount,
+                         JobPool*         pool = nullptr);
+
+    // True if the box, in the space `clip` transforms from, is entirely
+    // behind the occluders rendered so far. Boxes crossing the near plane
+    // are never occluded.
+    bool IsBoxOccluded(const glm::mat4& clip, const glm::vec3& min, const glm::vec3& max) const;
+
+    // A conservative depth per pixel, row major, for debugging and tests.
+    void ReadDepth(std::vector<float>& depth) const;
+
+    uint32_t GetWidth() const { return m_TilesX * kTileWidth; }
+    uint32_t GetHeight() const { return m_TilesY * kTileHeight; }
+
+private:
+    struct Tile
+    {
+        // Farthest depth of the tile.
+        float zMax0;
+        // Farthest depth of the working layer, the pixels of `mask`.
+        float    zMax1;
+        uint32_t mask[kTileHeight];
+    };
+
+    // A triangle in pixels, set up once and rasterized by every band it
+    // overlaps.
+    struct ScreenTriangle
+    {
+        // E(x, y) = a x + b y + c is positive inside, at pixel centers.
+        float edgeA[3];
+        float edgeB[3];
+        float edgeC[3];
+        // z = zx x + zy y + z0.
+        float zx;
+        float zy;
+        float z0;
+        float zMin;
+        float zMax;
+        // Pixel bounds, max excluded. Empty for dropped triangles.
+        int32_t minX;
+        int32_t maxX;
+        int32_t minY;
+        int32_t maxY;
+    };
+
+    void SetupTriangle(const glm::mat4& clip, const glm::vec3 v[3], ScreenTriangle& triangle) const;
+    void RasterizeBand(uint32_t tileRowBegin, uint32_t tileRowEnd);
+    void RasterizeTileRow(const ScreenTriangle& triangle, uint32_t tileRow);
+    static void UpdateTile(Tile& tile, const uint32_t coverage[kTileHeight], float z);
+
+    uint32_t          m_TilesX;
+    uint32_t          m_TilesY;
+    std::vector<Tile> m_Tiles;
+
+    std::vector<ScreenTriangle> m_Triangles;
+};
@@ -0,0 +1,231 @@
+/**
+ * Small fork-join helpers for the CPU side mesh processing, and a pool of
+ * persistent workers for jobs issued every frame.
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Number of hardware threads we are allowed to fork into.
+inline unsigned GetWorkerCount()
+{
+    unsigned count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+namespace detail
+{
+// Joins the threads on scope exit, so that an exception leaving the caller
+// does not destroy joinable threads.
+struct ThreadJoiner
+{
+    std::vector<std::thread>& threads;
+
+    ~ThreadJoiner()
+    {
+        for (auto& thread : threads)
+        {
+            if (thread.joinable())
+                thread.join();
+        }
+    }
+};
+} // namespace detail
+
+// Split [0, count) into `numChunks` contiguous ranges and call
+// func(chunk, begin, end) for every range, one thread per range. The calling
+// thread runs the first range itself and joins the others before returning.
+// An exception thrown by `func` is rethrown once every range is done.
+template <typename Func>
+void ParallelForChunks(size_t count, size_t numChunks, Func&& func)
+{
+    numChunks = std::max<size_t>(1, std::min(numChunks, count));
+    if (numChunks <= 1)
+    {
+        func(size_t(0), size_t(0), count);
+        return;
+    }
+
+    std::vector<std::exception_ptr> errors(numChunks);
+    auto                            run = [&func, &errors](size_t chunk, size_t begin, size_t end) {
+        try
+        {
+            func(chunk, begin, end);
+        }
+        catch (...)
+        {
+            errors[chunk] = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numChunks - 1);
+    {
+        detail::ThreadJoiner joiner { threads };
+        for (size_t chunk = 1; chunk < numChunks; chunk++)
+        {
+            size_t begin = count * chunk / numChunks;
+            size_t end   = count * (chunk + 1) / numChunks;
+            threads.emplace_back([&run, chunk, begin, end]() { run(chunk, begin, end); });
+        }
+        run(size_t(0), size_t(0), count / numChunks);
+    }
+
+    for (const std::exception_ptr& error : errors)
+    {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+// Call func(i) for every i in [0, count), spread across all worker threads.
+template <typename Func>
+void ParallelFor(size_t count, Func&& func)
+{
+    ParallelForChunks(count, GetWorkerCount(), [&func](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            func(i);
+    });
+}
+
+// Run a() on the calling thread and b() on a new one, return once both are
+// done. Recursive builders fork with it. Exceptions are rethrown after the
+// join, the one of a() first.
+template <typename A, typename B>
+void ParallelInvoke(A&& a, B&& b)
+{
+    std::exception_ptr error;
+    std::thread        thread([&b, &error]() {
+        try
+        {
+            b();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    });
+    try
+    {
+        a();
+    }
+    catch (...)
+    {
+        thread.join();
+        throw;
+    }
+    thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Worker threads that stay alive between calls. ParallelFor spawns threads
+// every time, fine for loading but too slow for work issued every frame.
+class JobPool
+{
+public:
+    // `workerCount` threads besides the calling one.
+    explicit JobPool(unsigned workerCount = GetWorkerCount() - 1)
+    {
+        for (unsigned i = 0; i < workerCount; i++)
+            m_Threads.emplace_back([this]() { WorkerLoop(); });
+    }
+
+    ~JobPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Quit = true;
+        }
+        m_Wake.notify_all();
+        for (auto& thread : m_Threads)
+            thread.join();
+    }
+
+    JobPool(const JobPool&) = delete;
+    JobPool& operator=(const JobPool&) = delete;
+
+    // Threads running a ParallelFor, the workers and the caller.
+    unsigned GetThreadCount() const { return unsigned(m_Threads.size()) + 1; }
+
+    // Call func(i) for every i in [0, count) on the workers and the calling
+    // thread, return once all calls are done. One call at a time.
+    template <typename Func>
+    void ParallelFor(size_t count, Func&& func)
+    {
+        std::function<void(size_t)> job = std::ref(func);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Job   = &job;
+            m_Count = count;
+            m_Next.store(0, std::memory_order_relaxed);
+            m_Generation++;
+        }
+        m_Wake.notify_all();
+
+        Run(job);
+
+        // Close the job so that late workers skip it, and wait for the ones
+        // that joined.
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Job = nullptr;
+        m_Done.wait(lock, [this]() { return m_Active == 0; });
+    }
+
+private:
+    void Run(const std::function<void(size_t)>& job)
+    {
+        size_t i;
+        while ((i = m_Next.fetch_add(1, std::memory_order_relaxed)) < m_Count)
+            job(i);
+    }
+
+    void WorkerLoop()
+    {
+        uint64_t seen = 0;
+        for (;;)
+        {
+            const std::function<void(size_t)>* job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Wake.wait(lock, [&]() { return m_Quit || m_Generation != seen; });
+                if (m_Quit)
+                    return;
+                seen = m_Generation;
+                if (!m_Job)
+                    continue;
+                job = m_Job;
+                m_Active++;
+            }
+
+            Run(*job);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (--m_Active == 0)
+                m_Done.notify_one();
+        }
+    }
+
+    std::vector<std::thread> m_Threads;
+
+    std::mutex              m_Mutex;
+    std::condition_variable m_Wake;
+    std::condition_variable m_Done;
+
+    const std::function<void(size_t)>* m_Job        = nullptr;
+    size_t                             m_Count      = 0;
+    std::atomic<size_t>                m_Next       = { 0 };
+    uint64_t                           m_Generation = 0;
+    unsigned                           m_Active     = 0;
+    bool                               m_Quit       = false;
+};
@@ -0,0 +1,73 @@
+#include "presentpacer.h"
+
+#include <algorithm>
+#include <assert.h>
+
+PresentPacer::PresentPacer(uint32_t minLatency, uint32_t maxLatency, uint32_t stableFrames) :
+    m_MinLatency(std::max(1u, minLatency)),
+    m_MaxLatency(std::max(m_MinLatency, maxLatency)),
+    m_StableFrames(stableFrames),
+    m_Latency(m_MinLatency)
+{
+    m_Counters.frameLatency = m_Latency;
+}
+
+void PresentPacer::OnPresent(uint64_t presentId, uint32_t syncInterval)
+{
+    assert(presentId >= m_Counters.lastPresentId);
+    m_Counters.presents++;
+    m_Counters.lastPresentId = presentId;
+    m_SyncInterval           = syncInterval;
+}
+
+void PresentPacer::OnDisplaySample(const DisplaySample& sample)
+{
+    if (!m_HasSample)
+    {
+        m_HasSample                = true;
+        m_LastSample               = sample;
+        m_Counters.lastDisplayedId = sample.presentCount;
+        return;
+    }
+    if (sample.presentCount <= m_LastSample.presentCount)
+        return;
+
+    uint64_t frames    = sample.presentCount - m_LastSample.presentCount;
+    uint64_t refreshes = sample.presentRefreshCount - m_LastSample.presentRefreshCount;
+    m_LastSample       = sample;
+
+    m_Counters.displayedFrames += frames;
+    m_Counters.lastDisplayedId = sample.presentCount;
+
+    // Without vsync a frame has no vblank to miss.
+    uint64_t expected = frames * m_SyncInterval;
+    uint64_t missed   = m_SyncInterval > 0 && refreshes > expected ? refreshes - expected : 0;
+    m_Counters.missedVBlanks += missed;
+
+    uint32_t latency = m_Latency;
+    if (missed > 0)
+    {
+        m_FramesSinceMiss = 0;
+        latency           = std::min(m_Latency + 1, m_MaxLatency);
+    }
+    else
+    {
+        m_FramesSinceMiss += uint32_t(std::min<uint64_t>(frames, m_StableFrames));
+        if (m_FramesSinceMiss >= m_StableFrames)
+        {
+            m_FramesSinceMiss = 0;
+            latency           = std::max(m_Latency - 1, m_MinLatency);
+        }
+    }
+    if (latency != m_Latency)
+    {
+        m_Latency               = latency;
+        m_Counters.frameLatency = latency;
+        m_Counters.latencyChangeCount++;
+    }
+}
+
+uint32_t PresentPacer::GetQueuedFrameCount() const
+{
+    return uint32_t(m_Counters.lastPresentId - std::min(m_Counters.lastPresentId, m_Counters.lastDisplayedId));
+}
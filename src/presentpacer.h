@@ -0,0 +1,77 @@
+/**
+ * Present statistics and the frame latency policy of a swapchain.
+ *
+ * The swapchain queues at most GetFrameLatency presents ahead of the
+ * display, the application loop waits for a slot before sampling input.
+ * Fewer queued frames mean less input to photon latency, but every frame
+ * the CPU or GPU delivers late shows up as a vblank repeating the previous
+ * one. The policy starts at the lowest latency, adds a frame of queue when
+ * vblanks are missed, which also lets frames slower than a refresh overlap
+ * with the display, and removes it again after a stretch without misses.
+ *
+ * Bookkeeping only: present ids and refresh counts are plain integers from
+ * DXGI_FRAME_STATISTICS, or from a simulated display.
+ */
+#pragma once
+
+#include <cstdint>
+
+// What the display reports about the last present it showed.
+struct DisplaySample
+{
+    // Presents up to and including the one on screen.
+    uint64_t presentCount;
+    // Vblank it went on screen at.
+    uint64_t presentRefreshCount;
+};
+
+struct PresentCounters
+{
+    uint64_t presents        = 0;
+    uint64_t displayedFrames = 0;
+    // Vblanks a frame stayed on screen beyond its sync interval, because the
+    // next one was not ready.
+    uint64_t missedVBlanks = 0;
+    // Id of the last present, and of the last one on screen.
+    uint64_t lastPresentId      = 0;
+    uint64_t lastDisplayedId    = 0;
+    uint32_t frameLatency       = 0;
+    uint32_t latencyChangeCount = 0;
+};
+
+class PresentPacer
+{
+public:
+    // Displayed frames without a miss before the latency goes down again.
+    static constexpr uint32_t DefaultStableFrames = 120;
+
+    PresentPacer(uint32_t minLatency = 1, uint32_t maxLatency = 3, uint32_t stableFrames = DefaultStableFrames);
+
+    // A Present call got id `presentId`, DXGI's present count after it.
+    void OnPresent(uint64_t presentId, uint32_t syncInterval);
+
+    // A new sample of the display, samples repeating the last one are fine.
+    void OnDisplaySample(const DisplaySample& sample);
+
+    // Presents the swapchain may queue, for SetMaximumFrameLatency.
+    uint32_t GetFrameLatency() const { return m_Latency; }
+
+    // Presents not on screen yet, as of the last sample.
+    uint32_t GetQueuedFrameCount() const;
+
+    const PresentCounters& GetCounters() const { return m_Counters; }
+
+private:
+    uint32_t m_MinLatency;
+    uint32_t m_MaxLatency;
+    uint32_t m_StableFrames;
+
+    uint32_t m_Latency;
+    uint32_t m_SyncInterval    = 1;
+    uint32_t m_FramesSinceMiss = 0;
+
+    bool          m_HasSample  = false;
+    DisplaySample m_LastSample = {};
+
+    PresentCounters m_Counters;
+};
@@ -0,0 +1,48 @@
+#include "queuefencewaiter.h"
+#include "commandqueue.h"
+
+#include <assert.h>
+#include <vector>
+
+QueueFenceWaiter::QueueFenceWaiter(Microsoft::WRL::ComPtr<ID3D12Device2> device) :
+    m_Device(device)
+{
+    m_CompletionEvent = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_WakeEvent       = ::CreateEvent(NULL, FALSE, FALSE, NULL);
+    assert(m_CompletionEvent && m_WakeEvent && "Failed to create fence event.");
+}
+
+QueueFenceWaiter::~QueueFenceWaiter()
+{
+    ::CloseHandle(m_CompletionEvent);
+    ::CloseHandle(m_WakeEvent);
+}
+
+void QueueFenceWaiter::WaitAny(Span<const FenceTarget> targets)
+{
+    HANDLE events[] = { m_WakeEvent, m_CompletionEvent };
+    DWORD  count    = 1;
+    if (!targets.empty())
+    {
+        std::vector<ID3D12Fence*> fences(targets.size());
+        std::vector<UINT64>       values(targets.size());
+        for (size_t i = 0; i < targets.size(); i++)
+        {
+            auto queue = dynamic_cast<const CommandQueue*>(targets[i].fence);
+            assert(queue && "Only command queues can be waited for.");
+            fences[i] = queue->GetD3D12Fence();
+            values[i] = targets[i].fenceValue;
+        }
+        // An earlier registration firing late only wakes the watcher once
+        // more for nothing.
+        ThrowIfFailed(m_Device->SetEventOnMultipleFenceCompletion(fences.data(), values.data(), UINT(targets.size()),
+                                                                  D3D12_MULTIPLE_FENCE_WAIT_FLAG_ANY, m_CompletionEvent));
+        count = 2;
+    }
+    ::WaitForMultipleObjects(count, events, FALSE, INFINITE);
+}
+
+void QueueFenceWaiter::Wake()
+{
+    ::SetEvent(m_WakeEvent);
+}
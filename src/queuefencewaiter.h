@@ -0,0 +1,27 @@
+/**
+ * FenceWaiter for the fences of command queues. The watcher thread sleeps
+ * in one WaitForMultipleObjects on an event set when any of the fences
+ * reaches its target, and an event set by Wake.
+ */
+#pragma once
+
+#include "fencewatcher.h"
+#include "helpers.h"
+
+class QueueFenceWaiter : public FenceWaiter
+{
+public:
+    explicit QueueFenceWaiter(Microsoft::WRL::ComPtr<ID3D12Device2> device);
+    ~QueueFenceWaiter();
+
+    // Every target has to be a CommandQueue.
+    void WaitAny(Span<const FenceTarget> targets) override;
+    void Wake() override;
+
+private:
+    Microsoft::WRL::ComPtr<ID3D12Device2> m_Device;
+
+    // Both auto reset, a Wake before WaitAny is not lost.
+    HANDLE m_CompletionEvent;
+    HANDLE m_WakeEvent;
+};
@@ -0,0 +1,67 @@
+#include "releasequeue.h"
+#include "commandqueue.h"
+#include "gpuallocator.h"
+
+using namespace Microsoft::WRL;
+
+ReleaseQueue::ReleaseQueue(std::shared_ptr<GpuAllocator> allocator) :
+    m_Allocator(allocator)
+{
+}
+
+ReleaseQueue::~ReleaseQueue()
+{
+    for (Pending& pending : m_Pending)
+        pending.items.Retire(~0ull, [](std::function<void()> release) { release(); });
+}
+
+DeferredQueue<std::function<void()>>& ReleaseQueue::GetQueue(const CommandQueue& queue)
+{
+    for (Pending& pending : m_Pending)
+    {
+        if (pending.queue == &queue)
+            return pending.items;
+    }
+    m_Pending.push_back({ &queue, {} });
+    return m_Pending.back().items;
+}
+
+void ReleaseQueue::Defer(const CommandQueue& queue, uint64_t fenceValue, std::function<void()> release)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    GetQueue(queue).Push(fenceValue, std::move(release));
+}
+
+void ReleaseQueue::Release(ComPtr<ID3D12Resource>& resource, const CommandQueue& queue, uint64_t fenceValue)
+{
+    if (!resource)
+        return;
+
+    std::shared_ptr<GpuAllocator> allocator = m_Allocator;
+    ComPtr<ID3D12Resource>        released  = std::move(resource);
+    Defer(queue, fenceValue, [allocator, released]() mutable { allocator->Release(released); });
+}
+
+void ReleaseQueue::Release(ComPtr<ID3D12Resource>& resource, const CommandQueue& queue)
+{
+    Release(resource, queue, queue.GetLastFenceValue());
+}
+
+void ReleaseQueue::Retire()
+{
+    // Collected first and released outside of the lock, releasing may queue
+    // more.
+    std::vector<std::function<void()>> retired;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        for (Pending& pending : m_Pending)
+        {
+            if (pending.items.IsEmpty())
+                continue;
+            uint64_t completed = pending.queue->GetCompletedFenceValue();
+            pending.items.Retire(completed, [&](std::function<void()> release) { retired.push_back(std::move(release)); });
+        }
+    }
+    for (auto& release : retired)
+        release();
+}
@@ -0,0 +1,58 @@
+/**
+ * Deferred destruction of GPU objects.
+ *
+ * Resources and descriptors still referenced by submitted command lists
+ * are queued with the fence value of their last use on a command queue and
+ * released once the queue passes it, instead of flushing the queues before
+ * letting go of them. Retire runs once per frame from the application loop.
+ *
+ * Thread safe.
+ */
+#pragma once
+
+#include "deferredqueue.h"
+#include "helpers.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+class CommandQueue;
+class GpuAllocator;
+
+class ReleaseQueue
+{
+public:
+    explicit ReleaseQueue(std::shared_ptr<GpuAllocator> allocator);
+    // Releases everything still queued, the GPU has to be idle.
+    ~ReleaseQueue();
+
+    // Release `resource` once `queue` reaches `fenceValue`, and reset it.
+    // Placed resources give their memory back to the GpuAllocator.
+    void Release(Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const CommandQueue& queue, uint64_t fenceValue);
+    // Same, after everything submitted to `queue` so far.
+    void Release(Microsoft::WRL::ComPtr<ID3D12Resource>& resource, const CommandQueue& queue);
+
+    // Run `release` once `queue` reaches `fenceValue`, for descriptors and
+    // anything else the GPU may still read.
+    void Defer(const CommandQueue& queue, uint64_t fenceValue, std::function<void()> release);
+
+    // Release what the queues are done with.
+    void Retire();
+
+private:
+    DeferredQueue<std::function<void()>>& GetQueue(const CommandQueue& queue);
+
+    std::shared_ptr<GpuAllocator> m_Allocator;
+
+    std::mutex m_Mutex;
+    // A handful of command queues at most, found by a linear search.
+    struct Pending
+    {
+        const CommandQueue*                  queue;
+        DeferredQueue<std::function<void()>> items;
+    };
+    std::vector<Pending> m_Pending;
+};
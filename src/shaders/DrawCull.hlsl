@@ -0,0 +1,144 @@
+// Frustum culling and LOD selection of the submesh draws, compacted in
+// submesh order into the arguments of ExecuteIndirect. CullDraws in
+// drawcull.cpp is the CPU reference, keep the two in step.
+
+#define GROUP_SIZE 256
+
+struct Dequantization
+{
+	float4 offset;
+	float4 scale;
+};
+
+struct DrawSource
+{
+	Dequantization dequant;
+	uint material;
+	uint lod_offset;
+	uint lod_count;
+	uint padding;
+};
+
+struct MeshLod
+{
+	uint  index_offset;
+	uint  index_count;
+	float error;
+	uint  padding;
+};
+
+// The root constants of the mesh pipeline, then D3D12_DRAW_INDEXED_ARGUMENTS.
+struct IndirectDraw
+{
+	uint           material;
+	Dequantization dequant;
+	uint           index_count;
+	uint           instance_count;
+	uint           index_offset;
+	int            vertex_offset;
+	uint           instance_offset;
+};
+
+struct CullConstants
+{
+	float4 planes[6]; // object space
+	float4 eye;       // object space, w model scale
+	float  lod_scale;
+	float  lod_error_pixels;
+	uint   draw_count;
+	uint   padding;
+};
+
+ConstantBuffer<CullConstants> cull : register(b0);
+StructuredBuffer<DrawSource> sources : register(t0);
+StructuredBuffer<MeshLod> lods : register(t1);
+RWStructuredBuffer<IndirectDraw> draws : register(u0);
+RWStructuredBuffer<uint> draw_count : register(u1);
+
+groupshared uint visible_sum[GROUP_SIZE];
+
+// Same operations in the same order as the reference, precise keeps the
+// compiler from fusing or reordering them.
+bool CullDraw(DrawSource source, out IndirectDraw draw)
+{
+	draw = (IndirectDraw)0;
+
+	float4 offset = source.dequant.offset;
+	float4 scale  = source.dequant.scale;
+
+	precise float cx     = offset.x + scale.x * 0.5f;
+	precise float cy     = offset.y + scale.y * 0.5f;
+	precise float cz     = offset.z + scale.z * 0.5f;
+	precise float radius = sqrt(scale.x * scale.x + scale.y * scale.y + scale.z * scale.z) * 0.5f;
+
+	for (uint p = 0; p < 6; p++)
+	{
+		float4 plane = cull.planes[p];
+		precise float d = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+		if (d < -radius)
+			return false;
+	}
+
+	precise float dx       = cx - cull.eye.x;
+	precise float dy       = cy - cull.eye.y;
+	precise float dz       = cz - cull.eye.z;
+	precise float distance = (sqrt(dx * dx + dy * dy + dz * dz) - radius) * cull.eye.w;
+	distance               = distance > 1.0f ? distance : 1.0f;
+
+	uint lod = source.lod_offset;
+	for (uint level = source.lod_count; level-- > 1;)
+	{
+		precise float error   = lods[source.lod_offset + level].error * cull.lod_scale;
+		precise float allowed = cull.lod_error_pixels * distance;
+		if (error <= allowed)
+		{
+			lod = source.lod_offset + level;
+			break;
+		}
+	}
+
+	draw.material        = source.material;
+	draw.dequant         = source.dequant;
+	draw.index_count     = lods[lod].index_count;
+	draw.instance_count  = 1;
+	draw.index_offset    = lods[lod].index_offset;
+	draw.vertex_offset   = 0;
+	draw.instance_offset = 0;
+	return true;
+}
+
+// One group walks the draws GROUP_SIZE at a time, a prefix sum of the
+// visible flags gives every visible draw its slot after the earlier ones.
+[numthreads(GROUP_SIZE, 1, 1)]
+void main(uint thread : SV_GroupIndex)
+{
+	uint count = 0;
+	for (uint first = 0; first < cull.draw_count; first += GROUP_SIZE)
+	{
+		uint         d       = first + thread;
+		IndirectDraw draw    = (IndirectDraw)0;
+		bool         visible = false;
+		if (d < cull.draw_count)
+			visible = CullDraw(sources[d], draw);
+
+		// Inclusive prefix sum, Hillis-Steele.
+		visible_sum[thread] = visible ? 1 : 0;
+		GroupMemoryBarrierWithGroupSync();
+		for (uint stride = 1; stride < GROUP_SIZE; stride <<= 1)
+		{
+			uint before = thread >= stride ? visible_sum[thread - stride] : 0;
+			GroupMemoryBarrierWithGroupSync();
+			visible_sum[thread] += before;
+			GroupMemoryBarrierWithGroupSync();
+		}
+
+		if (visible)
+			draws[count + visible_sum[thread] - 1] = draw;
+		count += visible_sum[GROUP_SIZE - 1];
+		// Everyone read the total before the next chunk overwrites it.
+		GroupMemoryBarrierWithGroupSync();
+	}
+
+	if (thread == 0)
+		draw_count[0] = count;
+}
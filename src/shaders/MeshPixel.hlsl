@@ -10,31 +10,39 @@ struct UniformData
 	float4x4 NormalMatrix;
 	float4x4 ModelMatrix;
 	float4   eye;
+	float4   light_dir;
 };
 
 struct Material
 {
 	float4 diffuse;  //w alpha
 	float4 specular; //w shininess
-	float4 light_dir;
+};
+
+// Index of the submesh material in the table.
+struct DrawConstants
+{
+	uint material;
 };
 
 ConstantBuffer<UniformData> uniform_data : register(b0);
-ConstantBuffer<Material> material : register(b1);
+ConstantBuffer<DrawConstants> draw : register(b1);
+StructuredBuffer<Material> materials : register(t0);
 
 float4 main( PixelShaderInput IN ) : SV_Target
 {
+	Material material = materials[draw.material];
 
 	float3 albedo = material.diffuse.xyz;
 	float3 specular = material.specular.xyz;
 	float shininess = material.specular.w;
 	float alpha = material.diffuse.w;
 	//diffuse
-	float NdotL = max(0.0f, dot(IN.Normal, material.light_dir.xyz));
+	float NdotL = max(0.0f, dot(IN.Normal, uniform_data.light_dir.xyz));
 	float3 diffuse = albedo * NdotL; //light color 1.0;
 	//specular
 	float3 viewdir = normalize((float3)uniform_data.eye - IN.WPos);
-	float3 reflect_dir = reflect((float3)material.light_dir, IN.Normal);
+	float3 reflect_dir = reflect((float3)uniform_data.light_dir, IN.Normal);
 	float spec = pow(max(dot(viewdir, reflect_dir), 0.0), shininess);
 
 	return float4(albedo * (NdotL+spec), alpha); // IN.Color;
@@ -4,15 +4,24 @@ struct UniformData
 	float4x4 NormalMatrix;
 	float4x4 ModelMatrix;
 	float4   eye;
+	float4   light_dir;
+};
+
+// Maps the unorm16 positions of the current submesh back to object space.
+struct Dequantization
+{
+	float4 offset;
+	float4 scale;
 };
 
 ConstantBuffer<UniformData> Uniform : register(b0);
+ConstantBuffer<Dequantization> Dequant : register(b2);
 
+// The texcoord of the packed format is not used here.
 struct VertexPos
 {
-	float3 Position : POSITION;
-	float3 Normal   : NORMAL;
-	float3 texcoord : TEXCOORD;
+	float4 Position : POSITION; // unorm16
+	float2 Normal   : NORMAL;   // snorm16 octahedral
 };
 
 struct VertexShaderOutput
@@ -22,14 +31,24 @@ struct VertexShaderOutput
 	float4 Position : SV_Position;
 };
 
+float3 DecodeOctahedral(float2 e)
+{
+	float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+	float  t = max(-n.z, 0.0f);
+	n.xy -= (n.xy >= 0.0f ? 1.0f : -1.0f) * t;
+	return normalize(n);
+}
+
 VertexShaderOutput main(VertexPos IN)
 {
     VertexShaderOutput OUT;
 
-    OUT.Position = mul(Uniform.MVP, float4(IN.Position, 1.0f));
-    float3 Normal = mul((float3x3)Uniform.NormalMatrix, IN.Normal);
+    float3 Position = Dequant.offset.xyz + IN.Position.xyz * Dequant.scale.xyz;
+
+    OUT.Position = mul(Uniform.MVP, float4(Position, 1.0f));
+    float3 Normal = mul((float3x3)Uniform.NormalMatrix, DecodeOctahedral(IN.Normal));
     OUT.Normal = normalize(Normal);
-    OUT.WPos   = (float3)mul(Uniform.ModelMatrix, float4(IN.Position, 1.0f));
+    OUT.WPos   = (float3)mul(Uniform.ModelMatrix, float4(Position, 1.0f));
     // OUT.Color = float4(Normal, 1.0);
     // OUT.Color = float4(depth, depth, depth, 1.0);
 
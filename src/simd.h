@@ -0,0 +1,65 @@
+/**
+ * Compile time detection of the SIMD instruction sets the CPU side kernels
+ * can use. Every kernel keeps a scalar path for the other targets, define
+ * PETIT_SIMD_SSE2 to 0 to force it.
+ *
+ * AVX2 is not assumed of x86-64 CPUs. Kernels using it are compiled for it
+ * alone, marked PETIT_TARGET_AVX2, and only called when CpuHasAvx2 says so.
+ * Define PETIT_SIMD_AVX2 to 0 to leave them out.
+ */
+#pragma once
+
+#if !defined(PETIT_SIMD_SSE2)
+#    if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#        define PETIT_SIMD_SSE2 1
+#    else
+#        define PETIT_SIMD_SSE2 0
+#    endif
+#endif
+
+#if PETIT_SIMD_SSE2
+#    include <emmintrin.h>
+#endif
+
+#if !defined(PETIT_SIMD_AVX2)
+#    define PETIT_SIMD_AVX2 PETIT_SIMD_SSE2
+#endif
+
+#if PETIT_SIMD_AVX2
+#    include <immintrin.h>
+#    if defined(_MSC_VER) && !defined(__clang__)
+#        include <intrin.h>
+// MSVC emits any intrinsic regardless of /arch.
+#        define PETIT_TARGET_AVX2
+#    else
+#        define PETIT_TARGET_AVX2 __attribute__((target("avx2")))
+#    endif
+
+// Whether the CPU, and the OS saving the YMM registers, support AVX2.
+inline bool CpuHasAvx2()
+{
+#    if defined(_MSC_VER) && !defined(__clang__)
+    static const bool supported = []() {
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx     = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }();
+    return supported;
+#    else
+    return __builtin_cpu_supports("avx2");
+#    endif
+}
+#else
+inline bool CpuHasAvx2()
+{
+    return false;
+}
+#endif
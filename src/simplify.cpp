@@ -0,0 +1,387 @@
+#include "simplify.h"
+#include "meshweld.h"
+#include "parallel.h"
+#include "vertexcache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+
+// Symmetric 4x4 quadric of the squared distance to a set of planes, scaled
+// by the total plane weight.
+struct Quadric
+{
+    double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+    double b0 = 0, b1 = 0, b2 = 0;
+    double c = 0;
+    double w = 0;
+
+    void AddPlane(const glm::dvec3& n, double d, double weight)
+    {
+        a00 += weight * n.x * n.x;
+        a01 += weight * n.x * n.y;
+        a02 += weight * n.x * n.z;
+        a11 += weight * n.y * n.y;
+        a12 += weight * n.y * n.z;
+        a22 += weight * n.z * n.z;
+        b0 += weight * n.x * d;
+        b1 += weight * n.y * d;
+        b2 += weight * n.z * d;
+        c += weight * d * d;
+        w += weight;
+    }
+
+    void Add(const Quadric& q)
+    {
+        a00 += q.a00, a01 += q.a01, a02 += q.a02, a11 += q.a11, a12 += q.a12, a22 += q.a22;
+        b0 += q.b0, b1 += q.b1, b2 += q.b2;
+        c += q.c;
+        w += q.w;
+    }
+
+    // Weighted mean of the squared plane distances of `p`.
+    double Evaluate(const glm::dvec3& p) const
+    {
+        double r = a00 * p.x * p.x + a11 * p.y * p.y + a22 * p.z * p.z +
+                   2.0 * (a01 * p.x * p.y + a02 * p.x * p.z + a12 * p.y * p.z) +
+                   2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+        return w > 0.0 ? std::max(r, 0.0) / w : 0.0;
+    }
+};
+
+struct PositionKey
+{
+    glm::vec3 position;
+
+    bool operator==(const PositionKey& other) const { return position == other.position; }
+};
+
+struct PositionKeyHash
+{
+    uint64_t operator()(const PositionKey& key) const { return HashBytes(&key.position, sizeof(key.position)); }
+};
+
+struct EdgeHash
+{
+    uint64_t operator()(uint64_t edge) const { return MixHash(edge); }
+};
+
+struct Collapse
+{
+    double   cost;
+    double   error;
+    uint32_t source;
+    uint32_t target;
+
+    bool operator<(const Collapse& other) const
+    {
+        if (cost != other.cost)
+            return cost < other.cost;
+        if (source != other.source)
+            return source < other.source;
+        return target < other.target;
+    }
+};
+
+inline uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return (uint64_t(a) << 32) | b;
+}
+
+} // namespace
+
+size_t SimplifyMesh(uint32_t*              destination,
+                    const uint32_t*        indices,
+                    size_t                 indexCount,
+                    const MeshVertex*      vertices,
+                    size_t                 targetIndexCount,
+                    const SimplifyOptions& options,
+                    float*                 resultError)
+{
+    indexCount -= indexCount % 3;
+    if (resultError)
+        *resultError = 0.0f;
+    if (indexCount == 0)
+        return 0;
+
+    // Work on the vertex range the indices touch.
+    auto              range       = std::minmax_element(indices, indices + indexCount);
+    const uint32_t    base        = *range.first;
+    const size_t      vertexCount = *range.second - base + 1;
+    const MeshVertex* local       = vertices + base;
+
+    std::vector<uint32_t> result(indices, indices + indexCount);
+    for (auto& index : result)
+        index -= base;
+
+    // Vertices sharing a position (attribute seams) share one position id.
+    std::vector<uint32_t> positionId(vertexCount);
+    std::vector<uint32_t> wedgeCount;
+    {
+        FlatIndexMap<PositionKey, PositionKeyHash> positions(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            auto inserted = positions.Insert({ local[v].position }, (uint32_t)wedgeCount.size());
+            positionId[v] = inserted.first;
+            if (inserted.second)
+                wedgeCount.push_back(0);
+        }
+    }
+    const size_t positionCount = wedgeCount.size();
+
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    for (uint32_t index : result)
+        referenced[index] = 1;
+    for (uint32_t v = 0; v < vertexCount; v++)
+        wedgeCount[positionId[v]] += referenced[v];
+
+    // Lock seams, borders (edges without a twin) and non manifold edges.
+    std::vector<uint8_t> locked(positionCount, 0);
+    for (size_t p = 0; p < positionCount; p++)
+        locked[p] = wedgeCount[p] > 1;
+    {
+        FlatIndexMap<uint64_t, EdgeHash> edges(indexCount);
+        std::vector<uint32_t>            edgeUses;
+        for (size_t i = 0; i < indexCount; i += 3)
+            for (int e = 0; e < 3; e++)
+            {
+                uint32_t a        = positionId[result[i + e]];
+                uint32_t b        = positionId[result[i + (e + 1) % 3]];
+                auto     inserted = edges.Insert(EdgeKey(a, b), (uint32_t)edgeUses.size());
+                if (inserted.second)
+                    edgeUses.push_back(0);
+                edgeUses[inserted.first]++;
+            }
+        for (size_t i = 0; i < indexCount; i += 3)
+            for (int e = 0; e < 3; e++)
+            {
+                uint32_t a    = positionId[result[i + e]];
+                uint32_t b    = positionId[result[i + (e + 1) % 3]];
+                uint32_t twin = edges.Find(EdgeKey(b, a));
+                if (twin == edges.kEmpty || edgeUses[edges.Find(EdgeKey(a, b))] > 1 || edgeUses[twin] > 1)
+                    locked[a] = locked[b] = 1;
+            }
+    }
+
+    // Plane quadrics of every position, weighted by triangle area.
+    std::vector<Quadric> quadrics(positionCount);
+    glm::vec3            boundsMin = local[result[0]].position;
+    glm::vec3            boundsMax = boundsMin;
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        glm::dvec3 p0 = local[result[i + 0]].position;
+        glm::dvec3 p1 = local[result[i + 1]].position;
+        glm::dvec3 p2 = local[result[i + 2]].position;
+        glm::dvec3 n  = glm::cross(p1 - p0, p2 - p0);
+        double     l  = glm::length(n);
+        for (int c = 0; c < 3; c++)
+        {
+            boundsMin = glm::min(boundsMin, local[result[i + c]].position);
+            boundsMax = glm::max(boundsMax, local[result[i + c]].position);
+        }
+        if (l <= 0.0)
+            continue;
+        n /= l;
+        for (int c = 0; c < 3; c++)
+            quadrics[positionId[result[i + c]]].AddPlane(n, -glm::dot(n, p0), l * 0.5);
+    }
+    const glm::vec3 extent        = boundsMax - boundsMin;
+    const double    attributeUnit = glm::dot(extent, extent);
+
+    const size_t          targetTriangles = targetIndexCount / 3;
+    double                maxError        = 0.0;
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint8_t>  touched(positionCount);
+    std::vector<uint32_t> fanOffsets(positionCount + 1);
+    std::vector<uint32_t> fans;
+    std::vector<Collapse> collapses;
+
+    while (result.size() / 3 > targetTriangles)
+    {
+        // Triangles around every position.
+        std::fill(fanOffsets.begin(), fanOffsets.end(), 0);
+        for (uint32_t index : result)
+            fanOffsets[positionId[index] + 1]++;
+        for (size_t p = 0; p < positionCount; p++)
+            fanOffsets[p + 1] += fanOffsets[p];
+        fans.resize(result.size());
+        {
+            std::vector<uint32_t> cursor(fanOffsets.begin(), fanOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++)
+                fans[cursor[positionId[result[i]]]++] = uint32_t(i / 3);
+        }
+
+        // Every edge leaving a free vertex is a candidate. Free vertices are
+        // never on a border, so their edges show up in both directions and
+        // we only need to look at one of them.
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3)
+            for (int e = 0; e < 3; e++)
+            {
+                uint32_t a = result[i + e];
+                uint32_t b = result[i + (e + 1) % 3];
+                if (positionId[a] > positionId[b])
+                    continue;
+                for (int direction = 0; direction < 2; direction++, std::swap(a, b))
+                {
+                    if (locked[positionId[a]])
+                        continue;
+
+                    Quadric q = quadrics[positionId[a]];
+                    q.Add(quadrics[positionId[b]]);
+                    double error     = q.Evaluate(local[b].position);
+                    double deviation = options.normalWeight * (1.0 - glm::dot(local[a].normal, local[b].normal));
+                    glm::vec2 uv     = glm::vec2(local[a].texcoord) - glm::vec2(local[b].texcoord);
+                    deviation += options.texcoordWeight * glm::dot(uv, uv);
+                    collapses.push_back({ error + deviation * attributeUnit, error, a, b });
+                }
+            }
+        std::sort(collapses.begin(), collapses.end());
+
+        for (uint32_t v = 0; v < vertexCount; v++)
+            remap[v] = v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t triangles = result.size() / 3;
+        size_t applied   = 0;
+        for (const Collapse& collapse : collapses)
+        {
+            if (triangles <= targetTriangles)
+                break;
+
+            uint32_t pa = positionId[collapse.source];
+            uint32_t pb = positionId[collapse.target];
+            if (touched[pa] || touched[pb] || pa == pb)
+                continue;
+
+            // Reject collapses that flip a triangle of the source fan.
+            const glm::vec3 to      = local[collapse.target].position;
+            bool            flips   = false;
+            size_t          removed = 0;
+            for (uint32_t f = fanOffsets[pa]; f < fanOffsets[pa + 1] && !flips; f++)
+            {
+                const uint32_t* t = &result[3 * fans[f]];
+                if (positionId[t[0]] == pb || positionId[t[1]] == pb || positionId[t[2]] == pb)
+                {
+                    removed++;
+                    continue;
+                }
+                glm::vec3 p[3], moved[3];
+                for (int c = 0; c < 3; c++)
+                {
+                    p[c]     = local[t[c]].position;
+                    moved[c] = positionId[t[c]] == pa ? to : p[c];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after  = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                flips            = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips || removed == 0)
+                continue;
+
+            // The fan of the source changes, keep it out of this pass.
+            for (uint32_t f = fanOffsets[pa]; f < fanOffsets[pa + 1]; f++)
+            {
+                const uint32_t* t = &result[3 * fans[f]];
+                for (int c = 0; c < 3; c++)
+                    touched[positionId[t[c]]] = 1;
+            }
+
+            remap[collapse.source] = collapse.target;
+            quadrics[pb].Add(quadrics[pa]);
+            maxError = std::max(maxError, collapse.error);
+            triangles -= removed;
+            applied++;
+        }
+        if (applied == 0)
+            break;
+
+        // Apply the collapses and drop the triangles that became degenerate.
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t a = remap[result[i + 0]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (positionId[a] == positionId[b] || positionId[b] == positionId[c] || positionId[a] == positionId[c])
+                continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    for (size_t i = 0; i < result.size(); i++)
+        destination[i] = result[i] + base;
+    if (resultError)
+        *resultError = (float)std::sqrt(maxError);
+    return result.size();
+}
+
+void BuildLodChains(MeshBuffers& mesh, const SimplifyOptions& options)
+{
+    struct SubMeshLods
+    {
+        std::vector<MeshLod>  lods;
+        std::vector<uint32_t> indices;
+    };
+
+    std::vector<SubMeshLods> built(mesh.submeshes.size());
+    ParallelFor(mesh.submeshes.size(), [&](size_t s) {
+        const MeshSubMesh& submesh = mesh.submeshes[s];
+        SubMeshLods&       out     = built[s];
+
+        std::vector<uint32_t> current(mesh.indices.begin() + submesh.index_offset,
+                                      mesh.indices.begin() + submesh.index_offset + submesh.index_count);
+        std::vector<uint32_t> simplified(current.size());
+        float                 error = 0.0f;
+        for (uint32_t level = 1; level < kMaxMeshLods; level++)
+        {
+            float  levelError = 0.0f;
+            size_t target     = current.size() / 6 * 3;
+            size_t count      = SimplifyMesh(simplified.data(), current.data(), current.size(), mesh.vertices.data(),
+                                             target, options, &levelError);
+            // Stop once the mesh does not shrink anymore.
+            if (count == 0 || count > current.size() * 9 / 10)
+                break;
+
+            OptimizeVertexCache(simplified.data(), count);
+
+            // Every level simplifies the previous one, so the errors add up.
+            error += levelError;
+            MeshLod lod      = {};
+            lod.index_offset = (uint32_t)out.indices.size();
+            lod.index_count  = (uint32_t)count;
+            lod.error        = error;
+            out.lods.push_back(lod);
+            out.indices.insert(out.indices.end(), simplified.begin(), simplified.begin() + count);
+            current.assign(simplified.begin(), simplified.begin() + count);
+        }
+    });
+
+    mesh.lods.clear();
+    for (size_t s = 0; s < mesh.submeshes.size(); s++)
+    {
+        MeshSubMesh& submesh = mesh.submeshes[s];
+        submesh.lod_offset   = (uint32_t)mesh.lods.size();
+        submesh.lod_count    = (uint32_t)built[s].lods.size() + 1;
+
+        MeshLod full      = {};
+        full.index_offset = submesh.index_offset;
+        full.index_count  = submesh.index_count;
+        full.error        = 0.0f;
+        mesh.lods.push_back(full);
+
+        uint32_t indexBase = (uint32_t)mesh.indices.size();
+        for (MeshLod lod : built[s].lods)
+        {
+            lod.index_offset += indexBase;
+            mesh.lods.push_back(lod);
+        }
+        mesh.indices.insert(mesh.indices.end(), built[s].indices.begin(), built[s].indices.end());
+    }
+}
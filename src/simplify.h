@@ -0,0 +1,58 @@
+/**
+ * Quadric error mesh simplification and LOD chains.
+ *
+ * Edges are collapsed onto one of their existing vertices (half edge
+ * collapses), so every level of detail only needs a new index buffer and
+ * keeps sharing the base vertex buffer. The cost of a collapse is the
+ * quadric error (Garland-Heckbert) of the moved vertex plus weighted normal
+ * and texcoord deviations. Vertices on mesh borders and on attribute seams
+ * are never moved, so the silhouette of open meshes and the UV layout are
+ * preserved.
+ *
+ * Collapses are applied in passes of independent edges sorted by cost, with
+ * ties broken by vertex index, so the result does not depend on threading.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+
+// Levels of detail per submesh, the full resolution range included.
+constexpr uint32_t kMaxMeshLods = 5;
+
+struct SimplifyOptions
+{
+    // Weight of the normal deviation (1 - cos) and of the squared texcoord
+    // distance of a collapse, relative to the squared extent of the mesh.
+    float normalWeight   = 0.01f;
+    float texcoordWeight = 0.01f;
+};
+
+/**
+ * Simplify the triangles of indices[0, indexCount) to at most
+ * `targetIndexCount` indices, writing them to `destination`, which needs
+ * room for `indexCount` indices. Fewer collapses happen if the mesh runs out
+ * of collapsible edges.
+ *
+ * @param resultError Receives the largest geometric error introduced, as a
+ *                    distance in the units of the mesh. Can be null.
+ * @returns The number of indices written.
+ */
+size_t SimplifyMesh(uint32_t*              destination,
+                    const uint32_t*        indices,
+                    size_t                 indexCount,
+                    const MeshVertex*      vertices,
+                    size_t                 targetIndexCount,
+                    const SimplifyOptions& options     = {},
+                    float*                 resultError = nullptr);
+
+/**
+ * Build up to kMaxMeshLods levels for every submesh, the submeshes are
+ * simplified in parallel. Every level halves the triangle count of the
+ * previous one, its index range is appended to `mesh.indices` and
+ * vertex cache optimized. Fills `mesh.lods` and MeshSubMesh::lod_offset and
+ * lod_count, level 0 being the submesh's own range.
+ */
+void BuildLodChains(MeshBuffers& mesh, const SimplifyOptions& options = {});
@@ -0,0 +1,55 @@
+/**
+ * View of a contiguous array, std::span is C++20.
+ */
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+template <typename T>
+class Span
+{
+public:
+    Span() = default;
+    Span(T* data, size_t size) :
+        m_Data(data),
+        m_Size(size)
+    {
+    }
+    template <size_t N>
+    Span(T (&array)[N]) :
+        m_Data(array),
+        m_Size(N)
+    {
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    Span(std::vector<U>& vector) :
+        m_Data(vector.data()),
+        m_Size(vector.size())
+    {
+    }
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<const U (*)[], T (*)[]>>>
+    Span(const std::vector<U>& vector) :
+        m_Data(vector.data()),
+        m_Size(vector.size())
+    {
+    }
+    template <typename U, size_t N, typename = std::enable_if_t<std::is_convertible_v<const U (*)[], T (*)[]>>>
+    Span(const std::array<U, N>& array) :
+        m_Data(array.data()),
+        m_Size(N)
+    {
+    }
+    T*     data() const { return m_Data; }
+    size_t size() const { return m_Size; }
+    bool   empty() const { return m_Size == 0; }
+    T*     begin() const { return m_Data; }
+    T*     end() const { return m_Data + m_Size; }
+    T&     operator[](size_t i) const { return m_Data[i]; }
+
+private:
+    T*     m_Data = nullptr;
+    size_t m_Size = 0;
+};
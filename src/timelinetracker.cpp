@@ -0,0 +1,116 @@
+#include "timelinetracker.h"
+
+#include <algorithm>
+#include <assert.h>
+
+TimelineTracker::TimelineTracker(uint32_t timelineCount) :
+    m_TimelineCount(timelineCount),
+    m_Timelines(timelineCount)
+{
+    for (Timeline& timeline : m_Timelines)
+        timeline.known.assign(timelineCount, 0);
+}
+
+const TimelineTracker::Snapshot* TimelineTracker::FindSnapshot(const Timeline& timeline, uint64_t value) const
+{
+    // Known values only grow, the last snapshot at or before `value` is a
+    // safe lower bound for what the signal reaching it was ordered after.
+    auto next = std::upper_bound(timeline.snapshots.begin(), timeline.snapshots.end(), value,
+                                 [](uint64_t target, const Snapshot& snapshot) { return target < snapshot.value; });
+    return next == timeline.snapshots.begin() ? nullptr : &*std::prev(next);
+}
+
+void TimelineTracker::Resolve(uint32_t timeline, Span<const SyncPoint> points, std::vector<SyncPoint>& waits)
+{
+    assert(timeline < m_TimelineCount);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Timeline&                   self = m_Timelines[timeline];
+
+    // The latest point per timeline, the earlier ones are implied.
+    std::vector<uint64_t> wanted(m_TimelineCount, 0);
+    for (const SyncPoint& point : points)
+    {
+        assert(point.timeline < m_TimelineCount);
+        if (point.timeline == timeline)
+            continue;
+        m_Stats.requested++;
+        wanted[point.timeline] = std::max(wanted[point.timeline], point.value);
+    }
+
+    // What the wanted points were ordered after themselves.
+    std::vector<uint64_t> implied = self.known;
+    for (uint32_t other = 0; other < m_TimelineCount; other++)
+    {
+        const Timeline& producer = m_Timelines[other];
+        if (wanted[other] <= std::max(producer.completed, self.known[other]))
+        {
+            wanted[other] = 0;
+            continue;
+        }
+        if (const Snapshot* snapshot = FindSnapshot(producer, wanted[other]))
+        {
+            for (uint32_t i = 0; i < m_TimelineCount; i++)
+            {
+                if (i != other && i != timeline)
+                    implied[i] = std::max(implied[i], snapshot->known[i]);
+            }
+        }
+    }
+
+    for (uint32_t other = 0; other < m_TimelineCount; other++)
+    {
+        if (wanted[other] > implied[other])
+        {
+            waits.push_back({ other, wanted[other] });
+            m_Stats.issued++;
+        }
+        uint64_t known = std::max(implied[other], wanted[other]);
+        if (other != timeline && known > self.known[other])
+        {
+            self.known[other] = known;
+            self.dirty        = true;
+        }
+    }
+}
+
+void TimelineTracker::Signal(uint32_t timeline, uint64_t value)
+{
+    assert(timeline < m_TimelineCount);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Timeline&                   self = m_Timelines[timeline];
+
+    assert(value > self.signaled);
+    self.signaled = value;
+    if (self.dirty)
+    {
+        self.snapshots.push_back({ value, self.known });
+        self.dirty = false;
+    }
+}
+
+void TimelineTracker::Complete(uint32_t timeline, uint64_t completedValue)
+{
+    assert(timeline < m_TimelineCount);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    Timeline&                   self = m_Timelines[timeline];
+
+    self.completed = std::max(self.completed, completedValue);
+    // Waits for complete values are dropped without a lookup, only the last
+    // snapshot at or before the completed value can still be found.
+    while (self.snapshots.size() > 1 && self.snapshots[1].value <= self.completed)
+        self.snapshots.pop_front();
+}
+
+uint64_t TimelineTracker::GetKnownValue(uint32_t timeline, uint32_t other) const
+{
+    assert(timeline < m_TimelineCount && other < m_TimelineCount);
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    const Timeline&             self = m_Timelines[timeline];
+    return other == timeline ? self.signaled : self.known[other];
+}
+
+TimelineWaitStats TimelineTracker::GetStats() const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Stats;
+}
@@ -0,0 +1,94 @@
+/**
+ * Ordering between the timelines of several command queues.
+ *
+ * Every queue signals increasing values on a fence of its own, its
+ * timeline. A queue consuming what another one produced waits on the GPU
+ * for the producer's value, and a signal after that wait orders it too: a
+ * third queue waiting for the consumer's signal needs no wait of its own on
+ * the producer. The tracker remembers, for every timeline, what it is
+ * already ordered after and drops the waits implied by it, so producers and
+ * consumers overlap without the CPU in between and without redundant
+ * waits.
+ *
+ * Bookkeeping only, like the UploadRing: timelines are indices and fence
+ * values plain integers, the CommandQueue issues the waits. Thread safe.
+ */
+#pragma once
+
+#include "span.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// A value on a timeline.
+struct SyncPoint
+{
+    uint32_t timeline;
+    uint64_t value;
+};
+
+struct TimelineWaitStats
+{
+    // Waits asked for, and the ones actually issued. The others were
+    // already complete or implied by earlier waits.
+    uint64_t requested = 0;
+    uint64_t issued    = 0;
+};
+
+class TimelineTracker
+{
+public:
+    explicit TimelineTracker(uint32_t timelineCount);
+
+    /**
+     * Work about to be submitted on `timeline` depends on `points`. Appends
+     * to `waits` the ones it has to wait for, at most one per timeline, and
+     * counts them as waited for from now on. Points on `timeline` itself,
+     * complete or implied by earlier waits are left out.
+     */
+    void Resolve(uint32_t timeline, Span<const SyncPoint> points, std::vector<SyncPoint>& waits);
+
+    // `timeline` signaled `value`, after every wait resolved on it so far.
+    // Values must increase.
+    void Signal(uint32_t timeline, uint64_t value);
+
+    // The CPU saw `timeline` reach `completedValue`.
+    void Complete(uint32_t timeline, uint64_t completedValue);
+
+    // Highest value of `other` that work submitted next on `timeline` is
+    // ordered after, without counting completion.
+    uint64_t GetKnownValue(uint32_t timeline, uint32_t other) const;
+
+    uint32_t          GetTimelineCount() const { return m_TimelineCount; }
+    TimelineWaitStats GetStats() const;
+
+private:
+    // What a timeline was ordered after when it signaled `value`, recorded
+    // when it changes.
+    struct Snapshot
+    {
+        uint64_t              value;
+        std::vector<uint64_t> known;
+    };
+
+    struct Timeline
+    {
+        std::vector<uint64_t> known;
+        uint64_t              signaled  = 0;
+        uint64_t              completed = 0;
+        // Known values changed since the last snapshot.
+        bool                 dirty = false;
+        std::deque<Snapshot> snapshots;
+    };
+
+    // The snapshot ordered before `value` of `timeline`, null if none.
+    const Snapshot* FindSnapshot(const Timeline& timeline, uint64_t value) const;
+
+    uint32_t              m_TimelineCount;
+    std::vector<Timeline> m_Timelines;
+
+    mutable std::mutex m_Mutex;
+    TimelineWaitStats  m_Stats;
+};
@@ -0,0 +1,257 @@
+#include "tlsf.h"
+
+#include <assert.h>
+
+#if defined(_MSC_VER)
+#    include <intrin.h>
+#endif
+
+namespace
+{
+uint32_t HighestBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return index;
+#else
+    return 63 - __builtin_clzll(value);
+#endif
+}
+
+uint32_t LowestBit(uint64_t value)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return index;
+#else
+    return __builtin_ctzll(value);
+#endif
+}
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64_t size) :
+    m_Size(size)
+{
+    for (auto& heads : m_Heads)
+        for (uint32_t& head : heads)
+            head = Null;
+
+    // Block 0 always starts the range, merges keep the lower block.
+    uint32_t block = NewBlock();
+    m_Blocks[block] = { 0, size, Null, Null, Null, Null, true };
+    if (size > 0)
+        InsertFree(block);
+}
+
+void TlsfAllocator::Mapping(uint64_t size, uint32_t& fl, uint32_t& sl)
+{
+    if (size < SlCount)
+    {
+        fl = 0;
+        sl = uint32_t(size);
+        return;
+    }
+    uint32_t bit = HighestBit(size);
+    fl           = bit - SlShift + 1;
+    sl           = uint32_t(size >> (bit - SlShift)) - SlCount;
+}
+
+uint32_t TlsfAllocator::NewBlock()
+{
+    if (!m_UnusedBlocks.empty())
+    {
+        uint32_t block = m_UnusedBlocks.back();
+        m_UnusedBlocks.pop_back();
+        return block;
+    }
+    m_Blocks.emplace_back();
+    return uint32_t(m_Blocks.size() - 1);
+}
+
+void TlsfAllocator::InsertFree(uint32_t block)
+{
+    uint32_t fl, sl;
+    Mapping(m_Blocks[block].size, fl, sl);
+
+    Block& b     = m_Blocks[block];
+    b.free       = true;
+    b.prevFree   = Null;
+    b.nextFree   = m_Heads[fl][sl];
+    if (b.nextFree != Null)
+        m_Blocks[b.nextFree].prevFree = block;
+    m_Heads[fl][sl] = block;
+
+    m_FlBitmap |= 1ull << fl;
+    m_SlBitmap[fl] |= 1u << sl;
+    m_FreeBlockCount++;
+}
+
+void TlsfAllocator::RemoveFree(uint32_t block)
+{
+    uint32_t fl, sl;
+    Mapping(m_Blocks[block].size, fl, sl);
+
+    Block& b = m_Blocks[block];
+    if (b.prevFree != Null)
+        m_Blocks[b.prevFree].nextFree = b.nextFree;
+    else
+        m_Heads[fl][sl] = b.nextFree;
+    if (b.nextFree != Null)
+        m_Blocks[b.nextFree].prevFree = b.prevFree;
+    b.free = false;
+
+    if (m_Heads[fl][sl] == Null)
+    {
+        m_SlBitmap[fl] &= ~(1u << sl);
+        if (m_SlBitmap[fl] == 0)
+            m_FlBitmap &= ~(1ull << fl);
+    }
+    m_FreeBlockCount--;
+}
+
+uint32_t TlsfAllocator::FindFree(uint64_t size) const
+{
+    // Round up to the next list so that any block in it is large enough.
+    if (size >= SlCount)
+    {
+        uint64_t rounded = size + (1ull << (HighestBit(size) - SlShift)) - 1;
+        if (rounded < size)
+            return Null;
+        size = rounded;
+    }
+    uint32_t fl, sl;
+    Mapping(size, fl, sl);
+
+    uint32_t slMap = m_SlBitmap[fl] & (~0u << sl);
+    if (slMap == 0)
+    {
+        uint64_t flMap = fl + 1 < FlCount ? m_FlBitmap & (~0ull << (fl + 1)) : 0;
+        if (flMap == 0)
+            return Null;
+        fl    = LowestBit(flMap);
+        slMap = m_SlBitmap[fl];
+    }
+    return m_Heads[fl][LowestBit(slMap)];
+}
+
+void TlsfAllocator::SplitTail(uint32_t block, uint64_t size)
+{
+    if (m_Blocks[block].size == size)
+        return;
+
+    uint32_t tail = NewBlock();
+    Block&   b    = m_Blocks[block];
+    m_Blocks[tail] = { b.offset + size, b.size - size, block, b.nextPhysical, Null, Null, false };
+    if (b.nextPhysical != Null)
+        m_Blocks[b.nextPhysical].prevPhysical = tail;
+    b.nextPhysical = tail;
+    b.size         = size;
+    InsertFree(tail);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Use(uint32_t block, uint64_t size, uint64_t alignment)
+{
+    RemoveFree(block);
+
+    // Give the padding in front back as a free block of its own. The block
+    // before is in use, free neighbours are always merged.
+    uint64_t gap = AlignUp(m_Blocks[block].offset, alignment) - m_Blocks[block].offset;
+    if (gap > 0)
+    {
+        SplitTail(block, gap);
+        uint32_t aligned = m_Blocks[block].nextPhysical;
+        RemoveFree(aligned);
+        InsertFree(block);
+        block = aligned;
+    }
+    SplitTail(block, size);
+
+    m_UsedSize += size;
+    m_AllocationCount++;
+    return { m_Blocks[block].offset, block };
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if (size == 0)
+        return {};
+
+    // Offsets are usually aligned already, look for a block of the exact
+    // size first and only pay for the padding if it is not.
+    uint32_t block = FindFree(size);
+    if (block != Null && AlignUp(m_Blocks[block].offset, alignment) + size > m_Blocks[block].offset + m_Blocks[block].size)
+        block = FindFree(size + alignment - 1);
+    if (block == Null)
+        return {};
+    return Use(block, size, alignment);
+}
+
+TlsfAllocator::Allocation TlsfAllocator::AllocateBelow(uint64_t size, uint64_t alignment, uint64_t limit)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    if (size == 0)
+        return {};
+
+    for (uint32_t block = 0; block != Null && m_Blocks[block].offset < limit; block = m_Blocks[block].nextPhysical)
+    {
+        const Block& b     = m_Blocks[block];
+        uint64_t     start = AlignUp(b.offset, alignment);
+        if (b.free && start < limit && start + size <= b.offset + b.size)
+            return Use(block, size, alignment);
+    }
+    return {};
+}
+
+void TlsfAllocator::Free(Allocation allocation)
+{
+    uint32_t block = allocation.block;
+    assert(block < m_Blocks.size() && !m_Blocks[block].free && m_Blocks[block].offset == allocation.offset);
+
+    m_UsedSize -= m_Blocks[block].size;
+    m_AllocationCount--;
+
+    uint32_t next = m_Blocks[block].nextPhysical;
+    if (next != Null && m_Blocks[next].free)
+    {
+        RemoveFree(next);
+        m_Blocks[block].size += m_Blocks[next].size;
+        m_Blocks[block].nextPhysical = m_Blocks[next].nextPhysical;
+        if (m_Blocks[next].nextPhysical != Null)
+            m_Blocks[m_Blocks[next].nextPhysical].prevPhysical = block;
+        m_UnusedBlocks.push_back(next);
+    }
+
+    uint32_t prev = m_Blocks[block].prevPhysical;
+    if (prev != Null && m_Blocks[prev].free)
+    {
+        RemoveFree(prev);
+        m_Blocks[prev].size += m_Blocks[block].size;
+        m_Blocks[prev].nextPhysical = m_Blocks[block].nextPhysical;
+        if (m_Blocks[block].nextPhysical != Null)
+            m_Blocks[m_Blocks[block].nextPhysical].prevPhysical = prev;
+        m_UnusedBlocks.push_back(block);
+        block = prev;
+    }
+
+    InsertFree(block);
+}
+
+uint64_t TlsfAllocator::GetLargestFreeBlock() const
+{
+    if (m_FlBitmap == 0)
+        return 0;
+
+    // Every block of the highest non empty list is at least as large as any
+    // block of the lower ones.
+    uint32_t fl      = HighestBit(m_FlBitmap);
+    uint32_t sl      = HighestBit(m_SlBitmap[fl]);
+    uint64_t largest = 0;
+    for (uint32_t block = m_Heads[fl][sl]; block != Null; block = m_Blocks[block].nextFree)
+        largest = m_Blocks[block].size > largest ? m_Blocks[block].size : largest;
+    return largest;
+}
@@ -0,0 +1,90 @@
+/**
+ * Two level segregated fit allocator.
+ *
+ * Bookkeeping only: it places allocations in a range of `size` bytes, the
+ * GpuAllocator runs one per ID3D12Heap. Free blocks sit in lists bucketed
+ * by the power of two of their size (first level) and 16 linear steps
+ * inside it (second level). Two bitmaps find a non empty list large enough
+ * for a request, so allocating and freeing are O(1) and freed blocks merge
+ * with their free neighbours right away.
+ */
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+class TlsfAllocator
+{
+public:
+    static constexpr uint64_t InvalidOffset = ~0ull;
+
+    struct Allocation
+    {
+        uint64_t offset = InvalidOffset;
+        uint32_t block  = 0;
+    };
+
+    explicit TlsfAllocator(uint64_t size);
+
+    /**
+     * Reserve `size` bytes aligned to `alignment`, a power of two. Returns an
+     * allocation at InvalidOffset if no free block is large enough.
+     */
+    Allocation Allocate(uint64_t size, uint64_t alignment = 1);
+
+    /**
+     * Like Allocate but takes the lowest free block that fits and starts
+     * below `limit`, or fails. Meant for defragmentation, which moves the
+     * allocation at `limit` there: it is linear in the number of blocks.
+     */
+    Allocation AllocateBelow(uint64_t size, uint64_t alignment, uint64_t limit);
+
+    void Free(Allocation allocation);
+
+    uint64_t GetSize() const { return m_Size; }
+    uint64_t GetUsedSize() const { return m_UsedSize; }
+    uint32_t GetAllocationCount() const { return m_AllocationCount; }
+    uint32_t GetFreeBlockCount() const { return m_FreeBlockCount; }
+    uint64_t GetLargestFreeBlock() const;
+
+private:
+    static constexpr uint32_t SlShift = 4;
+    static constexpr uint32_t SlCount = 1u << SlShift;
+    static constexpr uint32_t FlCount = 64;
+    static constexpr uint32_t Null    = ~0u;
+
+    struct Block
+    {
+        uint64_t offset;
+        uint64_t size;
+        // Neighbours in address order.
+        uint32_t prevPhysical;
+        uint32_t nextPhysical;
+        // Neighbours in the free list, if free.
+        uint32_t prevFree;
+        uint32_t nextFree;
+        bool     free;
+    };
+
+    static void Mapping(uint64_t size, uint32_t& fl, uint32_t& sl);
+
+    uint32_t NewBlock();
+    void     InsertFree(uint32_t block);
+    void     RemoveFree(uint32_t block);
+    uint32_t FindFree(uint64_t size) const;
+    // Split the tail past `size` off `block` as a free block.
+    void       SplitTail(uint32_t block, uint64_t size);
+    Allocation Use(uint32_t block, uint64_t size, uint64_t alignment);
+
+    uint64_t m_Size;
+    uint64_t m_UsedSize        = 0;
+    uint32_t m_AllocationCount = 0;
+    uint32_t m_FreeBlockCount  = 0;
+
+    std::vector<Block>    m_Blocks;
+    std::vector<uint32_t> m_UnusedBlocks;
+
+    uint64_t m_FlBitmap = 0;
+    uint32_t m_SlBitmap[FlCount] = {};
+    uint32_t m_Heads[FlCount][SlCount];
+};
@@ -0,0 +1,45 @@
+#include "uploadallocator.h"
+
+#include <stdexcept>
+
+using namespace Microsoft::WRL;
+
+UploadAllocator::UploadAllocator(std::shared_ptr<GpuAllocator> allocator, uint64_t pageSize) :
+    m_GpuAllocator(allocator),
+    m_Allocator(pageSize)
+{
+}
+
+UploadAllocator::~UploadAllocator()
+{
+    // The owner makes sure the GPU is done with the pages.
+    for (Page& page : m_Pages)
+    {
+        page.buffer->Unmap(0, nullptr);
+        m_GpuAllocator->Release(page.buffer);
+    }
+}
+
+UploadAllocator::Allocation UploadAllocator::Allocate(uint64_t size, uint64_t alignment)
+{
+    LinearAllocator::Allocation allocation = m_Allocator.Allocate(size, alignment);
+    if (allocation.page == LinearAllocator::InvalidPage)
+        throw std::runtime_error("UploadAllocator: allocation larger than a page");
+
+    // First use of the page, back it with a buffer that stays mapped.
+    if (allocation.page == m_Pages.size())
+    {
+        Page page;
+        page.buffer = m_GpuAllocator->CreateBuffer(
+            m_Allocator.GetPageSize(), D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+        page.buffer->SetName(L"Upload Allocator Page");
+
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(page.buffer->Map(0, &readRange, reinterpret_cast<void**>(&page.cpu)));
+        page.gpu = page.buffer->GetGPUVirtualAddress();
+        m_Pages.push_back(page);
+    }
+
+    const Page& page = m_Pages[allocation.page];
+    return { page.cpu + allocation.offset, page.gpu + allocation.offset };
+}
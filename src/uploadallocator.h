@@ -0,0 +1,67 @@
+/**
+ * Per frame upload memory, mostly for constant buffers.
+ *
+ * A LinearAllocator over pages of persistently mapped upload heap. Writes
+ * go straight to the returned CPU pointer and the GPU address can be bound
+ * as a root CBV, no Map/Unmap per frame and no frame overwriting constants
+ * an earlier frame still reads.
+ *
+ * Not thread safe, one allocator per recording thread.
+ */
+#pragma once
+
+#include "gpuallocator.h"
+#include "helpers.h"
+#include "linearallocator.h"
+
+#include <memory>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+class UploadAllocator
+{
+public:
+    static constexpr uint64_t DefaultPageSize = 2 * 1024 * 1024;
+
+    struct Allocation
+    {
+        void*                     cpu;
+        D3D12_GPU_VIRTUAL_ADDRESS gpu;
+    };
+
+    UploadAllocator(std::shared_ptr<GpuAllocator> allocator, uint64_t pageSize = DefaultPageSize);
+    ~UploadAllocator();
+
+    // Memory valid until the frame is submitted and its fence completes.
+    // Aligned for a CBV by default.
+    Allocation Allocate(uint64_t size, uint64_t alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
+
+    // Copy `data` to a new allocation, returns the address to bind.
+    template <typename T>
+    D3D12_GPU_VIRTUAL_ADDRESS AllocateConstants(const T& data)
+    {
+        Allocation allocation = Allocate(sizeof(T));
+        memcpy(allocation.cpu, &data, sizeof(T));
+        return allocation.gpu;
+    }
+
+    // After executing the command lists using this frame's allocations, with
+    // the fence value they signal.
+    void Submit(uint64_t fenceValue) { m_Allocator.Submit(fenceValue); }
+
+    // Before recording a frame, with the completed value of the same queue.
+    void Retire(uint64_t completedValue) { m_Allocator.Retire(completedValue); }
+
+private:
+    struct Page
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+        uint8_t*                               cpu;
+        D3D12_GPU_VIRTUAL_ADDRESS              gpu;
+    };
+
+    std::shared_ptr<GpuAllocator> m_GpuAllocator;
+    LinearAllocator               m_Allocator;
+    std::vector<Page>             m_Pages;
+};
@@ -0,0 +1,57 @@
+#include "uploadring.h"
+
+#include <assert.h>
+
+UploadRing::UploadRing(uint64_t capacity) :
+    m_Capacity(capacity)
+{
+}
+
+uint64_t UploadRing::Allocate(uint64_t size, uint64_t alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    assert(m_Capacity % alignment == 0);
+    if (size == 0 || size > m_Capacity)
+        return InvalidOffset;
+
+    uint64_t start = (m_Head + alignment - 1) & ~(alignment - 1);
+    // Skip the end of the ring rather than splitting the allocation.
+    if (start % m_Capacity + size > m_Capacity)
+        start += m_Capacity - start % m_Capacity;
+    if (start + size - m_Tail > m_Capacity)
+        return InvalidOffset;
+
+    m_Head = start + size;
+    return start % m_Capacity;
+}
+
+void UploadRing::Submit(uint64_t fenceValue)
+{
+    if (!HasPending())
+        return;
+
+    assert(m_InFlight.empty() || m_InFlight.back().fenceValue <= fenceValue);
+    m_InFlight.push_back({ fenceValue, m_Head });
+    m_Submitted = m_Head;
+}
+
+void UploadRing::Retire(uint64_t completedValue)
+{
+    while (!m_InFlight.empty() && m_InFlight.front().fenceValue <= completedValue)
+    {
+        m_Tail = m_InFlight.front().end;
+        m_InFlight.pop_front();
+    }
+    // Nothing left to read, start over from the beginning of the ring.
+    if (m_InFlight.empty() && !HasPending())
+    {
+        m_Head      = 0;
+        m_Tail      = 0;
+        m_Submitted = 0;
+    }
+}
+
+uint64_t UploadRing::GetOldestFenceValue() const
+{
+    return m_InFlight.empty() ? 0 : m_InFlight.front().fenceValue;
+}
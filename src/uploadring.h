@@ -0,0 +1,66 @@
+/**
+ * Staging ring for GPU uploads.
+ *
+ * Bookkeeping only: it hands out offsets into a buffer of `capacity` bytes
+ * and recycles them once the fence value of the submission that read them
+ * has completed. Fence values are plain integers here, so it does not
+ * depend on D3D12, the UploadService wraps it around a mapped upload heap.
+ * The ShaderVisibleHeap counts descriptors with one instead of bytes.
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+class UploadRing
+{
+public:
+    // Returned by Allocate when the ring is full.
+    static constexpr uint64_t InvalidOffset = ~0ull;
+
+    /**
+     * @param capacity Size of the ring in bytes, a multiple of every
+     *                 alignment later passed to Allocate.
+     */
+    explicit UploadRing(uint64_t capacity);
+
+    /**
+     * Reserve `size` contiguous bytes aligned to `alignment`, a power of two.
+     * Returns InvalidOffset if they do not fit before older submissions
+     * retire. An allocation never wraps around the end of the ring.
+     */
+    uint64_t Allocate(uint64_t size, uint64_t alignment);
+
+    // Everything allocated since the last call is read by the submission
+    // signaling `fenceValue`. Fence values must increase.
+    void Submit(uint64_t fenceValue);
+
+    // Recycle the space of every submission up to `completedValue`.
+    void Retire(uint64_t completedValue);
+
+    // Fence value to wait for so that the oldest submission retires, 0 if
+    // nothing is in flight.
+    uint64_t GetOldestFenceValue() const;
+
+    // True if there are allocations not submitted yet.
+    bool HasPending() const { return m_Head != m_Submitted; }
+
+    uint64_t GetCapacity() const { return m_Capacity; }
+    uint64_t GetUsedSize() const { return m_Head - m_Tail; }
+
+private:
+    struct Submission
+    {
+        uint64_t fenceValue;
+        // Head of the ring when it was submitted.
+        uint64_t end;
+    };
+
+    uint64_t m_Capacity;
+    // Positions grow forever, the offset in the ring is position % capacity.
+    uint64_t m_Head      = 0;
+    uint64_t m_Tail      = 0;
+    uint64_t m_Submitted = 0;
+
+    std::deque<Submission> m_InFlight;
+};
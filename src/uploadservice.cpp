@@ -0,0 +1,148 @@
+#include "uploadservice.h"
+#include "commandqueue.h"
+
+#include <algorithm>
+#include <string.h>
+
+using namespace Microsoft::WRL;
+
+UploadService::UploadService(std::shared_ptr<GpuAllocator> allocator,
+                             std::shared_ptr<CommandQueue> copyQueue,
+                             uint64_t                      capacity) :
+    m_Allocator(allocator),
+    m_CopyQueue(copyQueue),
+    m_Ring(capacity)
+{
+    m_RingBuffer = CreateUploadBuffer(capacity);
+    m_RingBuffer->SetName(L"Upload Ring");
+
+    // Upload heaps can stay mapped for their whole lifetime.
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(m_RingBuffer->Map(0, &readRange, reinterpret_cast<void**>(&m_RingData)));
+}
+
+UploadService::~UploadService()
+{
+    // Nothing may still be reading the ring.
+    Submit();
+    m_CopyQueue->Flush();
+    m_RingBuffer->Unmap(0, nullptr);
+    m_Allocator->Release(m_RingBuffer);
+    Retire();
+}
+
+ComPtr<ID3D12Resource> UploadService::CreateUploadBuffer(uint64_t size)
+{
+    return m_Allocator->CreateBuffer(size, D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+}
+
+ID3D12GraphicsCommandList2* UploadService::GetCommandList()
+{
+    if (!m_CommandList)
+        m_CommandList = m_CopyQueue->GetCommandList();
+    return m_CommandList.Get();
+}
+
+void UploadService::Retire()
+{
+    uint64_t completed = m_CopyQueue->GetCompletedFenceValue();
+    m_Ring.Retire(completed);
+    auto retired = std::partition(m_LargeUploads.begin(), m_LargeUploads.end(), [&](const LargeUpload& upload) {
+        return upload.fenceValue == 0 || upload.fenceValue > completed;
+    });
+    for (auto upload = retired; upload != m_LargeUploads.end(); ++upload)
+        m_Allocator->Release(upload->buffer);
+    m_LargeUploads.erase(retired, m_LargeUploads.end());
+}
+
+uint64_t UploadService::AllocateStaging(uint64_t size, uint64_t alignment)
+{
+    Retire();
+    uint64_t offset = m_Ring.Allocate(size, alignment);
+    if (offset != UploadRing::InvalidOffset)
+        return offset;
+
+    // The copies already recorded read the ring too, they have to go first.
+    if (m_Ring.HasPending())
+        Submit();
+    while (offset == UploadRing::InvalidOffset && m_Ring.GetOldestFenceValue() != 0)
+    {
+        m_CopyQueue->WaitForFenceValue(m_Ring.GetOldestFenceValue());
+        Retire();
+        offset = m_Ring.Allocate(size, alignment);
+    }
+    return offset;
+}
+
+void UploadService::UploadBuffer(ID3D12Resource* destination, uint64_t offset, const void* data, uint64_t size)
+{
+    if (size == 0)
+        return;
+
+    if (size > m_Ring.GetCapacity())
+    {
+        LargeUpload upload = { 0, CreateUploadBuffer(size) };
+
+        void*         mapped = nullptr;
+        CD3DX12_RANGE readRange(0, 0);
+        ThrowIfFailed(upload.buffer->Map(0, &readRange, &mapped));
+        memcpy(mapped, data, size);
+        upload.buffer->Unmap(0, nullptr);
+
+        GetCommandList()->CopyBufferRegion(destination, offset, upload.buffer.Get(), 0, size);
+        m_LargeUploads.push_back(upload);
+        return;
+    }
+
+    uint64_t staging = AllocateStaging(size, 4);
+    memcpy(m_RingData + staging, data, size);
+    GetCommandList()->CopyBufferRegion(destination, offset, m_RingBuffer.Get(), staging, size);
+}
+
+void UploadService::UploadTexture(ID3D12Resource*               destination,
+                                  UINT                          firstSubresource,
+                                  UINT                          count,
+                                  const D3D12_SUBRESOURCE_DATA* data)
+{
+    uint64_t size = GetRequiredIntermediateSize(destination, firstSubresource, count);
+    if (size > m_Ring.GetCapacity())
+    {
+        LargeUpload upload = { 0, CreateUploadBuffer(size) };
+        UpdateSubresources(GetCommandList(), destination, upload.buffer.Get(), 0, firstSubresource, count, data);
+        m_LargeUploads.push_back(upload);
+        return;
+    }
+
+    // Writes the rows with their pitch padding into the ring and records one
+    // CopyTextureRegion per subresource.
+    uint64_t staging = AllocateStaging(size, D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT);
+    UpdateSubresources(GetCommandList(), destination, m_RingBuffer.Get(), staging, firstSubresource, count, data);
+}
+
+UploadTicket UploadService::Submit()
+{
+    UploadTicket ticket;
+    if (!m_CommandList)
+        return ticket;
+
+    ticket.fenceValue = m_CopyQueue->ExecuteCommandList(m_CommandList);
+    m_CommandList.Reset();
+
+    m_Ring.Submit(ticket.fenceValue);
+    for (LargeUpload& upload : m_LargeUploads)
+    {
+        if (upload.fenceValue == 0)
+            upload.fenceValue = ticket.fenceValue;
+    }
+    return ticket;
+}
+
+QueueWait UploadService::GetGpuWait(UploadTicket ticket) const
+{
+    return { m_CopyQueue.get(), ticket.fenceValue };
+}
+
+bool UploadService::IsComplete(UploadTicket ticket) const
+{
+    return m_CopyQueue->IsFenceComplete(ticket.fenceValue);
+}
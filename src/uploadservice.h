@@ -0,0 +1,101 @@
+/**
+ * Uploads through the COPY queue.
+ *
+ * Buffer and texture data is staged in a persistently mapped upload heap
+ * managed as an UploadRing, and every copy recorded until Submit goes into
+ * one command list. Submit returns a ticket, the queues consuming the data
+ * wait for it on the GPU, so neither the loading code nor the render loop
+ * blocks on the copies.
+ *
+ * Not thread safe, uploads are recorded from one thread.
+ */
+#pragma once
+
+#include "gpuallocator.h"
+#include "helpers.h"
+#include "uploadring.h"
+
+#include <memory>
+#include <stdint.h>
+#include <vector>
+
+class CommandQueue;
+struct QueueWait;
+
+// A COPY queue submission carrying uploads. The default ticket is complete.
+struct UploadTicket
+{
+    uint64_t fenceValue = 0;
+};
+
+class UploadService
+{
+public:
+    static constexpr uint64_t DefaultCapacity = 64ull * 1024 * 1024;
+
+    UploadService(std::shared_ptr<GpuAllocator> allocator,
+                  std::shared_ptr<CommandQueue> copyQueue,
+                  uint64_t                      capacity = DefaultCapacity);
+    ~UploadService();
+
+    /**
+     * Copy `size` bytes to `destination` at `offset`. The destination has to
+     * be in the COMMON state, buffers decay back to it after the copy and
+     * are promoted implicitly by the queue reading them.
+     */
+    void UploadBuffer(ID3D12Resource* destination, uint64_t offset, const void* data, uint64_t size);
+
+    /**
+     * Copy subresources [firstSubresource, firstSubresource + count) of a
+     * texture in the COMMON state.
+     */
+    void UploadTexture(ID3D12Resource*               destination,
+                       UINT                          firstSubresource,
+                       UINT                          count,
+                       const D3D12_SUBRESOURCE_DATA* data);
+
+    // Submit the copies recorded so far, without waiting for them.
+    UploadTicket Submit();
+
+    // The GPU wait a submission reading the uploads of `ticket` needs, for
+    // CommandQueue::ExecuteCommandLists.
+    QueueWait GetGpuWait(UploadTicket ticket) const;
+
+    bool IsComplete(UploadTicket ticket) const;
+
+private:
+    /**
+     * Reserve staging space. When the ring is full the pending copies are
+     * submitted and the CPU waits for the oldest submission, the only case
+     * where uploads block.
+     */
+    uint64_t AllocateStaging(uint64_t size, uint64_t alignment);
+
+    ID3D12GraphicsCommandList2* GetCommandList();
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(uint64_t size);
+
+    // Release what completed submissions were reading.
+    void Retire();
+
+private:
+    std::shared_ptr<GpuAllocator> m_Allocator;
+    std::shared_ptr<CommandQueue> m_CopyQueue;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> m_RingBuffer;
+    uint8_t*                               m_RingData = nullptr;
+    UploadRing                             m_Ring;
+
+    // Open until the next Submit.
+    Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList2> m_CommandList;
+
+    // Uploads too large for the ring get an upload buffer of their own,
+    // kept until their submission completes. A fence value of 0 means not
+    // submitted yet.
+    struct LargeUpload
+    {
+        uint64_t                               fenceValue;
+        Microsoft::WRL::ComPtr<ID3D12Resource> buffer;
+    };
+    std::vector<LargeUpload> m_LargeUploads;
+};
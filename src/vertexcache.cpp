@@ -0,0 +1,256 @@
+#include "vertexcache.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+// Scoring parameters from Forsyth's "Linear-Speed Vertex Cache Optimisation".
+constexpr float  kCacheDecayPower   = 1.5f;
+constexpr float  kLastTriangleScore = 0.75f;
+constexpr float  kValenceBoostScale = 2.0f;
+constexpr float  kValenceBoostPower = 0.5f;
+constexpr size_t kValenceTableSize  = 64;
+
+struct ScoreTables
+{
+    float cache[kVertexCacheSize];
+    float valence[kValenceTableSize];
+
+    ScoreTables()
+    {
+        for (size_t i = 0; i < kVertexCacheSize; i++)
+        {
+            // The three vertices of the last triangle get a fixed score, so
+            // the next triangle is not always picked from the same edge.
+            if (i < 3)
+                cache[i] = kLastTriangleScore;
+            else
+                cache[i] = std::pow(1.0f - float(i - 3) / float(kVertexCacheSize - 3), kCacheDecayPower);
+        }
+        valence[0] = 0.0f;
+        for (size_t i = 1; i < kValenceTableSize; i++)
+            valence[i] = kValenceBoostScale * std::pow(float(i), -kValenceBoostPower);
+    }
+};
+
+const ScoreTables& GetScoreTables()
+{
+    static const ScoreTables tables;
+    return tables;
+}
+
+inline float VertexScore(const ScoreTables& tables, int cachePosition, uint32_t remaining)
+{
+    // no triangle left to draw, the vertex is useless.
+    if (remaining == 0)
+        return -1.0f;
+
+    float score = cachePosition < 0 ? 0.0f : tables.cache[cachePosition];
+    if (remaining < kValenceTableSize)
+        score += tables.valence[remaining];
+    else
+        score += kValenceBoostScale * std::pow(float(remaining), -kValenceBoostPower);
+    return score;
+}
+
+} // namespace
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>&    indices,
+                                    const std::vector<MeshSubMesh>& submeshes,
+                                    size_t                          vertexCount,
+                                    size_t                          cacheSize)
+{
+    VertexCacheStats stats;
+
+    // FIFO cache: a vertex is a hit if fewer than `cacheSize` misses happened
+    // since it was inserted. The cache starts cold for every draw.
+    std::vector<int64_t> insertedAt(vertexCount, INT64_MIN / 2);
+    std::vector<uint8_t> referenced(vertexCount, 0);
+    int64_t              misses    = 0;
+    size_t               triangles = 0;
+    size_t               unique    = 0;
+
+    for (const auto& submesh : submeshes)
+    {
+        int64_t drawStart = misses;
+        for (uint32_t i = 0; i < submesh.index_count; i++)
+        {
+            uint32_t v = indices[submesh.index_offset + i];
+            if (insertedAt[v] < drawStart || misses - insertedAt[v] >= (int64_t)cacheSize)
+                insertedAt[v] = misses++;
+
+            unique += referenced[v] == 0;
+            referenced[v] = 1;
+        }
+        triangles += submesh.index_count / 3;
+    }
+
+    stats.acmr = triangles ? float(misses) / float(triangles) : 0.0f;
+    stats.atvr = unique ? float(misses) / float(unique) : 0.0f;
+    return stats;
+}
+
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount)
+{
+    const ScoreTables& tables        = GetScoreTables();
+    const size_t       triangleCount = indexCount / 3;
+    if (triangleCount < 2)
+        return;
+
+    const std::vector<uint32_t> source(indices, indices + triangleCount * 3);
+
+    // Work on compact local vertex ids, the range may only touch a small
+    // part of a large vertex buffer.
+    std::vector<uint32_t> unique(source);
+    std::sort(unique.begin(), unique.end());
+    unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+    const size_t vertexCount = unique.size();
+
+    std::vector<uint32_t> local(source.size());
+    for (size_t i = 0; i < source.size(); i++)
+        local[i] = uint32_t(std::lower_bound(unique.begin(), unique.end(), source[i]) - unique.begin());
+
+    // vertex -> triangles adjacency, the live triangles of a vertex are kept
+    // at the front of its list.
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t v : local)
+        remaining[v]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(local.size());
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < local.size(); i++)
+            adjacency[cursor[local[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<int>   cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = VertexScore(tables, -1, remaining[v]);
+
+    std::vector<float>   triangleScore(triangleCount);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    int64_t              best      = 0;
+    float                bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScore[t] = vertexScore[local[3 * t]] + vertexScore[local[3 * t + 1]] + vertexScore[local[3 * t + 2]];
+        if (triangleScore[t] > bestScore)
+        {
+            bestScore = triangleScore[t];
+            best      = (int64_t)t;
+        }
+    }
+
+    uint32_t cache[kVertexCacheSize + 3];
+    size_t   cacheCount = 0;
+    size_t   scanCursor = 0;
+
+    for (size_t output = 0; output < triangleCount; output++)
+    {
+        // Nothing in the cache is adjacent to a live triangle anymore, take
+        // the next one in input order.
+        if (best < 0)
+        {
+            while (emitted[scanCursor])
+                scanCursor++;
+            best = (int64_t)scanCursor;
+        }
+
+        const size_t    t       = (size_t)best;
+        const uint32_t* corners = &local[3 * t];
+        emitted[t]              = 1;
+        indices[3 * output + 0] = source[3 * t + 0];
+        indices[3 * output + 1] = source[3 * t + 1];
+        indices[3 * output + 2] = source[3 * t + 2];
+
+        // Detach the triangle from its vertices.
+        for (int c = 0; c < 3; c++)
+        {
+            uint32_t  v     = corners[c];
+            uint32_t* begin = &adjacency[offsets[v]];
+            uint32_t* end   = begin + remaining[v];
+            uint32_t* it    = std::find(begin, end, uint32_t(t));
+            std::swap(*it, end[-1]);
+            remaining[v]--;
+        }
+
+        // The triangle's vertices move to the front of the LRU cache.
+        uint32_t newCache[kVertexCacheSize + 3];
+        size_t   newCount = 0;
+        for (int c = 0; c < 3; c++)
+            newCache[newCount++] = corners[c];
+        for (size_t i = 0; i < cacheCount; i++)
+        {
+            uint32_t v = cache[i];
+            if (v != corners[0] && v != corners[1] && v != corners[2])
+                newCache[newCount++] = v;
+        }
+
+        for (size_t i = 0; i < newCount; i++)
+        {
+            uint32_t v       = newCache[i];
+            int      pos     = i < kVertexCacheSize ? int(i) : -1;
+            cachePosition[v] = pos;
+            vertexScore[v]   = VertexScore(tables, pos, remaining[v]);
+        }
+
+        // Only the triangles around the touched vertices changed score.
+        best      = -1;
+        bestScore = -1.0f;
+        for (size_t i = 0; i < newCount; i++)
+        {
+            uint32_t v = newCache[i];
+            for (uint32_t a = offsets[v]; a < offsets[v] + remaining[v]; a++)
+            {
+                uint32_t        adjacent = adjacency[a];
+                const uint32_t* tc       = &local[3 * adjacent];
+                float           score    = vertexScore[tc[0]] + vertexScore[tc[1]] + vertexScore[tc[2]];
+                triangleScore[adjacent]  = score;
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best      = adjacent;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCount, kVertexCacheSize);
+        std::copy(newCache, newCache + cacheCount, cache);
+    }
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, const std::vector<MeshSubMesh>& submeshes)
+{
+    ParallelFor(submeshes.size(), [&](size_t s) {
+        OptimizeVertexCache(indices.data() + submeshes[s].index_offset, submeshes[s].index_count);
+    });
+}
+
+size_t OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices)
+{
+    std::vector<uint32_t>   remap(vertices.size(), UINT32_MAX);
+    std::vector<MeshVertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices)
+    {
+        if (remap[index] == UINT32_MAX)
+        {
+            remap[index] = (uint32_t)reordered.size();
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+
+    size_t dropped = vertices.size() - reordered.size();
+    vertices.swap(reordered);
+    return dropped;
+}
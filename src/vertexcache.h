@@ -0,0 +1,52 @@
+/**
+ * Post-transform vertex cache and vertex fetch optimization.
+ *
+ * OptimizeVertexCache reorders the triangles of an index range with Tom
+ * Forsyth's linear-speed algorithm, so consecutive triangles reuse recently
+ * shaded vertices. OptimizeVertexFetch then renumbers the vertices in the
+ * order they are first referenced, so the vertex fetches walk the vertex
+ * buffer mostly linearly.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Cache size the optimizer targets and the statistics are measured with.
+constexpr size_t kVertexCacheSize = 32;
+
+struct VertexCacheStats
+{
+    // Average cache miss ratio: shaded vertices per triangle, 0.5 to 3.
+    float acmr = 0.0f;
+    // Average transform to vertex ratio: shaded vertices per unique vertex,
+    // 1 is optimal.
+    float atvr = 0.0f;
+};
+
+/**
+ * Simulate a FIFO post-transform cache of `cacheSize` entries over every
+ * submesh range of `indices`.
+ */
+VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>&    indices,
+                                    const std::vector<MeshSubMesh>& submeshes,
+                                    size_t                          vertexCount,
+                                    size_t                          cacheSize = kVertexCacheSize);
+
+/**
+ * Reorder the triangles of indices[0, indexCount) for the post-transform
+ * cache. Indices are not renumbered.
+ */
+void OptimizeVertexCache(uint32_t* indices, size_t indexCount);
+
+// Optimize every submesh range of `indices`, the submeshes run in parallel.
+void OptimizeVertexCache(std::vector<uint32_t>& indices, const std::vector<MeshSubMesh>& submeshes);
+
+/**
+ * Renumber the vertices in first-use order and drop the unreferenced ones.
+ * @returns The number of vertices dropped.
+ */
+size_t OptimizeVertexFetch(std::vector<MeshVertex>& vertices, std::vector<uint32_t>& indices);
@@ -0,0 +1,510 @@
+#include "vertexformat.h"
+#include "parallel.h"
+#include "simd.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+const VertexAttribute PackedVertex<false>::kLayout[2] = {
+    { "POSITION", VERTEX_ATTRIBUTE_UNORM16X4, offsetof(PackedVertexNoUV, position) },
+    { "NORMAL", VERTEX_ATTRIBUTE_SNORM16X2, offsetof(PackedVertexNoUV, normal) },
+};
+
+const VertexAttribute PackedVertex<true>::kLayout[3] = {
+    { "POSITION", VERTEX_ATTRIBUTE_UNORM16X4, offsetof(PackedVertexUV, position) },
+    { "NORMAL", VERTEX_ATTRIBUTE_SNORM16X2, offsetof(PackedVertexUV, normal) },
+    { "TEXCOORD", VERTEX_ATTRIBUTE_FLOAT16X2, offsetof(PackedVertexUV, texcoord) },
+};
+
+namespace
+{
+
+constexpr float kUnorm16Max = 65535.0f;
+constexpr float kSnorm16Max = 32767.0f;
+
+inline uint32_t FloatBits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+inline float BitsFloat(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+// Round to nearest even, like cvtps2dq with the default rounding mode.
+inline int32_t RoundToInt(float f)
+{
+    return (int32_t)std::nearbyint(f);
+}
+
+inline float SignNotZero(float f)
+{
+    return std::copysign(1.0f, f);
+}
+
+// Grid parameters shared by the position kernels. w is zero, so the padding
+// lane always encodes to 0.
+struct PositionGrid
+{
+    float offset[4];
+    float invStep[4]; // quantized units per object space unit
+    float step[4];    // object space units per quantized unit
+
+    explicit PositionGrid(const VertexQuantization& q)
+    {
+        for (int c = 0; c < 4; c++)
+        {
+            offset[c]  = c < 3 ? q.offset[c] : 0.0f;
+            invStep[c] = c < 3 && q.scale[c] > 0.0f ? kUnorm16Max / q.scale[c] : 0.0f;
+            step[c]    = c < 3 ? q.scale[c] / kUnorm16Max : 0.0f;
+        }
+    }
+};
+
+inline void QuantizePosition(const MeshVertex& v, const PositionGrid& grid, uint16_t* out)
+{
+    for (int c = 0; c < 4; c++)
+    {
+        float p = c < 3 ? v.position[c] : 0.0f;
+        float t = (p - grid.offset[c]) * grid.invStep[c];
+        // written like maxps/minps, NaN encodes to 0.
+        t = t > 0.0f ? t : 0.0f;
+        t = t < kUnorm16Max ? t : kUnorm16Max;
+        out[c] = (uint16_t)RoundToInt(t);
+    }
+}
+
+inline void DequantizePosition(const uint16_t* in, const PositionGrid& grid, MeshVertex& v)
+{
+    for (int c = 0; c < 3; c++)
+        v.position[c] = float(in[c]) * grid.step[c] + grid.offset[c];
+}
+
+// Octahedral mapping of a unit vector, see "A Survey of Efficient
+// Representations for Independent Unit Vectors" (Cigolle et al.).
+inline void EncodeNormal(const glm::vec3& n, int16_t* out)
+{
+    float sum = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    float inv = 1.0f / (sum > std::numeric_limits<float>::min() ? sum : std::numeric_limits<float>::min());
+    float x   = n.x * inv;
+    float y   = n.y * inv;
+    float z   = n.z * inv;
+    if (z < 0.0f)
+    {
+        float fx = (1.0f - std::fabs(y)) * SignNotZero(x);
+        float fy = (1.0f - std::fabs(x)) * SignNotZero(y);
+        x        = fx;
+        y        = fy;
+    }
+    float qx = x * kSnorm16Max;
+    float qy = y * kSnorm16Max;
+    out[0]   = (int16_t)std::min(RoundToInt(qx > -kSnorm16Max ? qx : -kSnorm16Max), 32767);
+    out[1]   = (int16_t)std::min(RoundToInt(qy > -kSnorm16Max ? qy : -kSnorm16Max), 32767);
+}
+
+inline glm::vec3 DecodeNormal(const int16_t* in)
+{
+    float x = std::max(float(in[0]) / kSnorm16Max, -1.0f);
+    float y = std::max(float(in[1]) / kSnorm16Max, -1.0f);
+    float z = 1.0f - std::fabs(x) - std::fabs(y);
+    float t = std::max(-z, 0.0f);
+    x -= SignNotZero(x) * t;
+    y -= SignNotZero(y) * t;
+    float inv = 1.0f / std::sqrt(x * x + y * y + z * z);
+    return glm::vec3(x * inv, y * inv, z * inv);
+}
+
+#if PETIT_SIMD_SSE2
+
+const __m128 kSignMask = _mm_set1_ps(-0.0f);
+
+inline __m128 AbsPS(__m128 v)
+{
+    return _mm_andnot_ps(kSignMask, v);
+}
+
+inline __m128 SignNotZeroPS(__m128 v)
+{
+    return _mm_or_ps(_mm_and_ps(v, kSignMask), _mm_set1_ps(1.0f));
+}
+
+inline __m128 SelectPS(__m128 mask, __m128 a, __m128 b)
+{
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+inline __m128i SelectSI(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+inline void Store32(void* dst, __m128i v)
+{
+    int32_t value = _mm_cvtsi128_si32(v);
+    memcpy(dst, &value, sizeof(value));
+}
+
+// Four floats to four halfs in the low 16 bits of every lane, round to
+// nearest even (Fabian Giesen's float_to_half_SSE2).
+inline __m128i FloatToHalfSSE2(__m128 f)
+{
+    const __m128i kF32Infinity  = _mm_set1_epi32(255 << 23);
+    const __m128i kF16Max       = _mm_set1_epi32((127 + 16) << 23);
+    const __m128i kNaNBit       = _mm_set1_epi32(0x200);
+    const __m128i kF16Infinity  = _mm_set1_epi32(0x7c00);
+    const __m128i kMinNormal    = _mm_set1_epi32((127 - 14) << 23);
+    const __m128i kSubnormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i kNormalBias   = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+    __m128  sign      = _mm_and_ps(f, kSignMask);
+    __m128  absf      = _mm_xor_ps(f, sign);
+    __m128i absBits   = _mm_castps_si128(absf);
+    __m128i isNaN     = _mm_cmpgt_epi32(absBits, kF32Infinity);
+    __m128i isRegular = _mm_cmpgt_epi32(kF16Max, absBits);
+    __m128i infOrNaN  = _mm_or_si128(_mm_and_si128(isNaN, kNaNBit), kF16Infinity);
+    __m128i isSubnorm = _mm_cmpgt_epi32(kMinNormal, absBits);
+
+    // Subnormal results: let the FPU round the mantissa with a magic add.
+    __m128  subnorm1 = _mm_add_ps(absf, _mm_castsi128_ps(kSubnormMagic));
+    __m128i subnorm  = _mm_sub_epi32(_mm_castps_si128(subnorm1), kSubnormMagic);
+
+    // Normal results: rebias the exponent and round the mantissa.
+    __m128i mantOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+    __m128i rounded = _mm_sub_epi32(_mm_add_epi32(absBits, kNormalBias), mantOdd);
+    __m128i normal  = _mm_srli_epi32(rounded, 13);
+
+    __m128i finite = SelectSI(isSubnorm, subnorm, normal);
+    __m128i joined = SelectSI(isRegular, finite, infOrNaN);
+    return _mm_or_si128(joined, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+}
+
+// Four halfs in the low 16 bits of every lane to floats.
+inline __m128 HalfToFloatSSE2(__m128i h)
+{
+    const __m128i kNoSign    = _mm_set1_epi32(0x7fff);
+    const __m128  kMagic     = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+    const __m128i kWasInfNaN = _mm_set1_epi32(0x7bff);
+    const __m128  kInfNaNExp = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+    __m128i expMant   = _mm_and_si128(h, kNoSign);
+    __m128i sign      = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+    __m128  scaled    = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)), kMagic);
+    __m128  infNaNExp = _mm_and_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(expMant, kWasInfNaN)), kInfNaNExp);
+    return _mm_or_ps(scaled, _mm_or_ps(_mm_castsi128_ps(sign), infNaNExp));
+}
+
+#endif // PETIT_SIMD_SSE2
+
+} // namespace
+
+uint16_t FloatToHalf(float value)
+{
+    const uint32_t kF32Infinity  = 255u << 23;
+    const uint32_t kF16Max       = (127u + 16u) << 23;
+    const uint32_t kMinNormal    = (127u - 14u) << 23;
+    const float    kSubnormMagic = BitsFloat(((127u - 15u) + (23u - 10u) + 1u) << 23);
+
+    uint32_t bits = FloatBits(value);
+    uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= kF16Max)
+        half = bits > kF32Infinity ? 0x7e00 : 0x7c00;
+    else if (bits < kMinNormal)
+        half = (uint16_t)(FloatBits(BitsFloat(bits) + kSubnormMagic) - FloatBits(kSubnormMagic));
+    else
+    {
+        uint32_t mantOdd = (bits >> 13) & 1;
+        bits += 0xfffu - ((127u - 15u) << 23) + mantOdd;
+        half = (uint16_t)(bits >> 13);
+    }
+    return half | (uint16_t)(sign >> 16);
+}
+
+float HalfToFloat(uint16_t value)
+{
+    const uint32_t kShiftedExp = 0x7c00u << 13;
+    const float    kMagic      = BitsFloat(113u << 23);
+
+    uint32_t bits = (uint32_t)(value & 0x7fff) << 13;
+    uint32_t exp  = bits & kShiftedExp;
+    bits += (127u - 15u) << 23;
+    if (exp == kShiftedExp)
+        bits += (128u - 16u) << 23; // Inf/NaN
+    else if (exp == 0)
+        bits = FloatBits(BitsFloat(bits + (1u << 23)) - kMagic); // zero/subnormal
+    return BitsFloat(bits | (uint32_t)(value & 0x8000) << 16);
+}
+
+VertexQuantization VertexQuantization::FromBounds(const glm::vec3& min, const glm::vec3& max)
+{
+    VertexQuantization q;
+    q.offset = glm::vec4(min, 0.0f);
+    q.scale  = glm::vec4(glm::max(max - min, glm::vec3(0.0f)), 0.0f);
+    return q;
+}
+
+VertexQuantization VertexQuantization::FromVertices(const MeshVertex* vertices, size_t count)
+{
+    if (count == 0)
+        return FromBounds(glm::vec3(0.0f), glm::vec3(0.0f));
+
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (size_t i = 1; i < count; i++)
+    {
+        min = glm::min(min, vertices[i].position);
+        max = glm::max(max, vertices[i].position);
+    }
+    return FromBounds(min, max);
+}
+
+bool HasTexcoords(ArrayView<MeshVertex> vertices)
+{
+    for (const auto& vertex : vertices)
+        if (vertex.texcoord.z >= 0.0f)
+            return true;
+    return false;
+}
+
+void QuantizePositions(const MeshVertex* in, size_t count, const VertexQuantization& q, uint16_t* out, size_t stride)
+{
+    const PositionGrid grid(q);
+    char*              dst = reinterpret_cast<char*>(out);
+    size_t             i   = 0;
+
+#if PETIT_SIMD_SSE2
+    // One vertex per iteration, xyz and the padding lane at once. The load
+    // reads normal.x into w, which the zero invStep discards.
+    const __m128  offset  = _mm_loadu_ps(grid.offset);
+    const __m128  invStep = _mm_loadu_ps(grid.invStep);
+    const __m128  zero    = _mm_setzero_ps();
+    const __m128  maxq    = _mm_set1_ps(kUnorm16Max);
+    const __m128i bias    = _mm_set1_epi32(32768);
+    const __m128i flip    = _mm_set1_epi16((short)0x8000);
+    for (; i < count; i++)
+    {
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&in[i].position.x), offset), invStep);
+        // max() returns its second operand for NaN, so NaN encodes to 0.
+        t         = _mm_min_ps(_mm_max_ps(t, zero), maxq);
+        __m128i u = _mm_sub_epi32(_mm_cvtps_epi32(t), bias);
+        u         = _mm_xor_si128(_mm_packs_epi32(u, u), flip);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i * stride), u);
+    }
+#endif
+    for (; i < count; i++)
+        QuantizePosition(in[i], grid, reinterpret_cast<uint16_t*>(dst + i * stride));
+}
+
+void EncodeNormals(const MeshVertex* in, size_t count, int16_t* out, size_t stride)
+{
+    char*  dst = reinterpret_cast<char*>(out);
+    size_t i   = 0;
+
+#if PETIT_SIMD_SSE2
+    const __m128 one    = _mm_set1_ps(1.0f);
+    const __m128 tiny   = _mm_set1_ps(std::numeric_limits<float>::min());
+    const __m128 snorm  = _mm_set1_ps(kSnorm16Max);
+    const __m128 lowest = _mm_set1_ps(-kSnorm16Max);
+    for (; i + 4 <= count; i += 4)
+    {
+        const MeshVertex* v = in + i;
+        __m128 x = _mm_setr_ps(v[0].normal.x, v[1].normal.x, v[2].normal.x, v[3].normal.x);
+        __m128 y = _mm_setr_ps(v[0].normal.y, v[1].normal.y, v[2].normal.y, v[3].normal.y);
+        __m128 z = _mm_setr_ps(v[0].normal.z, v[1].normal.z, v[2].normal.z, v[3].normal.z);
+
+        __m128 inv = _mm_div_ps(one, _mm_max_ps(_mm_add_ps(_mm_add_ps(AbsPS(x), AbsPS(y)), AbsPS(z)), tiny));
+        x          = _mm_mul_ps(x, inv);
+        y          = _mm_mul_ps(y, inv);
+        z          = _mm_mul_ps(z, inv);
+
+        __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+        __m128 fx    = _mm_mul_ps(_mm_sub_ps(one, AbsPS(y)), SignNotZeroPS(x));
+        __m128 fy    = _mm_mul_ps(_mm_sub_ps(one, AbsPS(x)), SignNotZeroPS(y));
+        x            = SelectPS(lower, fx, x);
+        y            = SelectPS(lower, fy, y);
+
+        __m128i qx = _mm_cvtps_epi32(_mm_max_ps(_mm_mul_ps(x, snorm), lowest));
+        __m128i qy = _mm_cvtps_epi32(_mm_max_ps(_mm_mul_ps(y, snorm), lowest));
+        // x0 y0 x1 y1 x2 y2 x3 y3, saturated to int16.
+        __m128i packed = _mm_packs_epi32(_mm_unpacklo_epi32(qx, qy), _mm_unpackhi_epi32(qx, qy));
+        for (int k = 0; k < 4; k++)
+        {
+            Store32(dst + (i + k) * stride, packed);
+            packed = _mm_srli_si128(packed, 4);
+        }
+    }
+#endif
+    for (; i < count; i++)
+        EncodeNormal(in[i].normal, reinterpret_cast<int16_t*>(dst + i * stride));
+}
+
+void EncodeTexcoords(const MeshVertex* in, size_t count, uint16_t* out, size_t stride)
+{
+    char*  dst = reinterpret_cast<char*>(out);
+    size_t i   = 0;
+
+#if PETIT_SIMD_SSE2
+    for (; i + 2 <= count; i += 2)
+    {
+        __m128  uv   = _mm_setr_ps(in[i].texcoord.x, in[i].texcoord.y, in[i + 1].texcoord.x, in[i + 1].texcoord.y);
+        __m128i half = FloatToHalfSSE2(uv);
+        // Sign extend so the signed saturating pack keeps the bits.
+        half = _mm_srai_epi32(_mm_slli_epi32(half, 16), 16);
+        half = _mm_packs_epi32(half, half);
+        Store32(dst + i * stride, half);
+        Store32(dst + (i + 1) * stride, _mm_srli_si128(half, 4));
+    }
+#endif
+    for (; i < count; i++)
+    {
+        uint16_t* uv = reinterpret_cast<uint16_t*>(dst + i * stride);
+        uv[0]        = FloatToHalf(in[i].texcoord.x);
+        uv[1]        = FloatToHalf(in[i].texcoord.y);
+    }
+}
+
+void DequantizePositions(const uint16_t* in, size_t stride, size_t count, const VertexQuantization& q, MeshVertex* out)
+{
+    const PositionGrid grid(q);
+    const char*        src = reinterpret_cast<const char*>(in);
+    size_t             i   = 0;
+
+#if PETIT_SIMD_SSE2
+    const __m128  offset = _mm_loadu_ps(grid.offset);
+    const __m128  step   = _mm_loadu_ps(grid.step);
+    const __m128i zero   = _mm_setzero_si128();
+    for (; i < count; i++)
+    {
+        __m128i u = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src + i * stride)), zero);
+        __m128  p = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(u), step), offset);
+        float   position[4];
+        _mm_storeu_ps(position, p);
+        out[i].position = glm::vec3(position[0], position[1], position[2]);
+    }
+#endif
+    for (; i < count; i++)
+        DequantizePosition(reinterpret_cast<const uint16_t*>(src + i * stride), grid, out[i]);
+}
+
+void DecodeNormals(const int16_t* in, size_t stride, size_t count, MeshVertex* out)
+{
+    const char* src = reinterpret_cast<const char*>(in);
+    size_t      i   = 0;
+
+#if PETIT_SIMD_SSE2
+    const __m128 one      = _mm_set1_ps(1.0f);
+    const __m128 snorm    = _mm_set1_ps(kSnorm16Max);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        int32_t ex[4], ey[4];
+        for (int k = 0; k < 4; k++)
+        {
+            const int16_t* e = reinterpret_cast<const int16_t*>(src + (i + k) * stride);
+            ex[k]            = e[0];
+            ey[k]            = e[1];
+        }
+        // Divide like the scalar path, a reciprocal multiply rounds differently.
+        __m128 x = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ex)));
+        __m128 y = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ey)));
+        x        = _mm_max_ps(_mm_div_ps(x, snorm), minusOne);
+        y        = _mm_max_ps(_mm_div_ps(y, snorm), minusOne);
+        __m128 z = _mm_sub_ps(_mm_sub_ps(one, AbsPS(x)), AbsPS(y));
+        __m128 t = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+        x        = _mm_sub_ps(x, _mm_mul_ps(SignNotZeroPS(x), t));
+        y        = _mm_sub_ps(y, _mm_mul_ps(SignNotZeroPS(y), t));
+
+        __m128 inv = _mm_div_ps(one, _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+        float  nx[4], ny[4], nz[4];
+        _mm_storeu_ps(nx, _mm_mul_ps(x, inv));
+        _mm_storeu_ps(ny, _mm_mul_ps(y, inv));
+        _mm_storeu_ps(nz, _mm_mul_ps(z, inv));
+        for (int k = 0; k < 4; k++)
+            out[i + k].normal = glm::vec3(nx[k], ny[k], nz[k]);
+    }
+#endif
+    for (; i < count; i++)
+        out[i].normal = DecodeNormal(reinterpret_cast<const int16_t*>(src + i * stride));
+}
+
+void DecodeTexcoords(const uint16_t* in, size_t stride, size_t count, MeshVertex* out)
+{
+    const char* src = reinterpret_cast<const char*>(in);
+    size_t      i   = 0;
+
+#if PETIT_SIMD_SSE2
+    for (; i + 2 <= count; i += 2)
+    {
+        const uint16_t* a  = reinterpret_cast<const uint16_t*>(src + i * stride);
+        const uint16_t* b  = reinterpret_cast<const uint16_t*>(src + (i + 1) * stride);
+        __m128          uv = HalfToFloatSSE2(_mm_setr_epi32(a[0], a[1], b[0], b[1]));
+        float           f[4];
+        _mm_storeu_ps(f, uv);
+        out[i].texcoord     = glm::vec3(f[0], f[1], 0.0f);
+        out[i + 1].texcoord = glm::vec3(f[2], f[3], 0.0f);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        const uint16_t* uv = reinterpret_cast<const uint16_t*>(src + i * stride);
+        out[i].texcoord    = glm::vec3(HalfToFloat(uv[0]), HalfToFloat(uv[1]), 0.0f);
+    }
+}
+
+template <typename Format>
+std::vector<Format> PackVertices(const MeshView& mesh, std::vector<VertexQuantization>& quantization)
+{
+    std::vector<Format> packed(mesh.vertices.size());
+    quantization.resize(mesh.submeshes.size());
+    ParallelFor(mesh.submeshes.size(), [&](size_t s) {
+        const MeshSubMesh& submesh  = mesh.submeshes[s];
+        const MeshVertex*  vertices = mesh.vertices.data + submesh.vertex_offset;
+        quantization[s]             = VertexQuantization::FromVertices(vertices, submesh.vertex_count);
+        EncodeVertices(vertices, submesh.vertex_count, quantization[s], packed.data() + submesh.vertex_offset);
+    });
+    return packed;
+}
+
+template std::vector<PackedVertexNoUV> PackVertices<PackedVertexNoUV>(const MeshView&, std::vector<VertexQuantization>&);
+template std::vector<PackedVertexUV>   PackVertices<PackedVertexUV>(const MeshView&, std::vector<VertexQuantization>&);
+
+size_t SplitVerticesBySubMesh(std::vector<MeshVertex>&  vertices,
+                              std::vector<uint32_t>&    indices,
+                              std::vector<MeshSubMesh>& submeshes)
+{
+    std::vector<MeshVertex> split;
+    split.reserve(vertices.size());
+    // New index of every vertex, entries below the current submesh's
+    // vertex_offset belong to an earlier submesh.
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    size_t                added = 0;
+
+    for (auto& submesh : submeshes)
+    {
+        submesh.vertex_offset = (uint32_t)split.size();
+        for (uint32_t i = submesh.index_offset; i < submesh.index_offset + submesh.index_count; i++)
+        {
+            uint32_t& index = remap[indices[i]];
+            if (index == UINT32_MAX || index < submesh.vertex_offset)
+            {
+                added += index != UINT32_MAX;
+                index = (uint32_t)split.size();
+                split.push_back(vertices[indices[i]]);
+            }
+            indices[i] = index;
+        }
+        submesh.vertex_count = (uint32_t)split.size() - submesh.vertex_offset;
+    }
+
+    vertices.swap(split);
+    return added;
+}
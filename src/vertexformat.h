@@ -0,0 +1,160 @@
+/**
+ * Packed vertex formats.
+ *
+ * MeshVertex is 36 bytes of floats, which is convenient for the mesh
+ * processing passes but wasteful on the GPU. The packed formats store:
+ *
+ *  - the position as unorm16, relative to the bounding box of its submesh,
+ *  - the normal as snorm16 octahedral coordinates,
+ *  - the texcoord as two halfs, or nothing at all when the mesh has none.
+ *
+ * Every format is a PackedVertex<> instantiation with its attribute layout,
+ * so the encoder and the input layout are chosen at compile time. The layout
+ * is API agnostic, the renderer maps it to its own input element type.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum VertexAttributeFormat : uint32_t
+{
+    VERTEX_ATTRIBUTE_UNORM16X4 = 0,
+    VERTEX_ATTRIBUTE_SNORM16X2,
+    VERTEX_ATTRIBUTE_FLOAT16X2,
+};
+
+struct VertexAttribute
+{
+    const char*           semantic;
+    VertexAttributeFormat format;
+    uint32_t              offset;
+};
+
+// A packed vertex format, see PackedVertex<>.
+struct VertexFormat
+{
+    uint32_t               stride;
+    const VertexAttribute* attributes;
+    uint32_t               attributeCount;
+};
+
+/**
+ * Maps the unorm16 positions of a submesh back to object space, on the GPU
+ * the vertex shader computes `offset + position * scale`. Laid out for a
+ * root constant.
+ */
+struct VertexQuantization
+{
+    glm::vec4 offset = glm::vec4(0.0f);
+    glm::vec4 scale  = glm::vec4(1.0f);
+
+    // Quantization grid covering [min, max].
+    static VertexQuantization FromBounds(const glm::vec3& min, const glm::vec3& max);
+    // Quantization grid covering `count` vertices.
+    static VertexQuantization FromVertices(const MeshVertex* vertices, size_t count);
+};
+
+template <bool kTexcoord>
+struct PackedVertex;
+
+template <>
+struct PackedVertex<false>
+{
+    static constexpr bool kHasTexcoord = false;
+
+    uint16_t position[4]; // unorm16, w is unused
+    int16_t  normal[2];   // snorm16 octahedral
+
+    static const VertexAttribute kLayout[2];
+};
+
+template <>
+struct PackedVertex<true>
+{
+    static constexpr bool kHasTexcoord = true;
+
+    uint16_t position[4]; // unorm16, w is unused
+    int16_t  normal[2];   // snorm16 octahedral
+    uint16_t texcoord[2]; // half
+
+    static const VertexAttribute kLayout[3];
+};
+
+using PackedVertexNoUV = PackedVertex<false>;
+using PackedVertexUV   = PackedVertex<true>;
+
+static_assert(sizeof(PackedVertexNoUV) == 12, "unexpected padding in PackedVertexNoUV");
+static_assert(sizeof(PackedVertexUV) == 16, "unexpected padding in PackedVertexUV");
+
+template <typename Format>
+VertexFormat GetVertexFormat()
+{
+    return { sizeof(Format), Format::kLayout, uint32_t(sizeof(Format::kLayout) / sizeof(VertexAttribute)) };
+}
+
+// True if any vertex has a texcoord, the loader marks missing ones with -1.
+bool HasTexcoords(ArrayView<MeshVertex> vertices);
+
+/**
+ * Attribute kernels, SSE2 where available. They read `count` MeshVertex and
+ * write one attribute into a strided array of packed vertices, `stride` is
+ * in bytes.
+ */
+void QuantizePositions(const MeshVertex* in, size_t count, const VertexQuantization& q, uint16_t* out, size_t stride);
+void EncodeNormals(const MeshVertex* in, size_t count, int16_t* out, size_t stride);
+void EncodeTexcoords(const MeshVertex* in, size_t count, uint16_t* out, size_t stride);
+
+// Inverse of the kernels above, writing into the same MeshVertex fields.
+void DequantizePositions(const uint16_t* in, size_t stride, size_t count, const VertexQuantization& q, MeshVertex* out);
+void DecodeNormals(const int16_t* in, size_t stride, size_t count, MeshVertex* out);
+void DecodeTexcoords(const uint16_t* in, size_t stride, size_t count, MeshVertex* out);
+
+// Scalar conversions, round to nearest even. They match the SIMD kernels.
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t value);
+
+template <typename Format>
+void EncodeVertices(const MeshVertex* in, size_t count, const VertexQuantization& q, Format* out)
+{
+    // Offset from the array rather than taking out->normal, the kernels walk
+    // past the first vertex and gcc would bound them by the member's size.
+    char* base = reinterpret_cast<char*>(out);
+    QuantizePositions(in, count, q, reinterpret_cast<uint16_t*>(base + offsetof(Format, position)), sizeof(Format));
+    EncodeNormals(in, count, reinterpret_cast<int16_t*>(base + offsetof(Format, normal)), sizeof(Format));
+    if constexpr (Format::kHasTexcoord)
+        EncodeTexcoords(in, count, reinterpret_cast<uint16_t*>(base + offsetof(Format, texcoord)), sizeof(Format));
+}
+
+template <typename Format>
+void DecodeVertices(const Format* in, size_t count, const VertexQuantization& q, MeshVertex* out)
+{
+    DequantizePositions(in->position, sizeof(Format), count, q, out);
+    DecodeNormals(in->normal, sizeof(Format), count, out);
+    if constexpr (Format::kHasTexcoord)
+        DecodeTexcoords(in->texcoord, sizeof(Format), count, out);
+    else
+        for (size_t i = 0; i < count; i++)
+            out[i].texcoord = glm::vec3(-1.0f);
+}
+
+/**
+ * Encode the vertex range of every submesh with its own quantization grid,
+ * `quantization` gets one entry per submesh.
+ */
+template <typename Format>
+std::vector<Format> PackVertices(const MeshView& mesh, std::vector<VertexQuantization>& quantization);
+
+/**
+ * Give every submesh its own contiguous vertex range, duplicating the
+ * vertices shared between submeshes, so each one can be quantized against
+ * its own bounds. Sets MeshSubMesh::vertex_offset and vertex_count and keeps
+ * the first-use order inside every range.
+ * @returns The number of vertices added.
+ */
+size_t SplitVerticesBySubMesh(std::vector<MeshVertex>&  vertices,
+                              std::vector<uint32_t>&    indices,
+                              std::vector<MeshSubMesh>& submeshes);
@@ -4,6 +4,7 @@
 #include "SDL_video.h"
 #include "application.h"
 #include "commandqueue.h"
+#include "descriptorallocator.h"
 #include "d3dx12.h"
 #include "helpers.h"
 #include <algorithm>
@@ -11,8 +12,8 @@
 
 using namespace Microsoft::WRL;
 
-Window::Window(const std::string& windowName, int clientWidth, int clientHeight, bool vSync) :
-    m_WindowName(windowName), m_VSync(vSync), m_FrameCounter(0)
+Window::Window(const std::string& windowName, int clientWidth, int clientHeight, bool vSync, bool lowLatency) :
+    m_WindowName(windowName), m_VSync(vSync), m_LowLatency(lowLatency), m_FrameCounter(0)
 {
     Application& app = Application::Get();
 
@@ -20,9 +21,10 @@ Window::Window(const std::string& windowName, int clientWidth, int clientHeight,
 
     m_IsTearingSupported = app.IsTearingSupported();
 
-    m_dxgiSwapChain          = CreateSwapChain();
-    m_d3d12RTVDescriptorHeap = app.CreateDescriptorHeap(BufferCount, D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
-    m_RTVDescriptorSize      = app.GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    m_dxgiSwapChain = CreateSwapChain();
+    auto rtvs       = app.GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    for (int i = 0; i < BufferCount; ++i)
+        m_RenderTargetViews[i] = rtvs->Allocate();
 
     UpdateRenderTargetViews();
 }
@@ -31,6 +33,12 @@ Window::~Window()
 {
     // Window should be destroyed with Application::DestroyWindow before
     // the window goes out of scope.
+    if (m_FrameLatencyWaitable)
+        ::CloseHandle(m_FrameLatencyWaitable);
+    // Only read when recording, the command lists using them are closed.
+    auto rtvs = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
+    for (int i = 0; i < BufferCount; ++i)
+        rtvs->Free(m_RenderTargetViews[i]);
     SDL_DestroyWindow(m_window);
 
     // assert(!m_hWnd && "Use Application::DestroyWindow before destruction.");
@@ -74,6 +82,17 @@ void Window::SetVSync(bool vSync) { m_VSync = vSync; }
 
 void Window::ToggleVSync() { SetVSync(!m_VSync); }
 
+bool Window::IsLowLatency() const { return m_LowLatency; }
+
+void Window::WaitForFrameLatency()
+{
+    // Bounded, a lost device would block forever.
+    if (m_FrameLatencyWaitable)
+        ::WaitForSingleObjectEx(m_FrameLatencyWaitable, 1000, TRUE);
+}
+
+const PresentCounters& Window::GetPresentCounters() const { return m_PresentPacer.GetCounters(); }
+
 void Window::OnWindowEvent(const SDL_WindowEvent* event)
 {
     if (event->event == SDL_WINDOWEVENT_RESIZED)
@@ -91,7 +110,10 @@ void Window::OnResize(int w, int h)
         window_size.first  = std::max(1, w);
         window_size.second = std::max(1, h);
 
-        Application::Get().Flush();
+        // Only the DIRECT queue uses the back buffers, wait for what it has
+        // in flight rather than flushing every queue.
+        auto directQueue = Application::Get().GetCommandQueue(D3D12_COMMAND_LIST_TYPE_DIRECT);
+        directQueue->WaitForFenceValue(directQueue->GetLastFenceValue());
 
         for (int i = 0; i < BufferCount; ++i)
         {
@@ -139,7 +161,9 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain()
     swapChainDesc.AlphaMode             = DXGI_ALPHA_MODE_UNSPECIFIED;
     // It is recommended to always allow tearing if tearing support is
     // available.
-    swapChainDesc.Flags               = m_IsTearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+    swapChainDesc.Flags = m_IsTearingSupported ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0;
+    if (m_LowLatency)
+        swapChainDesc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
     ID3D12CommandQueue* pCommandQueue = app.GetCommandQueue()->GetD3D12CommandQueue().Get();
 
     ComPtr<IDXGISwapChain1> swapChain1;
@@ -153,6 +177,13 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain()
 
     ThrowIfFailed(swapChain1.As(&dxgiSwapChain4));
 
+    // ResizeBuffers keeps the flags, the waitable object stays valid.
+    if (m_LowLatency)
+    {
+        ThrowIfFailed(dxgiSwapChain4->SetMaximumFrameLatency(m_PresentPacer.GetFrameLatency()));
+        m_FrameLatencyWaitable = dxgiSwapChain4->GetFrameLatencyWaitableObject();
+    }
+
     m_CurrentBackBufferIndex = dxgiSwapChain4->GetCurrentBackBufferIndex();
 
     return dxgiSwapChain4;
@@ -162,29 +193,24 @@ Microsoft::WRL::ComPtr<IDXGISwapChain4> Window::CreateSwapChain()
 void Window::UpdateRenderTargetViews()
 {
     auto device = Application::Get().GetDevice();
-
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHandle(
-        m_d3d12RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
+    auto rtvs   = Application::Get().GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
     for (int i = 0; i < BufferCount; ++i)
     {
         ComPtr<ID3D12Resource> backBuffer;
         ThrowIfFailed(m_dxgiSwapChain->GetBuffer(i, IID_PPV_ARGS(&backBuffer)));
 
-        device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvHandle);
+        device->CreateRenderTargetView(backBuffer.Get(), nullptr, rtvs->GetCpuHandle(m_RenderTargetViews[i]));
 
         m_d3d12BackBuffers[i] = backBuffer;
-
-        rtvHandle.Offset(m_RTVDescriptorSize);
     }
 }
 
 D3D12_CPU_DESCRIPTOR_HANDLE Window::GetCurrentRenderTargetView() const
 {
-    return CD3DX12_CPU_DESCRIPTOR_HANDLE(
-        m_d3d12RTVDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-        m_CurrentBackBufferIndex,
-        m_RTVDescriptorSize);
+    return Application::Get()
+        .GetDescriptorAllocator(D3D12_DESCRIPTOR_HEAP_TYPE_RTV)
+        ->GetCpuHandle(m_RenderTargetViews[m_CurrentBackBufferIndex]);
 }
 
 Microsoft::WRL::ComPtr<ID3D12Resource> Window::GetCurrentBackBuffer() const
@@ -204,5 +230,18 @@ UINT Window::Present()
     ThrowIfFailed(m_dxgiSwapChain->Present(syncInterval, presentFlags));
     m_CurrentBackBufferIndex = m_dxgiSwapChain->GetCurrentBackBufferIndex();
 
+    UINT presentId = 0;
+    ThrowIfFailed(m_dxgiSwapChain->GetLastPresentCount(&presentId));
+    m_PresentPacer.OnPresent(presentId, syncInterval);
+
+    // Fails until a first frame is on screen, and while the statistics are
+    // disjoint after a mode change.
+    uint32_t              latency = m_PresentPacer.GetFrameLatency();
+    DXGI_FRAME_STATISTICS stats   = {};
+    if (SUCCEEDED(m_dxgiSwapChain->GetFrameStatistics(&stats)))
+        m_PresentPacer.OnDisplaySample({ stats.PresentCount, stats.PresentRefreshCount });
+    if (m_FrameLatencyWaitable && m_PresentPacer.GetFrameLatency() != latency)
+        ThrowIfFailed(m_dxgiSwapChain->SetMaximumFrameLatency(m_PresentPacer.GetFrameLatency()));
+
     return m_CurrentBackBufferIndex;
 }
@@ -5,7 +5,9 @@
 
 // #include "SDL2/include/SDL_video.h"
 #include "clock.h"
+#include "descriptorallocator.h"
 #include "helpers.h"
+#include "presentpacer.h"
 // #include <SDL.h>
 #include <memory>
 #include <stdint.h>
@@ -63,6 +65,26 @@ public:
      */
     void Hide();
 
+    /**
+     * Whether the swapchain bounds the presents queued ahead of the display,
+     * see PresentPacer.
+     */
+    bool IsLowLatency() const;
+
+    /**
+     * Block until the swapchain can queue another present. The application
+     * loop calls it before sampling input, so the input is as recent as
+     * possible once the frame is on screen. Returns at once if the window
+     * is not in low latency mode.
+     */
+    void WaitForFrameLatency();
+
+    /**
+     * Presents, displayed frames and missed vblanks so far, from the frame
+     * statistics of the swapchain.
+     */
+    const PresentCounters& GetPresentCounters() const;
+
     /**
      * Return the current back buffer index.
      */
@@ -91,7 +113,7 @@ protected:
     friend class Game;
 
     Window() = delete;
-    Window(const std::string& windowName, int clientWidth, int clientHeight, bool vSync);
+    Window(const std::string& windowName, int clientWidth, int clientHeight, bool vSync, bool lowLatency);
     virtual ~Window();
 
     // // Register a Game with this window. This allows
@@ -138,6 +160,7 @@ private:
     std::string m_WindowName;
 
     bool m_VSync;
+    bool m_LowLatency;
 
     HighResolutionClock m_UpdateClock;
     HighResolutionClock m_RenderClock;
@@ -145,13 +168,18 @@ private:
 
     // std::weak_ptr<Game> m_pGame;
 
-    Microsoft::WRL::ComPtr<IDXGISwapChain4>      m_dxgiSwapChain;
-    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> m_d3d12RTVDescriptorHeap;
-    Microsoft::WRL::ComPtr<ID3D12Resource>       m_d3d12BackBuffers[BufferCount];
+    Microsoft::WRL::ComPtr<IDXGISwapChain4> m_dxgiSwapChain;
+    Microsoft::WRL::ComPtr<ID3D12Resource>  m_d3d12BackBuffers[BufferCount];
+    // From the application's RTV allocator.
+    DescriptorHandle m_RenderTargetViews[BufferCount];
 
-    UINT m_RTVDescriptorSize;
     UINT m_CurrentBackBufferIndex;
 
+    // Signaled when the swapchain can queue another present, in low latency
+    // mode only.
+    HANDLE       m_FrameLatencyWaitable = nullptr;
+    PresentPacer m_PresentPacer;
+
     RECT m_WindowRect;
     bool m_IsTearingSupported;
 };
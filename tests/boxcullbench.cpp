@@ -0,0 +1,99 @@
+/**
+ * Frustum culling throughput of the box kernels, from 10k to 1M boxes, on
+ * one thread per kernel and split across a JobPool like MeshApp's CPU path.
+ */
+#include "boxcull.h"
+#include "meshlet.h"
+#include "parallel.h"
+
+#include <benchmark/benchmark.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Boxes spread around a camera looking at the middle, about two thirds in
+// view.
+const BoxesSoA& GetBoxes(size_t count)
+{
+    static std::map<size_t, BoxesSoA> made;
+    BoxesSoA&                         boxes = made[count];
+    if (boxes.size() != count)
+    {
+        std::mt19937                          random(11);
+        std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+        std::uniform_real_distribution<float> extent(0.1f, 4.0f);
+        boxes.Resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            glm::vec3 min(position(random), position(random), position(random));
+            boxes.Set(i, min, min + glm::vec3(extent(random), extent(random), extent(random)));
+        }
+    }
+    return boxes;
+}
+
+void GetPlanes(glm::vec4 planes[6])
+{
+    glm::mat4 view       = glm::lookAt(glm::vec3(0.0f, 20.0f, -120.0f), glm::vec3(0.0f), glm::vec3(0, 1, 0));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 250.0f);
+    ExtractFrustumPlanes(projection * view, planes);
+}
+
+void BM_CullBoxes(benchmark::State& state)
+{
+    BoxCullKernel kernel = BoxCullKernel(state.range(0));
+    if (kernel > GetBoxCullKernel())
+    {
+        state.SkipWithError("kernel not supported");
+        return;
+    }
+    const BoxesSoA& boxes = GetBoxes(size_t(state.range(1)));
+    glm::vec4       planes[6];
+    GetPlanes(planes);
+
+    std::vector<uint8_t> visible(boxes.size());
+    size_t               count = 0;
+    for (auto _ : state)
+    {
+        count = CullBoxes(planes, boxes, 0, boxes.size(), visible.data(), kernel);
+        benchmark::DoNotOptimize(visible.data());
+    }
+    state.counters["boxes/s"] = benchmark::Counter(double(boxes.size()), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["visible"] = double(count) / double(boxes.size());
+}
+
+void BM_CullBoxesParallel(benchmark::State& state)
+{
+    const BoxesSoA& boxes = GetBoxes(size_t(state.range(0)));
+    JobPool         pool(unsigned(state.range(1)) - 1);
+    glm::vec4       planes[6];
+    GetPlanes(planes);
+
+    std::vector<uint8_t> visible(boxes.size());
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(CullBoxes(pool, planes, boxes, visible.data()));
+        benchmark::DoNotOptimize(visible.data());
+    }
+    state.counters["boxes/s"] = benchmark::Counter(double(boxes.size()), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+} // namespace
+
+BENCHMARK(BM_CullBoxes)
+    ->ArgsProduct({ { int(BoxCullKernel::Scalar), int(BoxCullKernel::Sse2), int(BoxCullKernel::Avx2) }, { 10000, 100000, 1000000 } })
+    ->ArgNames({ "kernel", "boxes" })
+    ->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_CullBoxesParallel)
+    ->ArgsProduct({ { 1000000 }, { 1, 2, 4, 8 } })
+    ->ArgNames({ "boxes", "threads" })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
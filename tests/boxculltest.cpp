@@ -0,0 +1,149 @@
+#include "boxcull.h"
+#include "meshlet.h"
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Boxes scattered around the origin, some tiny, some large, some flat.
+BoxesSoA MakeBoxes(size_t count, std::mt19937& random)
+{
+    std::uniform_real_distribution<float> position(-60.0f, 60.0f);
+    std::uniform_real_distribution<float> extent(0.0f, 8.0f);
+    BoxesSoA                              boxes;
+    boxes.Resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 min(position(random), position(random), position(random));
+        glm::vec3 size(extent(random), extent(random), extent(random));
+        if (i % 7 == 0)
+            size.y = 0.0f;
+        boxes.Set(i, min, min + size);
+    }
+    return boxes;
+}
+
+// Planes of a random camera, scaled so they are not normalized. Now and
+// then one plane is axis aligned, with zero normal components.
+void MakePlanes(std::mt19937& random, glm::vec4 planes[6])
+{
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    glm::vec3                             eye(40.0f * unit(random), 20.0f * unit(random), 40.0f * unit(random));
+    glm::mat4                             view       = glm::lookAt(eye, glm::vec3(10.0f * unit(random), 0.0f, 10.0f * unit(random)), glm::vec3(0, 1, 0));
+    glm::mat4                             projection = glm::perspective(glm::radians(50.0f + 30.0f * unit(random)), 16.0f / 9.0f, 0.1f, 100.0f);
+    ExtractFrustumPlanes(projection * view, planes);
+    for (int p = 0; p < 6; p++)
+        planes[p] *= 0.5f + 4.0f * std::abs(unit(random));
+    if (random() % 4 == 0)
+        planes[random() % 6] = glm::vec4(0.0f, 0.0f, 1.0f, 5.0f * unit(random));
+}
+
+// Outside when all eight corners are outside one plane.
+bool IsBoxOutside(const glm::vec4 planes[6], const BoxesSoA& boxes, size_t i)
+{
+    for (int p = 0; p < 6; p++)
+    {
+        bool allOutside = true;
+        for (int corner = 0; corner < 8; corner++)
+        {
+            float x    = corner & 1 ? boxes.max_x[i] : boxes.min_x[i];
+            float y    = corner & 2 ? boxes.max_y[i] : boxes.min_y[i];
+            float z    = corner & 4 ? boxes.max_z[i] : boxes.min_z[i];
+            float d    = planes[p].x * x + planes[p].y * y + planes[p].z * z + planes[p].w;
+            allOutside = allOutside && d < 0.0f;
+        }
+        if (allOutside)
+            return true;
+    }
+    return false;
+}
+
+// The kernels this CPU can run, a kernel not compiled in falls back to the
+// scalar one.
+std::vector<BoxCullKernel> SupportedKernels()
+{
+    std::vector<BoxCullKernel> kernels = { BoxCullKernel::Scalar };
+    if (GetBoxCullKernel() >= BoxCullKernel::Sse2)
+        kernels.push_back(BoxCullKernel::Sse2);
+    if (GetBoxCullKernel() >= BoxCullKernel::Avx2)
+        kernels.push_back(BoxCullKernel::Avx2);
+    return kernels;
+}
+
+} // namespace
+
+// Every kernel agrees with the eight corner test, box for box, on ranges
+// that start and end off the SIMD width, and leaves the bytes around the
+// range alone.
+TEST(BoxCull, KernelsMatchTheCornerReference)
+{
+    std::mt19937 random(3);
+    size_t       visibleTotal = 0;
+    size_t       boxTotal     = 0;
+    for (int frustum = 0; frustum < 300; frustum++)
+    {
+        glm::vec4 planes[6];
+        MakePlanes(random, planes);
+        BoxesSoA boxes = MakeBoxes(1 + random() % 3000, random);
+        size_t   begin = random() % std::min<size_t>(boxes.size(), 13);
+        size_t   end   = boxes.size() - random() % (boxes.size() - begin);
+
+        std::vector<uint8_t> expected(boxes.size(), 0xcd);
+        size_t               expectedCount = 0;
+        for (size_t i = begin; i < end; i++)
+        {
+            expected[i] = IsBoxOutside(planes, boxes, i) ? 0 : 1;
+            expectedCount += expected[i];
+        }
+        visibleTotal += expectedCount;
+        boxTotal += end - begin;
+
+        for (BoxCullKernel kernel : SupportedKernels())
+        {
+            SCOPED_TRACE(testing::Message() << "frustum " << frustum << ", kernel " << int(kernel));
+            std::vector<uint8_t> visible(boxes.size(), 0xcd);
+            EXPECT_EQ(CullBoxes(planes, boxes, begin, end, visible.data(), kernel), expectedCount);
+            ASSERT_EQ(visible, expected);
+        }
+    }
+    // Both outcomes were exercised.
+    EXPECT_GT(visibleTotal, boxTotal / 20);
+    EXPECT_LT(visibleTotal, boxTotal - boxTotal / 20);
+}
+
+TEST(BoxCull, EmptyRange)
+{
+    std::mt19937 random(5);
+    glm::vec4    planes[6];
+    MakePlanes(random, planes);
+    BoxesSoA boxes = MakeBoxes(16, random);
+    uint8_t  visible[16];
+    for (BoxCullKernel kernel : SupportedKernels())
+        EXPECT_EQ(CullBoxes(planes, boxes, 9, 9, visible, kernel), 0u);
+}
+
+// Split into jobs or not, across thread counts, the same boxes come out.
+TEST(BoxCull, JobPoolMatchesOneRange)
+{
+    std::mt19937 random(9);
+    BoxesSoA     boxes = MakeBoxes(200003, random);
+    glm::vec4    planes[6];
+    MakePlanes(random, planes);
+
+    std::vector<uint8_t> expected(boxes.size());
+    size_t               expectedCount = CullBoxes(planes, boxes, 0, boxes.size(), expected.data(), BoxCullKernel::Scalar);
+    for (unsigned workers : { 0u, 1u, 3u })
+    {
+        JobPool              pool(workers);
+        std::vector<uint8_t> visible(boxes.size(), 0xcd);
+        EXPECT_EQ(CullBoxes(pool, planes, boxes, visible.data()), expectedCount);
+        EXPECT_EQ(visible, expected) << workers << " workers";
+    }
+}
@@ -0,0 +1,192 @@
+/**
+ * BVH build time and ray throughput, on generated grids up to 10M triangles
+ * and on the OBJ file named by PETIT_BENCH_OBJ, bin/models/bmw.obj for
+ * instance. Coherent rays are a grid shot straight through the bounds, like
+ * picking and visibility probes, incoherent ones start and point anywhere.
+ */
+#include "bvh.h"
+#include "meshweld.h"
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <map>
+#include <random>
+
+namespace
+{
+
+constexpr int kRayGrid = 512;
+
+const MeshBuffers& LoadGrid(size_t triangleCount)
+{
+    static std::map<size_t, MeshBuffers> grids;
+    MeshBuffers&                         mesh = grids[triangleCount];
+    if (mesh.indices.empty())
+        mesh = MakeGridMesh(256, uint32_t(std::max<size_t>(1, triangleCount / 512)));
+    return mesh;
+}
+
+const MeshBuffers& LoadObj(const std::string& path)
+{
+    static std::map<std::string, MeshBuffers> loaded;
+    MeshBuffers&                              mesh = loaded[path];
+    if (mesh.indices.empty())
+    {
+        tinyobj::attrib_t                attrib;
+        std::vector<tinyobj::shape_t>    shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string                      warn, err;
+        std::string                      directory = path.substr(0, path.find_last_of("/\\"));
+        if (!LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, path.c_str(), directory.c_str()))
+            return mesh;
+        DeduplicateCorners(attrib, shapes, mesh.vertices, mesh.indices);
+
+        MeshSubMesh submesh  = {};
+        submesh.index_count  = uint32_t(mesh.indices.size());
+        submesh.vertex_count = uint32_t(mesh.vertices.size());
+        mesh.submeshes.push_back(submesh);
+    }
+    return mesh;
+}
+
+const MeshBvh& GetBvh(const MeshBuffers& mesh)
+{
+    static std::map<const MeshBuffers*, MeshBvh> built;
+    MeshBvh&                                     bvh = built[&mesh];
+    if (bvh.nodes.empty())
+        BuildBvh(bvh, MeshView::FromBuffers(mesh));
+    return bvh;
+}
+
+void Build(benchmark::State& state, const MeshBuffers& mesh)
+{
+    if (mesh.indices.empty())
+    {
+        state.SkipWithError("no mesh");
+        return;
+    }
+    MeshView view = MeshView::FromBuffers(mesh);
+    MeshBvh  bvh;
+    for (auto _ : state)
+    {
+        BuildBvh(bvh, view);
+        benchmark::DoNotOptimize(bvh.nodes.data());
+    }
+    state.counters["triangles/s"] = benchmark::Counter(double(mesh.indices.size() / 3), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["nodes"]       = double(bvh.nodes.size());
+}
+
+std::vector<BvhRay> CoherentRays(const MeshBvh& bvh)
+{
+    // Down the smallest axis, the grids are flat in y.
+    glm::vec3 size = bvh.bounds_max - bvh.bounds_min;
+    int       axis = size.y <= size.x && size.y <= size.z ? 1 : size.x <= size.z ? 0 : 2;
+    int       u    = (axis + 1) % 3;
+    int       v    = (axis + 2) % 3;
+
+    std::vector<BvhRay> rays;
+    rays.reserve(kRayGrid * kRayGrid);
+    for (int y = 0; y < kRayGrid; y++)
+    {
+        for (int x = 0; x < kRayGrid; x++)
+        {
+            BvhRay ray;
+            ray.origin    = bvh.bounds_min;
+            ray.direction = glm::vec3(0.0f);
+            ray.origin[u] += size[u] * (x + 0.5f) / kRayGrid;
+            ray.origin[v] += size[v] * (y + 0.5f) / kRayGrid;
+            ray.origin[axis] -= size[axis] * 0.5f + 1e-3f;
+            ray.direction[axis] = 1.0f;
+            rays.push_back(ray);
+        }
+    }
+    return rays;
+}
+
+std::vector<BvhRay> IncoherentRays(const MeshBvh& bvh)
+{
+    std::mt19937                          random(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::vec3                             size = glm::max(bvh.bounds_max - bvh.bounds_min, glm::vec3(1e-3f));
+
+    std::vector<BvhRay> rays(kRayGrid * kRayGrid);
+    for (auto& ray : rays)
+    {
+        ray.origin = bvh.bounds_min + size * glm::vec3(unit(random), unit(random), unit(random));
+        glm::vec3 direction;
+        do
+            direction = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f - 1.0f;
+        while (glm::dot(direction, direction) < 1e-4f);
+        ray.direction = glm::normalize(direction);
+    }
+    return rays;
+}
+
+void Trace(benchmark::State& state, const MeshBuffers& mesh, bool coherent)
+{
+    if (mesh.indices.empty())
+    {
+        state.SkipWithError("no mesh");
+        return;
+    }
+    const MeshBvh&      bvh  = GetBvh(mesh);
+    std::vector<BvhRay> rays = coherent ? CoherentRays(bvh) : IncoherentRays(bvh);
+    size_t              hits = 0;
+    for (auto _ : state)
+    {
+        hits = 0;
+        for (const BvhRay& ray : rays)
+        {
+            BvhHit hit;
+            hits += IntersectBvh(bvh, ray, hit);
+        }
+        benchmark::DoNotOptimize(hits);
+    }
+    state.counters["Mrays/s"] = benchmark::Counter(double(rays.size()) * 1e-6, benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["hit%"]    = 100.0 * double(hits) / double(rays.size());
+}
+
+void BM_BuildGrid(benchmark::State& state)
+{
+    Build(state, LoadGrid(size_t(state.range(0))));
+}
+
+void BM_TraceGridCoherent(benchmark::State& state)
+{
+    Trace(state, LoadGrid(size_t(state.range(0))), true);
+}
+
+void BM_TraceGridIncoherent(benchmark::State& state)
+{
+    Trace(state, LoadGrid(size_t(state.range(0))), false);
+}
+
+} // namespace
+
+BENCHMARK(BM_BuildGrid)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_TraceGridCoherent)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TraceGridIncoherent)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    if (const char* path = getenv("PETIT_BENCH_OBJ"))
+    {
+        std::string file = path;
+        benchmark::RegisterBenchmark("BM_BuildObj", [file](benchmark::State& state) { Build(state, LoadObj(file)); })
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+        benchmark::RegisterBenchmark("BM_TraceObjCoherent", [file](benchmark::State& state) { Trace(state, LoadObj(file), true); })
+            ->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark("BM_TraceObjIncoherent", [file](benchmark::State& state) { Trace(state, LoadObj(file), false); })
+            ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
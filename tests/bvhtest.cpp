@@ -0,0 +1,198 @@
+#include "bvh.h"
+#include "synthetic.h"
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <random>
+
+namespace
+{
+
+// Three submeshes of a bumpy grid, then triangles outside of every submesh
+// range, as LODs leave them, which the tree must not pick up.
+MeshBuffers MakeMesh()
+{
+    MeshBuffers mesh  = MakeGridMesh(48, 36, 3);
+    size_t      count = mesh.indices.size();
+    for (size_t i = 0; i < count; i += 6)
+        mesh.indices.insert(mesh.indices.end(), { mesh.indices[i], mesh.indices[i + 2], mesh.indices[i + 5] });
+    return mesh;
+}
+
+// Every full resolution triangle moved by `transform`, computed the way
+// the tree does so both sides agree on edge hits.
+std::vector<BvhTriangle> TransformTriangles(const MeshBuffers& mesh, const glm::mat4& transform)
+{
+    std::vector<BvhTriangle> triangles;
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+    {
+        for (uint32_t i = submesh.index_offset; i < submesh.index_offset + submesh.index_count; i += 3)
+        {
+            glm::vec3 p[3];
+            for (int k = 0; k < 3; k++)
+                p[k] = glm::vec3(transform * glm::vec4(mesh.vertices[mesh.indices[i + k]].position, 1.0f));
+            triangles.push_back({ p[0], p[1] - p[0], p[2] - p[0], i / 3 });
+        }
+    }
+    return triangles;
+}
+
+BvhHit BruteForce(const std::vector<BvhTriangle>& triangles, const BvhRay& ray)
+{
+    BvhHit hit;
+    hit.t = ray.tmax;
+    for (const BvhTriangle& triangle : triangles)
+    {
+        glm::vec3 p   = glm::cross(ray.direction, triangle.edge2);
+        float     det = glm::dot(triangle.edge1, p);
+        if (det == 0.0f)
+            continue;
+        float     invDet = 1.0f / det;
+        glm::vec3 s      = ray.origin - triangle.v0;
+        float     u      = glm::dot(s, p) * invDet;
+        if (u < 0.0f || u > 1.0f)
+            continue;
+        glm::vec3 q = glm::cross(s, triangle.edge1);
+        float     v = glm::dot(ray.direction, q) * invDet;
+        if (v < 0.0f || u + v > 1.0f)
+            continue;
+        float t = glm::dot(triangle.edge2, q) * invDet;
+        if (t <= ray.tmin || t >= hit.t)
+            continue;
+        hit.t        = t;
+        hit.u        = u;
+        hit.v        = v;
+        hit.triangle = triangle.triangle;
+    }
+    return hit;
+}
+
+// Rays dropped onto the surface from above, which mostly hit, and rays
+// from anywhere in any direction, some with a short range.
+std::vector<BvhRay> MakeRays(const glm::vec3& min, const glm::vec3& max, uint32_t seed)
+{
+    std::mt19937                          random(seed);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    glm::vec3                             size = max - min;
+    std::vector<BvhRay>                   rays;
+    for (int i = 0; i < 1000; i++)
+    {
+        BvhRay    ray;
+        glm::vec3 target = min + size * glm::vec3(unit(random), unit(random), unit(random));
+        if (i % 2)
+        {
+            ray.origin    = target + glm::vec3(0.0f, 2.0f * size.y + 1.0f, 0.0f);
+            ray.direction = glm::vec3(0.2f * unit(random) - 0.1f, -1.0f, 0.2f * unit(random) - 0.1f);
+        }
+        else
+        {
+            ray.origin    = min - 0.5f * size + 2.0f * size * glm::vec3(unit(random), unit(random), unit(random));
+            ray.direction = target - ray.origin;
+        }
+        if (i % 5 == 0)
+            ray.tmax = 0.5f + unit(random);
+        if (i % 7 == 0)
+            ray.tmin = 0.3f;
+        rays.push_back(ray);
+    }
+    return rays;
+}
+
+// Both find the same closest hit, or none, and the any hit query agrees.
+void ExpectMatchesBruteForce(const MeshBvh& bvh, const MeshBuffers& mesh, const glm::mat4& transform, uint32_t seed)
+{
+    std::vector<BvhTriangle> triangles = TransformTriangles(mesh, transform);
+    size_t                   hits      = 0;
+    for (const BvhRay& ray : MakeRays(bvh.bounds_min, bvh.bounds_max, seed))
+    {
+        BvhHit expected = BruteForce(triangles, ray);
+        BvhHit hit;
+        bool   found = IntersectBvh(bvh, ray, hit);
+        ASSERT_EQ(found, expected.triangle != kBvhNoHit);
+        ASSERT_EQ(IsRayOccluded(bvh, ray), found);
+        if (!found)
+            continue;
+        hits++;
+        ASSERT_EQ(hit.t, expected.t);
+        // On a shared edge either triangle is the closest.
+        if (hit.triangle != expected.triangle)
+        {
+            EXPECT_TRUE(hit.u == 0.0f || hit.v == 0.0f || hit.u + hit.v == 1.0f || expected.u == 0.0f || expected.v == 0.0f || expected.u + expected.v == 1.0f);
+            continue;
+        }
+        EXPECT_EQ(hit.u, expected.u);
+        EXPECT_EQ(hit.v, expected.v);
+    }
+    // Both outcomes were exercised.
+    EXPECT_GT(hits, 200u);
+    EXPECT_LT(hits, 900u);
+}
+
+} // namespace
+
+TEST(Bvh, MatchesBruteForce)
+{
+    MeshBuffers mesh = MakeMesh();
+    MeshBvh     bvh;
+    BuildBvh(bvh, MeshView::FromBuffers(mesh));
+
+    size_t fullTriangles = 0;
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+        fullTriangles += submesh.index_count / 3;
+    ASSERT_EQ(bvh.triangles.size(), fullTriangles);
+    ExpectMatchesBruteForce(bvh, mesh, glm::mat4(1.0f), 1);
+}
+
+TEST(Bvh, TransformedBuildMatchesBruteForce)
+{
+    MeshBuffers mesh      = MakeMesh();
+    glm::mat4   transform = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(3.0f, -1.0f, 2.0f)), 0.7f, glm::vec3(1.0f, 2.0f, 0.5f));
+    MeshBvh     bvh;
+    BuildBvh(bvh, MeshView::FromBuffers(mesh), transform);
+    ExpectMatchesBruteForce(bvh, mesh, transform, 2);
+}
+
+// A refitted tree answers like the mesh under its new transform, even one
+// that shears the mesh, and refitting back gives the built bounds.
+TEST(Bvh, RefitMatchesBruteForce)
+{
+    MeshBuffers mesh = MakeMesh();
+    MeshView    view = MeshView::FromBuffers(mesh);
+    MeshBvh     bvh;
+    BuildBvh(bvh, view);
+    MeshBvh built = bvh;
+
+    glm::mat4 shear(1.0f);
+    shear[1][0] = 0.8f;
+    shear[0][2] = -0.5f;
+    glm::mat4 transform = glm::scale(glm::rotate(shear, 1.1f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(2.0f, 5.0f, 0.5f));
+    RefitBvh(bvh, view, transform);
+    ExpectMatchesBruteForce(bvh, mesh, transform, 3);
+
+    RefitBvh(bvh, view, glm::mat4(1.0f));
+    EXPECT_EQ(bvh.bounds_min, built.bounds_min);
+    EXPECT_EQ(bvh.bounds_max, built.bounds_max);
+    ASSERT_EQ(bvh.nodes.size(), built.nodes.size());
+    for (size_t n = 0; n < bvh.nodes.size(); n++)
+        ASSERT_EQ(memcmp(bvh.nodes[n].bounds, built.nodes[n].bounds, sizeof(bvh.nodes[n].bounds)), 0) << "node " << n;
+    ExpectMatchesBruteForce(bvh, mesh, glm::mat4(1.0f), 4);
+}
+
+TEST(Bvh, EmptyMesh)
+{
+    MeshBuffers mesh;
+    MeshBvh     bvh;
+    BuildBvh(bvh, MeshView::FromBuffers(mesh));
+    EXPECT_TRUE(bvh.nodes.empty());
+
+    BvhRay ray;
+    ray.origin    = glm::vec3(0.0f);
+    ray.direction = glm::vec3(0.0f, 0.0f, 1.0f);
+    BvhHit hit;
+    EXPECT_FALSE(IntersectBvh(bvh, ray, hit));
+    EXPECT_EQ(hit.triangle, kBvhNoHit);
+    EXPECT_FALSE(IsRayOccluded(bvh, ray));
+}
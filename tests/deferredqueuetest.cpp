@@ -0,0 +1,165 @@
+#include "deferredqueue.h"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Stands in for a command queue fence: values are signaled on submit and
+// complete when the test says so.
+struct FakeFence
+{
+    uint64_t signaled  = 0;
+    uint64_t completed = 0;
+
+    uint64_t Signal() { return ++signaled; }
+    void     CompleteUpTo(uint64_t value) { completed = std::max(completed, std::min(value, signaled)); }
+};
+
+// Something the GPU may still read, counting how often it was released.
+struct Tracked
+{
+    uint64_t lastUse  = 0;
+    int      releases = 0;
+};
+
+} // namespace
+
+TEST(DeferredQueue, RetiresUpToTheCompletedValue)
+{
+    DeferredQueue<int> queue;
+    queue.Push(1, 10);
+    queue.Push(2, 20);
+    queue.Push(2, 21);
+    queue.Push(4, 40);
+    EXPECT_EQ(queue.GetOldestFenceValue(), 1u);
+
+    std::vector<int> released;
+    auto             release = [&](int item) { released.push_back(item); };
+    EXPECT_EQ(queue.Retire(0, release), 0u);
+    EXPECT_EQ(queue.Retire(2, release), 3u);
+    EXPECT_EQ(released, (std::vector<int> { 10, 20, 21 }));
+    EXPECT_EQ(queue.GetOldestFenceValue(), 4u);
+
+    EXPECT_EQ(queue.Retire(3, release), 0u);
+    EXPECT_EQ(queue.Retire(4, release), 1u);
+    EXPECT_TRUE(queue.IsEmpty());
+    EXPECT_EQ(queue.GetOldestFenceValue(), 0u);
+}
+
+TEST(DeferredQueue, SortsInOlderValues)
+{
+    DeferredQueue<int> queue;
+    queue.Push(5, 50);
+    queue.Push(7, 70);
+    queue.Push(3, 30);
+    queue.Push(6, 60);
+    EXPECT_EQ(queue.GetOldestFenceValue(), 3u);
+
+    std::vector<int> released;
+    queue.Retire(6, [&](int item) { released.push_back(item); });
+    EXPECT_EQ(released, (std::vector<int> { 30, 50, 60 }));
+    EXPECT_EQ(queue.GetSize(), 1u);
+}
+
+TEST(DeferredQueue, MoveOnlyItems)
+{
+    DeferredQueue<std::unique_ptr<int>> queue;
+    queue.Push(1, std::make_unique<int>(7));
+    int value = 0;
+    queue.Retire(1, [&](std::unique_ptr<int> item) { value = *item; });
+    EXPECT_EQ(value, 7);
+}
+
+// A window resize: the back buffers were last used by the frames still in
+// flight, they go away once the DIRECT queue passes the newest of them and
+// not before, without waiting for anything else.
+TEST(DeferredQueue, ResizeReleasesBackBuffersAfterTheirLastFrame)
+{
+    const int kBufferCount = 3;
+
+    FakeFence               fence;
+    DeferredQueue<Tracked*> queue;
+    std::vector<Tracked>    backBuffers(kBufferCount);
+    for (Tracked& buffer : backBuffers)
+        buffer.lastUse = fence.Signal();
+
+    for (Tracked& buffer : backBuffers)
+        queue.Push(buffer.lastUse, &buffer);
+    auto release = [](Tracked* buffer) { buffer->releases++; };
+
+    fence.CompleteUpTo(1);
+    queue.Retire(fence.completed, release);
+    EXPECT_EQ(backBuffers[0].releases, 1);
+    EXPECT_EQ(backBuffers[1].releases, 0);
+    EXPECT_EQ(backBuffers[2].releases, 0);
+
+    // What ResizeBuffers waits for.
+    EXPECT_EQ(queue.GetOldestFenceValue(), 2u);
+    fence.CompleteUpTo(kBufferCount);
+    queue.Retire(fence.completed, release);
+    for (const Tracked& buffer : backBuffers)
+        EXPECT_EQ(buffer.releases, 1);
+    EXPECT_TRUE(queue.IsEmpty());
+}
+
+// One queue per command queue like the ReleaseQueue, with objects queued
+// under random fence values, sometimes older than the newest, and fences
+// that lag behind at random. Nothing may be released before the fence
+// passes its last use, and everything exactly once.
+TEST(DeferredQueue, NeverReleasesInFlight)
+{
+    const int kQueues  = 3;
+    const int kObjects = 50000;
+
+    FakeFence               fences[kQueues];
+    DeferredQueue<Tracked*> queues[kQueues];
+    std::vector<Tracked>    objects(kObjects);
+    std::vector<int>        queueOf(kObjects);
+
+    std::mt19937                       random(13);
+    std::uniform_int_distribution<int> pickQueue(0, kQueues - 1);
+    std::uniform_int_distribution<int> age(0, 3);
+    std::uniform_int_distribution<int> lag(0, 5);
+
+    int  current = 0;
+    auto release = [&](Tracked* object) {
+        int index = int(object - objects.data());
+        ASSERT_LE(object->lastUse, fences[queueOf[index]].completed) << "object " << index;
+        object->releases++;
+    };
+    while (current < kObjects)
+    {
+        for (int i = 0; i < 8 && current < kObjects; i++, current++)
+        {
+            int        q       = pickQueue(random);
+            FakeFence& fence   = fences[q];
+            uint64_t   newest  = fence.Signal();
+            uint64_t   lastUse = newest - std::min<uint64_t>(newest - 1, uint64_t(age(random)));
+
+            objects[current].lastUse = std::max(lastUse, fence.completed + 1);
+            queueOf[current]         = q;
+            queues[q].Push(objects[current].lastUse, &objects[current]);
+        }
+        for (int q = 0; q < kQueues; q++)
+        {
+            fences[q].CompleteUpTo(fences[q].signaled - std::min<uint64_t>(fences[q].signaled, uint64_t(lag(random))));
+            queues[q].Retire(fences[q].completed, release);
+            ASSERT_TRUE(queues[q].IsEmpty() || queues[q].GetOldestFenceValue() > fences[q].completed);
+        }
+    }
+
+    // Teardown, like ~ReleaseQueue once the GPU is idle.
+    for (int q = 0; q < kQueues; q++)
+    {
+        fences[q].CompleteUpTo(fences[q].signaled);
+        queues[q].Retire(fences[q].completed, release);
+        EXPECT_TRUE(queues[q].IsEmpty());
+    }
+    for (int i = 0; i < kObjects; i++)
+        ASSERT_EQ(objects[i].releases, 1) << "object " << i;
+}
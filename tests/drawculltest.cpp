@@ -0,0 +1,237 @@
+#include "drawcull.h"
+#include "meshlet.h"
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// DrawCull.hlsl's.
+constexpr uint32_t kGroupSize = 256;
+// MeshApp's.
+constexpr float kLodErrorPixels = 1.0f;
+constexpr float kFoV            = glm::radians(45.0f);
+constexpr float kViewportHeight = 720.0f;
+
+// Fills the argument buffers, no draw the cull writes looks like it.
+const IndirectDraw kUnwritten = { 0xcdcdcdcd,
+                                  { glm::vec4(-1.0f), glm::vec4(-1.0f) },
+                                  { 0xcdcdcdcd, 0xcdcdcdcd, 0xcdcdcdcd, -1, 0xcdcdcdcd } };
+
+struct Scene
+{
+    glm::mat4               model;
+    glm::mat4               viewProjection;
+    glm::vec3               eye;
+    float                   modelScale;
+    std::vector<DrawSource> sources;
+    std::vector<MeshLod>    lods;
+    DrawCullConstants       constants;
+
+    Scene(uint32_t drawCount, uint32_t seed)
+    {
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+        auto                                  between = [&](float low, float high) { return low + (high - low) * unit(random); };
+
+        modelScale = between(0.2f, 3.0f);
+        model      = glm::translate(glm::mat4(1.0f), glm::vec3(between(-5, 5), between(-5, 5), between(-5, 5)));
+        model      = glm::rotate(model, between(0.0f, 6.28f), glm::normalize(glm::vec3(between(-1, 1), 1.0f, between(-1, 1))));
+        model      = glm::scale(model, glm::vec3(modelScale));
+        eye        = glm::vec3(between(-80, 80), between(-20, 20), between(-80, 80));
+        glm::mat4 view       = glm::lookAt(eye, glm::vec3(between(-10, 10), 0.0f, between(-10, 10)), glm::vec3(0, 1, 0));
+        glm::mat4 projection = glm::perspective(kFoV, 16.0f / 9.0f, 0.1f, 150.0f);
+        viewProjection       = projection * view;
+
+        uint32_t indexOffset = 0;
+        sources.resize(drawCount);
+        for (DrawSource& source : sources)
+        {
+            source.dequant.offset = glm::vec4(between(-40, 40), between(-15, 15), between(-40, 40), 0.0f);
+            source.dequant.scale  = glm::vec4(between(0.05f, 6.0f), between(0.05f, 6.0f), between(0.05f, 6.0f), 0.0f);
+            source.material       = random() % 32;
+            source.lod_offset     = uint32_t(lods.size());
+            source.lod_count      = 1 + random() % 5;
+            source.padding        = 0;
+            // Every level gets an index range of its own, so a draw tells
+            // which submesh and level it came from.
+            float error = 0.0f;
+            for (uint32_t level = 0; level < source.lod_count; level++)
+            {
+                uint32_t indexCount = 3 * (1 + random() % 100);
+                lods.push_back({ indexOffset, indexCount, error, 0 });
+                indexOffset += indexCount;
+                error += between(0.0005f, 0.05f) * float(1 << level);
+            }
+        }
+
+        // What MeshApp::SubmitDrawCulling fills in.
+        ExtractFrustumPlanes(viewProjection * model, constants.planes);
+        constants.eye              = glm::vec4(glm::vec3(glm::inverse(model) * glm::vec4(eye, 1.0f)), modelScale);
+        constants.lod_scale        = modelScale * kViewportHeight / (2.0f * std::tan(kFoV * 0.5f));
+        constants.lod_error_pixels = kLodErrorPixels;
+        constants.draw_count       = drawCount;
+        constants.padding          = 0;
+    }
+};
+
+// DrawCull.hlsl's main, one thread group walking the draws a chunk at a
+// time. Each thread culls its draw like the shader's CullDraw, here the
+// reference for one source, then the group compacts the chunk with the same
+// Hillis-Steele prefix sum, every step reading before anyone writes.
+uint32_t EmulateDrawCullShader(const DrawCullConstants& constants, const DrawSource* sources, const MeshLod* lods, IndirectDraw* out)
+{
+    DrawCullConstants single = constants;
+    single.draw_count        = 1;
+
+    uint32_t count = 0;
+    for (uint32_t first = 0; first < constants.draw_count; first += kGroupSize)
+    {
+        IndirectDraw draws[kGroupSize];
+        bool         visible[kGroupSize];
+        uint32_t     visibleSum[kGroupSize];
+        for (uint32_t thread = 0; thread < kGroupSize; thread++)
+        {
+            uint32_t d         = first + thread;
+            visible[thread]    = d < constants.draw_count && CullDraws(single, &sources[d], lods, &draws[thread]) == 1;
+            visibleSum[thread] = visible[thread] ? 1 : 0;
+        }
+        for (uint32_t stride = 1; stride < kGroupSize; stride <<= 1)
+        {
+            uint32_t before[kGroupSize];
+            for (uint32_t thread = 0; thread < kGroupSize; thread++)
+                before[thread] = thread >= stride ? visibleSum[thread - stride] : 0;
+            for (uint32_t thread = 0; thread < kGroupSize; thread++)
+                visibleSum[thread] += before[thread];
+        }
+        for (uint32_t thread = 0; thread < kGroupSize; thread++)
+        {
+            if (visible[thread])
+                out[count + visibleSum[thread] - 1] = draws[thread];
+        }
+        count += visibleSum[kGroupSize - 1];
+    }
+    return count;
+}
+
+} // namespace
+
+// The shader's chunked compaction and the serial reference write the same
+// bytes, on both sides of the group size.
+TEST(DrawCull, MatchesTheShaderCompaction)
+{
+    const uint32_t sizes[] = { 0, 1, 255, 256, 257, 511, 1000, 3000 };
+    uint32_t       seed    = 1;
+    size_t         culled  = 0;
+    size_t         drawn   = 0;
+    for (uint32_t drawCount : sizes)
+    {
+        for (int repeat = 0; repeat < 25; repeat++)
+        {
+            Scene scene(drawCount, seed++);
+            SCOPED_TRACE(seed);
+
+            // The slot past the last draw stays untouched.
+            std::vector<IndirectDraw> expected(drawCount + 1, kUnwritten);
+            std::vector<IndirectDraw> emulated(drawCount + 1, kUnwritten);
+
+            uint32_t count = CullDraws(scene.constants, scene.sources.data(), scene.lods.data(), expected.data());
+            ASSERT_EQ(EmulateDrawCullShader(scene.constants, scene.sources.data(), scene.lods.data(), emulated.data()), count);
+            EXPECT_EQ(memcmp(static_cast<const void*>(expected.data()), static_cast<const void*>(emulated.data()), emulated.size() * sizeof(IndirectDraw)), 0);
+            drawn += count;
+            culled += drawCount - count;
+        }
+    }
+    // Both sides of the frustum were exercised.
+    EXPECT_GT(drawn, culled / 10);
+    EXPECT_GT(culled, drawn / 10);
+    RecordProperty("drawn", int(drawn));
+    RecordProperty("culled", int(culled));
+}
+
+// The object space culling agrees with the world space frustum test and
+// MeshApp::SelectLod, except where rounding decides a tie.
+TEST(DrawCull, MatchesTheWorldSpaceSelection)
+{
+    size_t compared = 0;
+    size_t ties     = 0;
+    for (uint32_t seed = 1; seed <= 100; seed++)
+    {
+        Scene scene(2000, seed);
+        SCOPED_TRACE(seed);
+
+        std::vector<IndirectDraw> draws(scene.sources.size());
+        uint32_t                  count = CullDraws(scene.constants, scene.sources.data(), scene.lods.data(), draws.data());
+
+        // Which source and level every draw is.
+        std::map<uint32_t, std::pair<uint32_t, uint32_t>> byIndexOffset;
+        for (uint32_t s = 0; s < scene.sources.size(); s++)
+            for (uint32_t level = 0; level < scene.sources[s].lod_count; level++)
+                byIndexOffset[scene.lods[scene.sources[s].lod_offset + level].index_offset] = { s, level };
+        std::vector<int> drawnLevel(scene.sources.size(), -1);
+        uint32_t         previous = 0;
+        for (uint32_t d = 0; d < count; d++)
+        {
+            auto [s, level] = byIndexOffset.at(draws[d].args.index_offset);
+            ASSERT_TRUE(d == 0 || s > previous) << "draws out of submesh order";
+            previous      = s;
+            drawnLevel[s] = int(level);
+            EXPECT_EQ(draws[d].material, scene.sources[s].material);
+            EXPECT_EQ(draws[d].args.index_count, scene.lods[scene.sources[s].lod_offset + level].index_count);
+            EXPECT_EQ(draws[d].args.instance_count, 1u);
+        }
+
+        glm::vec4 planes[6];
+        ExtractFrustumPlanes(scene.viewProjection, planes);
+        for (uint32_t s = 0; s < scene.sources.size(); s++)
+        {
+            const DrawSource& source = scene.sources[s];
+            const glm::vec4&  q      = source.dequant.offset;
+            glm::vec3         center = glm::vec3(scene.model * glm::vec4(glm::vec3(q + source.dequant.scale * 0.5f), 1.0f));
+            float             radius = glm::length(glm::vec3(source.dequant.scale)) * 0.5f * scene.modelScale;
+
+            bool  tie     = false;
+            bool  outside = false;
+            float margin  = 1e-3f * (1.0f + radius);
+            for (int p = 0; p < 6; p++)
+            {
+                float distance = glm::dot(glm::vec3(planes[p]), center) + planes[p].w;
+                tie |= std::abs(distance + radius) < margin;
+                outside |= distance < -radius;
+            }
+
+            // MeshApp::SelectLod.
+            float distance   = std::max(glm::length(center - scene.eye) - radius, 1.0f);
+            float pixelScale = kViewportHeight / (2.0f * std::tan(kFoV * 0.5f) * distance);
+            int   level      = 0;
+            for (uint32_t l = source.lod_count; l-- > 1;)
+            {
+                float pixels = scene.lods[source.lod_offset + l].error * scene.modelScale * pixelScale;
+                tie |= std::abs(pixels - kLodErrorPixels) < 1e-3f * kLodErrorPixels;
+                if (pixels <= kLodErrorPixels)
+                {
+                    level = int(l);
+                    break;
+                }
+            }
+
+            if (tie)
+            {
+                ties++;
+                continue;
+            }
+            compared++;
+            EXPECT_EQ(drawnLevel[s], outside ? -1 : level) << "source " << s;
+        }
+    }
+    EXPECT_LT(ties * 100, compared);
+    RecordProperty("compared", int(compared));
+    RecordProperty("ties", int(ties));
+}
@@ -0,0 +1,216 @@
+#include "fencedpool.h"
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// A command allocator: the fence value of the submission that last used it,
+// and whether a list is recording into it.
+struct FakeAllocator
+{
+    uint64_t          lastUse = 0;
+    std::atomic<bool> recording { false };
+};
+
+struct FakeList
+{
+    FakeAllocator* allocator;
+    uint32_t       slot;
+};
+
+// Stands in for the D3D12 device, counting allocator creations.
+class FakeDevice
+{
+public:
+    FakeAllocator* CreateCommandAllocator()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Allocators.push_back(std::make_unique<FakeAllocator>());
+        return m_Allocators.back().get();
+    }
+
+    size_t GetCreatedCount()
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        return m_Allocators.size();
+    }
+
+private:
+    std::mutex                                  m_Mutex;
+    std::vector<std::unique_ptr<FakeAllocator>> m_Allocators;
+};
+
+// CommandQueue's recycling with the D3D12 calls taken out: GetCommandList
+// on any thread, HandOff to the submitting thread and ExecuteHandedOff,
+// against a fence the test completes.
+class FakeQueue
+{
+public:
+    explicit FakeQueue(FakeDevice& device) :
+        m_Device(device) { }
+
+    FakeList GetCommandList()
+    {
+        uint32_t       slot = GetThreadSlot();
+        FakeAllocator* allocator;
+        if (m_Pools.Get(slot).Acquire(m_Completed.load(std::memory_order_acquire), allocator))
+        {
+            // Reset, the GPU must be done with it.
+            if (allocator->lastUse > m_Completed.load(std::memory_order_acquire))
+                m_Violations++;
+        }
+        else
+            allocator = m_Device.CreateCommandAllocator();
+        if (allocator->recording.exchange(true))
+            m_Violations++;
+        return { allocator, slot };
+    }
+
+    void HandOff(FakeList list)
+    {
+        list.allocator->recording = false;
+        m_HandedOff.Push(list);
+    }
+
+    uint64_t ExecuteHandedOff()
+    {
+        uint64_t value = ++m_Signaled;
+        m_HandedOff.Drain([&](FakeList list) {
+            list.allocator->lastUse = value;
+            m_Pools.Get(list.slot).Return(value, list.allocator);
+        });
+        return value;
+    }
+
+    // The GPU finishes everything but the last `lag` submissions.
+    void Lag(uint64_t lag) { m_Completed.store(m_Signaled > lag ? m_Signaled - lag : 0, std::memory_order_release); }
+
+    FencedPoolStats GetStats() const { return m_Pools.GetStats(); }
+    int             GetViolations() const { return m_Violations.load(); }
+
+private:
+    FakeDevice&                 m_Device;
+    FencedPools<FakeAllocator*> m_Pools;
+    MpscQueue<FakeList>         m_HandedOff;
+    uint64_t                    m_Signaled = 0;
+    std::atomic<uint64_t>       m_Completed { 0 };
+    std::atomic<int>            m_Violations { 0 };
+};
+
+} // namespace
+
+// The oldest entry still in flight does not hide a newer one that is done.
+TEST(FencedPool, ScansPastEntriesInFlight)
+{
+    FencedPool<int> pool;
+    pool.Return(5, 50);
+    pool.Return(1, 10);
+    pool.Return(3, 30);
+
+    int object = 0;
+    EXPECT_TRUE(pool.Acquire(1, object));
+    EXPECT_EQ(object, 10);
+    EXPECT_FALSE(pool.Acquire(2, object));
+    EXPECT_TRUE(pool.Acquire(4, object));
+    EXPECT_EQ(object, 30);
+
+    FencedPoolStats stats = pool.GetStats();
+    EXPECT_EQ(stats.recycled, 2u);
+    EXPECT_EQ(stats.created, 1u);
+}
+
+TEST(FencedPool, ReturnsFromOtherThreads)
+{
+    FencedPool<int> pool;
+    std::thread     submitter([&]() {
+        for (int i = 1; i <= 100; i++)
+            pool.Return(uint64_t(i), i);
+    });
+    submitter.join();
+
+    int object = 0;
+    int count  = 0;
+    while (pool.Acquire(100, object))
+        count++;
+    EXPECT_EQ(count, 100);
+}
+
+TEST(FencedPool, ThreadSlotsAreUniqueAndReused)
+{
+    uint32_t              mine = GetThreadSlot();
+    std::vector<uint32_t> slots(8);
+    std::atomic<size_t>   arrived { 0 };
+    ParallelForChunks(slots.size(), slots.size(), [&](size_t chunk, size_t, size_t) {
+        slots[chunk] = GetThreadSlot();
+        // Keep every thread alive until all have their slot.
+        arrived++;
+        while (arrived.load() < slots.size())
+            std::this_thread::yield();
+    });
+    // The first chunk runs on this thread.
+    EXPECT_EQ(slots[0], mine);
+    std::sort(slots.begin() + 1, slots.end());
+    EXPECT_EQ(std::unique(slots.begin() + 1, slots.end()), slots.end());
+    for (size_t i = 1; i < slots.size(); i++)
+        EXPECT_NE(slots[i], mine);
+
+    // The exited threads gave theirs back.
+    uint32_t    again = MaxThreadSlots;
+    std::thread thread([&]() { again = GetThreadSlot(); });
+    thread.join();
+    EXPECT_TRUE(std::binary_search(slots.begin() + 1, slots.end(), again));
+}
+
+// Threads record lists every frame and hand them to the submitting thread,
+// with the GPU two frames behind. ParallelForChunks starts new threads every
+// frame, they pick up the slots and pools of the previous ones. No allocator
+// may be reset while in flight or shared by two lists, and once the pools
+// are warm nearly every list reuses an allocator instead of creating one.
+TEST(FencedPool, StressParallelRecording)
+{
+    const size_t   kThreads       = 6;
+    const size_t   kListsPerFrame = 24;
+    const int      kFrames        = 2000;
+    const uint64_t kLag           = 2;
+
+    FakeDevice device;
+    FakeQueue  queue(device);
+
+    size_t warmCreated = 0;
+    for (int frame = 0; frame < kFrames; frame++)
+    {
+        ParallelForChunks(kListsPerFrame, kThreads, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                queue.HandOff(queue.GetCommandList());
+        });
+        queue.ExecuteHandedOff();
+        queue.Lag(kLag);
+        if (frame == kFrames / 10)
+            warmCreated = device.GetCreatedCount();
+    }
+
+    FencedPoolStats stats = queue.GetStats();
+    EXPECT_EQ(queue.GetViolations(), 0);
+    EXPECT_EQ(stats.created, device.GetCreatedCount());
+    EXPECT_EQ(stats.created + stats.recycled, kListsPerFrame * kFrames);
+
+    // At most kThreads slots are in use at once. A thread that finishes its
+    // chunk early gives its slot to one starting later, so a slot may record
+    // a whole frame, over the frames in flight and the one being recorded.
+    EXPECT_LE(stats.created, kThreads * kListsPerFrame * (kLag + 1));
+    double hitRate = double(stats.recycled) / double(stats.created + stats.recycled);
+    EXPECT_GT(hitRate, 0.99);
+    // How the chunks land on slots changes every frame, the pools still grow
+    // now and then once warm.
+    EXPECT_LE(device.GetCreatedCount() - warmCreated, kListsPerFrame * 2);
+    RecordProperty("created", int(stats.created));
+    RecordProperty("hit_rate_permille", int(hitRate * 1000));
+}
@@ -0,0 +1,157 @@
+#include "fencewatcher.h"
+#include "mailbox.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+// Poll until `done` holds, the watcher runs callbacks on its own thread.
+template <typename F>
+bool WaitFor(F&& done)
+{
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (!done())
+    {
+        if (std::chrono::steady_clock::now() > deadline)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+} // namespace
+
+TEST(FenceWatcher, RunsCallbacksOnceTheFenceGetsThere)
+{
+    auto         waiter = std::make_shared<CpuFenceWaiter>();
+    CpuFence     fence(*waiter);
+    FenceWatcher watcher(waiter);
+
+    std::atomic<int> order[3] = {};
+    std::atomic<int> next { 1 };
+    for (int i = 2; i >= 0; i--)
+        watcher.Watch(fence, uint64_t(i + 1), [&, i]() { order[i] = next++; });
+
+    fence.Signal(2);
+    ASSERT_TRUE(WaitFor([&]() { return watcher.GetCompletedCount() == 2; }));
+    EXPECT_EQ(order[0].load(), 1);
+    EXPECT_EQ(order[1].load(), 2);
+    EXPECT_EQ(order[2].load(), 0);
+
+    fence.Signal(3);
+    ASSERT_TRUE(WaitFor([&]() { return watcher.GetCompletedCount() == 3; }));
+    EXPECT_EQ(order[2].load(), 3);
+}
+
+TEST(FenceWatcher, CompletedValuesRunRightAway)
+{
+    auto         waiter = std::make_shared<CpuFenceWaiter>();
+    CpuFence     fence(*waiter);
+    FenceWatcher watcher(waiter);
+    fence.Signal(5);
+
+    std::atomic<bool> ran { false };
+    watcher.Watch(fence, 4, [&]() { ran = true; });
+    EXPECT_TRUE(WaitFor([&]() { return ran.load(); }));
+}
+
+TEST(FenceWatcher, PostsToTheMailbox)
+{
+    auto         waiter = std::make_shared<CpuFenceWaiter>();
+    CpuFence     fence(*waiter);
+    FenceWatcher watcher(waiter);
+    Mailbox      mailbox;
+
+    std::thread::id ranOn;
+    watcher.Watch(fence, 1, mailbox, [&]() { ranOn = std::this_thread::get_id(); });
+    fence.Signal(1);
+    ASSERT_TRUE(WaitFor([&]() { return watcher.GetCompletedCount() == 1; }));
+
+    // Posted, not run yet.
+    EXPECT_EQ(ranOn, std::thread::id());
+    EXPECT_EQ(mailbox.Run(), 1u);
+    EXPECT_EQ(ranOn, std::this_thread::get_id());
+}
+
+TEST(FenceWatcher, DropsPendingCallbacksOnDestruction)
+{
+    auto             waiter = std::make_shared<CpuFenceWaiter>();
+    CpuFence         fence(*waiter);
+    std::atomic<int> ran { 0 };
+    {
+        FenceWatcher watcher(waiter);
+        watcher.Watch(fence, 1, [&]() { ran++; });
+        watcher.Watch(fence, 100, [&]() { ran++; });
+        fence.Signal(1);
+        ASSERT_TRUE(WaitFor([&]() { return watcher.GetCompletedCount() == 1; }));
+    }
+    EXPECT_EQ(ran.load(), 1);
+}
+
+// Several threads register callbacks on several fences, mostly ahead of
+// where the fences are, while others signal the fences in small steps.
+// Every callback must run exactly once, and never before its fence reached
+// its value.
+TEST(FenceWatcher, StressManyThreadsAndFences)
+{
+    const int      kFences       = 4;
+    const int      kRegistrars   = 4;
+    const int      kPerRegistrar = 5000;
+    const uint64_t kFinalValue   = 5000;
+
+    auto                                   waiter = std::make_shared<CpuFenceWaiter>();
+    std::vector<std::unique_ptr<CpuFence>> fences;
+    for (int f = 0; f < kFences; f++)
+        fences.push_back(std::make_unique<CpuFence>(*waiter));
+    std::vector<std::atomic<int>> runs(kRegistrars * kPerRegistrar);
+    std::atomic<int>              early { 0 };
+    // Destroyed first, a failed wait below drops the callbacks still
+    // pending instead of leaving them to run on freed counters.
+    FenceWatcher watcher(waiter);
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < kRegistrars; r++)
+    {
+        threads.emplace_back([&, r]() {
+            std::mt19937                       random(r + 1);
+            std::uniform_int_distribution<int> pick(0, kFences - 1);
+            std::uniform_int_distribution<int> ahead(0, 40);
+            for (int i = 0; i < kPerRegistrar; i++)
+            {
+                CpuFence& fence = *fences[pick(random)];
+                uint64_t  value = std::min(kFinalValue, fence.GetCompletedFenceValue() + uint64_t(ahead(random)));
+                size_t    id    = size_t(r * kPerRegistrar + i);
+                watcher.Watch(fence, value, [&, id, value, fencePtr = &fence]() {
+                    if (fencePtr->GetCompletedFenceValue() < value)
+                        early++;
+                    runs[id]++;
+                });
+            }
+        });
+    }
+    for (int f = 0; f < kFences; f++)
+    {
+        threads.emplace_back([&, f]() {
+            for (uint64_t value = 1; value <= kFinalValue; value++)
+            {
+                fences[f]->Signal(value);
+                if (value % 64 == 0)
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    ASSERT_TRUE(WaitFor([&]() { return watcher.GetCompletedCount() == runs.size(); }))
+        << watcher.GetCompletedCount() << " of " << runs.size();
+    EXPECT_EQ(early.load(), 0);
+    for (size_t id = 0; id < runs.size(); id++)
+        ASSERT_EQ(runs[id].load(), 1) << "callback " << id;
+}
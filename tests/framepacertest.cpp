@@ -0,0 +1,151 @@
+#include "framepacer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// A CPU recording frames and a GPU running them one after the other, in
+// simulated milliseconds. The fence completes a frame's value when the GPU
+// finishes it.
+struct Simulation
+{
+    double                cpuTime = 0.0;
+    double                gpuFree = 0.0;
+    std::vector<double>   completeTimes { 0.0 }; // by fence value
+    std::vector<uint64_t> slotLastUse;
+
+    // Checked at the start of every frame, after the wait.
+    uint32_t maxPending      = 0;
+    bool     slotReusedEarly = false;
+
+    uint64_t CompletedAt(double time) const
+    {
+        // The GPU is serial, completion times increase with the value.
+        return uint64_t(std::upper_bound(completeTimes.begin(), completeTimes.end(), time) - completeTimes.begin()) - 1;
+    }
+
+    // Run `frames` frames and return the average frame period over the
+    // second half.
+    double Run(FramePacer& pacer, int frames, double cpuCost, double gpuCost)
+    {
+        slotLastUse.assign(pacer.GetFramesInFlight(), 0);
+        double halfway = 0.0;
+        for (int frame = 0; frame < frames; frame++)
+        {
+            if (frame == frames / 2)
+                halfway = cpuTime;
+
+            uint64_t wait = pacer.BeginFrame();
+            cpuTime       = std::max(cpuTime, completeTimes[wait]);
+            uint64_t done = CompletedAt(cpuTime);
+            // What the slot holds belongs to a frame the GPU finished.
+            if (slotLastUse[pacer.GetFrameIndex()] > done)
+                slotReusedEarly = true;
+            maxPending = std::max(maxPending, pacer.GetPendingFrameCount(done));
+
+            cpuTime += cpuCost;
+            uint64_t value = completeTimes.size();
+            gpuFree        = std::max(gpuFree, cpuTime) + gpuCost;
+            completeTimes.push_back(gpuFree);
+            slotLastUse[pacer.GetFrameIndex()] = value;
+            pacer.EndFrame(value);
+        }
+        return (cpuTime - halfway) / (frames - frames / 2);
+    }
+};
+
+} // namespace
+
+TEST(FramePacer, CyclesThroughTheSlots)
+{
+    FramePacer pacer(3);
+    EXPECT_EQ(pacer.GetFramesInFlight(), 3u);
+    for (uint64_t frame = 1; frame <= 7; frame++)
+    {
+        uint64_t wait = pacer.BeginFrame();
+        EXPECT_TRUE(pacer.IsInFrame());
+        EXPECT_EQ(pacer.GetFrameIndex(), uint32_t((frame - 1) % 3));
+        EXPECT_EQ(pacer.GetFrameNumber(), frame);
+        // The frame three back, none for the first three.
+        EXPECT_EQ(wait, frame > 3 ? (frame - 3) * 10 : 0);
+        pacer.EndFrame(frame * 10);
+        EXPECT_FALSE(pacer.IsInFrame());
+    }
+    EXPECT_EQ(pacer.GetPendingFrameCount(40), 3u);
+    EXPECT_EQ(pacer.GetPendingFrameCount(60), 1u);
+    EXPECT_EQ(pacer.GetPendingFrameCount(70), 0u);
+}
+
+TEST(FramePacer, AtLeastOneFrame)
+{
+    FramePacer pacer(0);
+    EXPECT_EQ(pacer.GetFramesInFlight(), 1u);
+    pacer.BeginFrame();
+    pacer.EndFrame(1);
+    EXPECT_EQ(pacer.BeginFrame(), 1u);
+}
+
+// A frame that submitted nothing ends on the previous value.
+TEST(FramePacer, RepeatedFenceValues)
+{
+    FramePacer pacer(2);
+    pacer.BeginFrame();
+    pacer.EndFrame(5);
+    pacer.BeginFrame();
+    pacer.EndFrame(5);
+    EXPECT_EQ(pacer.BeginFrame(), 5u);
+    EXPECT_EQ(pacer.GetPendingFrameCount(4), 2u);
+}
+
+// With one frame in flight the CPU and GPU take turns. With two, a frame
+// costs the slower of the two, and the CPU never runs more than N - 1
+// frames ahead nor reuses a slot the GPU may still read.
+TEST(FramePacer, SimulatedOverlap)
+{
+    const double kCpu = 6.0;
+    const double kGpu = 10.0;
+
+    for (uint32_t framesInFlight = 1; framesInFlight <= 4; framesInFlight++)
+    {
+        FramePacer pacer(framesInFlight);
+        Simulation simulation;
+        double     period = simulation.Run(pacer, 200, kCpu, kGpu);
+
+        SCOPED_TRACE(framesInFlight);
+        EXPECT_FALSE(simulation.slotReusedEarly);
+        EXPECT_LE(simulation.maxPending, framesInFlight - 1);
+        if (framesInFlight == 1)
+            EXPECT_DOUBLE_EQ(period, kCpu + kGpu);
+        else
+            EXPECT_DOUBLE_EQ(period, std::max(kCpu, kGpu));
+    }
+}
+
+// GPU bound, the CPU is ahead by as many frames as allowed, the latency
+// the frame count buys.
+TEST(FramePacer, SimulatedLatency)
+{
+    for (uint32_t framesInFlight = 2; framesInFlight <= 4; framesInFlight++)
+    {
+        FramePacer pacer(framesInFlight);
+        Simulation simulation;
+        simulation.Run(pacer, 100, 2.0, 10.0);
+        EXPECT_EQ(simulation.maxPending, framesInFlight - 1);
+        // Submitted but not finished when the CPU stops.
+        EXPECT_EQ(pacer.GetPendingFrameCount(simulation.CompletedAt(simulation.cpuTime)), framesInFlight);
+    }
+}
+
+// CPU bound, the GPU idles between frames and the CPU never waits.
+TEST(FramePacer, SimulatedCpuBound)
+{
+    FramePacer pacer(3);
+    Simulation simulation;
+    double     period = simulation.Run(pacer, 100, 10.0, 4.0);
+    EXPECT_DOUBLE_EQ(period, 10.0);
+    EXPECT_LE(simulation.maxPending, 1u);
+}
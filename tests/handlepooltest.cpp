@@ -0,0 +1,133 @@
+#include "handlepool.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+TEST(HandlePool, LowestIndicesFirstUntilFull)
+{
+    HandlePool pool(4);
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        HandlePool::Handle handle = pool.Allocate();
+        EXPECT_EQ(handle.index, i);
+        EXPECT_TRUE(pool.IsAlive(handle));
+    }
+    EXPECT_EQ(pool.GetAllocatedCount(), 4u);
+    EXPECT_FALSE(pool.Allocate().IsValid());
+
+    HandlePool empty(0);
+    EXPECT_FALSE(empty.Allocate().IsValid());
+}
+
+TEST(HandlePool, FreedHandlesGoStale)
+{
+    HandlePool         pool(8);
+    HandlePool::Handle a = pool.Allocate();
+    pool.Allocate();
+
+    EXPECT_TRUE(pool.Free(a));
+    EXPECT_FALSE(pool.IsAlive(a));
+    EXPECT_FALSE(pool.Free(a));
+    EXPECT_EQ(pool.GetAllocatedCount(), 1u);
+
+    // The index comes back first, under a new generation the old handle
+    // does not match.
+    HandlePool::Handle again = pool.Allocate();
+    EXPECT_EQ(again.index, a.index);
+    EXPECT_NE(again.generation, a.generation);
+    EXPECT_FALSE(pool.IsAlive(a));
+    EXPECT_FALSE(pool.Free(a));
+    EXPECT_TRUE(pool.IsAlive(again));
+
+    EXPECT_FALSE(pool.IsAlive(HandlePool::Handle()));
+}
+
+TEST(HandlePool, FreeOrderIsReuseOrder)
+{
+    HandlePool                      pool(16);
+    std::vector<HandlePool::Handle> handles;
+    for (int i = 0; i < 16; i++)
+        handles.push_back(pool.Allocate());
+    pool.Free(handles[3]);
+    pool.Free(handles[9]);
+    pool.Free(handles[5]);
+    EXPECT_EQ(pool.Allocate().index, 5u);
+    EXPECT_EQ(pool.Allocate().index, 9u);
+    EXPECT_EQ(pool.Allocate().index, 3u);
+    EXPECT_FALSE(pool.Allocate().IsValid());
+}
+
+// Threads allocate and free at random against a small pool, so indices are
+// popped and pushed back under each other all the time. No index may be
+// handed to two owners at once, and every handle stays valid until its
+// owner frees it.
+TEST(HandlePool, StressConcurrentOwners)
+{
+    const uint32_t kCapacity = 64;
+    const int      kThreads  = 6;
+    const int      kSteps    = 200000;
+
+    HandlePool                    pool(kCapacity);
+    std::vector<std::atomic<int>> owners(kCapacity);
+    std::atomic<int>              conflicts { 0 };
+    std::atomic<int>              lost { 0 };
+    std::vector<std::thread>      threads;
+    for (int t = 0; t < kThreads; t++)
+    {
+        threads.emplace_back([&, t]() {
+            std::mt19937                    random(t + 1);
+            std::vector<HandlePool::Handle> held;
+            for (int step = 0; step < kSteps; step++)
+            {
+                if (held.empty() || (held.size() < kCapacity / 4 && random() % 2 == 0))
+                {
+                    HandlePool::Handle handle = pool.Allocate();
+                    if (!handle.IsValid())
+                        continue;
+                    if (owners[handle.index].exchange(t + 1) != 0)
+                        conflicts++;
+                    held.push_back(handle);
+                }
+                else
+                {
+                    size_t             victim = random() % held.size();
+                    HandlePool::Handle handle = held[victim];
+                    held[victim]              = held.back();
+                    held.pop_back();
+                    if (!pool.IsAlive(handle))
+                        lost++;
+                    if (owners[handle.index].exchange(0) != t + 1)
+                        conflicts++;
+                    if (!pool.Free(handle))
+                        lost++;
+                }
+            }
+            for (const HandlePool::Handle& handle : held)
+            {
+                owners[handle.index] = 0;
+                pool.Free(handle);
+            }
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+
+    EXPECT_EQ(conflicts.load(), 0);
+    EXPECT_EQ(lost.load(), 0);
+    EXPECT_EQ(pool.GetAllocatedCount(), 0u);
+
+    // Every index made it back to the free list exactly once.
+    std::vector<bool> seen(kCapacity, false);
+    for (uint32_t i = 0; i < kCapacity; i++)
+    {
+        HandlePool::Handle handle = pool.Allocate();
+        ASSERT_TRUE(handle.IsValid());
+        EXPECT_FALSE(seen[handle.index]);
+        seen[handle.index] = true;
+    }
+    EXPECT_FALSE(pool.Allocate().IsValid());
+}
@@ -0,0 +1,157 @@
+#include "linearallocator.h"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <unordered_map>
+
+namespace
+{
+
+constexpr uint64_t kConstantAlignment = 256;
+constexpr uint64_t kPageSize          = 64 * 1024;
+// Window::BufferCount.
+constexpr uint64_t kFramesInFlight = 3;
+
+// Stands in for the DIRECT queue fence, completing a fixed number of frames
+// behind the CPU.
+struct FakeFence
+{
+    uint64_t signaled  = 0;
+    uint64_t completed = 0;
+
+    uint64_t Signal() { return ++signaled; }
+    void     Lag(uint64_t frames) { completed = std::max(completed, signaled > frames ? signaled - frames : 0); }
+};
+
+} // namespace
+
+TEST(LinearAllocator, BumpsThroughAPage)
+{
+    LinearAllocator allocator(kPageSize);
+    auto            a = allocator.Allocate(100, kConstantAlignment);
+    auto            b = allocator.Allocate(100, kConstantAlignment);
+    auto            c = allocator.Allocate(1, 1);
+    EXPECT_EQ(a.page, 0u);
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(b.page, 0u);
+    EXPECT_EQ(b.offset, 256u);
+    EXPECT_EQ(c.offset, 356u);
+    EXPECT_EQ(allocator.GetPageCount(), 1u);
+}
+
+TEST(LinearAllocator, RejectsEmptyAndOversized)
+{
+    LinearAllocator allocator(kPageSize);
+    EXPECT_EQ(allocator.Allocate(0, 1).page, LinearAllocator::InvalidPage);
+    EXPECT_EQ(allocator.Allocate(kPageSize + 1, 1).page, LinearAllocator::InvalidPage);
+    EXPECT_EQ(allocator.Allocate(kPageSize, kConstantAlignment).page, 0u);
+}
+
+TEST(LinearAllocator, MovesToANewPageWhenFull)
+{
+    LinearAllocator allocator(1024);
+    allocator.Allocate(1000, 1);
+    auto next = allocator.Allocate(100, 1);
+    EXPECT_EQ(next.page, 1u);
+    EXPECT_EQ(next.offset, 0u);
+}
+
+TEST(LinearAllocator, EveryFrameGetsItsOwnPages)
+{
+    FakeFence       fence;
+    LinearAllocator allocator(kPageSize);
+
+    auto first = allocator.Allocate(256, kConstantAlignment);
+    allocator.Submit(fence.Signal());
+    auto second = allocator.Allocate(256, kConstantAlignment);
+    EXPECT_NE(first.page, second.page);
+    EXPECT_EQ(second.offset, 0u);
+
+    allocator.Submit(fence.Signal());
+    fence.completed = 1;
+    allocator.Retire(fence.completed);
+    EXPECT_EQ(allocator.GetFreePageCount(), 1u);
+
+    // The first frame's page comes back.
+    EXPECT_EQ(allocator.Allocate(256, kConstantAlignment).page, first.page);
+    EXPECT_EQ(allocator.GetPageCount(), 2u);
+}
+
+TEST(LinearAllocator, EmptyFrameSubmitsNothing)
+{
+    LinearAllocator allocator(kPageSize);
+    allocator.Submit(1);
+    allocator.Retire(1);
+    EXPECT_EQ(allocator.GetFreePageCount(), 0u);
+    EXPECT_EQ(allocator.GetPageCount(), 0u);
+}
+
+// 100k constant buffers per frame with the GPU a few frames behind. No
+// page may be handed to a frame while an earlier frame that has not
+// completed still owns it, allocations within a page never overlap, and the
+// page count settles instead of growing every frame.
+TEST(LinearAllocator, StressHundredThousandPerFrame)
+{
+    const uint32_t kAllocationsPerFrame = 100000;
+    const int      kFrames              = 24;
+
+    FakeFence       fence;
+    LinearAllocator allocator(kPageSize);
+
+    std::mt19937                            random(11);
+    std::uniform_int_distribution<uint64_t> size(1, 1024);
+
+    // Fence value of the frame that last used every page, 0 while the
+    // current frame owns it.
+    std::unordered_map<uint32_t, uint64_t> owner;
+    uint64_t                               bytes       = 0;
+    uint32_t                               steadyPages = 0;
+    for (int frame = 0; frame < kFrames; frame++)
+    {
+        uint32_t lastPage = LinearAllocator::InvalidPage;
+        uint64_t lastEnd  = 0;
+        for (uint32_t i = 0; i < kAllocationsPerFrame; i++)
+        {
+            uint64_t                    bytesWanted = size(random);
+            LinearAllocator::Allocation allocation  = allocator.Allocate(bytesWanted, kConstantAlignment);
+            ASSERT_NE(allocation.page, LinearAllocator::InvalidPage);
+            ASSERT_EQ(allocation.offset % kConstantAlignment, 0u);
+            ASSERT_LE(allocation.offset + bytesWanted, kPageSize);
+
+            if (allocation.page != lastPage)
+            {
+                auto previous = owner.find(allocation.page);
+                if (previous != owner.end())
+                {
+                    ASSERT_TRUE(previous->second != 0 && previous->second <= fence.completed)
+                        << "page " << allocation.page << " still in flight";
+                }
+                owner[allocation.page] = 0;
+                lastPage               = allocation.page;
+                lastEnd                = 0;
+            }
+            ASSERT_GE(allocation.offset, lastEnd);
+            lastEnd = allocation.offset + bytesWanted;
+            bytes += bytesWanted;
+        }
+
+        uint64_t value = fence.Signal();
+        allocator.Submit(value);
+        for (auto& page : owner)
+            if (page.second == 0)
+                page.second = value;
+
+        fence.Lag(kFramesInFlight - 1);
+        allocator.Retire(fence.completed);
+        if (frame == kFrames / 2)
+            steadyPages = allocator.GetPageCount();
+    }
+
+    // Random sizes make a frame take a page more now and then, no more.
+    EXPECT_LE(allocator.GetPageCount(), steadyPages + steadyPages / 100);
+    // An allocation takes at most 1024 + 255 bytes with the padding, and
+    // only the frames in flight hold pages.
+    EXPECT_LE(allocator.GetPageCount(), uint32_t(kFramesInFlight * (kAllocationsPerFrame * 1279 / kPageSize + 1)));
+    EXPECT_GT(bytes, 0u);
+}
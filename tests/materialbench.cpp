@@ -0,0 +1,127 @@
+/**
+ * CPU cost of recording submesh draws on one command list, with the
+ * material pushed as 12 root constants per draw as MeshApp::RecordDraws
+ * used to, against an index into the material table bound once.
+ */
+#include "meshdata.h"
+#include "nullcommandlist.h"
+#include "vertexformat.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr uint32_t kMaterialCount = 64;
+
+struct Scene
+{
+    std::vector<MeshMaterial>       materials;
+    std::vector<uint32_t>           materialIds;
+    std::vector<VertexQuantization> quantization;
+    std::vector<uint32_t>           indexCounts;
+    std::vector<uint32_t>           indexOffsets;
+
+    explicit Scene(size_t drawCount)
+    {
+        std::mt19937 random(7);
+        materials.resize(kMaterialCount);
+        for (MeshMaterial& material : materials)
+            material.diffuse = glm::vec4(float(random() % 256) / 255.0f, 0.5f, 0.5f, 1.0f);
+        // The table ends with the default material, like LoadObjMesh's.
+        materials.push_back(MeshMaterial::default_material());
+
+        materialIds.resize(drawCount);
+        quantization.resize(drawCount);
+        indexCounts.resize(drawCount);
+        indexOffsets.resize(drawCount);
+        uint32_t offset = 0;
+        for (size_t s = 0; s < drawCount; s++)
+        {
+            // Some submeshes have no valid material.
+            materialIds[s]         = random() % (kMaterialCount + 8);
+            quantization[s].offset = glm::vec4(float(s), 0.0f, 0.0f, 0.0f);
+            indexCounts[s]         = 3 * (1 + random() % 2000);
+            indexOffsets[s]        = offset;
+            offset += indexCounts[s];
+        }
+    }
+};
+
+void BindPipeline(NullCommandList& commandList)
+{
+    for (uint32_t op = 1; op <= 10; op++)
+        commandList.SetState(op, op);
+}
+
+// Before: the material, light direction included, copied per draw.
+void RecordMaterialConstants(NullCommandList& commandList, const Scene& scene, const glm::vec3& lightDir)
+{
+    BindPipeline(commandList);
+    for (size_t s = 0; s < scene.materialIds.size(); s++)
+    {
+        MeshMaterial material = scene.materialIds[s] < kMaterialCount ? scene.materials[scene.materialIds[s]] :
+                                                                        MeshMaterial::default_material();
+        material.lightDir     = glm::vec4(lightDir, 0.0);
+        commandList.SetGraphicsRoot32BitConstants(1, sizeof(MeshMaterial) / sizeof(uint32_t), &material, 0);
+        commandList.SetGraphicsRoot32BitConstants(2, sizeof(VertexQuantization) / sizeof(uint32_t), &scene.quantization[s], 0);
+        commandList.DrawIndexedInstanced(scene.indexCounts[s], 1, scene.indexOffsets[s], 0, 0);
+    }
+}
+
+// After: the table is bound with the pipeline, a draw passes its index.
+void RecordMaterialIndex(NullCommandList& commandList, const Scene& scene)
+{
+    BindPipeline(commandList);
+    commandList.SetState(11, 0);
+    uint32_t materialCount = uint32_t(scene.materials.size());
+    for (size_t s = 0; s < scene.materialIds.size(); s++)
+    {
+        uint32_t material = std::min<uint32_t>(scene.materialIds[s], materialCount - 1);
+        commandList.SetGraphicsRoot32BitConstant(1, material, 0);
+        commandList.SetGraphicsRoot32BitConstants(2, sizeof(VertexQuantization) / sizeof(uint32_t), &scene.quantization[s], 0);
+        commandList.DrawIndexedInstanced(scene.indexCounts[s], 1, scene.indexOffsets[s], 0, 0);
+    }
+}
+
+void BM_RecordMaterialConstants(benchmark::State& state)
+{
+    Scene           scene(size_t(state.range(0)));
+    NullCommandList commandList;
+    glm::vec3       lightDir(1.0f, 1.0f, 0.0f);
+    for (auto _ : state)
+    {
+        commandList.Reset();
+        RecordMaterialConstants(commandList, scene, lightDir);
+        commandList.Close();
+        benchmark::ClobberMemory();
+    }
+    state.counters["draws/s"] = benchmark::Counter(double(state.range(0)), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["KB"]      = double(commandList.GetPacketSize() * sizeof(uint32_t)) / 1024.0;
+}
+
+void BM_RecordMaterialIndex(benchmark::State& state)
+{
+    Scene           scene(size_t(state.range(0)));
+    NullCommandList commandList;
+    for (auto _ : state)
+    {
+        commandList.Reset();
+        RecordMaterialIndex(commandList, scene);
+        commandList.Close();
+        benchmark::ClobberMemory();
+    }
+    state.counters["draws/s"] = benchmark::Counter(double(state.range(0)), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["KB"]      = double(commandList.GetPacketSize() * sizeof(uint32_t)) / 1024.0;
+}
+
+} // namespace
+
+BENCHMARK(BM_RecordMaterialConstants)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_RecordMaterialIndex)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,117 @@
+#include "materialsort.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+
+namespace
+{
+
+struct Triangles
+{
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> materials;
+
+    // Triangle t holds indices 3t, 3t+1 and 3t+2, so the output names where
+    // every triangle came from. Materials come in runs of random length,
+    // some materials never used.
+    Triangles(size_t count, uint32_t materialCount, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        indices.resize(3 * count);
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = uint32_t(i);
+        materials.resize(count);
+        uint32_t material = 0;
+        for (size_t t = 0; t < count; t++)
+        {
+            if (random() % 5 == 0)
+                material = random() % materialCount;
+            materials[t] = material % 3 == 2 ? 0 : material;
+        }
+    }
+};
+
+} // namespace
+
+TEST(MaterialSort, CountMaterialRuns)
+{
+    EXPECT_EQ(CountMaterialRuns({}), 0u);
+    EXPECT_EQ(CountMaterialRuns({ 4 }), 1u);
+    EXPECT_EQ(CountMaterialRuns({ 1, 1, 2, 2, 2, 1, 3, 3 }), 4u);
+}
+
+// One range per used material, in material order, covering every index,
+// and within a range the triangles keep their input order.
+TEST(MaterialSort, OneStableRangePerMaterial)
+{
+    const uint32_t kMaterialCount = 12;
+    Triangles      input(20000, kMaterialCount, 1);
+    ASSERT_GT(CountMaterialRuns(input.materials), 1000u);
+
+    std::vector<uint32_t>    indices = input.indices;
+    std::vector<MeshSubMesh> submeshes;
+    SortTrianglesByMaterial(indices, input.materials, kMaterialCount, submeshes);
+    ASSERT_EQ(indices.size(), input.indices.size());
+
+    uint32_t offset = 0;
+    for (size_t s = 0; s < submeshes.size(); s++)
+    {
+        const MeshSubMesh& submesh = submeshes[s];
+        EXPECT_EQ(submesh.index_offset, offset);
+        EXPECT_GT(submesh.index_count, 0u);
+        EXPECT_NE(submesh.material_id % 3, 2u);
+        if (s > 0)
+            EXPECT_LT(submeshes[s - 1].material_id, submesh.material_id);
+        offset += submesh.index_count;
+
+        uint32_t previous = 0;
+        for (uint32_t i = submesh.index_offset; i < submesh.index_offset + submesh.index_count; i += 3)
+        {
+            uint32_t triangle = indices[i] / 3;
+            ASSERT_EQ(indices[i], 3 * triangle);
+            ASSERT_EQ(indices[i + 1], 3 * triangle + 1);
+            ASSERT_EQ(indices[i + 2], 3 * triangle + 2);
+            ASSERT_EQ(input.materials[triangle], submesh.material_id);
+            if (i > submesh.index_offset)
+                ASSERT_GT(triangle, previous) << "material " << submesh.material_id;
+            previous = triangle;
+        }
+    }
+    EXPECT_EQ(offset, indices.size());
+
+    size_t used = 0;
+    for (uint32_t m = 0; m < kMaterialCount; m++)
+        used += std::find(input.materials.begin(), input.materials.end(), m) != input.materials.end();
+    EXPECT_EQ(submeshes.size(), used);
+}
+
+// Every chunk count, including more chunks than triangles, gives the
+// single chunk output.
+TEST(MaterialSort, ChunksMatchOneChunk)
+{
+    const uint32_t kMaterialCount = 40;
+    for (size_t count : { size_t(0), size_t(5), size_t(1001), size_t(150000) })
+    {
+        Triangles                input(count, kMaterialCount, uint32_t(count));
+        std::vector<uint32_t>    expected = input.indices;
+        std::vector<MeshSubMesh> expectedSubmeshes;
+        SortTrianglesByMaterial(expected, input.materials, kMaterialCount, expectedSubmeshes, 1);
+
+        for (size_t chunks : { 0, 2, 3, 8, 16 })
+        {
+            std::vector<uint32_t>    indices = input.indices;
+            std::vector<MeshSubMesh> submeshes;
+            SortTrianglesByMaterial(indices, input.materials, kMaterialCount, submeshes, chunks);
+            EXPECT_EQ(indices, expected) << count << " triangles, " << chunks << " chunks";
+            ASSERT_EQ(submeshes.size(), expectedSubmeshes.size());
+            for (size_t s = 0; s < submeshes.size(); s++)
+            {
+                EXPECT_EQ(submeshes[s].index_offset, expectedSubmeshes[s].index_offset);
+                EXPECT_EQ(submeshes[s].index_count, expectedSubmeshes[s].index_count);
+                EXPECT_EQ(submeshes[s].material_id, expectedSubmeshes[s].material_id);
+            }
+        }
+    }
+}
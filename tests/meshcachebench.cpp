@@ -0,0 +1,122 @@
+/**
+ * Cold against warm mesh loads. A cold load parses the OBJ, deduplicates
+ * the vertices and writes the cache, the app runs more passes on top. A
+ * warm load maps the cache and reads the mesh through the view. The
+ * restamp case touches the OBJ first, so the content is hashed again.
+ */
+#include "meshcache.h"
+#include "meshweld.h"
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+#include <chrono>
+
+namespace
+{
+
+struct Options
+{
+    float weldEpsilon = 0.0f;
+};
+
+struct Fixture
+{
+    ScratchDirectory directory { "meshcachebench" };
+    std::string      objPath;
+    std::string      cachePath;
+    size_t           triangleCount = 0;
+};
+
+Fixture& GetFixture(size_t triangleCount)
+{
+    static Fixture fixture;
+    if (fixture.triangleCount != triangleCount)
+    {
+        fixture.objPath   = fixture.directory / "grid.obj";
+        fixture.cachePath = fixture.directory / "grid.pmesh";
+        WriteGridObj(fixture.objPath, triangleCount);
+        fixture.triangleCount = triangleCount;
+    }
+    return fixture;
+}
+
+bool ColdLoad(const Fixture& fixture)
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string                      warn, err;
+    if (!LoadObjParallel(&attrib, &shapes, &materials, &warn, &err, fixture.objPath.c_str(), fixture.directory.GetPath().string().c_str()))
+        return false;
+
+    MeshBuffers mesh;
+    DeduplicateCorners(attrib, shapes, mesh.vertices, mesh.indices);
+    mesh.submeshes.push_back(MeshSubMesh { 0, uint32_t(mesh.indices.size()), 0, 0, uint32_t(mesh.vertices.size()), 0, 0, 0, 0 });
+
+    MeshSources sources;
+    Options     options;
+    return sources.Collect(fixture.objPath, fixture.directory.GetPath().string()) &&
+           WriteMeshCache(fixture.cachePath, sources, &options, sizeof(options), mesh);
+}
+
+// Reads every index, as the upload would.
+uint64_t WarmLoad(const Fixture& fixture)
+{
+    MeshCache cache;
+    Options   options;
+    if (!cache.Open(fixture.cachePath, &options, sizeof(options)))
+        return 0;
+    uint64_t sum = 0;
+    for (uint32_t index : cache.GetView().indices)
+        sum += index;
+    return sum + 1;
+}
+
+void BM_ColdLoad(benchmark::State& state)
+{
+    Fixture& fixture = GetFixture(size_t(state.range(0)));
+    for (auto _ : state)
+    {
+        if (!ColdLoad(fixture))
+            state.SkipWithError("cold load failed");
+    }
+}
+
+void BM_WarmLoad(benchmark::State& state)
+{
+    Fixture& fixture = GetFixture(size_t(state.range(0)));
+    ColdLoad(fixture);
+    for (auto _ : state)
+    {
+        uint64_t sum = WarmLoad(fixture);
+        if (sum == 0)
+            state.SkipWithError("warm load failed");
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+void BM_WarmLoadRestamp(benchmark::State& state)
+{
+    Fixture& fixture = GetFixture(size_t(state.range(0)));
+    ColdLoad(fixture);
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        std::filesystem::last_write_time(fixture.objPath, std::filesystem::last_write_time(fixture.objPath) + std::chrono::seconds(1));
+        state.ResumeTiming();
+        uint64_t sum = WarmLoad(fixture);
+        if (sum == 0)
+            state.SkipWithError("warm load failed");
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_ColdLoad)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WarmLoad)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_WarmLoadRestamp)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
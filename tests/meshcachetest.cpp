@@ -0,0 +1,138 @@
+#include "meshcache.h"
+#include "synthetic.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <fstream>
+
+namespace
+{
+
+struct Options
+{
+    float weldEpsilon = 0.0f;
+};
+
+class MeshCacheTest : public ::testing::Test
+{
+protected:
+    MeshCacheTest() :
+        m_Directory(std::string("meshcachetest-") + ::testing::UnitTest::GetInstance()->current_test_info()->name()),
+        m_ObjPath(m_Directory / "grid.obj"),
+        m_CachePath(m_Directory / "grid.pmesh"),
+        m_Mesh(MakeGridMesh(64, 32, 4))
+    {
+        WriteGridObj(m_ObjPath, 1000);
+        EXPECT_TRUE(m_Sources.Collect(m_ObjPath, m_Directory.GetPath().string()));
+        EXPECT_TRUE(WriteMeshCache(m_CachePath, m_Sources, &m_Options, sizeof(m_Options), m_Mesh));
+    }
+
+    bool Open(MeshCache& cache) { return cache.Open(m_CachePath, &m_Options, sizeof(m_Options)); }
+
+    MeshCacheHeader ReadHeader()
+    {
+        MeshCacheHeader header = {};
+        std::ifstream   file(m_CachePath, std::ios::binary);
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        return header;
+    }
+
+    MeshSourceStamp ReadStamp(uint32_t index)
+    {
+        MeshSourceStamp stamp = {};
+        std::ifstream   file(m_CachePath, std::ios::binary);
+        file.seekg(std::streamoff(ReadHeader().sections[MESH_CACHE_SECTION_SOURCES].offset + index * sizeof(stamp)));
+        file.read(reinterpret_cast<char*>(&stamp), sizeof(stamp));
+        return stamp;
+    }
+
+    template <typename T>
+    void Patch(uint64_t offset, const T& value)
+    {
+        std::fstream file(m_CachePath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(std::streamoff(offset));
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    ScratchDirectory m_Directory;
+    std::string      m_ObjPath;
+    std::string      m_CachePath;
+    MeshBuffers      m_Mesh;
+    MeshSources      m_Sources;
+    Options          m_Options;
+};
+
+TEST_F(MeshCacheTest, ViewPointsAtTheWrittenMesh)
+{
+    MeshCache cache;
+    ASSERT_TRUE(Open(cache));
+    MeshView view = cache.GetView();
+    ASSERT_EQ(view.vertices.size(), m_Mesh.vertices.size());
+    ASSERT_EQ(view.indices.size(), m_Mesh.indices.size());
+    ASSERT_EQ(view.submeshes.size(), m_Mesh.submeshes.size());
+    EXPECT_TRUE(std::equal(view.indices.begin(), view.indices.end(), m_Mesh.indices.begin()));
+    EXPECT_TRUE(std::equal(view.vertices.begin(), view.vertices.end(), m_Mesh.vertices.begin()));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(view.vertices.data) % kMeshCacheAlignment, 0u);
+    // The OBJ and its MTL.
+    EXPECT_EQ(m_Sources.stamps.size(), 2u);
+}
+
+TEST_F(MeshCacheTest, OtherOptionsAreRejected)
+{
+    Options   other = { 0.5f };
+    MeshCache cache;
+    EXPECT_FALSE(cache.Open(m_CachePath, &other, sizeof(other)));
+}
+
+TEST_F(MeshCacheTest, ChangedContentIsRejected)
+{
+    WriteGridObj(m_ObjPath, 2000);
+    MeshCache cache;
+    EXPECT_FALSE(Open(cache));
+}
+
+TEST_F(MeshCacheTest, TouchedSourceIsRestamped)
+{
+    auto touched = std::filesystem::last_write_time(m_ObjPath) + std::chrono::seconds(10);
+    std::filesystem::last_write_time(m_ObjPath, touched);
+    ASSERT_NE(ReadStamp(0).writeTime, int64_t(touched.time_since_epoch().count()));
+
+    // Same content, the cache is kept and the new stamp written back so the
+    // next open does not hash again.
+    MeshCache cache;
+    ASSERT_TRUE(Open(cache));
+    EXPECT_EQ(cache.GetView().indices.size(), m_Mesh.indices.size());
+    cache.Close();
+    EXPECT_EQ(ReadStamp(0).writeTime, int64_t(touched.time_since_epoch().count()));
+    EXPECT_TRUE(Open(cache));
+}
+
+TEST_F(MeshCacheTest, TruncatedFileIsRejected)
+{
+    std::filesystem::resize_file(m_CachePath, std::filesystem::file_size(m_CachePath) - kMeshCacheAlignment);
+    MeshCache cache;
+    EXPECT_FALSE(Open(cache));
+}
+
+TEST_F(MeshCacheTest, WrappingSectionCountIsRejected)
+{
+    // count * stride wraps to a small value.
+    uint64_t count  = (UINT64_MAX / sizeof(MeshVertex)) + 2;
+    uint64_t offset = offsetof(MeshCacheHeader, sections) + MESH_CACHE_SECTION_VERTICES * sizeof(MeshCacheSection) + offsetof(MeshCacheSection, count);
+    Patch(offset, count);
+    MeshCache cache;
+    EXPECT_FALSE(Open(cache));
+}
+
+TEST_F(MeshCacheTest, UnterminatedStampPathIsRejected)
+{
+    MeshSourceStamp stamp = ReadStamp(0);
+    memset(stamp.path, 'x', sizeof(stamp.path));
+    stamp.writeTime++;
+    Patch(ReadHeader().sections[MESH_CACHE_SECTION_SOURCES].offset, stamp);
+    MeshCache cache;
+    EXPECT_FALSE(Open(cache));
+}
+
+} // namespace
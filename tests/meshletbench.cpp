@@ -0,0 +1,52 @@
+/**
+ * Meshlet build throughput and how full the meshlets get, on generated
+ * grids in vertex cache order.
+ */
+#include "meshlet.h"
+#include "synthetic.h"
+#include "vertexcache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+
+namespace
+{
+
+const MeshBuffers& Grid(size_t triangleCount)
+{
+    static std::map<size_t, MeshBuffers> grids;
+    MeshBuffers&                         mesh = grids[triangleCount];
+    if (mesh.indices.empty())
+    {
+        uint32_t rows = uint32_t(std::max<size_t>(1, triangleCount / 512));
+        mesh          = MakeGridMesh(256, rows, 16);
+        OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    }
+    return mesh;
+}
+
+void BM_BuildMeshlets(benchmark::State& state)
+{
+    MeshBuffers mesh          = Grid(size_t(state.range(0)));
+    size_t      triangleCount = mesh.indices.size() / 3;
+    for (auto _ : state)
+    {
+        BuildMeshlets(mesh);
+        benchmark::DoNotOptimize(mesh.meshlet_bounds.data());
+    }
+
+    size_t vertices = mesh.meshlet_vertices.size();
+    state.counters["triangles/s"]   = benchmark::Counter(double(triangleCount), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["meshlets"]      = double(mesh.meshlets.size());
+    state.counters["triangle_fill"] = double(triangleCount) / double(mesh.meshlets.size() * kMeshletMaxTriangles);
+    state.counters["vertex_fill"]   = double(vertices) / double(mesh.meshlets.size() * kMeshletMaxVertices);
+    // Vertex shader invocations per triangle, 0.5 is the grid's ideal.
+    state.counters["vertices/triangle"] = double(vertices) / double(triangleCount);
+}
+
+} // namespace
+
+BENCHMARK(BM_BuildMeshlets)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,235 @@
+#include "meshlet.h"
+#include "synthetic.h"
+#include "vertexcache.h"
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+
+namespace
+{
+
+// A grid bent into a bumpy surface, so the meshlet normals spread.
+MeshBuffers MakeBumpyMesh(uint32_t columns, uint32_t rows, uint32_t submeshCount)
+{
+    MeshBuffers mesh = MakeGridMesh(columns, rows, submeshCount);
+    for (auto& vertex : mesh.vertices)
+        vertex.position.y = 0.03f * std::sin(vertex.position.x * 9.0f) * std::cos(vertex.position.z * 7.0f);
+    OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    return mesh;
+}
+
+glm::vec3 TriangleNormal(const MeshBuffers& mesh, const Meshlet& meshlet, uint32_t t, glm::vec3& corner)
+{
+    uint32_t local[3];
+    UnpackMeshletTriangle(mesh.meshlet_triangles[meshlet.triangle_offset + t], local);
+    glm::vec3 p[3];
+    for (int k = 0; k < 3; k++)
+        p[k] = mesh.vertices[mesh.meshlet_vertices[meshlet.vertex_offset + local[k]]].position;
+    corner = p[0];
+    return glm::cross(p[1] - p[0], p[2] - p[0]);
+}
+
+} // namespace
+
+// Every submesh triangle ends up in exactly one of its meshlets, in index
+// order, and no meshlet is over the limits.
+TEST(Meshlet, CoversEveryTriangleWithinLimits)
+{
+    MeshBuffers mesh = MakeBumpyMesh(100, 90, 3);
+    BuildMeshlets(mesh);
+
+    ASSERT_EQ(mesh.meshlet_bounds.size(), mesh.meshlets.size());
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+    {
+        ASSERT_GT(submesh.meshlet_count, 0u);
+        std::vector<uint32_t> rebuilt;
+        for (uint32_t m = submesh.meshlet_offset; m < submesh.meshlet_offset + submesh.meshlet_count; m++)
+        {
+            const Meshlet& meshlet = mesh.meshlets[m];
+            ASSERT_GE(meshlet.triangle_count, 1u);
+            ASSERT_LE(meshlet.vertex_count, kMeshletMaxVertices);
+            ASSERT_LE(meshlet.triangle_count, kMeshletMaxTriangles);
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+            {
+                uint32_t local[3];
+                UnpackMeshletTriangle(mesh.meshlet_triangles[meshlet.triangle_offset + t], local);
+                for (int k = 0; k < 3; k++)
+                {
+                    ASSERT_LT(local[k], meshlet.vertex_count);
+                    rebuilt.push_back(mesh.meshlet_vertices[meshlet.vertex_offset + local[k]]);
+                }
+            }
+        }
+        std::vector<uint32_t> expected(mesh.indices.begin() + submesh.index_offset,
+                                       mesh.indices.begin() + submesh.index_offset + submesh.index_count);
+        ASSERT_EQ(rebuilt, expected);
+    }
+}
+
+TEST(Meshlet, CustomLimits)
+{
+    MeshBuffers mesh = MakeBumpyMesh(40, 40, 1);
+    BuildMeshlets(mesh, 32, 16);
+
+    uint32_t triangles = 0;
+    for (const Meshlet& meshlet : mesh.meshlets)
+    {
+        ASSERT_LE(meshlet.vertex_count, 32u);
+        ASSERT_LE(meshlet.triangle_count, 16u);
+        triangles += meshlet.triangle_count;
+    }
+    EXPECT_EQ(triangles, mesh.indices.size() / 3);
+    // A grid in cache order fills the triangle limit most of the time.
+    EXPECT_LT(mesh.meshlets.size(), triangles / 12);
+}
+
+// Limits above what 8 bit local indices and the bounds can hold are
+// clamped, and every triangle still lands in a meshlet.
+TEST(Meshlet, LargeLimitsAreClamped)
+{
+    MeshBuffers mesh = MakeBumpyMesh(40, 40, 1);
+    BuildMeshlets(mesh, 255, 512);
+
+    uint32_t triangles = 0;
+    for (const Meshlet& meshlet : mesh.meshlets)
+    {
+        ASSERT_LE(meshlet.vertex_count, 255u);
+        ASSERT_LE(meshlet.triangle_count, 256u);
+        triangles += meshlet.triangle_count;
+    }
+    EXPECT_EQ(triangles, mesh.indices.size() / 3);
+    EXPECT_EQ(mesh.meshlet_bounds.size(), mesh.meshlets.size());
+
+    BuildMeshlets(mesh, 1000, 1000);
+    for (const Meshlet& meshlet : mesh.meshlets)
+        ASSERT_LE(meshlet.triangle_count, 256u);
+}
+
+TEST(Meshlet, SpheresContainTheirVertices)
+{
+    MeshBuffers mesh = MakeBumpyMesh(64, 64, 2);
+    BuildMeshlets(mesh);
+
+    for (size_t m = 0; m < mesh.meshlets.size(); m++)
+    {
+        const Meshlet&       meshlet = mesh.meshlets[m];
+        const MeshletBounds& bounds  = mesh.meshlet_bounds[m];
+        float                reach   = 0.0f;
+        for (uint32_t v = 0; v < meshlet.vertex_count; v++)
+        {
+            const glm::vec3& p = mesh.vertices[mesh.meshlet_vertices[meshlet.vertex_offset + v]].position;
+            reach              = std::max(reach, glm::length(p - bounds.center));
+        }
+        ASSERT_LE(reach, bounds.radius * (1.0f + 1e-5f)) << m;
+        // Ritter's sphere is not much bigger than the farthest vertex.
+        ASSERT_LE(bounds.radius, reach * 1.25f) << m;
+    }
+}
+
+// The apex is behind every triangle plane and every normal is inside the
+// cone, so a backfacing meshlet has only backfacing triangles.
+TEST(Meshlet, ConeIsConservative)
+{
+    MeshBuffers mesh = MakeBumpyMesh(64, 64, 1);
+    BuildMeshlets(mesh);
+
+    std::mt19937                          random(7);
+    std::uniform_real_distribution<float> coordinate(-2.0f, 3.0f);
+    size_t                                culled = 0;
+    for (size_t m = 0; m < mesh.meshlets.size(); m++)
+    {
+        const Meshlet&       meshlet = mesh.meshlets[m];
+        const MeshletBounds& bounds  = mesh.meshlet_bounds[m];
+        if (bounds.cone_cutoff >= 1.0f)
+            continue;
+
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+        {
+            glm::vec3 corner;
+            glm::vec3 normal = glm::normalize(TriangleNormal(mesh, meshlet, t, corner));
+            ASSERT_LE(glm::dot(bounds.cone_apex - corner, normal), 1e-5f);
+            // sin of the angle to the axis within the cutoff.
+            float sine = glm::length(glm::cross(normal, bounds.cone_axis));
+            ASSERT_TRUE(glm::dot(normal, bounds.cone_axis) > 0.0f && sine <= bounds.cone_cutoff + 1e-5f);
+        }
+
+        for (int e = 0; e < 64; e++)
+        {
+            glm::vec3 eye(coordinate(random), coordinate(random), coordinate(random));
+            if (!IsMeshletBackfacing(bounds, eye))
+                continue;
+            culled++;
+            for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+            {
+                glm::vec3 corner;
+                glm::vec3 normal = TriangleNormal(mesh, meshlet, t, corner);
+                ASSERT_GE(glm::dot(normal, corner - eye), 0.0f) << m << " " << t;
+            }
+        }
+    }
+    // About a third of the eyes are under the surface.
+    EXPECT_GT(culled, mesh.meshlets.size() * 10);
+}
+
+TEST(Meshlet, FlatMeshletCullsFromBelowOnly)
+{
+    // 7 x 7 quads, 64 vertices and 98 triangles.
+    MeshBuffers mesh = MakeGridMesh(7, 7);
+    for (auto& vertex : mesh.vertices)
+        vertex.position.y = 0.0f;
+    BuildMeshlets(mesh);
+    ASSERT_EQ(mesh.meshlets.size(), 1u);
+
+    // The grid winding faces +y.
+    const MeshletBounds& bounds = mesh.meshlet_bounds[0];
+    EXPECT_NEAR(bounds.cone_axis.y, 1.0f, 1e-6f);
+    EXPECT_NEAR(bounds.cone_cutoff, 0.0f, 1e-3f);
+    EXPECT_TRUE(IsMeshletBackfacing(bounds, glm::vec3(0.5f, -1.0f, 0.5f)));
+    EXPECT_FALSE(IsMeshletBackfacing(bounds, glm::vec3(0.5f, 1.0f, 0.5f)));
+    EXPECT_FALSE(IsMeshletBackfacing(bounds, glm::vec3(10.0f, 0.01f, 0.5f)));
+}
+
+TEST(Meshlet, DegenerateTrianglesNeverCull)
+{
+    MeshBuffers mesh;
+    mesh.vertices.resize(3);
+    mesh.vertices[0].position = glm::vec3(0.0f);
+    mesh.vertices[1].position = glm::vec3(1.0f, 0.0f, 0.0f);
+    mesh.vertices[2].position = glm::vec3(2.0f, 0.0f, 0.0f);
+    mesh.indices              = { 0, 1, 2, 0, 0, 1 };
+    MeshSubMesh submesh       = {};
+    submesh.index_count       = 6;
+    mesh.submeshes.push_back(submesh);
+
+    BuildMeshlets(mesh);
+    ASSERT_EQ(mesh.meshlets.size(), 1u);
+    EXPECT_EQ(mesh.meshlets[0].vertex_count, 3u);
+    EXPECT_EQ(mesh.meshlet_bounds[0].cone_cutoff, 1.0f);
+    EXPECT_FALSE(IsMeshletBackfacing(mesh.meshlet_bounds[0], glm::vec3(0.0f, 5.0f, 0.0f)));
+    EXPECT_NEAR(mesh.meshlet_bounds[0].radius, 1.0f, 1e-6f);
+}
+
+TEST(Meshlet, FrustumPlanes)
+{
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 1.5f, 0.1f, 100.0f);
+    glm::mat4 view       = glm::lookAtRH(glm::vec3(0.0f, 0.0f, 5.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    ExtractFrustumPlanes(projection * view, planes);
+
+    for (int p = 0; p < 6; p++)
+        EXPECT_NEAR(glm::length(glm::vec3(planes[p])), 1.0f, 1e-5f);
+
+    EXPECT_FALSE(IsSphereOutsideFrustum(glm::vec3(0.0f), 1.0f, planes));
+    // Behind the camera, past the far plane and off to the side.
+    EXPECT_TRUE(IsSphereOutsideFrustum(glm::vec3(0.0f, 0.0f, 7.0f), 1.0f, planes));
+    EXPECT_TRUE(IsSphereOutsideFrustum(glm::vec3(0.0f, 0.0f, -100.0f), 1.0f, planes));
+    EXPECT_TRUE(IsSphereOutsideFrustum(glm::vec3(50.0f, 0.0f, 0.0f), 1.0f, planes));
+    // Straddling the near plane is inside.
+    EXPECT_FALSE(IsSphereOutsideFrustum(glm::vec3(0.0f, 0.0f, 4.95f), 0.1f, planes));
+
+    // The distance to the near plane is the view depth minus near.
+    EXPECT_NEAR(glm::dot(glm::vec3(planes[4]), glm::vec3(0.0f)) + planes[4].w, 4.9f, 1e-4f);
+}
@@ -0,0 +1,107 @@
+/**
+ * Vertex deduplication throughput and the vertex and byte reduction it
+ * gets, on generated grids and on the OBJ file named by PETIT_BENCH_OBJ,
+ * bin/models/bmw.obj for instance.
+ */
+#include "meshweld.h"
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <map>
+
+namespace
+{
+
+struct LoadedObj
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+    size_t                           cornerCount = 0;
+};
+
+const LoadedObj& Load(const std::string& path)
+{
+    static std::map<std::string, LoadedObj> loaded;
+    LoadedObj&                              obj = loaded[path];
+    if (obj.shapes.empty())
+    {
+        std::string warn, err;
+        std::string directory = path.substr(0, path.find_last_of("/\\"));
+        LoadObjParallel(&obj.attrib, &obj.shapes, &obj.materials, &warn, &err, path.c_str(), directory.c_str());
+        for (const tinyobj::shape_t& shape : obj.shapes)
+            obj.cornerCount += shape.mesh.indices.size();
+    }
+    return obj;
+}
+
+const LoadedObj& LoadGrid(size_t triangleCount)
+{
+    static ScratchDirectory directory("meshweldbench");
+    std::string             path = directory / ("grid" + std::to_string(triangleCount) + ".obj");
+    if (!std::filesystem::exists(path))
+        WriteGridObj(path, triangleCount);
+    return Load(path);
+}
+
+void Deduplicate(benchmark::State& state, const LoadedObj& obj, float epsilon)
+{
+    if (obj.cornerCount == 0)
+    {
+        state.SkipWithError("no mesh");
+        return;
+    }
+    size_t vertexCount = 0;
+    for (auto _ : state)
+    {
+        std::vector<MeshVertex> vertices;
+        std::vector<uint32_t>   indices;
+        DeduplicateCorners(obj.attrib, obj.shapes, vertices, indices);
+        if (epsilon > 0.0f)
+            WeldVerticesEpsilon(vertices, indices, epsilon);
+        vertexCount = vertices.size();
+        benchmark::DoNotOptimize(indices.data());
+    }
+
+    // One vertex per corner before.
+    size_t bytesBefore = obj.cornerCount * sizeof(MeshVertex);
+    size_t bytesAfter  = vertexCount * sizeof(MeshVertex) + obj.cornerCount * sizeof(uint32_t);
+    state.counters["corners/s"]    = benchmark::Counter(double(obj.cornerCount), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["vertices"]     = double(vertexCount);
+    state.counters["vertex_ratio"] = double(obj.cornerCount) / double(vertexCount);
+    state.counters["byte_ratio"]   = double(bytesBefore) / double(bytesAfter);
+}
+
+void BM_DeduplicateGrid(benchmark::State& state)
+{
+    Deduplicate(state, LoadGrid(size_t(state.range(0))), 0.0f);
+}
+
+void BM_DeduplicateAndWeldGrid(benchmark::State& state)
+{
+    Deduplicate(state, LoadGrid(size_t(state.range(0))), 1e-4f);
+}
+
+} // namespace
+
+BENCHMARK(BM_DeduplicateGrid)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_DeduplicateAndWeldGrid)->Arg(100000)->Arg(1000000)->Arg(10000000)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv)
+{
+    if (const char* path = getenv("PETIT_BENCH_OBJ"))
+    {
+        std::string file = path;
+        benchmark::RegisterBenchmark("BM_DeduplicateObj", [file](benchmark::State& state) { Deduplicate(state, Load(file), 0.0f); })
+            ->Unit(benchmark::kMillisecond);
+    }
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "meshweld.h"
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+struct LoadedObj
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+void LoadGrid(LoadedObj& obj, size_t triangleCount)
+{
+    ScratchDirectory directory("meshweldtest");
+    std::string      path = directory / "grid.obj";
+    WriteGridObj(path, triangleCount);
+    std::string warn, err;
+    ASSERT_TRUE(LoadObjParallel(&obj.attrib, &obj.shapes, &obj.materials, &warn, &err, path.c_str(), directory.GetPath().string().c_str())) << err;
+}
+
+TEST(DeduplicateCorners, KeepsEveryCorner)
+{
+    LoadedObj obj;
+    LoadGrid(obj, 20000);
+
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t>   indices;
+    DeduplicateCorners(obj.attrib, obj.shapes, vertices, indices);
+
+    const tinyobj::mesh_t& mesh = obj.shapes[0].mesh;
+    ASSERT_EQ(indices.size(), mesh.indices.size());
+    // The grid shares its attribute indices, so one vertex per position.
+    EXPECT_EQ(vertices.size(), obj.attrib.vertices.size() / 3);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        const MeshVertex& vertex = vertices[indices[i]];
+        size_t            v      = size_t(mesh.indices[i].vertex_index);
+        ASSERT_EQ(vertex.position, glm::vec3(obj.attrib.vertices[3 * v], obj.attrib.vertices[3 * v + 1], obj.attrib.vertices[3 * v + 2]));
+        size_t t = size_t(mesh.indices[i].texcoord_index);
+        ASSERT_EQ(vertex.texcoord, glm::vec3(obj.attrib.texcoords[2 * t], obj.attrib.texcoords[2 * t + 1], 0.0f));
+    }
+}
+
+TEST(DeduplicateCorners, SplitsOnAnyDifferentIndex)
+{
+    tinyobj::attrib_t attrib;
+    attrib.vertices  = { 0, 0, 0, 1, 0, 0, 0, 1, 0 };
+    attrib.normals   = { 0, 0, 2, 0, 0, -1 };
+    attrib.texcoords = { 0, 0, 1, 1 };
+
+    tinyobj::shape_t shape;
+    shape.mesh.indices = {
+        { 0, 0, 0 }, { 1, 0, 0 }, { 2, 0, 0 },
+        { 0, 1, 0 }, { 1, 0, 1 }, { 2, 0, 0 },
+        { 0, -1, -1 }, { 1, 0, 0 }, { 2, 0, 0 },
+    };
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t>   indices;
+    DeduplicateCorners(attrib, { shape }, vertices, indices);
+
+    EXPECT_EQ(indices, (std::vector<uint32_t> { 0, 1, 2, 3, 4, 2, 5, 1, 2 }));
+    ASSERT_EQ(vertices.size(), 6u);
+    EXPECT_EQ(vertices[0].normal, glm::vec3(0, 0, 1));
+    EXPECT_EQ(vertices[5].normal, glm::vec3(0, 1, 0));
+    EXPECT_EQ(vertices[5].texcoord, glm::vec3(-1.0f));
+}
+
+TEST(WeldVerticesEpsilon, MergesOnlyNearVertices)
+{
+    std::vector<MeshVertex> vertices(4);
+    vertices[0].position = glm::vec3(0.0f);
+    vertices[1].position = glm::vec3(0.0005f, 0.0f, 0.0f);
+    vertices[2].position = glm::vec3(0.01f, 0.0f, 0.0f);
+    vertices[3].position = glm::vec3(0.0f);
+    vertices[3].normal   = glm::vec3(0.0f, 1.0f, 0.0f);
+    std::vector<uint32_t> indices = { 0, 1, 2, 3, 1, 0 };
+
+    EXPECT_EQ(WeldVerticesEpsilon(vertices, indices, 0.001f), 1u);
+    EXPECT_EQ(vertices.size(), 3u);
+    EXPECT_EQ(indices, (std::vector<uint32_t> { 0, 0, 1, 2, 0, 0 }));
+}
+
+} // namespace
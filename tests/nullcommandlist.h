@@ -0,0 +1,54 @@
+/**
+ * A stand-in for ID3D12GraphicsCommandList in the recording benchmarks.
+ * D3D12 has no null device on Linux, so the calls RecordDraws makes are
+ * virtual functions, like the COM interface, each writing a packet into
+ * memory the way a driver does.
+ */
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+class NullCommandList
+{
+public:
+    virtual ~NullCommandList() = default;
+
+    virtual void Reset() { m_Packets.clear(); }
+    virtual void Close() { Write(0, nullptr, 0); }
+
+    // What BindMeshPipeline sets, the pipeline, root signature, buffers,
+    // viewport, scissor, targets and root views, as one packet each.
+    virtual void SetState(uint32_t op, uint64_t value) { Write(op, &value, 2); }
+    virtual void SetGraphicsRoot32BitConstant(uint32_t parameter, uint32_t value, uint32_t offset)
+    {
+        uint32_t data[] = { parameter, value, offset };
+        Write(20, data, 3);
+    }
+    virtual void SetGraphicsRoot32BitConstants(uint32_t parameter, uint32_t count, const void* values, uint32_t offset)
+    {
+        Write(21, &parameter, 1);
+        Write(22, &offset, 1);
+        Write(23, values, count);
+    }
+    virtual void DrawIndexedInstanced(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t baseVertex, uint32_t firstInstance)
+    {
+        uint32_t data[] = { indexCount, instanceCount, firstIndex, uint32_t(baseVertex), firstInstance };
+        Write(30, data, 5);
+    }
+
+    size_t GetPacketSize() const { return m_Packets.size(); }
+
+private:
+    void Write(uint32_t op, const void* data, uint32_t dwords)
+    {
+        size_t at = m_Packets.size();
+        m_Packets.resize(at + 1 + dwords);
+        m_Packets[at] = op;
+        if (dwords)
+            memcpy(&m_Packets[at + 1], data, dwords * sizeof(uint32_t));
+    }
+
+    std::vector<uint32_t> m_Packets;
+};
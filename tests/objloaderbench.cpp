@@ -0,0 +1,69 @@
+/**
+ * LoadObjParallel against tinyobj::LoadObj, on grids of 1M to 50M
+ * triangles. The files are written once per size to the temporary
+ * directory, the big ones take a few GB.
+ */
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <memory>
+
+namespace
+{
+
+const std::string& GetGridObj(size_t triangleCount)
+{
+    static ScratchDirectory              directory("objloaderbench");
+    static std::map<size_t, std::string> paths;
+    std::string&                         path = paths[triangleCount];
+    if (path.empty())
+    {
+        path = directory / ("grid" + std::to_string(triangleCount) + ".obj");
+        WriteGridObj(path, triangleCount);
+    }
+    return path;
+}
+
+template <typename Load>
+void RunLoad(benchmark::State& state, Load&& load)
+{
+    const std::string& path      = GetGridObj(size_t(state.range(0)));
+    std::string        directory = path.substr(0, path.find_last_of("/\\"));
+    size_t             triangles = 0;
+    for (auto _ : state)
+    {
+        tinyobj::attrib_t                attrib;
+        std::vector<tinyobj::shape_t>    shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string                      warn, err;
+        if (!load(&attrib, &shapes, &materials, &warn, &err, path.c_str(), directory.c_str()))
+        {
+            state.SkipWithError(err.c_str());
+            return;
+        }
+        triangles = 0;
+        for (const tinyobj::shape_t& shape : shapes)
+            triangles += shape.mesh.indices.size() / 3;
+    }
+    state.counters["triangles/s"] = benchmark::Counter(double(triangles), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+void BM_TinyObj(benchmark::State& state)
+{
+    RunLoad(state, [](auto... args) { return tinyobj::LoadObj(args...); });
+}
+
+void BM_LoadObjParallel(benchmark::State& state)
+{
+    RunLoad(state, [](auto... args) { return LoadObjParallel(args...); });
+}
+
+} // namespace
+
+BENCHMARK(BM_TinyObj)->Arg(1000000)->Arg(10000000)->Arg(50000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_LoadObjParallel)->Arg(1000000)->Arg(10000000)->Arg(50000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
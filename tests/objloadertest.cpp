@@ -0,0 +1,95 @@
+#include "objloader.h"
+#include "synthetic.h"
+
+#include <gtest/gtest.h>
+
+namespace
+{
+
+struct ObjData
+{
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes;
+    std::vector<tinyobj::material_t> materials;
+};
+
+void ExpectSame(const ObjData& expected, const ObjData& actual)
+{
+    EXPECT_EQ(expected.attrib.vertices, actual.attrib.vertices);
+    EXPECT_EQ(expected.attrib.normals, actual.attrib.normals);
+    EXPECT_EQ(expected.attrib.texcoords, actual.attrib.texcoords);
+
+    ASSERT_EQ(expected.materials.size(), actual.materials.size());
+    for (size_t m = 0; m < expected.materials.size(); m++)
+        EXPECT_EQ(expected.materials[m].name, actual.materials[m].name);
+
+    ASSERT_EQ(expected.shapes.size(), actual.shapes.size());
+    for (size_t s = 0; s < expected.shapes.size(); s++)
+    {
+        const tinyobj::mesh_t& a = expected.shapes[s].mesh;
+        const tinyobj::mesh_t& b = actual.shapes[s].mesh;
+        EXPECT_EQ(expected.shapes[s].name, actual.shapes[s].name);
+        EXPECT_EQ(a.material_ids, b.material_ids);
+        ASSERT_EQ(a.indices.size(), b.indices.size());
+        for (size_t i = 0; i < a.indices.size(); i++)
+        {
+            ASSERT_EQ(a.indices[i].vertex_index, b.indices[i].vertex_index) << "corner " << i;
+            ASSERT_EQ(a.indices[i].normal_index, b.indices[i].normal_index) << "corner " << i;
+            ASSERT_EQ(a.indices[i].texcoord_index, b.indices[i].texcoord_index) << "corner " << i;
+        }
+    }
+}
+
+// Big enough for several chunks.
+class ObjLoaderTest : public ::testing::TestWithParam<unsigned>
+{
+protected:
+    static void SetUpTestSuite()
+    {
+        s_Directory = new ScratchDirectory("objloadertest");
+        s_Path      = *s_Directory / "grid.obj";
+        WriteGridObj(s_Path, 200000);
+
+        std::string warn, err;
+        s_Expected = new ObjData;
+        ASSERT_TRUE(tinyobj::LoadObj(&s_Expected->attrib, &s_Expected->shapes, &s_Expected->materials, &warn, &err,
+                                     s_Path.c_str(), s_Directory->GetPath().string().c_str()))
+            << err;
+    }
+
+    static void TearDownTestSuite()
+    {
+        delete s_Expected;
+        delete s_Directory;
+    }
+
+    static ScratchDirectory* s_Directory;
+    static std::string       s_Path;
+    static ObjData*          s_Expected;
+};
+
+ScratchDirectory* ObjLoaderTest::s_Directory = nullptr;
+std::string       ObjLoaderTest::s_Path;
+ObjData*          ObjLoaderTest::s_Expected = nullptr;
+
+TEST_P(ObjLoaderTest, MatchesTinyObj)
+{
+    ObjData     actual;
+    std::string warn, err;
+    ASSERT_TRUE(LoadObjParallel(&actual.attrib, &actual.shapes, &actual.materials, &warn, &err, s_Path.c_str(),
+                                s_Directory->GetPath().string().c_str(), GetParam()))
+        << err;
+    ExpectSame(*s_Expected, actual);
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, ObjLoaderTest, ::testing::Values(1u, 3u, 8u));
+
+TEST(ObjLoader, MissingFileFails)
+{
+    ObjData     actual;
+    std::string warn, err;
+    EXPECT_FALSE(LoadObjParallel(&actual.attrib, &actual.shapes, &actual.materials, &warn, &err, "/nonexistent/file.obj"));
+    EXPECT_FALSE(err.empty());
+}
+
+} // namespace
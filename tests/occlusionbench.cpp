@@ -0,0 +1,89 @@
+/**
+ * Software occlusion cost per frame: rasterizing occluders of 10k to 1M
+ * triangles into MeshApp's 320x184 buffer on 1 to 8 threads, then testing
+ * submesh boxes against it.
+ */
+#include "occlusion.h"
+#include "parallel.h"
+#include "synthetic.h"
+
+#include <benchmark/benchmark.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <map>
+#include <random>
+
+namespace
+{
+
+constexpr uint32_t kWidth  = 320;
+constexpr uint32_t kHeight = 184;
+
+const MeshBuffers& GetGrid(size_t triangleCount)
+{
+    static std::map<size_t, MeshBuffers> grids;
+    MeshBuffers&                         mesh = grids[triangleCount];
+    if (mesh.indices.empty())
+        mesh = MakeGridMesh(256, uint32_t(std::max<size_t>(1, triangleCount / 512)));
+    return mesh;
+}
+
+// Looking down at the grid from one side, it fills most of the screen.
+glm::mat4 GetClip()
+{
+    glm::mat4 view       = glm::lookAt(glm::vec3(0.5f, 0.6f, -0.4f), glm::vec3(0.5f, 0.0f, 0.5f), glm::vec3(0, 1, 0));
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), float(kWidth) / float(kHeight), 0.01f, 10.0f);
+    return projection * view;
+}
+
+void BM_RenderOccluders(benchmark::State& state)
+{
+    const MeshBuffers& mesh = GetGrid(size_t(state.range(0)));
+    JobPool            pool(unsigned(state.range(1)) - 1);
+    OcclusionBuffer    buffer(kWidth, kHeight);
+    glm::mat4          clip = GetClip();
+    for (auto _ : state)
+    {
+        buffer.Clear();
+        buffer.RenderTriangles(clip, &mesh.vertices[0].position, sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size() / 3, &pool);
+        benchmark::ClobberMemory();
+    }
+    state.counters["triangles/s"] = benchmark::Counter(double(mesh.indices.size() / 3), benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Small boxes under the grid surface and above it, half of them hidden.
+void BM_TestBoxes(benchmark::State& state)
+{
+    const MeshBuffers& mesh = GetGrid(100000);
+    OcclusionBuffer    buffer(kWidth, kHeight);
+    glm::mat4          clip = GetClip();
+    buffer.RenderTriangles(clip, &mesh.vertices[0].position, sizeof(MeshVertex), mesh.indices.data(), mesh.indices.size() / 3);
+
+    std::mt19937                          random(5);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<glm::vec3>                mins(size_t(state.range(0)));
+    for (size_t i = 0; i < mins.size(); i++)
+        mins[i] = glm::vec3(unit(random), i % 2 ? -0.2f : 0.15f, unit(random));
+
+    size_t occluded = 0;
+    for (auto _ : state)
+    {
+        occluded = 0;
+        for (const glm::vec3& min : mins)
+            occluded += buffer.IsBoxOccluded(clip, min, min + glm::vec3(0.02f));
+    }
+    state.counters["boxes/s"]  = benchmark::Counter(double(mins.size()), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["occluded"] = double(occluded) / double(mins.size());
+}
+
+} // namespace
+
+BENCHMARK(BM_RenderOccluders)
+    ->ArgsProduct({ { 10000, 100000, 1000000 }, { 1, 2, 4, 8 } })
+    ->ArgNames({ "triangles", "threads" })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+BENCHMARK(BM_TestBoxes)->Arg(10000)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,246 @@
+#include "occlusion.h"
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// MeshApp's buffer.
+constexpr uint32_t kWidth  = 320;
+constexpr uint32_t kHeight = 184;
+
+struct Scene
+{
+    glm::mat4              clip;
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t>  indices;
+
+    // Quads at random depths in front of a camera, most facing it, and
+    // loose triangles in between, some crossing the near plane or the
+    // screen edges.
+    explicit Scene(uint32_t seed)
+    {
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        glm::mat4                             view       = glm::lookAt(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(unit(random), unit(random), 0.0f), glm::vec3(0, 1, 0));
+        glm::mat4                             projection = glm::perspective(glm::radians(60.0f), float(kWidth) / float(kHeight), 0.5f, 60.0f);
+        clip                                             = projection * view;
+
+        for (int quad = 0; quad < 6; quad++)
+        {
+            glm::vec3 center(8.0f * unit(random), 5.0f * unit(random), 10.0f + 15.0f * unit(random));
+            glm::vec3 u(2.0f + 4.0f * unit(random), unit(random), unit(random));
+            glm::vec3 v(unit(random), 2.0f + 3.0f * unit(random), unit(random) * 2.0f);
+            uint32_t  base = uint32_t(positions.size());
+            positions.insert(positions.end(), { center - u - v, center + u - v, center + u + v, center - u + v });
+            indices.insert(indices.end(), { base, base + 1, base + 2, base, base + 2, base + 3 });
+        }
+        for (int triangle = 0; triangle < 40; triangle++)
+        {
+            glm::vec3 center(12.0f * unit(random), 8.0f * unit(random), 8.0f + 20.0f * unit(random));
+            uint32_t  base = uint32_t(positions.size());
+            for (int k = 0; k < 3; k++)
+                positions.push_back(center + 3.0f * glm::vec3(unit(random), unit(random), unit(random)));
+            indices.insert(indices.end(), { base, base + 1, base + 2 });
+        }
+    }
+
+    void Render(OcclusionBuffer& buffer, JobPool* pool) const
+    {
+        buffer.Clear();
+        buffer.RenderTriangles(clip, positions.data(), sizeof(glm::vec3), indices.data(), indices.size() / 3, pool);
+    }
+};
+
+// The nearest depth at every pixel center, triangle by triangle in double
+// precision. Triangles with a vertex in front of the near plane are left
+// out, the buffer drops them.
+std::vector<double> ReferenceDepth(const Scene& scene)
+{
+    std::vector<double> depth(size_t(kWidth) * kHeight, 1.0);
+    for (size_t t = 0; t < scene.indices.size() / 3; t++)
+    {
+        glm::dvec3 screen[3];
+        bool       dropped = false;
+        for (int i = 0; i < 3; i++)
+        {
+            glm::dvec4 p = glm::dmat4(scene.clip) * glm::dvec4(glm::dvec3(scene.positions[scene.indices[t * 3 + i]]), 1.0);
+            dropped      = dropped || p.z < 0.0 || p.w < 1e-6;
+            screen[i]    = glm::dvec3((p.x / p.w * 0.5 + 0.5) * kWidth, (0.5 - p.y / p.w * 0.5) * kHeight, p.z / p.w);
+        }
+        double area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+        if (dropped || area == 0.0)
+            continue;
+        for (uint32_t y = 0; y < kHeight; y++)
+        {
+            for (uint32_t x = 0; x < kWidth; x++)
+            {
+                double px = x + 0.5;
+                double py = y + 0.5;
+                double w[3];
+                for (int e = 0; e < 3; e++)
+                {
+                    const glm::dvec3& a = screen[(e + 1) % 3];
+                    const glm::dvec3& b = screen[(e + 2) % 3];
+                    w[e]                = ((b.x - a.x) * (py - a.y) - (px - a.x) * (b.y - a.y)) / area;
+                }
+                if (w[0] < 0.0 || w[1] < 0.0 || w[2] < 0.0)
+                    continue;
+                double& nearest = depth[size_t(y) * kWidth + x];
+                nearest         = std::min(nearest, w[0] * screen[0].z + w[1] * screen[1].z + w[2] * screen[2].z);
+            }
+        }
+    }
+    return depth;
+}
+
+// True if the box is behind the reference at every pixel its screen bounds
+// touch, the box's nearest corner against the nearest occluder.
+bool IsBoxHidden(const Scene& scene, const std::vector<double>& reference, const glm::vec3& min, const glm::vec3& max)
+{
+    double minX = kWidth, maxX = 0.0, minY = kHeight, maxY = 0.0, zNear = 1.0;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::dvec3 v(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z);
+        glm::dvec4 p = glm::dmat4(scene.clip) * glm::dvec4(v, 1.0);
+        if (p.z < 0.0 || p.w <= 0.0)
+            return false;
+        double x = (p.x / p.w * 0.5 + 0.5) * kWidth;
+        double y = (0.5 - p.y / p.w * 0.5) * kHeight;
+        minX     = std::min(minX, x);
+        maxX     = std::max(maxX, x);
+        minY     = std::min(minY, y);
+        maxY     = std::max(maxY, y);
+        zNear    = std::min(zNear, p.z / p.w);
+    }
+    for (int y = std::max(int(std::floor(minY)), 0); y < std::min(int(std::ceil(maxY)), int(kHeight)); y++)
+        for (int x = std::max(int(std::floor(minX)), 0); x < std::min(int(std::ceil(maxX)), int(kWidth)); x++)
+            if (reference[size_t(y) * kWidth + x] > zNear)
+                return false;
+    return true;
+}
+
+} // namespace
+
+// The buffer's depth is never nearer than the occluders, up to the pixels
+// whose center falls on a triangle edge, which the two sides round apart.
+TEST(Occlusion, DepthIsBehindTheReference)
+{
+    OcclusionBuffer buffer(kWidth, kHeight);
+    ASSERT_EQ(buffer.GetWidth(), kWidth);
+    ASSERT_EQ(buffer.GetHeight(), kHeight);
+
+    size_t nearer  = 0;
+    size_t covered = 0;
+    size_t pixels  = 0;
+    for (uint32_t seed = 1; seed <= 60; seed++)
+    {
+        Scene scene(seed);
+        scene.Render(buffer, nullptr);
+        std::vector<float> depth;
+        buffer.ReadDepth(depth);
+        std::vector<double> reference = ReferenceDepth(scene);
+
+        for (size_t i = 0; i < depth.size(); i++)
+        {
+            nearer += depth[i] < reference[i] - 1e-6;
+            covered += depth[i] < 1.0f;
+        }
+        pixels += depth.size();
+    }
+    EXPECT_LE(nearer, pixels / 100000 + 4);
+    // The buffer holds some occlusion.
+    EXPECT_GT(covered, pixels / 10);
+    RecordProperty("nearer", int(nearer));
+    RecordProperty("pixels", int(pixels));
+}
+
+// A box reported occluded is hidden behind the reference occluders, and
+// enough boxes are reported for the test to mean something.
+TEST(Occlusion, OccludedBoxesAreHidden)
+{
+    OcclusionBuffer buffer(kWidth, kHeight);
+    size_t          occluded = 0;
+    size_t          hidden   = 0;
+    for (uint32_t seed = 1; seed <= 20; seed++)
+    {
+        Scene scene(seed);
+        scene.Render(buffer, nullptr);
+        std::vector<double> reference = ReferenceDepth(scene);
+
+        std::mt19937                          random(seed);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        for (int box = 0; box < 2000; box++)
+        {
+            glm::vec3 min(10.0f * unit(random), 6.0f * unit(random), 20.0f + 25.0f * unit(random));
+            glm::vec3 max = min + glm::vec3(0.1f + std::abs(unit(random)), 0.1f + std::abs(unit(random)), 0.1f + std::abs(unit(random)));
+            bool      truth = IsBoxHidden(scene, reference, min, max);
+            hidden += truth;
+            if (buffer.IsBoxOccluded(scene.clip, min, max))
+            {
+                occluded++;
+                EXPECT_TRUE(truth) << "seed " << seed << ", box " << box;
+            }
+        }
+    }
+    EXPECT_GT(occluded, hidden / 4);
+    RecordProperty("occluded", int(occluded));
+    RecordProperty("hidden", int(hidden));
+}
+
+// Bands of tile rows on any number of workers give the same buffer.
+TEST(Occlusion, SameResultOnAnyThreadCount)
+{
+    // Copies of a scene pushed back, enough triangles for several setup
+    // jobs.
+    Scene                  scene(7);
+    std::vector<glm::vec3> positions = scene.positions;
+    std::vector<uint32_t>  indices   = scene.indices;
+    for (int copy = 1; copy <= 60; copy++)
+    {
+        uint32_t base = uint32_t(scene.positions.size());
+        for (const glm::vec3& position : positions)
+            scene.positions.push_back(position + glm::vec3(0.0f, 0.0f, 0.5f * float(copy)));
+        for (uint32_t index : indices)
+            scene.indices.push_back(base + index);
+    }
+    ASSERT_GT(scene.indices.size() / 3, size_t(2048));
+
+    OcclusionBuffer    single(kWidth, kHeight);
+    std::vector<float> expected;
+    scene.Render(single, nullptr);
+    single.ReadDepth(expected);
+
+    for (unsigned workers : { 0u, 1u, 3u, 7u })
+    {
+        JobPool            pool(workers);
+        OcclusionBuffer    buffer(kWidth, kHeight);
+        std::vector<float> depth;
+        scene.Render(buffer, &pool);
+        buffer.ReadDepth(depth);
+        EXPECT_EQ(depth, expected) << workers << " workers";
+    }
+}
+
+TEST(Occlusion, NearPlaneBoxesAreNeverOccluded)
+{
+    Scene           scene(3);
+    OcclusionBuffer buffer(kWidth, kHeight);
+    scene.Render(buffer, nullptr);
+    // Around the eye, crossing the near plane.
+    EXPECT_FALSE(buffer.IsBoxOccluded(scene.clip, glm::vec3(-1.0f, -1.0f, -11.0f), glm::vec3(1.0f, 1.0f, -9.0f)));
+    // Off screen.
+    EXPECT_FALSE(buffer.IsBoxOccluded(scene.clip, glm::vec3(500.0f, 0.0f, 30.0f), glm::vec3(501.0f, 1.0f, 31.0f)));
+
+    buffer.Clear();
+    std::vector<float> depth;
+    buffer.ReadDepth(depth);
+    for (float z : depth)
+        ASSERT_EQ(z, 1.0f);
+}
@@ -0,0 +1,36 @@
+#include "parallel.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <stdexcept>
+
+TEST(ParallelForChunks, CoversEveryIndexOnce)
+{
+    std::vector<std::atomic<int>> hits(1000);
+    ParallelForChunks(hits.size(), 7, [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            hits[i]++;
+    });
+    for (const auto& hit : hits)
+        EXPECT_EQ(hit.load(), 1);
+}
+
+TEST(ParallelForChunks, RethrowsAfterJoining)
+{
+    std::atomic<size_t> done = { 0 };
+    EXPECT_THROW(ParallelForChunks(64, 8, [&](size_t chunk, size_t, size_t) {
+                     if (chunk % 3 == 0)
+                         throw std::runtime_error("chunk failed");
+                     done++;
+                 }),
+                 std::runtime_error);
+    // Every other chunk still ran to the end.
+    EXPECT_EQ(done.load(), 5u);
+}
+
+TEST(ParallelInvoke, RethrowsEitherSide)
+{
+    EXPECT_THROW(ParallelInvoke([]() { throw std::runtime_error("a"); }, []() {}), std::runtime_error);
+    EXPECT_THROW(ParallelInvoke([]() {}, []() { throw std::runtime_error("b"); }), std::runtime_error);
+}
@@ -0,0 +1,192 @@
+#include "presentpacer.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+namespace
+{
+
+// A display refreshing every kRefresh ticks with a flip queue, and an
+// application loop that waits for a queue slot before sampling input, like
+// on the frame latency waitable object, then takes the frame's cost to
+// deliver its present. Vsync, one vblank per frame.
+constexpr uint64_t kRefresh = 100;
+
+struct DisplaySimulation
+{
+    struct Queued
+    {
+        uint64_t id;
+        uint64_t ready;
+    };
+
+    uint64_t           now     = 0;
+    uint64_t           vblank  = 0; // vblanks so far
+    uint64_t           nextId  = 1;
+    DisplaySample      shown   = {};
+    std::deque<Queued> queue;
+    // Input sampling time of every present, by id.
+    std::vector<uint64_t> sampledAt { 0 };
+
+    uint64_t totalLatency  = 0;
+    uint64_t latencyFrames = 0;
+    uint32_t maxQueued     = 0;
+
+    // Run the vblanks up to `time`, flipping to the oldest queued present
+    // that is ready.
+    void AdvanceTo(uint64_t time)
+    {
+        while ((vblank + 1) * kRefresh <= time)
+        {
+            vblank++;
+            if (!queue.empty() && queue.front().ready <= vblank * kRefresh)
+            {
+                shown = { queue.front().id, vblank };
+                totalLatency += vblank * kRefresh - sampledAt[queue.front().id];
+                latencyFrames++;
+                queue.pop_front();
+            }
+        }
+        now = std::max(now, time);
+    }
+
+    // One frame of the application loop.
+    void Frame(PresentPacer& pacer, uint64_t cost)
+    {
+        while (queue.size() >= pacer.GetFrameLatency())
+            AdvanceTo((vblank + 1) * kRefresh);
+        pacer.OnDisplaySample(shown);
+
+        sampledAt.push_back(now);
+        AdvanceTo(now + cost);
+        uint64_t id = nextId++;
+        queue.push_back({ id, now });
+        pacer.OnPresent(id, 1);
+        maxQueued = std::max(maxQueued, uint32_t(queue.size()));
+    }
+
+    double AverageLatency() const { return double(totalLatency) / double(std::max<uint64_t>(latencyFrames, 1)); }
+};
+
+} // namespace
+
+TEST(PresentPacer, CountsPresentsAndMisses)
+{
+    PresentPacer pacer(1, 3, 120);
+    pacer.OnPresent(1, 1);
+    pacer.OnDisplaySample({ 1, 10 });
+    EXPECT_EQ(pacer.GetCounters().lastDisplayedId, 1u);
+    // The first sample is the baseline only.
+    EXPECT_EQ(pacer.GetCounters().displayedFrames, 0u);
+
+    pacer.OnPresent(2, 1);
+    pacer.OnPresent(3, 1);
+    EXPECT_EQ(pacer.GetQueuedFrameCount(), 2u);
+    // Two frames over three vblanks, one missed.
+    pacer.OnDisplaySample({ 3, 13 });
+    const PresentCounters& counters = pacer.GetCounters();
+    EXPECT_EQ(counters.presents, 3u);
+    EXPECT_EQ(counters.displayedFrames, 2u);
+    EXPECT_EQ(counters.missedVBlanks, 1u);
+    EXPECT_EQ(counters.lastPresentId, 3u);
+    EXPECT_EQ(pacer.GetQueuedFrameCount(), 0u);
+    EXPECT_EQ(pacer.GetFrameLatency(), 2u);
+    EXPECT_EQ(counters.latencyChangeCount, 1u);
+}
+
+TEST(PresentPacer, IgnoresStaleSamples)
+{
+    PresentPacer pacer;
+    pacer.OnDisplaySample({ 5, 50 });
+    pacer.OnDisplaySample({ 6, 51 });
+    pacer.OnDisplaySample({ 6, 51 });
+    pacer.OnDisplaySample({ 4, 49 });
+    EXPECT_EQ(pacer.GetCounters().displayedFrames, 1u);
+    EXPECT_EQ(pacer.GetCounters().missedVBlanks, 0u);
+}
+
+TEST(PresentPacer, NoVsyncNoMisses)
+{
+    PresentPacer pacer;
+    pacer.OnPresent(1, 0);
+    pacer.OnDisplaySample({ 1, 1 });
+    pacer.OnPresent(2, 0);
+    pacer.OnDisplaySample({ 2, 9 });
+    EXPECT_EQ(pacer.GetCounters().missedVBlanks, 0u);
+    EXPECT_EQ(pacer.GetFrameLatency(), 1u);
+}
+
+TEST(PresentPacer, LatencyStaysInRange)
+{
+    PresentPacer pacer(2, 3, 4);
+    EXPECT_EQ(pacer.GetFrameLatency(), 2u);
+    pacer.OnDisplaySample({ 0, 0 });
+    for (uint64_t i = 1; i <= 5; i++)
+        pacer.OnDisplaySample({ i, i * 3 });
+    EXPECT_EQ(pacer.GetFrameLatency(), 3u);
+    for (uint64_t i = 6; i <= 30; i++)
+        pacer.OnDisplaySample({ i, 15 + (i - 5) });
+    EXPECT_EQ(pacer.GetFrameLatency(), 2u);
+}
+
+// Frames well within a refresh: one queued frame is enough, nothing is
+// missed, and input is sampled later than with a fixed queue of three.
+TEST(PresentPacer, SimulatedSteadyFramesKeepTheLowestLatency)
+{
+    PresentPacer      adaptive(1, 3, 120);
+    DisplaySimulation simulation;
+    for (int frame = 0; frame < 1000; frame++)
+        simulation.Frame(adaptive, 60);
+    EXPECT_EQ(adaptive.GetFrameLatency(), 1u);
+    EXPECT_EQ(adaptive.GetCounters().missedVBlanks, 0u);
+    EXPECT_LE(simulation.maxQueued, 1u);
+
+    PresentPacer      fixed(3, 3, 120);
+    DisplaySimulation queued;
+    for (int frame = 0; frame < 1000; frame++)
+        queued.Frame(fixed, 60);
+    EXPECT_LE(queued.maxQueued, 3u);
+    EXPECT_LT(simulation.AverageLatency() * 2.0, queued.AverageLatency());
+    EXPECT_LE(simulation.AverageLatency(), double(kRefresh));
+}
+
+// Occasional long frames miss vblanks, the queue grows to absorb them and
+// shrinks back once they stop.
+TEST(PresentPacer, SimulatedSpikesRaiseThenRecover)
+{
+    PresentPacer      pacer(1, 3, 120);
+    DisplaySimulation simulation;
+    uint32_t          highest = 0;
+    for (int frame = 0; frame < 600; frame++)
+    {
+        simulation.Frame(pacer, frame % 40 == 0 ? 250 : 60);
+        highest = std::max(highest, pacer.GetFrameLatency());
+        ASSERT_LE(simulation.maxQueued, 3u);
+    }
+    EXPECT_GT(pacer.GetCounters().missedVBlanks, 0u);
+    EXPECT_GT(highest, 1u);
+    EXPECT_LE(highest, 3u);
+
+    for (int frame = 0; frame < 600; frame++)
+        simulation.Frame(pacer, 60);
+    EXPECT_EQ(pacer.GetFrameLatency(), 1u);
+    EXPECT_GE(pacer.GetCounters().latencyChangeCount, 2u);
+    EXPECT_EQ(pacer.GetCounters().presents, 1200u);
+}
+
+// Every frame slower than a refresh misses whatever the queue, the latency
+// tops out at the maximum instead of growing.
+TEST(PresentPacer, SimulatedSlowFramesCapTheLatency)
+{
+    PresentPacer      pacer(1, 3, 120);
+    DisplaySimulation simulation;
+    for (int frame = 0; frame < 300; frame++)
+        simulation.Frame(pacer, 130);
+    EXPECT_EQ(pacer.GetFrameLatency(), 3u);
+    EXPECT_LE(simulation.maxQueued, 3u);
+    // 130 ticks a frame, three vblanks for every ten frames go unused.
+    EXPECT_GT(pacer.GetCounters().missedVBlanks, 80u);
+}
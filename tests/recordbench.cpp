@@ -0,0 +1,114 @@
+/**
+ * Scalability of recording submesh draws on several command lists at once,
+ * the CPU path of MeshApp::RenderMesh, from 1 to 8 threads.
+ *
+ * The lists are the NullCommandList stub. They come from per thread
+ * FencedPools like CommandQueue::GetCommandList, are recorded on a JobPool
+ * like MeshApp's and are "submitted" in order with one call.
+ */
+#include "drawrecord.h"
+#include "fencedpool.h"
+#include "nullcommandlist.h"
+#include "parallel.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+// Materials besides the default one at the end of the table, some
+// submeshes point past them.
+constexpr uint32_t kMaterialCount = 64;
+
+struct Scene
+{
+    std::vector<MeshSubMesh>        submeshes;
+    std::vector<MeshLod>            lods;
+    std::vector<VertexQuantization> quantization;
+    std::vector<uint8_t>            visible;
+
+    explicit Scene(size_t drawCount)
+    {
+        std::mt19937 random(7);
+        submeshes.resize(drawCount);
+        lods.resize(drawCount);
+        quantization.resize(drawCount);
+        visible.resize(drawCount);
+        uint32_t offset = 0;
+        for (size_t s = 0; s < drawCount; s++)
+        {
+            submeshes[s].material_id = random() % (kMaterialCount + 8);
+            lods[s].index_count      = 3 * (1 + random() % 2000);
+            lods[s].index_offset     = offset;
+            quantization[s].offset   = glm::vec4(float(s), 0.0f, 0.0f, 0.0f);
+            offset += lods[s].index_count;
+            // Most of the scene is in the frustum.
+            visible[s] = random() % 10 != 0;
+        }
+    }
+};
+
+// MeshApp::RecordDraws against the stub, BindMeshPipeline's state then the
+// shared draw loop.
+void RecordDraws(NullCommandList& commandList, const Scene& scene, size_t begin, size_t end)
+{
+    for (uint32_t op = 1; op <= 10; op++)
+        commandList.SetState(op, op);
+    RecordSubmeshDraws(&commandList, scene.submeshes.data(), scene.visible.data(), scene.quantization.data(), kMaterialCount + 1, begin, end,
+                       [&scene](size_t s) -> const MeshLod& { return scene.lods[s]; });
+}
+
+void BM_RecordDraws(benchmark::State& state)
+{
+    const size_t drawCount   = size_t(state.range(0));
+    const size_t threadCount = size_t(state.range(1));
+    Scene        scene(drawCount);
+    JobPool      pool(unsigned(threadCount) - 1);
+
+    FencedPools<std::unique_ptr<NullCommandList>> pools;
+    std::vector<NullCommandList*>                 submitted;
+    size_t                                        packets = 0;
+    for (auto _ : state)
+    {
+        size_t                                        jobCount = GetRecordJobCount(drawCount, pool.GetThreadCount());
+        std::vector<std::unique_ptr<NullCommandList>> lists(jobCount);
+        std::vector<uint32_t>                         slots(jobCount);
+        pool.ParallelFor(jobCount, [&](size_t job) {
+            // Lists are reset as soon as they are submitted.
+            slots[job] = GetThreadSlot();
+            if (!pools.Get(slots[job]).Acquire(0, lists[job]))
+                lists[job] = std::make_unique<NullCommandList>();
+            lists[job]->Reset();
+            RecordDraws(*lists[job], scene, drawCount * job / jobCount, drawCount * (job + 1) / jobCount);
+            lists[job]->Close();
+        });
+
+        // One ExecuteCommandLists, in recording order.
+        submitted.clear();
+        packets = 0;
+        for (auto& list : lists)
+        {
+            submitted.push_back(list.get());
+            packets += list->GetPacketSize();
+        }
+        benchmark::DoNotOptimize(submitted.data());
+        for (size_t job = 0; job < jobCount; job++)
+            pools.Get(slots[job]).Return(0, std::move(lists[job]));
+    }
+    state.counters["draws/s"] = benchmark::Counter(double(drawCount), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["KB"]      = double(packets * sizeof(uint32_t)) / 1024.0;
+}
+
+} // namespace
+
+BENCHMARK(BM_RecordDraws)
+    ->ArgsProduct({ { 1000, 10000, 100000 }, { 1, 2, 4, 8 } })
+    ->ArgNames({ "draws", "threads" })
+    ->Unit(benchmark::kMicrosecond)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,70 @@
+/**
+ * Simplifier throughput in input triangles per second, on generated grids:
+ * one submesh halved, and the full LOD chains of 16 submeshes built in
+ * parallel.
+ */
+#include "simplify.h"
+#include "synthetic.h"
+#include "vertexcache.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+
+namespace
+{
+
+const MeshBuffers& Grid(size_t triangleCount, uint32_t submeshCount)
+{
+    static std::map<std::pair<size_t, uint32_t>, MeshBuffers> grids;
+    MeshBuffers&                                              mesh = grids[{ triangleCount, submeshCount }];
+    if (mesh.indices.empty())
+    {
+        uint32_t rows = uint32_t(std::max<size_t>(1, triangleCount / 512));
+        mesh          = MakeGridMesh(256, rows, submeshCount);
+        OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    }
+    return mesh;
+}
+
+void BM_SimplifyHalf(benchmark::State& state)
+{
+    const MeshBuffers&    mesh = Grid(size_t(state.range(0)), 1);
+    std::vector<uint32_t> destination(mesh.indices.size());
+    size_t                written = 0;
+    float                 error   = 0.0f;
+    for (auto _ : state)
+    {
+        written = SimplifyMesh(destination.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(),
+                               mesh.indices.size() / 2, {}, &error);
+        benchmark::DoNotOptimize(destination.data());
+    }
+    state.counters["triangles/s"] = benchmark::Counter(double(mesh.indices.size() / 3), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["ratio"]       = double(written) / double(mesh.indices.size());
+    state.counters["error"]       = error;
+}
+
+void BM_BuildLodChains(benchmark::State& state)
+{
+    const MeshBuffers& grid      = Grid(size_t(state.range(0)), 16);
+    size_t             triangles = grid.indices.size() / 3;
+    size_t             lods      = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        MeshBuffers mesh = grid;
+        state.ResumeTiming();
+        BuildLodChains(mesh);
+        lods = mesh.lods.size();
+        benchmark::DoNotOptimize(mesh.indices.data());
+    }
+    state.counters["triangles/s"] = benchmark::Counter(double(triangles), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["lods"]        = double(lods);
+}
+
+} // namespace
+
+BENCHMARK(BM_SimplifyHalf)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_BuildLodChains)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+#include "simplify.h"
+#include "synthetic.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <thread>
+
+namespace
+{
+
+// A bumpy grid with a texcoord seam down the middle column: the triangles
+// right of it use copies of its vertices with their own texcoords.
+MeshBuffers MakeSeamedGrid(uint32_t columns, uint32_t rows, uint32_t submeshCount, std::set<uint32_t>& locked)
+{
+    MeshBuffers    mesh  = MakeGridMesh(columns, rows, submeshCount);
+    const uint32_t seam  = columns / 2;
+    const uint32_t count = uint32_t(mesh.vertices.size());
+    for (uint32_t y = 0; y <= rows; y++)
+    {
+        MeshVertex copy = mesh.vertices[y * (columns + 1) + seam];
+        copy.texcoord.x += 0.5f;
+        mesh.vertices.push_back(copy);
+        locked.insert(y * (columns + 1) + seam);
+        locked.insert(count + y);
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        // Right of the seam when any corner is past it.
+        bool right = false;
+        for (int c = 0; c < 3; c++)
+            right = right || mesh.indices[i + c] % (columns + 1) > seam;
+        for (int c = 0; c < 3 && right; c++)
+        {
+            uint32_t& index = mesh.indices[i + c];
+            if (index < count && index % (columns + 1) == seam)
+                index = count + index / (columns + 1);
+        }
+    }
+    for (MeshSubMesh& submesh : mesh.submeshes)
+        submesh.vertex_count = uint32_t(mesh.vertices.size());
+
+    // The outline of every submesh is its border.
+    for (uint32_t s = 0; s < submeshCount; s++)
+    {
+        uint32_t top    = rows * s / submeshCount;
+        uint32_t bottom = rows * (s + 1) / submeshCount;
+        for (uint32_t x = 0; x <= columns; x++)
+        {
+            locked.insert(top * (columns + 1) + x);
+            locked.insert(bottom * (columns + 1) + x);
+        }
+        for (uint32_t y = top; y <= bottom; y++)
+        {
+            locked.insert(y * (columns + 1));
+            locked.insert(y * (columns + 1) + columns);
+        }
+    }
+    return mesh;
+}
+
+std::set<uint32_t> Referenced(const uint32_t* indices, size_t count)
+{
+    return std::set<uint32_t>(indices, indices + count);
+}
+
+void ExpectValidTriangles(const MeshBuffers& mesh, const uint32_t* indices, size_t count)
+{
+    ASSERT_EQ(count % 3, 0u);
+    for (size_t i = 0; i < count; i += 3)
+    {
+        for (int c = 0; c < 3; c++)
+            ASSERT_LT(indices[i + c], mesh.vertices.size());
+        EXPECT_NE(mesh.vertices[indices[i]].position, mesh.vertices[indices[i + 1]].position);
+        EXPECT_NE(mesh.vertices[indices[i + 1]].position, mesh.vertices[indices[i + 2]].position);
+        EXPECT_NE(mesh.vertices[indices[i]].position, mesh.vertices[indices[i + 2]].position);
+    }
+}
+
+} // namespace
+
+// A grid has plenty of collapsible edges, so the target is met without
+// giving up much more than a collapse's worth of triangles.
+TEST(Simplify, ReachesTheTargetOnAGrid)
+{
+    std::set<uint32_t> locked;
+    MeshBuffers        mesh = MakeSeamedGrid(48, 48, 1, locked);
+    for (size_t target : { mesh.indices.size() / 2, mesh.indices.size() / 4 })
+    {
+        std::vector<uint32_t> simplified(mesh.indices.size());
+        float                 error = -1.0f;
+        size_t                count = SimplifyMesh(simplified.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), target, {}, &error);
+        EXPECT_LE(count, target);
+        EXPECT_GE(count, target - 12);
+        EXPECT_GT(error, 0.0f);
+        ExpectValidTriangles(mesh, simplified.data(), count);
+    }
+}
+
+// Border and seam vertices are never collapsed: every one of them is still
+// used by some triangle, however far the mesh is simplified.
+TEST(Simplify, BorderAndSeamVerticesStay)
+{
+    std::set<uint32_t> locked;
+    MeshBuffers        mesh = MakeSeamedGrid(40, 30, 1, locked);
+
+    std::vector<uint32_t> simplified(mesh.indices.size());
+    size_t                count = SimplifyMesh(simplified.data(), mesh.indices.data(), mesh.indices.size(), mesh.vertices.data(), 0);
+    ASSERT_GT(count, 0u);
+    ExpectValidTriangles(mesh, simplified.data(), count);
+
+    std::set<uint32_t> referenced = Referenced(simplified.data(), count);
+    for (uint32_t v : locked)
+        EXPECT_TRUE(referenced.count(v)) << "vertex " << v;
+    // Only locked vertices are left once it runs out of collapses.
+    for (uint32_t v : referenced)
+        EXPECT_TRUE(locked.count(v)) << "vertex " << v;
+}
+
+// Levels shrink, their error never decreases, and only the full level has
+// no error.
+TEST(Simplify, LodChainErrorsGrow)
+{
+    std::set<uint32_t> locked;
+    MeshBuffers        mesh = MakeSeamedGrid(64, 60, 3, locked);
+    BuildLodChains(mesh);
+
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+    {
+        ASSERT_GE(submesh.lod_count, 3u);
+        ASSERT_LE(submesh.lod_count, kMaxMeshLods);
+        const MeshLod* lods = &mesh.lods[submesh.lod_offset];
+        EXPECT_EQ(lods[0].index_offset, submesh.index_offset);
+        EXPECT_EQ(lods[0].index_count, submesh.index_count);
+        EXPECT_EQ(lods[0].error, 0.0f);
+        for (uint32_t level = 1; level < submesh.lod_count; level++)
+        {
+            EXPECT_LT(lods[level].index_count, lods[level - 1].index_count);
+            EXPECT_GE(lods[level].error, lods[level - 1].error);
+            EXPECT_GT(lods[level].error, 0.0f);
+            ExpectValidTriangles(mesh, &mesh.indices[lods[level].index_offset], lods[level].index_count);
+        }
+    }
+}
+
+// The same levels come out every time: run after run, on submeshes built
+// alone or next to others, and from several threads at once.
+TEST(Simplify, LodChainsAreDeterministic)
+{
+    std::set<uint32_t> locked;
+    MeshBuffers        source   = MakeSeamedGrid(50, 48, 4, locked);
+    MeshBuffers        expected = source;
+    BuildLodChains(expected);
+
+    MeshBuffers again = source;
+    BuildLodChains(again);
+    EXPECT_EQ(again.indices, expected.indices);
+
+    std::vector<MeshBuffers> concurrent(4, source);
+    {
+        std::vector<std::thread> threads;
+        for (MeshBuffers& mesh : concurrent)
+            threads.emplace_back([&mesh] { BuildLodChains(mesh); });
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+    for (const MeshBuffers& mesh : concurrent)
+        EXPECT_EQ(mesh.indices, expected.indices);
+
+    for (size_t s = 0; s < source.submeshes.size(); s++)
+    {
+        MeshBuffers alone = source;
+        alone.submeshes   = { source.submeshes[s] };
+        BuildLodChains(alone);
+
+        const MeshSubMesh& submesh = expected.submeshes[s];
+        ASSERT_EQ(alone.submeshes[0].lod_count, submesh.lod_count);
+        for (uint32_t level = 0; level < submesh.lod_count; level++)
+        {
+            const MeshLod& a = alone.lods[alone.submeshes[0].lod_offset + level];
+            const MeshLod& b = expected.lods[submesh.lod_offset + level];
+            ASSERT_EQ(a.index_count, b.index_count);
+            EXPECT_EQ(a.error, b.error);
+            EXPECT_TRUE(std::equal(&alone.indices[a.index_offset], &alone.indices[a.index_offset] + a.index_count, &expected.indices[b.index_offset]))
+                << "submesh " << s << ", level " << level;
+        }
+    }
+}
@@ -0,0 +1,104 @@
+#include "span.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <vector>
+
+namespace
+{
+
+// What CommandQueue and the fence waiters take, a read only span.
+size_t Sum(Span<const int> values)
+{
+    size_t sum = 0;
+    for (int value : values)
+        sum += size_t(value);
+    return sum;
+}
+
+void Fill(Span<int> values, int value)
+{
+    for (int& item : values)
+        item = value;
+}
+
+struct Base
+{
+};
+struct Derived : Base
+{
+    int extra;
+};
+
+} // namespace
+
+// Only conversions that keep constness and element size.
+static_assert(std::is_constructible_v<Span<const int>, std::vector<int>&>);
+static_assert(std::is_constructible_v<Span<const int>, const std::vector<int>&>);
+static_assert(!std::is_constructible_v<Span<int>, const std::vector<int>&>);
+static_assert(!std::is_constructible_v<Span<int>, const std::array<int, 3>&>);
+static_assert(!std::is_constructible_v<Span<int>, const int (&)[3]>);
+static_assert(!std::is_constructible_v<Span<Base>, std::vector<Derived>&>);
+
+TEST(Span, Vector)
+{
+    std::vector<int> values = { 1, 2, 3, 4 };
+    Span<int>        span   = values;
+    EXPECT_EQ(span.data(), values.data());
+    EXPECT_EQ(span.size(), 4u);
+
+    Fill(values, 5);
+    EXPECT_EQ(values, std::vector<int>(4, 5));
+    span[1] = 7;
+    EXPECT_EQ(values[1], 7);
+    EXPECT_EQ(Sum(values), 22u);
+}
+
+TEST(Span, ConstVector)
+{
+    const std::vector<int> values = { 1, 2, 3 };
+    Span<const int>        span   = values;
+    EXPECT_EQ(span.data(), values.data());
+    EXPECT_EQ(span.size(), 3u);
+    EXPECT_EQ(span.end() - span.begin(), 3);
+    EXPECT_EQ(Sum(values), 6u);
+}
+
+TEST(Span, StdArray)
+{
+    const std::array<int, 3> values = { 4, 5, 6 };
+    Span<const int>          span   = values;
+    EXPECT_EQ(span.data(), values.data());
+    EXPECT_EQ(span.size(), 3u);
+    EXPECT_EQ(Sum(values), 15u);
+
+    std::array<int, 2> mutableValues = { 1, 1 };
+    EXPECT_EQ(Sum(mutableValues), 2u);
+}
+
+TEST(Span, CArray)
+{
+    int values[5] = { 1, 2, 3, 4, 5 };
+    EXPECT_EQ(Sum(values), 15u);
+    Fill(values, 2);
+    EXPECT_EQ(Sum(values), 10u);
+
+    Span<int> span = values;
+    EXPECT_EQ(span.data(), values);
+    EXPECT_EQ(span.size(), 5u);
+}
+
+TEST(Span, PointerAndSize)
+{
+    int values[4] = { 1, 2, 3, 4 };
+    EXPECT_EQ(Sum({ values + 1, 2 }), 5u);
+    EXPECT_EQ(Sum({ values, 0 }), 0u);
+
+    Span<const int> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ(empty.data(), nullptr);
+    EXPECT_EQ(empty.begin(), empty.end());
+    EXPECT_TRUE(Span<const int>(values, 0).empty());
+    EXPECT_FALSE(Span<const int>(values, 4).empty());
+}
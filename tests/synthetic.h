@@ -0,0 +1,162 @@
+/**
+ * Synthetic inputs shared by the tests and benchmarks, the real models are
+ * not in the repository.
+ */
+#pragma once
+
+#include "meshdata.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+// A directory of its own under the system temporary one, removed with it.
+// The name gets a random suffix, so processes running the same test at once
+// under ctest -j never share one.
+class ScratchDirectory
+{
+public:
+    explicit ScratchDirectory(const std::string& name)
+    {
+        std::random_device                      device;
+        std::mt19937_64                         random((uint64_t(device()) << 32) ^ device() ^ uint64_t(std::chrono::steady_clock::now().time_since_epoch().count()));
+        std::filesystem::path                   temp = std::filesystem::temp_directory_path();
+        std::uniform_int_distribution<uint64_t> suffix;
+        do
+        {
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)suffix(random));
+            m_Path = temp / ("petit-" + name + "-" + hex);
+        } while (!std::filesystem::create_directories(m_Path));
+    }
+
+    ~ScratchDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(m_Path, error);
+    }
+
+    ScratchDirectory(const ScratchDirectory&) = delete;
+    ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+    const std::filesystem::path& GetPath() const { return m_Path; }
+    std::string                  operator/(const std::string& file) const { return (m_Path / file).string(); }
+
+private:
+    std::filesystem::path m_Path;
+};
+
+/**
+ * Write a wavy grid of about `triangleCount` triangles with normals and
+ * texcoords as an OBJ file, and its MTL next to it. Every few rows switch
+ * between `materialCount` materials, odd rows are written as quads.
+ * Returns the triangle count actually written.
+ */
+inline size_t WriteGridObj(const std::string& path, size_t triangleCount, uint32_t materialCount = 4)
+{
+    size_t columns = 256;
+    size_t rows    = std::max<size_t>(1, (triangleCount + columns * 2 - 1) / (columns * 2));
+
+    std::string mtlPath = path.substr(0, path.find_last_of('.')) + ".mtl";
+    std::string mtlName = mtlPath.substr(mtlPath.find_last_of("/\\") + 1);
+    if (FILE* mtl = fopen(mtlPath.c_str(), "wb"))
+    {
+        for (uint32_t m = 0; m < materialCount; m++)
+            fprintf(mtl, "newmtl material%u\nKd %g 0.5 0.5\n\n", m, m / double(materialCount));
+        fclose(mtl);
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file)
+        return 0;
+    std::vector<char> buffer(1 << 20);
+    setvbuf(file, buffer.data(), _IOFBF, buffer.size());
+
+    fprintf(file, "mtllib %s\no grid\n", mtlName.c_str());
+    for (size_t y = 0; y <= rows; y++)
+    {
+        for (size_t x = 0; x <= columns; x++)
+        {
+            double height = 0.1 * ((x * 7 + y * 13) % 17) / 17.0;
+            fprintf(file, "v %.6f %.6f %.6f\n", x / double(columns), height, y / double(columns));
+            fprintf(file, "vt %.5f %.5f\n", x / double(columns), y / double(rows));
+            fprintf(file, "vn 0 1 0\n");
+        }
+    }
+
+    size_t written = 0;
+    for (size_t y = 0; y < rows; y++)
+    {
+        if (y % 8 == 0)
+            fprintf(file, "usemtl material%u\n", uint32_t(y / 8 % materialCount));
+        for (size_t x = 0; x < columns; x++)
+        {
+            size_t a = y * (columns + 1) + x + 1;
+            size_t b = a + 1;
+            size_t c = a + columns + 1;
+            size_t d = c + 1;
+            if (y % 2)
+                fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, d, d, d, b, b, b);
+            else
+            {
+                fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", a, a, a, c, c, c, b, b, b);
+                fprintf(file, "f %zu/%zu/%zu %zu/%zu/%zu %zu/%zu/%zu\n", b, b, b, c, c, c, d, d, d);
+            }
+            written += 2;
+        }
+    }
+    fclose(file);
+    return written;
+}
+
+/**
+ * A wavy grid of `columns` x `rows` quads, two triangles each, split into
+ * `submeshCount` bands of rows that share the vertices. Every submesh has a
+ * single level of detail.
+ */
+inline MeshBuffers MakeGridMesh(uint32_t columns, uint32_t rows, uint32_t submeshCount = 1)
+{
+    MeshBuffers mesh;
+    for (uint32_t y = 0; y <= rows; y++)
+    {
+        for (uint32_t x = 0; x <= columns; x++)
+        {
+            MeshVertex vertex;
+            vertex.position = glm::vec3(x / float(columns), 0.1f * ((x * 7 + y * 13) % 17) / 17.0f, y / float(columns));
+            vertex.normal   = glm::vec3(0.0f, 1.0f, 0.0f);
+            vertex.texcoord = glm::vec3(x / float(columns), y / float(rows), 0.0f);
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    for (uint32_t s = 0; s < submeshCount; s++)
+    {
+        MeshSubMesh submesh = {};
+        submesh.index_offset = uint32_t(mesh.indices.size());
+        for (uint32_t y = rows * s / submeshCount; y < rows * (s + 1) / submeshCount; y++)
+        {
+            for (uint32_t x = 0; x < columns; x++)
+            {
+                uint32_t a = y * (columns + 1) + x;
+                uint32_t b = a + 1;
+                uint32_t c = a + columns + 1;
+                uint32_t d = c + 1;
+                mesh.indices.insert(mesh.indices.end(), { a, c, b, b, c, d });
+            }
+        }
+        submesh.index_count  = uint32_t(mesh.indices.size()) - submesh.index_offset;
+        submesh.material_id  = s;
+        submesh.vertex_count = uint32_t(mesh.vertices.size());
+        submesh.lod_offset   = uint32_t(mesh.lods.size());
+        submesh.lod_count    = 1;
+        mesh.submeshes.push_back(submesh);
+        mesh.lods.push_back(MeshLod { submesh.index_offset, submesh.index_count, 0.0f, 0 });
+        mesh.materials.push_back(MeshMaterial());
+    }
+    return mesh;
+}
@@ -0,0 +1,208 @@
+#include "timelinetracker.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <random>
+
+namespace
+{
+
+enum : uint32_t
+{
+    Direct,
+    Compute,
+    Copy,
+    TimelineCount
+};
+
+// Command queues as the GPU sees them: waits, work and signals, executed in
+// order, a wait blocking its queue until the other fence gets there.
+struct FakeGpu
+{
+    struct Op
+    {
+        enum Kind
+        {
+            Wait,
+            Work,
+            Signal
+        } kind;
+        SyncPoint point; // wait, or signal on the queue itself
+        size_t    work;
+    };
+
+    std::deque<Op> queues[TimelineCount];
+    uint64_t       fences[TimelineCount] = {};
+
+    bool IsBlocked(uint32_t q) const
+    {
+        return queues[q].empty() || (queues[q].front().kind == Op::Wait && fences[queues[q].front().point.timeline] < queues[q].front().point.value);
+    }
+};
+
+// Submit work on `timeline` depending on `points`, with the waits the
+// tracker asks for, then signal.
+uint64_t Submit(TimelineTracker& tracker, FakeGpu& gpu, uint64_t (&signaled)[TimelineCount], uint32_t timeline, Span<const SyncPoint> points, size_t work)
+{
+    std::vector<SyncPoint> waits;
+    tracker.Resolve(timeline, points, waits);
+    for (const SyncPoint& wait : waits)
+        gpu.queues[timeline].push_back({ FakeGpu::Op::Wait, wait, 0 });
+    gpu.queues[timeline].push_back({ FakeGpu::Op::Work, {}, work });
+
+    uint64_t value = ++signaled[timeline];
+    tracker.Signal(timeline, value);
+    gpu.queues[timeline].push_back({ FakeGpu::Op::Signal, { timeline, value }, 0 });
+    return value;
+}
+
+std::vector<SyncPoint> ResolveOnly(TimelineTracker& tracker, uint32_t timeline, std::vector<SyncPoint> points)
+{
+    std::vector<SyncPoint> waits;
+    tracker.Resolve(timeline, points, waits);
+    return waits;
+}
+
+} // namespace
+
+TEST(TimelineTracker, DropsOwnAndCompletedPoints)
+{
+    TimelineTracker tracker(TimelineCount);
+    tracker.Signal(Copy, 1);
+    tracker.Signal(Copy, 2);
+    tracker.Signal(Direct, 1);
+    tracker.Complete(Copy, 1);
+
+    auto waits = ResolveOnly(tracker, Direct, { { Direct, 1 }, { Copy, 1 } });
+    EXPECT_TRUE(waits.empty());
+
+    waits = ResolveOnly(tracker, Direct, { { Copy, 2 } });
+    ASSERT_EQ(waits.size(), 1u);
+    EXPECT_EQ(waits[0].timeline, uint32_t(Copy));
+    EXPECT_EQ(waits[0].value, 2u);
+    EXPECT_EQ(tracker.GetKnownValue(Direct, Copy), 2u);
+
+    TimelineWaitStats stats = tracker.GetStats();
+    EXPECT_EQ(stats.requested, 2u);
+    EXPECT_EQ(stats.issued, 1u);
+}
+
+TEST(TimelineTracker, OneWaitPerTimeline)
+{
+    TimelineTracker tracker(TimelineCount);
+    for (uint64_t value = 1; value <= 4; value++)
+        tracker.Signal(Copy, value);
+
+    auto waits = ResolveOnly(tracker, Compute, { { Copy, 2 }, { Copy, 4 }, { Copy, 3 } });
+    ASSERT_EQ(waits.size(), 1u);
+    EXPECT_EQ(waits[0].value, 4u);
+
+    // Already waited for.
+    EXPECT_TRUE(ResolveOnly(tracker, Compute, { { Copy, 3 } }).empty());
+}
+
+// COPY uploads, COMPUTE consumes the upload and DIRECT consumes the compute
+// result: DIRECT is ordered after the upload through COMPUTE's signal.
+TEST(TimelineTracker, WaitsThroughAnotherTimeline)
+{
+    TimelineTracker tracker(TimelineCount);
+    tracker.Signal(Copy, 1);
+    EXPECT_EQ(ResolveOnly(tracker, Compute, { { Copy, 1 } }).size(), 1u);
+    tracker.Signal(Compute, 1);
+
+    auto waits = ResolveOnly(tracker, Direct, { { Compute, 1 }, { Copy, 1 } });
+    ASSERT_EQ(waits.size(), 1u);
+    EXPECT_EQ(waits[0].timeline, uint32_t(Compute));
+    EXPECT_EQ(tracker.GetKnownValue(Direct, Copy), 1u);
+}
+
+// A signal before the wait does not order anything after the producer.
+TEST(TimelineTracker, SignalBeforeTheWaitImpliesNothing)
+{
+    TimelineTracker tracker(TimelineCount);
+    tracker.Signal(Copy, 1);
+    tracker.Signal(Compute, 1);
+    ResolveOnly(tracker, Compute, { { Copy, 1 } });
+    tracker.Signal(Compute, 2);
+
+    EXPECT_EQ(ResolveOnly(tracker, Direct, { { Compute, 1 }, { Copy, 1 } }).size(), 2u);
+}
+
+// Random submissions on the three queues, each depending on random values
+// the others signaled, run on a GPU that advances the queues in random
+// order while the CPU now and then reports completed values. Every piece
+// of work must run after everything it depends on, no queue may wait
+// forever, and the waits implied by others must be left out.
+TEST(TimelineTracker, RandomQueuesRespectDependencies)
+{
+    TimelineTracker tracker(TimelineCount);
+    FakeGpu         gpu;
+    uint64_t        signaled[TimelineCount] = {};
+
+    std::mt19937                       random(17);
+    std::uniform_int_distribution<int> pick(0, TimelineCount - 1);
+    std::uniform_int_distribution<int> dependencyCount(0, 3);
+    std::uniform_int_distribution<int> gpuSteps(0, 6);
+
+    std::vector<std::vector<SyncPoint>> dependencies;
+    size_t                              done = 0;
+    auto                                step = [&]() {
+        std::vector<uint32_t> ready;
+        for (uint32_t q = 0; q < TimelineCount; q++)
+            if (!gpu.IsBlocked(q))
+                ready.push_back(q);
+        if (ready.empty())
+            return false;
+        uint32_t    q  = ready[std::uniform_int_distribution<size_t>(0, ready.size() - 1)(random)];
+        FakeGpu::Op op = gpu.queues[q].front();
+        gpu.queues[q].pop_front();
+        if (op.kind == FakeGpu::Op::Signal)
+            gpu.fences[q] = op.point.value;
+        else if (op.kind == FakeGpu::Op::Work)
+        {
+            for (const SyncPoint& point : dependencies[op.work])
+                EXPECT_GE(gpu.fences[point.timeline], point.value) << "work " << op.work << " on " << q;
+            done++;
+        }
+        return true;
+    };
+
+    for (size_t work = 0; work < 20000; work++)
+    {
+        uint32_t               timeline = uint32_t(pick(random));
+        std::vector<SyncPoint> points;
+        for (int i = dependencyCount(random); i > 0; i--)
+        {
+            uint32_t other = uint32_t(pick(random));
+            if (signaled[other] == 0)
+                continue;
+            // Mostly recent values, like a frame's producers.
+            uint64_t back = std::min<uint64_t>(signaled[other] - 1, uint64_t(pick(random)));
+            points.push_back({ other, signaled[other] - back });
+        }
+        dependencies.push_back(points);
+        Submit(tracker, gpu, signaled, timeline, points, work);
+
+        for (int i = gpuSteps(random); i > 0; i--)
+            step();
+        uint32_t polled = uint32_t(pick(random));
+        tracker.Complete(polled, gpu.fences[polled]);
+    }
+
+    // Drain, a queue waiting on a value never signaled would get stuck.
+    while (step())
+    {
+    }
+    for (uint32_t q = 0; q < TimelineCount; q++)
+    {
+        EXPECT_TRUE(gpu.queues[q].empty()) << "queue " << q << " stuck";
+        EXPECT_EQ(gpu.fences[q], signaled[q]);
+    }
+    EXPECT_EQ(done, dependencies.size());
+
+    TimelineWaitStats stats = tracker.GetStats();
+    EXPECT_LT(stats.issued, stats.requested);
+    RecordProperty("requested", int(stats.requested));
+    RecordProperty("issued", int(stats.issued));
+}
@@ -0,0 +1,198 @@
+/**
+ * TLSF throughput and fragmentation on a 64MB heap, the GpuAllocator
+ * default, with the size and alignment mix of GPU resources: mostly small
+ * 64KB aligned buffers and 4KB textures, some multi megabyte ones.
+ *
+ * Fragmentation is 1 - largest free block / free size, 0 when all free
+ * memory is in one block.
+ */
+#include "tlsf.h"
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+namespace
+{
+
+constexpr uint64_t kHeapSize = 64ull << 20;
+
+struct Request
+{
+    uint64_t size;
+    uint64_t alignment;
+};
+
+class ResourceMix
+{
+public:
+    explicit ResourceMix(uint32_t seed) :
+        m_Random(seed) { }
+
+    Request Next()
+    {
+        int kind = m_Kind(m_Random);
+        if (kind < 50)
+            return { std::uniform_int_distribution<uint64_t>(1, 16)(m_Random) * 65536, 65536 };
+        if (kind < 85)
+            return { std::uniform_int_distribution<uint64_t>(1, 16)(m_Random) * 4096, 4096 };
+        return { std::uniform_int_distribution<uint64_t>(1, 4)(m_Random) << 20, 65536 };
+    }
+
+private:
+    std::mt19937                       m_Random;
+    std::uniform_int_distribution<int> m_Kind { 0, 99 };
+};
+
+double Fragmentation(const TlsfAllocator& tlsf)
+{
+    uint64_t free = tlsf.GetSize() - tlsf.GetUsedSize();
+    return free == 0 ? 0.0 : 1.0 - double(tlsf.GetLargestFreeBlock()) / double(free);
+}
+
+// Allocations and frees in random order around a steady fill.
+void BM_TlsfChurn(benchmark::State& state)
+{
+    const size_t operations = size_t(state.range(0));
+    double       fragmentation = 0.0;
+    double       utilization   = 0.0;
+    uint64_t     failures      = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        TlsfAllocator                          tlsf(kHeapSize);
+        ResourceMix                            mix(1);
+        std::mt19937                           random(2);
+        std::vector<TlsfAllocator::Allocation> live;
+        live.reserve(4096);
+        failures = 0;
+        state.ResumeTiming();
+
+        for (size_t i = 0; i < operations; i++)
+        {
+            // Keep the heap around 70% full.
+            bool allocate = live.empty() || tlsf.GetUsedSize() < kHeapSize * 7 / 10;
+            if (allocate)
+            {
+                Request request    = mix.Next();
+                auto    allocation = tlsf.Allocate(request.size, request.alignment);
+                if (allocation.offset == TlsfAllocator::InvalidOffset)
+                    failures++;
+                else
+                    live.push_back(allocation);
+            }
+            else
+            {
+                size_t victim = std::uniform_int_distribution<size_t>(0, live.size() - 1)(random);
+                tlsf.Free(live[victim]);
+                live[victim] = live.back();
+                live.pop_back();
+            }
+        }
+
+        state.PauseTiming();
+        fragmentation = Fragmentation(tlsf);
+        utilization   = double(tlsf.GetUsedSize()) / double(kHeapSize);
+        state.ResumeTiming();
+    }
+    state.counters["ops/s"]         = benchmark::Counter(double(operations), benchmark::Counter::kIsIterationInvariantRate);
+    state.counters["fragmentation"] = fragmentation;
+    state.counters["utilization"]   = utilization;
+    state.counters["failures"]      = double(failures);
+}
+
+// Fill the heap, free a random half and fill again until the first request
+// fails: how much of the heap is usable once it is fragmented.
+void BM_TlsfRefill(benchmark::State& state)
+{
+    double utilization   = 0.0;
+    double fragmentation = 0.0;
+    for (auto _ : state)
+    {
+        TlsfAllocator                          tlsf(kHeapSize);
+        ResourceMix                            mix(uint32_t(state.range(0)));
+        std::mt19937                           random(3);
+        std::vector<TlsfAllocator::Allocation> live;
+        for (;;)
+        {
+            Request request    = mix.Next();
+            auto    allocation = tlsf.Allocate(request.size, request.alignment);
+            if (allocation.offset == TlsfAllocator::InvalidOffset)
+                break;
+            live.push_back(allocation);
+        }
+        std::shuffle(live.begin(), live.end(), random);
+        for (size_t i = 0; i < live.size() / 2; i++)
+            tlsf.Free(live[i]);
+        fragmentation = Fragmentation(tlsf);
+
+        for (;;)
+        {
+            Request request = mix.Next();
+            if (tlsf.Allocate(request.size, request.alignment).offset == TlsfAllocator::InvalidOffset)
+                break;
+        }
+        utilization = double(tlsf.GetUsedSize()) / double(kHeapSize);
+    }
+    state.counters["fragmentation"] = fragmentation;
+    state.counters["utilization"]   = utilization;
+}
+
+// Fragment the heap, then compact it like GpuAllocator::Defragment: move
+// allocations from the end of the heap into the lowest hole below them.
+void BM_TlsfCompact(benchmark::State& state)
+{
+    double   before = 0.0;
+    double   after  = 0.0;
+    uint64_t moves  = 0;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        TlsfAllocator                                   tlsf(kHeapSize);
+        ResourceMix                                     mix(4);
+        std::mt19937                                    random(5);
+        std::vector<std::pair<TlsfAllocator::Allocation, Request>> live;
+        for (;;)
+        {
+            Request request    = mix.Next();
+            auto    allocation = tlsf.Allocate(request.size, request.alignment);
+            if (allocation.offset == TlsfAllocator::InvalidOffset)
+                break;
+            live.push_back({ allocation, request });
+        }
+        std::shuffle(live.begin(), live.end(), random);
+        for (size_t i = 0; i < live.size() / 2; i++)
+            tlsf.Free(live[i].first);
+        live.erase(live.begin(), live.begin() + live.size() / 2);
+        std::sort(live.begin(), live.end(), [](const auto& a, const auto& b) { return a.first.offset > b.first.offset; });
+        before = Fragmentation(tlsf);
+        moves  = 0;
+        state.ResumeTiming();
+
+        for (auto& entry : live)
+        {
+            auto target = tlsf.AllocateBelow(entry.second.size, entry.second.alignment, entry.first.offset);
+            if (target.offset == TlsfAllocator::InvalidOffset)
+                continue;
+            tlsf.Free(entry.first);
+            entry.first = target;
+            moves++;
+        }
+
+        state.PauseTiming();
+        after = Fragmentation(tlsf);
+        state.ResumeTiming();
+    }
+    state.counters["before"] = before;
+    state.counters["after"]  = after;
+    state.counters["moves"]  = double(moves);
+}
+
+} // namespace
+
+BENCHMARK(BM_TlsfChurn)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TlsfRefill)->Arg(1)->Arg(2)->Arg(3)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_TlsfCompact)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
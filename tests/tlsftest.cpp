@@ -0,0 +1,167 @@
+#include "tlsf.h"
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+
+namespace
+{
+
+// Live allocations by offset, to check them against each other.
+struct Reference
+{
+    std::map<uint64_t, std::pair<uint64_t, TlsfAllocator::Allocation>> live;
+    uint64_t                                                           used = 0;
+
+    ::testing::AssertionResult Add(TlsfAllocator::Allocation allocation, uint64_t size, uint64_t alignment, uint64_t capacity)
+    {
+        if (allocation.offset % alignment != 0)
+            return ::testing::AssertionFailure() << "misaligned " << allocation.offset;
+        if (allocation.offset + size > capacity)
+            return ::testing::AssertionFailure() << "out of range " << allocation.offset;
+        auto next = live.lower_bound(allocation.offset);
+        if (next != live.end() && next->first < allocation.offset + size)
+            return ::testing::AssertionFailure() << "overlaps the next allocation at " << next->first;
+        if (next != live.begin() && std::prev(next)->first + std::prev(next)->second.first > allocation.offset)
+            return ::testing::AssertionFailure() << "overlaps the previous allocation at " << std::prev(next)->first;
+        live[allocation.offset] = { size, allocation };
+        used += size;
+        return ::testing::AssertionSuccess();
+    }
+};
+
+} // namespace
+
+TEST(Tlsf, AllocatesFromTheStart)
+{
+    TlsfAllocator tlsf(1 << 20);
+    auto          a = tlsf.Allocate(1000);
+    auto          b = tlsf.Allocate(24);
+    EXPECT_EQ(a.offset, 0u);
+    EXPECT_EQ(b.offset, 1000u);
+    EXPECT_EQ(tlsf.GetUsedSize(), 1024u);
+    EXPECT_EQ(tlsf.GetAllocationCount(), 2u);
+    EXPECT_EQ(tlsf.GetLargestFreeBlock(), (1u << 20) - 1024u);
+}
+
+TEST(Tlsf, HonoursAlignment)
+{
+    TlsfAllocator tlsf(16 << 20);
+    tlsf.Allocate(100);
+    auto a = tlsf.Allocate(65536, 65536);
+    auto c = tlsf.Allocate(1, 4 << 20);
+    EXPECT_EQ(a.offset, 65536u);
+    EXPECT_EQ(c.offset, 4u << 20);
+    // The padding in front of an aligned allocation stays usable.
+    auto b = tlsf.Allocate(4096, 4096);
+    EXPECT_EQ(b.offset, 4096u);
+    EXPECT_EQ(tlsf.GetUsedSize(), 100u + 65536u + 1u + 4096u);
+}
+
+TEST(Tlsf, FailsWhenNothingFits)
+{
+    TlsfAllocator tlsf(4096);
+    EXPECT_EQ(tlsf.Allocate(0).offset, TlsfAllocator::InvalidOffset);
+    EXPECT_EQ(tlsf.Allocate(4097).offset, TlsfAllocator::InvalidOffset);
+    auto all = tlsf.Allocate(4096);
+    EXPECT_EQ(all.offset, 0u);
+    EXPECT_EQ(tlsf.Allocate(1).offset, TlsfAllocator::InvalidOffset);
+    EXPECT_EQ(tlsf.GetLargestFreeBlock(), 0u);
+    EXPECT_EQ(tlsf.GetFreeBlockCount(), 0u);
+}
+
+// Sizes at a size class boundary, so the last allocation can take the
+// exact remainder: otherwise the good fit rounding skips its class.
+TEST(Tlsf, MergesFreedNeighbours)
+{
+    TlsfAllocator tlsf(3072);
+    auto          a = tlsf.Allocate(1024);
+    auto          b = tlsf.Allocate(1024);
+    auto          c = tlsf.Allocate(1024);
+    ASSERT_EQ(c.offset, 2048u);
+
+    tlsf.Free(a);
+    tlsf.Free(c);
+    EXPECT_EQ(tlsf.GetFreeBlockCount(), 2u);
+    EXPECT_EQ(tlsf.GetLargestFreeBlock(), 1024u);
+
+    tlsf.Free(b);
+    EXPECT_EQ(tlsf.GetFreeBlockCount(), 1u);
+    EXPECT_EQ(tlsf.GetLargestFreeBlock(), 3072u);
+    EXPECT_EQ(tlsf.GetUsedSize(), 0u);
+    EXPECT_EQ(tlsf.Allocate(3072).offset, 0u);
+}
+
+TEST(Tlsf, AllocateBelowTakesTheLowestFit)
+{
+    TlsfAllocator tlsf(10000);
+    tlsf.Allocate(1000);
+    auto b = tlsf.Allocate(1000);
+    tlsf.Allocate(1000);
+    auto d = tlsf.Allocate(1000);
+    tlsf.Allocate(1000);
+    tlsf.Free(b);
+    tlsf.Free(d);
+
+    // Both holes fit, the lower one wins.
+    EXPECT_EQ(tlsf.AllocateBelow(500, 1, 9000).offset, 1000u);
+    // The rest of the first hole is too small, the second starts below the
+    // limit.
+    EXPECT_EQ(tlsf.AllocateBelow(600, 1, 3500).offset, 3000u);
+    // Nothing starts below 1000.
+    EXPECT_EQ(tlsf.AllocateBelow(100, 1, 1000).offset, TlsfAllocator::InvalidOffset);
+}
+
+// Random allocations and frees with the size and alignment mix of GPU
+// resources, checked against a reference. Whenever an allocation fails, no
+// free block may be large enough for it with room to spare for the
+// rounding of the size classes.
+TEST(Tlsf, RandomAgainstReference)
+{
+    const uint64_t kSize = 256ull << 20;
+    TlsfAllocator  tlsf(kSize);
+    Reference      reference;
+
+    std::mt19937                            random(5);
+    std::uniform_int_distribution<int>      action(0, 99);
+    std::uniform_int_distribution<uint64_t> smallSize(1, 64 << 10);
+    std::uniform_int_distribution<uint64_t> largeSize(64 << 10, 8 << 20);
+    const uint64_t                          alignments[] = { 1, 256, 4096, 65536, 4 << 20 };
+    std::uniform_int_distribution<int>      alignment(0, 4);
+
+    uint32_t failures = 0;
+    for (int step = 0; step < 200000; step++)
+    {
+        if (action(random) < 55 || reference.live.empty())
+        {
+            uint64_t size  = action(random) < 80 ? smallSize(random) : largeSize(random);
+            uint64_t align = alignments[alignment(random)];
+            auto     a     = tlsf.Allocate(size, align);
+            if (a.offset == TlsfAllocator::InvalidOffset)
+            {
+                failures++;
+                ASSERT_LT(tlsf.GetLargestFreeBlock(), (size + align - 1) * 17 / 16 + 1) << "step " << step;
+                continue;
+            }
+            ASSERT_TRUE(reference.Add(a, size, align, kSize)) << "step " << step;
+        }
+        else
+        {
+            auto it = reference.live.begin();
+            std::advance(it, std::uniform_int_distribution<size_t>(0, reference.live.size() - 1)(random));
+            tlsf.Free(it->second.second);
+            reference.used -= it->second.first;
+            reference.live.erase(it);
+        }
+        ASSERT_EQ(tlsf.GetUsedSize(), reference.used);
+        ASSERT_EQ(tlsf.GetAllocationCount(), reference.live.size());
+    }
+    EXPECT_GT(failures, 0u);
+
+    for (auto& allocation : reference.live)
+        tlsf.Free(allocation.second.second);
+    EXPECT_EQ(tlsf.GetUsedSize(), 0u);
+    EXPECT_EQ(tlsf.GetFreeBlockCount(), 1u);
+    EXPECT_EQ(tlsf.GetLargestFreeBlock(), kSize);
+}
@@ -0,0 +1,187 @@
+#include "uploadring.h"
+
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <random>
+
+namespace
+{
+
+// Stands in for the COPY queue fence: values are signaled on submit and
+// complete when the test says so.
+struct FakeFence
+{
+    uint64_t signaled  = 0;
+    uint64_t completed = 0;
+
+    uint64_t Signal() { return ++signaled; }
+    void     CompleteUpTo(uint64_t value) { completed = std::max(completed, std::min(value, signaled)); }
+};
+
+struct Range
+{
+    uint64_t offset;
+    uint64_t size;
+    uint64_t fenceValue; // 0 until submitted
+};
+
+bool Overlaps(const Range& a, const Range& b)
+{
+    return a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+}
+
+} // namespace
+
+TEST(UploadRing, AllocatesAlignedAndInOrder)
+{
+    UploadRing ring(1024);
+    EXPECT_EQ(ring.Allocate(10, 1), 0u);
+    EXPECT_EQ(ring.Allocate(10, 16), 16u);
+    EXPECT_EQ(ring.Allocate(1, 256), 256u);
+    EXPECT_EQ(ring.GetUsedSize(), 257u);
+    EXPECT_TRUE(ring.HasPending());
+
+    EXPECT_EQ(ring.Allocate(0, 1), UploadRing::InvalidOffset);
+    EXPECT_EQ(ring.Allocate(1025, 1), UploadRing::InvalidOffset);
+}
+
+TEST(UploadRing, FullUntilTheFenceCompletes)
+{
+    FakeFence  fence;
+    UploadRing ring(1024);
+
+    EXPECT_EQ(ring.Allocate(600, 1), 0u);
+    uint64_t first = fence.Signal();
+    ring.Submit(first);
+    EXPECT_FALSE(ring.HasPending());
+    EXPECT_EQ(ring.GetOldestFenceValue(), first);
+
+    // 600 + 600 does not fit, and the allocation never wraps.
+    EXPECT_EQ(ring.Allocate(600, 1), UploadRing::InvalidOffset);
+    EXPECT_EQ(ring.Allocate(424, 1), 600u);
+
+    ring.Retire(fence.completed);
+    EXPECT_EQ(ring.Allocate(100, 1), UploadRing::InvalidOffset);
+
+    fence.CompleteUpTo(first);
+    ring.Retire(fence.completed);
+    // The pending 424 bytes stay, the space before them is free again.
+    EXPECT_EQ(ring.GetUsedSize(), 424u);
+    EXPECT_EQ(ring.Allocate(600, 1), 0u);
+}
+
+TEST(UploadRing, SkipsTheEndInsteadOfSplitting)
+{
+    FakeFence  fence;
+    UploadRing ring(1024);
+
+    ring.Allocate(800, 1);
+    ring.Submit(fence.Signal());
+    ring.Allocate(100, 1);
+    ring.Submit(fence.Signal());
+    fence.CompleteUpTo(1);
+    ring.Retire(fence.completed);
+
+    // 124 bytes are left at the end, 200 go to the start of the ring.
+    EXPECT_EQ(ring.Allocate(200, 1), 0u);
+    EXPECT_EQ(ring.GetUsedSize(), 100u + 124u + 200u);
+}
+
+TEST(UploadRing, ResetsWhenIdle)
+{
+    FakeFence  fence;
+    UploadRing ring(1024);
+
+    ring.Allocate(700, 1);
+    ring.Submit(fence.Signal());
+    fence.CompleteUpTo(fence.signaled);
+    ring.Retire(fence.completed);
+
+    EXPECT_EQ(ring.GetUsedSize(), 0u);
+    EXPECT_EQ(ring.GetOldestFenceValue(), 0u);
+    // Back at the start, so a full size allocation fits.
+    EXPECT_EQ(ring.Allocate(1024, 1), 0u);
+}
+
+TEST(UploadRing, SubmitWithoutAllocationsIsIgnored)
+{
+    UploadRing ring(256);
+    ring.Submit(5);
+    EXPECT_EQ(ring.GetOldestFenceValue(), 0u);
+    ring.Allocate(16, 1);
+    ring.Submit(6);
+    EXPECT_EQ(ring.GetOldestFenceValue(), 6u);
+}
+
+// Uploads of random sizes against a fence that lags a random number of
+// submissions behind, waiting for the oldest one when the ring is full like
+// UploadService does. No allocation may overlap one the GPU could still be
+// reading.
+TEST(UploadRing, NeverHandsOutSpaceInFlight)
+{
+    const uint64_t kCapacity = 64 * 1024;
+    FakeFence      fence;
+    UploadRing     ring(kCapacity);
+
+    std::mt19937                            random(3);
+    std::uniform_int_distribution<uint64_t> size(1, 9000);
+    std::uniform_int_distribution<int>      alignmentShift(0, 9);
+    std::uniform_int_distribution<int>      batch(1, 6);
+    std::uniform_int_distribution<int>      lag(0, 4);
+
+    std::deque<Range> live;
+    uint64_t          waits  = 0;
+    auto              retire = [&]() {
+        ring.Retire(fence.completed);
+        while (!live.empty() && live.front().fenceValue != 0 && live.front().fenceValue <= fence.completed)
+            live.pop_front();
+    };
+    for (int step = 0; step < 20000; step++)
+    {
+        int count = batch(random);
+        for (int i = 0; i < count; i++)
+        {
+            uint64_t bytes     = size(random);
+            uint64_t alignment = 1ull << alignmentShift(random);
+            uint64_t offset    = ring.Allocate(bytes, alignment);
+            while (offset == UploadRing::InvalidOffset)
+            {
+                if (ring.GetOldestFenceValue() == 0)
+                {
+                    // Only pending allocations left, submit them first.
+                    uint64_t value = fence.Signal();
+                    ring.Submit(value);
+                    for (Range& range : live)
+                        if (range.fenceValue == 0)
+                            range.fenceValue = value;
+                }
+                fence.CompleteUpTo(ring.GetOldestFenceValue());
+                retire();
+                waits++;
+                offset = ring.Allocate(bytes, alignment);
+            }
+
+            ASSERT_EQ(offset % alignment, 0u);
+            ASSERT_LE(offset + bytes, kCapacity);
+            Range allocated = { offset, bytes, 0 };
+            for (const Range& range : live)
+                ASSERT_FALSE(Overlaps(allocated, range)) << "step " << step;
+            live.push_back(allocated);
+        }
+
+        uint64_t value = fence.Signal();
+        ring.Submit(value);
+        for (Range& range : live)
+            if (range.fenceValue == 0)
+                range.fenceValue = value;
+
+        fence.CompleteUpTo(fence.signaled - std::min<uint64_t>(fence.signaled, uint64_t(lag(random))));
+        retire();
+
+        ASSERT_LE(ring.GetUsedSize(), kCapacity);
+        ASSERT_TRUE(ring.GetOldestFenceValue() == 0 || ring.GetOldestFenceValue() > fence.completed);
+    }
+    // The lag is meant to fill the ring now and then.
+    EXPECT_GT(waits, 0u);
+}
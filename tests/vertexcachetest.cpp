@@ -0,0 +1,131 @@
+#include "synthetic.h"
+#include "vertexcache.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+
+using Triangle = std::array<uint32_t, 3>;
+
+// A grid with its triangles shuffled within every submesh, about the worst
+// order for the cache.
+MeshBuffers MakeShuffledGrid(uint32_t columns, uint32_t rows, uint32_t submeshCount)
+{
+    MeshBuffers  mesh = MakeGridMesh(columns, rows, submeshCount);
+    std::mt19937 random(3);
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+    {
+        Triangle* triangles = reinterpret_cast<Triangle*>(&mesh.indices[submesh.index_offset]);
+        std::shuffle(triangles, triangles + submesh.index_count / 3, random);
+    }
+    return mesh;
+}
+
+// The triangles of a range rotated to start at their smallest index, which
+// keeps the winding, and sorted.
+std::vector<Triangle> CanonicalTriangles(const uint32_t* indices, size_t indexCount)
+{
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i < indexCount; i += 3)
+    {
+        Triangle t = { indices[i], indices[i + 1], indices[i + 2] };
+        std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+        triangles.push_back(t);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+bool SameVertex(const MeshVertex& a, const MeshVertex& b)
+{
+    return a.position == b.position && a.normal == b.normal && a.texcoord == b.texcoord;
+}
+
+} // namespace
+
+TEST(VertexCache, AnalyzeCountsMisses)
+{
+    std::vector<MeshSubMesh> submeshes(1);
+    submeshes[0].index_count = 6;
+
+    // The same triangle twice, shaded once.
+    VertexCacheStats stats = AnalyzeVertexCache({ 0, 1, 2, 0, 1, 2 }, submeshes, 3);
+    EXPECT_FLOAT_EQ(stats.acmr, 1.5f);
+    EXPECT_FLOAT_EQ(stats.atvr, 1.0f);
+
+    // A cache of three entries forgets vertex 0 by the second triangle.
+    stats = AnalyzeVertexCache({ 0, 1, 2, 3, 4, 0 }, submeshes, 5, 3);
+    EXPECT_FLOAT_EQ(stats.acmr, 3.0f);
+    EXPECT_FLOAT_EQ(stats.atvr, 6.0f / 5.0f);
+}
+
+// Reordering only permutes the triangles of each submesh, up to the
+// rotation of their corners.
+TEST(VertexCache, PreservesTheTrianglesOfEverySubmesh)
+{
+    MeshBuffers mesh     = MakeShuffledGrid(64, 48, 3);
+    MeshBuffers original = mesh;
+    OptimizeVertexCache(mesh.indices, mesh.submeshes);
+
+    EXPECT_NE(mesh.indices, original.indices);
+    for (const MeshSubMesh& submesh : mesh.submeshes)
+    {
+        EXPECT_EQ(CanonicalTriangles(&mesh.indices[submesh.index_offset], submesh.index_count),
+                  CanonicalTriangles(&original.indices[submesh.index_offset], submesh.index_count));
+    }
+}
+
+TEST(VertexCache, ImprovesAShuffledGrid)
+{
+    MeshBuffers      mesh   = MakeShuffledGrid(128, 96, 2);
+    VertexCacheStats before = AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size());
+    OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    VertexCacheStats after = AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size());
+
+    EXPECT_LE(after.acmr, before.acmr);
+    EXPECT_LE(after.atvr, before.atvr);
+    // A grid has half a vertex per triangle, a good order gets near it.
+    EXPECT_LT(after.acmr, 0.8f);
+    EXPECT_GT(before.acmr, 2.0f);
+
+    // Already optimized, it does not get worse.
+    OptimizeVertexCache(mesh.indices, mesh.submeshes);
+    EXPECT_LE(AnalyzeVertexCache(mesh.indices, mesh.submeshes, mesh.vertices.size()).acmr, after.acmr);
+}
+
+// Vertices are renumbered in first use order, the unreferenced ones
+// dropped, and every corner still reads the same vertex.
+TEST(VertexCache, FetchRemapIsAPermutation)
+{
+    MeshBuffers mesh = MakeShuffledGrid(40, 30, 1);
+    // Unreferenced vertices in the middle and at the end.
+    MeshVertex unused;
+    unused.position = glm::vec3(-7.0f);
+    mesh.vertices.insert(mesh.vertices.begin() + 100, 5, unused);
+    for (uint32_t& index : mesh.indices)
+        index = index >= 100 ? index + 5 : index;
+    mesh.vertices.push_back(unused);
+
+    MeshBuffers original = mesh;
+    size_t      dropped  = OptimizeVertexFetch(mesh.vertices, mesh.indices);
+    EXPECT_EQ(dropped, 6u);
+    EXPECT_EQ(mesh.vertices.size(), original.vertices.size() - 6);
+    ASSERT_EQ(mesh.indices.size(), original.indices.size());
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++)
+    {
+        ASSERT_LE(mesh.indices[i], next) << "index " << i << " not in first use order";
+        if (mesh.indices[i] == next)
+            next++;
+        ASSERT_TRUE(SameVertex(mesh.vertices[mesh.indices[i]], original.vertices[original.indices[i]])) << "corner " << i;
+    }
+    EXPECT_EQ(next, mesh.vertices.size());
+    for (const MeshVertex& vertex : mesh.vertices)
+        EXPECT_NE(vertex.position, unused.position);
+}
@@ -0,0 +1,292 @@
+#include "vertexformat.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+namespace
+{
+
+// An odd count, so the SIMD kernels leave a scalar tail.
+constexpr size_t kVertexCount = 4099;
+
+std::vector<MeshVertex> RandomVertices(size_t count, uint32_t seed)
+{
+    std::mt19937                          random(seed);
+    std::uniform_real_distribution<float> position(-50.0f, 80.0f);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> uv(-4.0f, 4.0f);
+
+    std::vector<MeshVertex> vertices(count);
+    for (auto& vertex : vertices)
+    {
+        vertex.position = glm::vec3(position(random), position(random) * 0.01f, position(random));
+        glm::vec3 normal;
+        do
+            normal = glm::vec3(unit(random), unit(random), unit(random));
+        while (glm::dot(normal, normal) < 1e-4f);
+        vertex.normal   = glm::normalize(normal);
+        vertex.texcoord = glm::vec3(uv(random), uv(random), 0.0f);
+    }
+    // The corners of the octahedron and the poles hit the edge cases.
+    const glm::vec3 axes[] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+    for (size_t i = 0; i < 6 && i < count; i++)
+        vertices[i].normal = axes[i];
+    return vertices;
+}
+
+float AngleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    // atan2 in double, acos of a float dot product is too coarse near 0.
+    glm::dvec3 da(a), db(b);
+    return float(glm::degrees(std::atan2(glm::length(glm::cross(da, db)), glm::dot(da, db))));
+}
+
+uint32_t FloatBits(float f)
+{
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+float BitsFloat(uint32_t u)
+{
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+template <typename Format>
+void ExpectRoundTrip(const std::vector<MeshVertex>& vertices)
+{
+    VertexQuantization  q = VertexQuantization::FromVertices(vertices.data(), vertices.size());
+    std::vector<Format> packed(vertices.size());
+    EncodeVertices(vertices.data(), vertices.size(), q, packed.data());
+
+    std::vector<MeshVertex> decoded(vertices.size());
+    DecodeVertices(packed.data(), packed.size(), q, decoded.data());
+
+    // Half a quantization step per axis, plus float rounding.
+    glm::vec3 bound = glm::vec3(q.scale) / 65535.0f * 0.5f + glm::vec3(1e-5f) * glm::vec3(q.scale);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        glm::vec3 error = glm::abs(decoded[i].position - vertices[i].position);
+        ASSERT_LE(error.x, bound.x) << i;
+        ASSERT_LE(error.y, bound.y) << i;
+        ASSERT_LE(error.z, bound.z) << i;
+        EXPECT_EQ(packed[i].position[3], 0);
+
+        // snorm16 octahedral is well under 0.01 degrees.
+        ASSERT_LT(AngleDegrees(decoded[i].normal, vertices[i].normal), 0.01f) << i;
+        ASSERT_NEAR(glm::length(decoded[i].normal), 1.0f, 1e-5f) << i;
+
+        if constexpr (Format::kHasTexcoord)
+        {
+            // Half keeps 11 significant bits.
+            ASSERT_NEAR(decoded[i].texcoord.x, vertices[i].texcoord.x, std::fabs(vertices[i].texcoord.x) * 0x1p-11f) << i;
+            ASSERT_NEAR(decoded[i].texcoord.y, vertices[i].texcoord.y, std::fabs(vertices[i].texcoord.y) * 0x1p-11f) << i;
+        }
+        else
+            ASSERT_EQ(decoded[i].texcoord, glm::vec3(-1.0f));
+    }
+}
+
+} // namespace
+
+TEST(VertexFormat, Layout)
+{
+    VertexFormat noUV = GetVertexFormat<PackedVertexNoUV>();
+    EXPECT_EQ(noUV.stride, 12u);
+    ASSERT_EQ(noUV.attributeCount, 2u);
+    EXPECT_EQ(noUV.attributes[1].offset, offsetof(PackedVertexNoUV, normal));
+
+    VertexFormat uv = GetVertexFormat<PackedVertexUV>();
+    EXPECT_EQ(uv.stride, 16u);
+    ASSERT_EQ(uv.attributeCount, 3u);
+    EXPECT_EQ(uv.attributes[2].format, VERTEX_ATTRIBUTE_FLOAT16X2);
+    EXPECT_EQ(uv.attributes[2].offset, offsetof(PackedVertexUV, texcoord));
+
+    // Against the 36 byte MeshVertex.
+    EXPECT_GT(sizeof(MeshVertex), 2 * sizeof(PackedVertexUV));
+}
+
+TEST(VertexFormat, RoundTripNoUV)
+{
+    ExpectRoundTrip<PackedVertexNoUV>(RandomVertices(kVertexCount, 1));
+}
+
+TEST(VertexFormat, RoundTripUV)
+{
+    ExpectRoundTrip<PackedVertexUV>(RandomVertices(kVertexCount, 2));
+}
+
+TEST(VertexFormat, QuantizeClampsToGrid)
+{
+    std::vector<MeshVertex> vertices(3);
+    vertices[0].position = glm::vec3(-1.0f, 2.0f, 0.5f);
+    vertices[1].position = glm::vec3(-3.0f, 5.0f, NAN);
+    vertices[2].position = glm::vec3(0.0f, 2.0f, 0.5f);
+
+    // A flat z axis, the degenerate scale encodes to 0.
+    VertexQuantization q = VertexQuantization::FromBounds(glm::vec3(-1.0f, 2.0f, 0.5f), glm::vec3(0.0f, 4.0f, 0.5f));
+    uint16_t           out[3][4];
+    QuantizePositions(vertices.data(), vertices.size(), q, out[0], sizeof(out[0]));
+
+    EXPECT_EQ(out[0][0], 0);
+    EXPECT_EQ(out[0][1], 0);
+    EXPECT_EQ(out[1][0], 0);
+    EXPECT_EQ(out[1][1], 65535);
+    EXPECT_EQ(out[1][2], 0);
+    EXPECT_EQ(out[2][0], 65535);
+    EXPECT_EQ(out[2][2], 0);
+}
+
+// The SIMD bodies and the scalar tails must agree, encoding one vertex at a
+// time only runs the tail.
+TEST(VertexFormat, SimdMatchesScalar)
+{
+    std::vector<MeshVertex> vertices = RandomVertices(kVertexCount, 3);
+    VertexQuantization      q        = VertexQuantization::FromVertices(vertices.data(), vertices.size());
+
+    std::vector<PackedVertexUV> bulk(vertices.size());
+    std::vector<PackedVertexUV> single(vertices.size());
+    EncodeVertices(vertices.data(), vertices.size(), q, bulk.data());
+    for (size_t i = 0; i < vertices.size(); i++)
+        EncodeVertices(&vertices[i], 1, q, &single[i]);
+    ASSERT_EQ(memcmp(bulk.data(), single.data(), bulk.size() * sizeof(PackedVertexUV)), 0);
+
+    std::vector<MeshVertex> bulkDecoded(vertices.size());
+    std::vector<MeshVertex> singleDecoded(vertices.size());
+    DecodeVertices(bulk.data(), bulk.size(), q, bulkDecoded.data());
+    for (size_t i = 0; i < vertices.size(); i++)
+        DecodeVertices(&bulk[i], 1, q, &singleDecoded[i]);
+    for (size_t i = 0; i < vertices.size(); i++)
+        ASSERT_EQ(bulkDecoded[i], singleDecoded[i]) << i;
+}
+
+TEST(VertexFormat, HalfRoundTripsEveryValue)
+{
+    for (uint32_t h = 0; h < 0x10000; h++)
+    {
+        float f = HalfToFloat(uint16_t(h));
+        if (std::isnan(f))
+        {
+            EXPECT_TRUE((h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0) << h;
+            continue;
+        }
+        ASSERT_EQ(FloatToHalf(f), h) << h;
+    }
+    EXPECT_EQ(HalfToFloat(0x3c00), 1.0f);
+    EXPECT_EQ(HalfToFloat(0xc000), -2.0f);
+    EXPECT_EQ(HalfToFloat(0x0001), 0x1p-24f);
+}
+
+TEST(VertexFormat, FloatToHalfRoundsToNearestEven)
+{
+    // 1 + 2^-11 is halfway between 1 and the next half, 1 + 2^-10.
+    EXPECT_EQ(FloatToHalf(1.0f + 0x1p-11f), 0x3c00);
+    EXPECT_EQ(FloatToHalf(1.0f + 0x1p-10f + 0x1p-11f), 0x3c02);
+    EXPECT_EQ(FloatToHalf(65504.0f), 0x7bff);
+    EXPECT_EQ(FloatToHalf(65520.0f), 0x7c00);
+    EXPECT_EQ(FloatToHalf(-INFINITY), 0xfc00);
+    EXPECT_EQ(FloatToHalf(NAN) & 0x7fff, 0x7e00);
+    EXPECT_EQ(FloatToHalf(0x1p-25f), 0x0000);
+    EXPECT_EQ(FloatToHalf(0x1p-25f + 0x1p-30f), 0x0001);
+    EXPECT_EQ(FloatToHalf(-0.0f), 0x8000);
+}
+
+// The texcoord kernel goes through the SIMD converter, it must give the
+// scalar result for every class of float.
+TEST(VertexFormat, TexcoordKernelMatchesFloatToHalf)
+{
+    std::mt19937                            random(4);
+    std::uniform_int_distribution<uint32_t> bits;
+
+    std::vector<MeshVertex> vertices(1 << 16);
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        // Every exponent, random mantissas and signs.
+        uint32_t exponent      = uint32_t(i % 256) << 23;
+        uint32_t rest          = bits(random) & 0x807fffffu;
+        vertices[i].texcoord.x = BitsFloat(exponent | rest);
+        vertices[i].texcoord.y = BitsFloat(bits(random));
+    }
+
+    std::vector<uint16_t> halfs(2 * vertices.size());
+    EncodeTexcoords(vertices.data(), vertices.size(), halfs.data(), 2 * sizeof(uint16_t));
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        ASSERT_EQ(halfs[2 * i], FloatToHalf(vertices[i].texcoord.x)) << std::hex << FloatBits(vertices[i].texcoord.x);
+        ASSERT_EQ(halfs[2 * i + 1], FloatToHalf(vertices[i].texcoord.y)) << std::hex << FloatBits(vertices[i].texcoord.y);
+    }
+
+    std::vector<MeshVertex> decoded(vertices.size());
+    DecodeTexcoords(halfs.data(), 2 * sizeof(uint16_t), decoded.size(), decoded.data());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        float expected = HalfToFloat(halfs[2 * i]);
+        if (std::isnan(expected))
+            ASSERT_TRUE(std::isnan(decoded[i].texcoord.x));
+        else
+            ASSERT_EQ(decoded[i].texcoord.x, expected);
+    }
+}
+
+TEST(VertexFormat, PackVerticesPerSubMesh)
+{
+    std::vector<MeshVertex> vertices = RandomVertices(1000, 5);
+    for (size_t i = 500; i < 1000; i++)
+        vertices[i].position *= 0.001f;
+
+    std::vector<MeshSubMesh> submeshes(2);
+    submeshes[0].vertex_offset = 0;
+    submeshes[0].vertex_count  = 500;
+    submeshes[1].vertex_offset = 500;
+    submeshes[1].vertex_count  = 500;
+
+    MeshView mesh;
+    mesh.vertices  = ArrayView<MeshVertex>(vertices.data(), vertices.size());
+    mesh.submeshes = ArrayView<MeshSubMesh>(submeshes.data(), submeshes.size());
+
+    std::vector<VertexQuantization> quantization;
+    std::vector<PackedVertexNoUV>   packed = PackVertices<PackedVertexNoUV>(mesh, quantization);
+    ASSERT_EQ(quantization.size(), 2u);
+    // The small submesh gets its own, finer grid.
+    EXPECT_LT(quantization[1].scale.x, quantization[0].scale.x * 0.01f);
+
+    for (size_t s = 0; s < 2; s++)
+    {
+        std::vector<MeshVertex> decoded(500);
+        DecodeVertices(packed.data() + s * 500, 500, quantization[s], decoded.data());
+        glm::vec3 bound = glm::vec3(quantization[s].scale) / 65535.0f;
+        for (size_t i = 0; i < 500; i++)
+        {
+            glm::vec3 error = glm::abs(decoded[i].position - vertices[s * 500 + i].position);
+            ASSERT_TRUE(glm::all(glm::lessThanEqual(error, bound))) << s << " " << i;
+        }
+    }
+}
+
+TEST(VertexFormat, SplitVerticesBySubMesh)
+{
+    std::vector<MeshVertex> vertices = RandomVertices(4, 6);
+    std::vector<uint32_t>   indices  = { 0, 1, 2, 2, 1, 3 };
+
+    std::vector<MeshSubMesh> submeshes(2);
+    submeshes[0].index_offset = 0;
+    submeshes[0].index_count  = 3;
+    submeshes[1].index_offset = 3;
+    submeshes[1].index_count  = 3;
+
+    std::vector<MeshVertex> original = vertices;
+    EXPECT_EQ(SplitVerticesBySubMesh(vertices, indices, submeshes), 2u);
+    ASSERT_EQ(vertices.size(), 6u);
+    EXPECT_EQ(submeshes[1].vertex_offset, 3u);
+    EXPECT_EQ(submeshes[1].vertex_count, 3u);
+    EXPECT_EQ(indices, (std::vector<uint32_t>{ 0, 1, 2, 3, 4, 5 }));
+    EXPECT_EQ(vertices[3], original[2]);
+    EXPECT_EQ(vertices[4], original[1]);
+    EXPECT_EQ(vertices[5], original[3]);
+}